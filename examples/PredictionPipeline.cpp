@@ -0,0 +1,287 @@
+#include "PredictionPipeline.h"
+
+#include <cstdlib>
+#include <cstring>
+
+/**
+ * Next chunk of rows of the matrix
+ */
+bool MatrixLocationSource::next(mat& Xchunk, int maxRows)
+{
+    if (position >= X.rows()) return false;
+    
+    int end = min(position + maxRows, X.rows()) - 1;
+    Xchunk = X.get_rows(position, end);
+    position = end + 1;
+    
+    return true;
+}
+
+
+/**
+ * Next chunk of grid locations
+ */
+bool GridLocationSource::next(mat& Xchunk, int maxRows)
+{
+    long n2 = X2.length();
+    long size = X1.length() * n2;
+    if (position >= size) return false;
+    
+    int n = (int) min((long) maxRows, size - position);
+    Xchunk.set_size(n, 2);
+    for (int k=0; k<n; k++, position++)
+    {
+        Xchunk(k,0) = X1(position / n2);
+        Xchunk(k,1) = X2(position % n2);
+    }
+    
+    return true;
+}
+
+
+/**
+ * Constructor - opens the file
+ */
+CsvLocationSource::CsvLocationSource(const string filename, const vec& Xmean, const vec& Xcovdiag)
+: fin(filename.c_str(), ios::in), Xmean(Xmean), Xcovdiag(Xcovdiag), line(0), failed(false)
+{
+    if (!fin.is_open()) {
+        cerr << "Error opening file '" << filename << "'" << endl;
+        failed = true;
+    }
+}
+
+
+/**
+ * Read the next (at most) maxRows lines of the file
+ */
+bool CsvLocationSource::next(mat& Xchunk, int maxRows)
+{
+    if (failed) return false;
+    
+    Xchunk.set_size(maxRows, 2);
+    int n = 0;
+    string s;
+    
+    while (n < maxRows && getline(fin, s))
+    {
+        line++;
+        if (s.find_first_not_of(" \t\r") == string::npos) continue;   // Empty line
+        
+        // Location is in the first 2 columns
+        const char *p = s.c_str();
+        char *end;
+        double x1 = strtod(p, &end);
+        if (end == p || (p = strchr(end, ',')) == NULL) {
+            cerr << "Error reading location at line " << line << endl;
+            failed = true;
+            return false;
+        }
+        double x2 = strtod(p+1, &end);
+        if (end == p+1) {
+            cerr << "Error reading location at line " << line << endl;
+            failed = true;
+            return false;
+        }
+        
+        if (Xmean.length() > 0) {
+            x1 = (x1 - Xmean(0)) / sqrt(Xcovdiag(0));
+            x2 = (x2 - Xmean(1)) / sqrt(Xcovdiag(1));
+        }
+        
+        Xchunk(n,0) = x1;
+        Xchunk(n,1) = x2;
+        n++;
+    }
+    
+    if (n == 0) return false;
+    if (n < maxRows) Xchunk.set_size(n, 2, true);
+    
+    return true;
+}
+
+
+/**
+ * Constructor
+ * 
+ * @param psgp       trained PSGP
+ * @param cf         covariance function used for prediction
+ * @param chunkSize  number of locations per chunk
+ * @param nWorkers   number of prediction threads
+ * @param maxChunks  maximum number of chunks in the pipeline (at least nWorkers)
+ */
+PredictionPipeline::PredictionPipeline(const PSGP& psgp, CovarianceFunction& cf, int chunkSize, 
+                                       int nWorkers, int maxChunks)
+: psgp(psgp), cf(cf), chunkSize(chunkSize), nWorkers(nWorkers), maxChunks(maxChunks)
+{
+    assert(chunkSize > 0 && nWorkers > 0 && maxChunks >= nWorkers);
+    
+    pthread_mutex_init(&mutex, NULL);
+    pthread_cond_init(&changed, NULL);
+}
+
+
+/**
+ * Destructor
+ */
+PredictionPipeline::~PredictionPipeline()
+{
+    pthread_mutex_destroy(&mutex);
+    pthread_cond_destroy(&changed);
+}
+
+
+/**
+ * Set the normalisation parameters of the locations (see 
+ * itppext::normalise). Locations are written in the original space.
+ */
+void PredictionPipeline::setDenormalisation(const vec& _Xmean, const vec& _Xcovdiag)
+{
+    Xmean = _Xmean;
+    Xcovdiag = _Xcovdiag;
+}
+
+
+/**
+ * Predict at all locations of source and write the results to filename 
+ * (same format as csvstream::write)
+ * 
+ * Returns true if an error occurred, false otherwise.
+ */
+bool PredictionPipeline::run(LocationSource& source, const string filename, int decimals)
+{
+    fout.open(filename.c_str(), ios::out);
+    if (!fout.is_open()) {
+        cerr << "Error opening file " << filename << " for writing." << endl;
+        return true;
+    }
+    fout.precision(decimals);
+    fout.setf(ios::fixed,ios::floatfield);
+    
+    nRead = 0;
+    nWritten = 0;
+    sourceDone = false;
+    
+    pthread_t writerThread;
+    vector<pthread_t> workerThreads(nWorkers);
+    pthread_create(&writerThread, NULL, PredictionPipeline::writer, this);
+    for (int i=0; i<nWorkers; i++) {
+        pthread_create(&workerThreads[i], NULL, PredictionPipeline::worker, this);
+    }
+    
+    // Read chunks, waiting for the writer when the pipeline is full
+    while (true)
+    {
+        pthread_mutex_lock(&mutex);
+        while (nRead - nWritten >= maxChunks) pthread_cond_wait(&changed, &mutex);
+        pthread_mutex_unlock(&mutex);
+        
+        Chunk* chunk = new Chunk;
+        if (!source.next(chunk->X, chunkSize)) {
+            delete chunk;
+            break;
+        }
+        
+        pthread_mutex_lock(&mutex);
+        chunk->index = nRead++;
+        toPredict.push_back(chunk);
+        pthread_cond_broadcast(&changed);
+        pthread_mutex_unlock(&mutex);
+    }
+    
+    pthread_mutex_lock(&mutex);
+    sourceDone = true;
+    pthread_cond_broadcast(&changed);
+    pthread_mutex_unlock(&mutex);
+    
+    for (int i=0; i<nWorkers; i++) pthread_join(workerThreads[i], NULL);
+    pthread_join(writerThread, NULL);
+    
+    bool writeError = !fout.good();
+    fout.close();
+    
+    if (writeError) {
+        cerr << "Error writing predictions to " << filename << endl;
+    }
+    
+    return writeError || source.error();
+}
+
+
+/**
+ * Worker thread: predict at the chunks in the queue
+ */
+void* PredictionPipeline::worker(void* arg)
+{
+    PredictionPipeline* pipeline = (PredictionPipeline*) arg;
+    
+    while (true)
+    {
+        pthread_mutex_lock(&pipeline->mutex);
+        while (pipeline->toPredict.empty() && !pipeline->sourceDone) {
+            pthread_cond_wait(&pipeline->changed, &pipeline->mutex);
+        }
+        if (pipeline->toPredict.empty()) {
+            pthread_mutex_unlock(&pipeline->mutex);
+            break;
+        }
+        Chunk* chunk = pipeline->toPredict.front();
+        pipeline->toPredict.pop_front();
+        pthread_mutex_unlock(&pipeline->mutex);
+        
+        chunk->mean.set_size(chunk->X.rows());
+        chunk->var.set_size(chunk->X.rows());
+        pipeline->psgp.makePredictions(chunk->mean, chunk->var, chunk->X, pipeline->cf);
+        
+        pthread_mutex_lock(&pipeline->mutex);
+        pipeline->predicted[chunk->index] = chunk;
+        pthread_cond_broadcast(&pipeline->changed);
+        pthread_mutex_unlock(&pipeline->mutex);
+    }
+    
+    return NULL;
+}
+
+
+/**
+ * Writer thread: write the predicted chunks in order
+ */
+void* PredictionPipeline::writer(void* arg)
+{
+    PredictionPipeline* pipeline = (PredictionPipeline*) arg;
+    ofstream& fout = pipeline->fout;
+    
+    while (true)
+    {
+        pthread_mutex_lock(&pipeline->mutex);
+        map<long, Chunk*>::iterator next;
+        while ((next = pipeline->predicted.find(pipeline->nWritten)) == pipeline->predicted.end()
+               && !(pipeline->sourceDone && pipeline->nWritten == pipeline->nRead)) {
+            pthread_cond_wait(&pipeline->changed, &pipeline->mutex);
+        }
+        if (next == pipeline->predicted.end()) {
+            pthread_mutex_unlock(&pipeline->mutex);
+            break;
+        }
+        Chunk* chunk = next->second;
+        pipeline->predicted.erase(next);
+        pthread_mutex_unlock(&pipeline->mutex);
+        
+        if (pipeline->Xmean.length() > 0) {
+            itppext::denormalise(chunk->X, pipeline->Xmean, pipeline->Xcovdiag);
+        }
+        
+        for (int i=0; i<chunk->X.rows(); i++) {
+            fout << chunk->X(i,0) << ", " << chunk->X(i,1) << ", " 
+                 << chunk->mean(i) << ", " << chunk->var(i) << "\r\n";
+        }
+        delete chunk;
+        
+        pthread_mutex_lock(&pipeline->mutex);
+        pipeline->nWritten++;
+        pthread_cond_broadcast(&pipeline->changed);
+        pthread_mutex_unlock(&pipeline->mutex);
+    }
+    
+    return NULL;
+}
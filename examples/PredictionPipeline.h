@@ -0,0 +1,144 @@
+#ifndef PREDICTIONPIPELINE_H_
+#define PREDICTIONPIPELINE_H_
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <deque>
+#include <map>
+#include <vector>
+
+#include <pthread.h>
+
+#include "itpp/itbase.h"
+
+#include "itppext/itppext.h"
+
+#include "gaussian_processes/PSGP.h"
+#include "covariance_functions/CovarianceFunction.h"
+
+using namespace std;
+using namespace itpp;
+
+/**
+ * Source of prediction locations, read chunk by chunk. Locations are 
+ * returned in the input space of the model (i.e. normalised if the model
+ * was trained on normalised data).
+ */
+class LocationSource
+{
+public:
+    virtual ~LocationSource() {}
+    
+    // Next chunk of at most maxRows locations - returns false when no 
+    // locations are left
+    virtual bool next(mat& X, int maxRows) = 0;
+    
+    // Was there an error reading the locations?
+    virtual bool error() const { return false; }
+};
+
+/**
+ * Locations stored in a matrix
+ */
+class MatrixLocationSource : public LocationSource
+{
+public:
+    MatrixLocationSource(const mat& X) : X(X), position(0) {}
+    bool next(mat& Xchunk, int maxRows);
+    
+private:
+    const mat& X;
+    int position;
+};
+
+/**
+ * Locations on a regular grid, generated on demand. Location i*n2+j is 
+ * (X1(i), X2(j)), where n2 is the length of X2.
+ */
+class GridLocationSource : public LocationSource
+{
+public:
+    GridLocationSource(const vec& X1, const vec& X2) : X1(X1), X2(X2), position(0) {}
+    bool next(mat& Xchunk, int maxRows);
+    
+private:
+    vec X1, X2;
+    long position;
+};
+
+/**
+ * Locations read from a CSV file with 2 columns, one line at a time. If 
+ * Xmean and Xcovdiag are not empty, the locations are normalised with them
+ * (see itppext::normalise).
+ */
+class CsvLocationSource : public LocationSource
+{
+public:
+    CsvLocationSource(const string filename, const vec& Xmean, const vec& Xcovdiag);
+    bool next(mat& Xchunk, int maxRows);
+    bool error() const { return failed; }
+    
+private:
+    ifstream fin;
+    vec Xmean, Xcovdiag;
+    long line;
+    bool failed;
+};
+
+
+/**
+ * Pipelined prediction: the calling thread reads chunks of locations from 
+ * a LocationSource, a pool of worker threads makes the predictions, and a
+ * writer thread appends the results to a CSV file (location, mean, 
+ * variance, in the order of the source) as soon as the next chunk in order
+ * is available. The number of chunks between the reader and the writer is
+ * bounded, so the memory used does not depend on the number of locations.
+ * 
+ * The predictions use the const PSGP::makePredictions, which only needs
+ * the cross-covariance and diagonal of cf, so the workers share psgp and cf.
+ */
+class PredictionPipeline
+{
+public:
+    PredictionPipeline(const PSGP& psgp, CovarianceFunction& cf, int chunkSize, int nWorkers, 
+                       int maxChunks);
+    virtual ~PredictionPipeline();
+    
+    // Locations are denormalised with Xmean and Xcovdiag before being written
+    void setDenormalisation(const vec& Xmean, const vec& Xcovdiag);
+    
+    // Returns true if an error occurred, false otherwise
+    bool run(LocationSource& source, const string filename, int decimals = 5);
+    
+private:
+    struct Chunk
+    {
+        long index;
+        mat  X;
+        vec  mean, var;
+    };
+    
+    static void* worker(void* pipeline);
+    static void* writer(void* pipeline);
+    
+    const PSGP& psgp;
+    CovarianceFunction& cf;
+    int chunkSize;
+    int nWorkers;
+    int maxChunks;                  // Maximum number of chunks read but not written
+    vec Xmean, Xcovdiag;
+    
+    ofstream fout;
+    
+    deque<Chunk*>      toPredict;   // Chunks waiting for a worker
+    map<long, Chunk*>  predicted;   // Chunks waiting for the writer
+    long nRead;                     // Number of chunks read
+    long nWritten;                  // Number of chunks written
+    bool sourceDone;
+    
+    pthread_mutex_t mutex;
+    pthread_cond_t  changed;
+};
+
+#endif /*PREDICTIONPIPELINE_H_*/
@@ -7,6 +7,7 @@ SpatialExample::SpatialExample()
 
 SpatialExample::~SpatialExample()
 {
+    delete psgp;
 }
 
 void SpatialExample::setDefaults()
@@ -24,11 +25,14 @@ void SpatialExample::setDefaults()
     n_sweeps = 4;             // Number of sweeps through data (PSGP)
     n_outer_loops = 5;        // Number of outer loops (PSGP parameters estimation)
     
-    predictionType = PREDICTION_CHUNKS;  // Split prediction domain by default
-    predictionChunkSize = 1000;          // Default size for prediction chunks
+    predictionType = PREDICTION_CHUNKS;     // Split prediction domain by default
+    predictionChunkSize = 1000;             // Default size for prediction chunks
+    predictionWorkers = max(1, (int) sysconf(_SC_NPROCESSORS_ONLN));
     normaliseData = false;
     
     covariances = Vec<CovarianceFunction*>(NUM_COVARIANCE_FUNCTIONS);
+    
+    psgp = NULL;                         // No trained PSGP yet
 }
 
 
@@ -99,6 +103,37 @@ void SpatialExample::setPredictionLocations(mat _Xpred)
 }
 
 
+/**
+ * Read the prediction locations from a CSV file (2 columns) instead. The 
+ * file is read chunk by chunk in the prediction pipeline, so it can be 
+ * larger than the available memory.
+ */
+void SpatialExample::setPredictionLocationsFile(string filename) 
+{
+    predictionLocationsFile = filename;
+}
+
+
+/**
+ * Set the file the predictions are written to. The prediction pipeline 
+ * writes the results as they are computed.
+ */
+void SpatialExample::setPredictionFilename(string filename) 
+{
+    predFilename = filename;
+}
+
+
+/**
+ * Set the number of prediction threads in the prediction pipeline
+ */
+void SpatialExample::setNumberPredictionWorkers(int value) 
+{
+    assert(value > 0);
+    predictionWorkers = value;
+}
+
+
 /**
  * 
  */
@@ -111,6 +146,10 @@ void SpatialExample::setParameterEstimationMethod(ParameterEstimationMethod meth
  * Set prediction type: 
  *   PREDICTION_FULL: single prediction at all locations
  *   PREDICTION_CHUNKS: sequential prediction at subsets of locations  
+ *   PREDICTION_PIPELINE: parallel prediction at subsets of locations, 
+ *                        streamed to the prediction file (opt-in: the
+ *                        prediction file must be set, and the predictions
+ *                        are not kept in ypred/vpred)
  */
 void SpatialExample::setPredictionType(PredictionType type) 
 {
@@ -251,7 +290,8 @@ bool SpatialExample::initCovarianceFunction()
  * Learn PSGP parameters
  * 
  * 4 methods are provided:
- * - Use a GP to estimate the parameters (learnParametersGP)
+ * - Use a GP to estimate the parameters (learnParametersGP), or its
+ *   iterative version for large datasets (learnParametersIterativeGP)
  * - Use the PSGP to estimate the parameters (learnParametersPSGP)
  * - Use a custom parameter estimation method (learnParametersCustom)
  * - Do not optimise parameters
@@ -278,6 +318,19 @@ bool SpatialExample::learnParameters()
         covFunc->displayCovarianceParameters();
         return learnParametersPSGP();
         
+    case PARAM_ESTIM_ITERATIVE_GP:
+        // Estimate parameters using GP with iterative solvers
+        cout << "Parameter estimation using full GP (iterative solvers)" << endl;
+        return learnParametersIterativeGP();
+    
+    case PARAM_ESTIM_ITERATIVE_GP_PSGP:
+        // As PARAM_ESTIM_GP_PSGP, for datasets too large for the 
+        // dense GP
+        cout << "Parameter estimation using GP with iterative solvers (first guess) then PSGP" << endl;
+        learnParametersIterativeGP();
+        covFunc->displayCovarianceParameters();
+        return learnParametersPSGP();
+        
     case PARAM_ESTIM_CUSTOM:
         // Estimate parameters using custom method
         // Requires overloading of learnParametersCustom()
@@ -311,6 +364,25 @@ bool SpatialExample::learnParametersGP()
     return false;
 }
 
+/**
+ * Use an exact GP with iterative solvers (conjugate gradients and 
+ * stochastic log-determinant) to estimate parameters. The gradient is 
+ * itself a stochastic estimate, so it is not checked against finite 
+ * differences.
+ */
+bool SpatialExample::learnParametersIterativeGP()
+{
+    IterativeGaussianProcess gp(2, 1, X, y, *covFunc);
+
+    SCGModelTrainer gpTrainer(gp);
+
+    gpTrainer.setAnalyticGradients(true);
+    gpTrainer.setCheckGradient(false);
+    gpTrainer.Train(n_optim_iterations*5);
+    
+    return false;
+}
+
 /**
  * Use the PSGP to estimate parameters
  * 
@@ -328,31 +400,33 @@ bool SpatialExample::learnParametersPSGP()
     n_active = min(n_active, X.rows()); // Do not exceed number of obs.
         
     // SequentialGP psgp(2, 1, n_active, X, y, *covFunc, n_sweeps);
-    PSGP psgp(X, y, *covFunc, n_active, 1, n_sweeps);
+    delete psgp;
+    psgp = new PSGP(X, y, *covFunc, n_active, 1, n_sweeps);
         
     cout << "  Compute posterior" << endl;
     if (observedNoise) {
         // TODO: likelihood model for case with observation error
-        // psgp.computePosterior(*likFunctionVector);
+        // psgp->computePosterior(*likFunctionVector);
     }
     else {
-        psgp.computePosterior(*likFunction);    
+        psgp->computePosterior(*likFunction);    
     }
-    cout << "  " << psgp.getSizeActiveSet() << " active points needed." << endl;
+    cout << "  " << psgp->getSizeActiveSet() << " active points needed." << endl;
     
-    SCGModelTrainer gpTrainer(psgp);
-    psgp.setLikelihoodType(Approximate);
+    SCGModelTrainer gpTrainer(*psgp);
+    psgp->setLikelihoodType(Approximate);
 
     gpTrainer.setAnalyticGradients(true);
     gpTrainer.setCheckGradient(false);
 
+    // Alternate parameter optimisation and posterior update. The posterior
+    // is refreshed from the current active set and EP parameters rather 
+    // than recomputed from scratch.
     for (int i=0; i<n_outer_loops; i++) 
     {
         cout << endl << endl << "-- " << i+1 << "/" << n_outer_loops << endl;
         gpTrainer.Train(n_optim_iterations);
-        psgp.resetPosterior();
-        psgp.computePosterior(*likFunction);
-        // psgp.recomputePosterior();
+        psgp->refreshPosterior(*likFunction);
     }
 
     return false;
@@ -383,35 +457,48 @@ void SpatialExample::displayCurrentOptions()
 bool SpatialExample::makePredictions()
 {
     // If no prediction locations have been provided,
-    // default to uniform grid on observed area.
-    if (!isSetPredictionLocations) uniformGrid(X, Xpred);
+    // default to uniform grid on observed area. The pipeline
+    // generates the grid (and writes the predictions) chunk by chunk.
+    if (predictionType != PREDICTION_PIPELINE)
+    {
+        if (!isSetPredictionLocations) uniformGrid(X, Xpred);
         
-    // Reinitialise predictive mean and variance
-    ypred = zeros(Xpred.rows());
-    vpred = zeros(Xpred.rows());
+        // Reinitialise predictive mean and variance
+        ypred = zeros(Xpred.rows());
+        vpred = zeros(Xpred.rows());
+    }
     
-    // Gaussian Likelihood function
-    // TODO: Make this generic so can be set to something else
-    likFunction = new GaussianLikelihood(nugget);
+    // Reuse the PSGP trained during parameter estimation if there is one: its
+    // posterior is up to date with the current covariance parameters.
+    if (psgp == NULL)
+    {
+        // Gaussian Likelihood function
+        // TODO: Make this generic so can be set to something else
+        likFunction = new GaussianLikelihood(nugget);
     
-    // PSGP for prediction
-    n_active = min(n_active, X.rows()); // Do not exceed number of obs.
+        // PSGP for prediction
+        n_active = min(n_active, X.rows()); // Do not exceed number of obs.
     
-    // SequentialGP psgp(2, 1, n_active, X, y, *covFunc, n_sweeps);
-    PSGP psgp(X, y, *covFunc, n_active, 1, n_sweeps);
+        // SequentialGP psgp(2, 1, n_active, X, y, *covFunc, n_sweeps);
+        psgp = new PSGP(X, y, *covFunc, n_active, 1, n_sweeps);
     
-    cout << "  Compute posterior" << endl;
-    psgp.computePosterior(*likFunction);
+        cout << "  Compute posterior" << endl;
+        psgp->computePosterior(*likFunction);
+    }
     
     bool predictionError = false;
     
     switch (predictionType) {
     case PREDICTION_FULL:
-        predictionError = makePredictionsFull(psgp);
+        predictionError = makePredictionsFull(*psgp);
         break;
         
     case PREDICTION_CHUNKS:
-        predictionError = makePredictionsChunks(psgp);
+        predictionError = makePredictionsChunks(*psgp);
+        break;
+        
+    case PREDICTION_PIPELINE:
+        predictionError = makePredictionsPipeline(*psgp);
         break;
         
     default: 
@@ -495,6 +582,48 @@ bool SpatialExample::makePredictionsChunks(PSGP &psgp)
     return false;
 }
 
+/**
+ * Pipelined prediction - chunks of locations are read (from the prediction
+ * locations file, the prediction locations or a uniform grid on the 
+ * observed area), predicted by a pool of threads and written in order to
+ * the prediction file as they become available. Only a bounded number of
+ * chunks is held in memory.
+ */
+bool SpatialExample::makePredictionsPipeline(PSGP &psgp) 
+{
+    if (predFilename.empty()) {
+        cerr << "No prediction file set for pipelined prediction." << endl;
+        return true;
+    }
+    
+    PredictionPipeline pipeline(psgp, *kernelCF, predictionChunkSize, predictionWorkers, 
+                                2*predictionWorkers);
+    if (normaliseData) pipeline.setDenormalisation(Xmean, Xcovdiag);
+    
+    LocationSource *source;
+    if (!predictionLocationsFile.empty()) {
+        vec noNormalisation;
+        source = new CsvLocationSource(predictionLocationsFile, 
+                                       normaliseData ? Xmean : noNormalisation,
+                                       normaliseData ? Xcovdiag : noNormalisation);
+    }
+    else if (isSetPredictionLocations) {
+        source = new MatrixLocationSource(Xpred);
+    }
+    else {
+        vec X1, X2;
+        uniformGridAxes(X, X1, X2);
+        source = new GridLocationSource(X1, X2);
+    }
+    
+    cout << "  Predicting with " << predictionWorkers << " threads, writing to " 
+         << predFilename << endl;
+    bool error = pipeline.run(*source, predFilename);
+    
+    delete source;
+    return error;
+}
+
 /**
  * Given a set of locations X, determine a rectangle uniform grid covering
  * all locations in X and having resolution equal to the minimum distance
@@ -503,6 +632,32 @@ bool SpatialExample::makePredictionsChunks(PSGP &psgp)
  * If the resolution is 0 or ranges are empty, the empty matrix is returned.
  */
 void SpatialExample::uniformGrid(mat X, mat &grid)
+{
+    vec X1, X2;
+    uniformGridAxes(X, X1, X2);
+    
+    // Make sure ranges are not empty
+    if (X1.length() == 0 || X2.length() == 0) {
+        cerr << "Error computing uniform grid: empty range" << endl;
+        grid = mat(0,0);
+    }
+    
+    // Compute grid locations
+    grid = zeros(X1.length()*X2.length(),2);
+    for (int i=0; i<X1.length(); i++) {
+        for (int j=0; j<X2.length(); j++) {
+            grid(i*X2.length()+j,0) = X1(i);
+            grid(i*X2.length()+j,1) = X2(j);
+        }
+    }
+   
+}
+
+/**
+ * Coordinates of the uniform grid above along each axis (the grid 
+ * location i*X2.length()+j is (X1(i), X2(j)))
+ */
+void SpatialExample::uniformGridAxes(mat X, vec& X1, vec& X2)
 {
     // Determine max resolution (min distance between any 2 observations)
     double minDist2 = pow(X(0,0)-X(1,0),2) + pow(X(0,1)-X(1,1),2);
@@ -538,32 +693,18 @@ void SpatialExample::uniformGrid(mat X, mat &grid)
     if (0.5*res == res || abs(res) != res)
     {
         cerr << "Error computing uniform grid: resolution below machine precision" << endl;
-        grid = mat(0,0);
+        X1.set_size(0);
+        X2.set_size(0);
+        return;
     }
     
     int grid_size_x1 = min( MAX_PRED_GRID_SIZE_X, (int) ((x1max-x1min)/res) );
     int grid_size_x2 = min( MAX_PRED_GRID_SIZE_Y, (int) ((x2max-x2min)/res) );
     
-    vec X1 = linspace(x1min, x1max, grid_size_x1 );
-    vec X2 = linspace(x2min, x2max, grid_size_x2 );
+    X1 = linspace(x1min, x1max, grid_size_x1 );
+    X2 = linspace(x2min, x2max, grid_size_x2 );
             
     cout << "  Grid size: " << X1.length() << "x" << X2.length() << "x" << res << endl;
-    
-    // Make sure ranges are not empty
-    if (X1.length() == 0 || X2.length() == 0) {
-        cerr << "Error computing uniform grid: empty range" << endl;
-        grid = mat(0,0);
-    }
-    
-    // Compute grid locations
-    grid = zeros(X1.length()*X2.length(),2);
-    for (int i=0; i<X1.length(); i++) {
-        for (int j=0; j<X2.length(); j++) {
-            grid(i*X2.length()+j,0) = X1(i);
-            grid(i*X2.length()+j,1) = X2(j);
-        }
-    }
-   
 }
 
 
@@ -573,6 +714,15 @@ void SpatialExample::uniformGrid(mat X, mat &grid)
  */
 bool SpatialExample::saveResults(string filename)
 {
+    // The prediction pipeline has already written the results
+    if (predictionType == PREDICTION_PIPELINE) {
+        if (filename != predFilename) {
+            cerr << "Predictions were written to " << predFilename << ", not " << filename << endl;
+            return true;
+        }
+        return false;
+    }
+    
     csvstream csv;
     mat M(Xpred);               // Predictive locations
     
@@ -599,6 +749,9 @@ bool SpatialExample::saveResults(string filename)
  */
 void SpatialExample::run(string datafile, string predfile)
 {
+    dataFilename = datafile;
+    predFilename = predfile;
+    
     // Load data file
     cout << "Loading data file " << datafile << endl;
     loadData(datafile);
@@ -631,6 +784,10 @@ int main(int argc, char* argv[])
     SpatialExample ex;
     
     switch (argc) {
+    case 4:
+        ex.setPredictionLocationsFile(argv[3]);
+        // Fall through
+        
     case 3: 
         {
             ex.setParameterEstimationMethod(PARAM_ESTIM_PSGP);
@@ -647,7 +804,7 @@ int main(int argc, char* argv[])
     
     default:
         cerr << "Usage: " << endl;
-        cerr << "  demoName datafile predfile" << endl;
+        cerr << "  demoName datafile predfile [locationsfile]" << endl;
         return 1;
     }
     
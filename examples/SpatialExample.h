@@ -4,6 +4,8 @@
 #include <iostream>
 #include <string>
 
+#include <unistd.h>
+
 #include "itpp/itbase.h"
 
 #include "itppext/itppext.h"
@@ -11,10 +13,13 @@
 
 #include "gaussian_processes/PSGP.h"
 #include "gaussian_processes/GaussianProcess.h"
+#include "gaussian_processes/IterativeGaussianProcess.h"
 #include "optimisation/SCGModelTrainer.h"
 
 #include "likelihood_models/GaussianLikelihood.h"
 
+#include "PredictionPipeline.h"
+
 #include "covariance_functions/GaussianCF.h"
 #include "covariance_functions/ExponentialCF.h"
 #include "covariance_functions/Matern3CF.h"
@@ -32,9 +37,10 @@ using namespace std;
 using namespace itpp;
 
 enum ParameterEstimationMethod { PARAM_ESTIM_GP, PARAM_ESTIM_PSGP, PARAM_ESTIM_GP_PSGP,
+                                 PARAM_ESTIM_ITERATIVE_GP, PARAM_ESTIM_ITERATIVE_GP_PSGP,
                                  PARAM_ESTIM_NO_ESTIMATION, PARAM_ESTIM_CUSTOM };
 
-enum PredictionType { PREDICTION_FULL, PREDICTION_CHUNKS };
+enum PredictionType { PREDICTION_FULL, PREDICTION_CHUNKS, PREDICTION_PIPELINE };
 
 class SpatialExample
 {
@@ -67,6 +73,9 @@ public:
 	// PREDICTION
     void setPredictionType(PredictionType type);
 	void setPredictionLocations(mat Xpred);
+	void setPredictionLocationsFile(string filename);
+	void setPredictionFilename(string filename);
+	void setNumberPredictionWorkers(int value);
 	bool makePredictions();
 	
 	// CURRENT OPTIONS
@@ -100,6 +109,9 @@ protected:
     // LIKELIHOOD FUNCTION
     LikelihoodType *likFunction;
     
+    // PSGP trained during parameter estimation (reused for prediction)
+    PSGP *psgp;
+    
     string dataFilename;        // Name of data file (to read from)
     string predFilename;        // Name of prediction file (to write to)
     
@@ -112,12 +124,14 @@ protected:
     bool postProcess();         // This is a template method - for overriding
     
     void uniformGrid(mat X, mat& grid);
+    void uniformGridAxes(mat X, vec& X1, vec& X2);
     
     // PARAMETER ESTIMATION
     ParameterEstimationMethod paramEstimationMethod;
     int  n_optim_iterations;    // Number of iteration in parameter estimation
     int  n_outer_loops;         // Number of outer loops in optimisation of PSGP
     bool learnParametersGP();
+    bool learnParametersIterativeGP();
     bool learnParametersPSGP();
     bool learnParametersCustom();
     
@@ -125,8 +139,11 @@ protected:
     PredictionType predictionType;   // Whether we predict at all locations at once or split
                                      // the domain into chunks first
     long predictionChunkSize;        // Size of prediction chunks (number of locations)
+    int  predictionWorkers;          // Number of prediction threads (pipeline)
+    string predictionLocationsFile;  // CSV file of prediction locations (pipeline, optional)
     bool makePredictionsFull(PSGP &psgp);
     bool makePredictionsChunks(PSGP &psgp);
+    bool makePredictionsPipeline(PSGP &psgp);
     
 };
 
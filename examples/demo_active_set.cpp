@@ -91,9 +91,19 @@ int main(void)
             // scg.setCheckGradient(true);         // Check the gradients
             scg.Train(5);
 
-            // Recompute the posterior (including selection of active points)
-            psgp.resetPosterior();
-            psgp.computePosterior(gaussLik);
+            if (j == 0) 
+            {
+                // The size of the active set has changed: recompute the posterior 
+                // (including selection of active points)
+                psgp.resetPosterior();
+                psgp.computePosterior(gaussLik);
+            }
+            else
+            {
+                // Update the posterior for the new parameters, keeping the 
+                // current active set
+                psgp.refreshPosterior(gaussLik);
+            }
         }
 
                 
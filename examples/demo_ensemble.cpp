@@ -0,0 +1,127 @@
+/**
+ * This program compares a single PSGP with an ensemble of local PSGP 
+ * experts (PSGPEnsemble) on a 2D data set whose length scale changes 
+ * across the domain. Both learn their covariance parameters (the experts
+ * each learn their own, in parallel with OpenMP), with the same total 
+ * number of active points. The training time, prediction time and RMSE 
+ * of the predictive mean against the latent function are reported.
+ * 
+ * Usage:
+ *   demo_ensemble [nObs] [nExperts]
+ **/
+
+#include "demo_ensemble.h"
+
+#define N_OBS       4000
+#define N_EXPERTS   8
+#define N_ACTIVE    400       // Total number of active points
+#define N_GRID      100       // Prediction grid is N_GRID x N_GRID
+#define DOMAIN      10.0      // Domain is [0, DOMAIN]^2
+#define NUGGET      0.01
+
+int main(int argc, char* argv[])
+{
+    int nObs = (argc > 1) ? atoi(argv[1]) : N_OBS;
+    int nExperts = (argc > 2) ? atoi(argv[2]) : N_EXPERTS;
+    
+    RNG_reset(0);
+    
+    mat X;
+    vec Y;
+    generateData(X, Y, nObs);
+    
+    mat Xgrid(N_GRID * N_GRID, 2);
+    vec Ygrid(N_GRID * N_GRID);
+    for (int i=0; i<N_GRID; i++) 
+    {
+        for (int j=0; j<N_GRID; j++)
+        {
+            int k = i + N_GRID * j;
+            Xgrid(k, 0) = DOMAIN * i / (N_GRID - 1);
+            Xgrid(k, 1) = DOMAIN * j / (N_GRID - 1);
+            Ygrid(k) = latent(Xgrid(k, 0), Xgrid(k, 1));
+        }
+    }
+    
+    GaussianLikelihood noise(NUGGET);
+    vec mean(Xgrid.rows()), var(Xgrid.rows());
+    
+    cout << nObs << " observations, " << N_GRID << "x" << N_GRID << " prediction grid" << endl;
+    cout << setw(24) << "model" << setw(12) << "train (s)" << setw(14) << "predict (s)" 
+         << setw(12) << "RMSE" << endl;
+    
+    //-------------------------------------------------------------------------
+    // Single PSGP
+    GaussianCF cf(1.0, 1.0);
+    PSGP psgp(X, Y, cf, N_ACTIVE);
+    psgp.setVerbose(false);
+    
+    double t0 = wallTime();
+    psgp.computePosterior(noise);
+    SCGModelTrainer trainer(psgp);
+    trainer.setAnalyticGradients(true);
+    trainer.setCheckGradient(false);
+    trainer.setDisplay(false);
+    for (int i=0; i<2; i++)
+    {
+        trainer.Train(5);
+        psgp.refreshPosterior(noise);
+    }
+    double t1 = wallTime();
+    psgp.makePredictions(mean, var, Xgrid);
+    double t2 = wallTime();
+    
+    cout << setw(24) << "PSGP" << setw(12) << t1 - t0 << setw(14) << t2 - t1 
+         << setw(12) << rmse(mean, Ygrid) << endl;
+    
+    //-------------------------------------------------------------------------
+    // Ensemble of local experts, each with its own covariance function
+    vector<CovarianceFunction *> cfs;
+    for (int e=0; e<nExperts; e++) cfs.push_back(new GaussianCF(1.0, 1.0));
+    
+    t0 = wallTime();
+    PSGPEnsemble ensemble(X, Y, cfs, N_ACTIVE / nExperts);
+    ensemble.learnParameters(noise, 2, 5);
+    t1 = wallTime();
+    ensemble.makePredictions(mean, var, Xgrid);
+    t2 = wallTime();
+    
+    stringstream name;
+    name << "Ensemble (" << nExperts << " experts)";
+    cout << setw(24) << name.str() << setw(12) << t1 - t0 << setw(14) << t2 - t1 
+         << setw(12) << rmse(mean, Ygrid) << endl;
+    
+    for (int e=0; e<nExperts; e++) delete cfs[e];
+    
+    return 0;
+}
+
+
+double latent(double x0, double x1)
+{
+    // Frequency increases from left to right
+    double f = 0.5 + 0.25 * x0;
+    return sin(f * x0) * cos(0.5 * x1);
+}
+
+
+void generateData(mat& X, vec& Y, int n)
+{
+    X = DOMAIN * randu(n, 2);
+    Y.set_size(n);
+    for (int i=0; i<n; i++) Y(i) = latent(X(i, 0), X(i, 1)) + sqrt(NUGGET) * randn();
+}
+
+
+double wallTime()
+{
+    timeval t;
+    gettimeofday(&t, NULL);
+    return t.tv_sec + 1e-6 * t.tv_usec;
+}
+
+
+double rmse(const vec& mean, const vec& truth)
+{
+    return sqrt(sum_sqr(mean - truth) / mean.length());
+}
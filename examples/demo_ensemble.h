@@ -0,0 +1,44 @@
+#ifndef DEMO_ENSEMBLE_H_
+#define DEMO_ENSEMBLE_H_
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <cstdlib>
+
+#include <sys/time.h>
+
+#include <itpp/itbase.h>
+
+#include "gaussian_processes/PSGP.h"
+#include "gaussian_processes/PSGPEnsemble.h"
+#include "likelihood_models/GaussianLikelihood.h"
+#include "optimisation/SCGModelTrainer.h"
+
+#include "covariance_functions/GaussianCF.h"
+
+using namespace std;
+using namespace itpp;
+
+/**
+ * Latent function of the synthetic data set (smooth on the left of the 
+ * domain, quickly varying on the right)
+ */
+double latent(double x0, double x1);
+
+/**
+ * Generate n noisy observations at random locations in the domain
+ */
+void generateData(mat& X, vec& Y, int n);
+
+/**
+ * Wall clock time in seconds
+ */
+double wallTime();
+
+/**
+ * RMSE of the predictive mean against the latent function
+ */
+double rmse(const vec& mean, const vec& truth);
+
+#endif /*DEMO_ENSEMBLE_H_*/
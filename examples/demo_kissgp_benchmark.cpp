@@ -0,0 +1,178 @@
+/**
+ * This program compares KISS-GP (structured kernel interpolation on a 
+ * regular grid) with PSGP for the interpolation of a large 2D data set on
+ * a regular prediction grid. Both use the same (fixed) covariance function
+ * and noise variance. The active set size of PSGP and the grid size of 
+ * KISS-GP are increased in turn, recording the time to fit, the time to 
+ * predict and the RMSE of the predictive mean against the latent function.
+ * The cheapest configuration of each method reaching the same accuracy 
+ * (within 10% of the best RMSE over all runs) is then reported.
+ * 
+ * Usage:
+ *   demo_kissgp_benchmark [nObs]
+ **/
+
+#include "demo_kissgp_benchmark.h"
+
+#define N_OBS     20000
+#define N_GRID    200         // Prediction grid is N_GRID x N_GRID
+#define DOMAIN    10.0        // Domain is [0, DOMAIN]^2
+#define NUGGET    0.01
+
+// Covariance function shared by both methods
+GaussianCF kernel(1.0, 1.0);
+
+int main(int argc, char* argv[])
+{
+    int nObs = (argc > 1) ? atoi(argv[1]) : N_OBS;
+    
+    mat X;
+    vec Y;
+    generateData(X, Y, nObs);
+    
+    // Regular prediction grid, and the latent function on it
+    mat Xgrid(N_GRID * N_GRID, 2);
+    vec Ygrid(N_GRID * N_GRID);
+    for (int i=0; i<N_GRID; i++) 
+    {
+        for (int j=0; j<N_GRID; j++)
+        {
+            int k = i + N_GRID * j;
+            Xgrid(k, 0) = DOMAIN * i / (N_GRID - 1);
+            Xgrid(k, 1) = DOMAIN * j / (N_GRID - 1);
+            Ygrid(k) = latent(Xgrid(k, 0), Xgrid(k, 1));
+        }
+    }
+    
+    cout << nObs << " observations, " << N_GRID << "x" << N_GRID << " prediction grid" << endl;
+    cout << setw(8) << "method" << setw(8) << "size" << setw(12) << "fit (s)" 
+         << setw(14) << "predict (s)" << setw(12) << "RMSE" << endl;
+    
+    int activeSizes[] = { 50, 100, 200, 400, 800 };
+    int gridSizes[]   = { 20, 40, 80, 160, 320 };
+    int nConfigs = 5;
+    
+    vector<BenchmarkResult> results;
+    for (int c=0; c<nConfigs; c++) results.push_back(runPSGP(X, Y, Xgrid, Ygrid, activeSizes[c]));
+    for (int c=0; c<nConfigs; c++) results.push_back(runKISSGP(X, Y, Xgrid, Ygrid, gridSizes[c]));
+    
+    //-------------------------------------------------------------------------
+    // Cheapest configuration of each method at equal accuracy
+    double bestRmse = results[0].rmse;
+    for (unsigned int r=0; r<results.size(); r++) bestRmse = min(bestRmse, results[r].rmse);
+    double target = 1.1 * bestRmse;
+    
+    cout << endl << "Cheapest configurations with RMSE <= " << target << ":" << endl;
+    
+    string methods[] = { "PSGP", "KISS-GP" };
+    for (int m=0; m<2; m++)
+    {
+        int best = -1;
+        for (unsigned int r=0; r<results.size(); r++)
+        {
+            if (results[r].method != methods[m] || results[r].rmse > target) continue;
+            
+            double time = results[r].fitTime + results[r].predictTime;
+            if (best < 0 || time < results[best].fitTime + results[best].predictTime) best = r;
+        }
+        
+        if (best < 0) 
+        {
+            cout << setw(8) << methods[m] << ": none (increase the sizes)" << endl;
+        }
+        else
+        {
+            cout << setw(8) << methods[m] << ": size " << results[best].size << ", " 
+                 << results[best].fitTime + results[best].predictTime << " s" << endl;
+        }
+    }
+    
+    return 0;
+}
+
+
+double latent(double x0, double x1)
+{
+    return sin(x0) * cos(0.7 * x1) + 0.5 * sin(0.3 * x0 * x1);
+}
+
+
+void generateData(mat& X, vec& Y, int n)
+{
+    RNG_reset(123);
+    
+    X = DOMAIN * randu(n, 2);
+    Y.set_size(n);
+    for (int i=0; i<n; i++) Y(i) = latent(X(i, 0), X(i, 1)) + sqrt(NUGGET) * randn();
+}
+
+
+double wallTime()
+{
+    timeval t;
+    gettimeofday(&t, NULL);
+    return t.tv_sec + 1e-6 * t.tv_usec;
+}
+
+
+/**
+ * PSGP with nActive active points, under a Gaussian likelihood
+ */
+BenchmarkResult runPSGP(mat& X, vec& Y, const mat& Xgrid, const vec& Ygrid, int nActive)
+{
+    BenchmarkResult result;
+    result.method = "PSGP";
+    result.size = nActive;
+    
+    double t0 = wallTime();
+    PSGP psgp(X, Y, kernel, nActive);
+    GaussianLikelihood gaussLik(NUGGET);
+    psgp.computePosterior(gaussLik);
+    
+    double t1 = wallTime();
+    vec mean(Xgrid.rows()), var(Xgrid.rows());
+    psgp.makePredictions(mean, var, Xgrid);
+    
+    double t2 = wallTime();
+    result.fitTime = t1 - t0;
+    result.predictTime = t2 - t1;
+    result.rmse = sqrt(sum_sqr(mean - Ygrid) / Ygrid.size());
+    
+    cout << setw(8) << result.method << setw(8) << result.size << setw(12) << result.fitTime
+         << setw(14) << result.predictTime << setw(12) << result.rmse << endl;
+    return result;
+}
+
+
+/**
+ * KISS-GP on a gridSize x gridSize grid covering the domain. The 
+ * posterior is computed with the first predictions, which are timed 
+ * separately by predicting at a single location first.
+ */
+BenchmarkResult runKISSGP(mat& X, vec& Y, const mat& Xgrid, const vec& Ygrid, int gridSize)
+{
+    BenchmarkResult result;
+    result.method = "KISS-GP";
+    result.size = gridSize;
+    
+    double t0 = wallTime();
+    KISSGP kiss(2, 1, X, Y, kernel, NUGGET, gridSize, gridSize);
+    kiss.setGrid(zeros(2), DOMAIN * ones(2));
+    
+    vec mean(1), var(1);
+    kiss.makePredictions(mean, var, Xgrid.get_rows(0, 0));
+    
+    double t1 = wallTime();
+    mean.set_size(Xgrid.rows());
+    var.set_size(Xgrid.rows());
+    kiss.makePredictions(mean, var, Xgrid);
+    
+    double t2 = wallTime();
+    result.fitTime = t1 - t0;
+    result.predictTime = t2 - t1;
+    result.rmse = sqrt(sum_sqr(mean - Ygrid) / Ygrid.size());
+    
+    cout << setw(8) << result.method << setw(8) << result.size << setw(12) << result.fitTime
+         << setw(14) << result.predictTime << setw(12) << result.rmse << endl;
+    return result;
+}
@@ -0,0 +1,52 @@
+#ifndef DEMO_KISSGP_BENCHMARK_H_
+#define DEMO_KISSGP_BENCHMARK_H_
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <cstdlib>
+
+#include <sys/time.h>
+
+#include <itpp/itbase.h>
+
+#include "gaussian_processes/PSGP.h"
+#include "gaussian_processes/KISSGP.h"
+#include "likelihood_models/GaussianLikelihood.h"
+
+#include "covariance_functions/GaussianCF.h"
+
+using namespace std;
+using namespace itpp;
+
+/**
+ * Timing and accuracy of one configuration of a method
+ */
+struct BenchmarkResult
+{
+    string method;
+    int    size;          // Active set size (PSGP) or grid size per axis (KISS-GP)
+    double fitTime;       // Seconds to compute the posterior
+    double predictTime;   // Seconds to predict on the test grid
+    double rmse;          // RMSE of the predictive mean against the latent function
+};
+
+/**
+ * Latent function of the synthetic data set
+ */
+double latent(double x0, double x1);
+
+/**
+ * Generate n noisy observations at random locations in the domain
+ */
+void generateData(mat& X, vec& Y, int n);
+
+/**
+ * Wall clock time in seconds
+ */
+double wallTime();
+
+BenchmarkResult runPSGP(mat& X, vec& Y, const mat& Xgrid, const vec& Ygrid, int nActive);
+BenchmarkResult runKISSGP(mat& X, vec& Y, const mat& Xgrid, const vec& Ygrid, int gridSize);
+
+#endif /*DEMO_KISSGP_BENCHMARK_H_*/
@@ -0,0 +1,767 @@
+/**
+ * This demonstration program is a reference prediction server for a PSGP
+ * model. Most prediction requests are for a handful of locations, for 
+ * which the cost of a makePredictions call is dominated by per-call 
+ * overheads. The server coalesces concurrent small requests into 
+ * micro-batches, within a latency budget, and makes the predictions for 
+ * each batch in a single call. The model is a PSGPSnapshot read from a 
+ * file, published through a PSGPSnapshotHolder so that it could be 
+ * swapped while serving.
+ * 
+ * The protocol is described in demo_prediction_server.h.
+ * 
+ * Usage:
+ *   demo_prediction_server [nClients [nRequests]]
+ *       trains a model, serves it on a temporary socket and runs the load
+ *       generator against it, without and with request coalescing
+ *   demo_prediction_server train model_file
+ *       trains the demonstration model and writes its snapshot
+ *   demo_prediction_server serve model_file socket [budget_ms [max_batch]]
+ *       serves model_file on a Unix domain socket until interrupted, or on
+ *       stdin/stdout if socket is "-"
+ *   demo_prediction_server load socket nClients nRequests [maxPoints]
+ *       runs the load generator against a server and prints the latencies
+ **/
+
+#include "demo_prediction_server.h"
+
+#include <algorithm>
+#include <cmath>
+
+#define N_OBS    2000
+#define N_ACTIVE 300
+#define NUGGET   0.01
+
+#define LATENCY_BUDGET 0.002    // Default coalescing budget (seconds)
+#define MAX_BATCH      2000     // Default maximum number of points per batch
+#define MAX_POINTS     8        // Default maximum number of points per load request
+#define N_CLIENTS      16
+#define N_REQUESTS     500
+
+namespace
+{
+    /**
+     * Monotonic time in seconds
+     */
+    double now()
+    {
+        timespec t;
+        clock_gettime(CLOCK_MONOTONIC, &t);
+        return t.tv_sec + 1e-9*t.tv_nsec;
+    }
+    
+    bool readFully(int fd, void* buffer, size_t n)
+    {
+        char* p = (char*) buffer;
+        while (n > 0)
+        {
+            ssize_t r = read(fd, p, n);
+            if (r < 0 && errno == EINTR) continue;
+            if (r <= 0) return false;
+            p += r;
+            n -= r;
+        }
+        return true;
+    }
+    
+    bool writeFully(int fd, const void* buffer, size_t n)
+    {
+        const char* p = (const char*) buffer;
+        while (n > 0)
+        {
+            ssize_t r = write(fd, p, n);
+            if (r < 0 && errno == EINTR) continue;
+            if (r <= 0) return false;
+            p += r;
+            n -= r;
+        }
+        return true;
+    }
+    
+    struct ConnectionThreadArg
+    {
+        PredictionServer* server;
+        Connection* connection;
+    };
+}
+
+
+int main(int argc, char* argv[])
+{
+    signal(SIGPIPE, SIG_IGN);
+    
+    //-------------------------------------------------------------------------
+    // Train mode
+    if (argc == 3 && string(argv[1]) == "train")
+    {
+        return trainModel(argv[2]) ? 0 : 1;
+    }
+    
+    //-------------------------------------------------------------------------
+    // Serve mode
+    if (argc >= 4 && string(argv[1]) == "serve")
+    {
+        double budget = (argc > 4) ? 1e-3*atof(argv[4]) : LATENCY_BUDGET;
+        int maxBatch  = (argc > 5) ? atoi(argv[5]) : MAX_BATCH;
+        
+        CovarianceFunction* kernel = new GaussianCF(1.0, 1.0);
+        PSGPSnapshot* snapshot = PSGPSnapshot::read(argv[2], kernel);
+        if (!snapshot) 
+        {
+            delete kernel;
+            return 1;
+        }
+        
+        PSGPSnapshotHolder holder;
+        holder.publish(snapshot);
+        
+        if (string(argv[3]) == "-")
+        {
+            // stdout carries the protocol, so report on stderr
+            PredictionServer server(holder, budget, maxBatch);
+            server.serveStream(STDIN_FILENO, STDOUT_FILENO);
+            server.stop();
+            server.printStatistics(cerr);
+            return 0;
+        }
+        
+        // Block termination signals in all threads, and wait for them here
+        sigset_t signals;
+        sigemptyset(&signals);
+        sigaddset(&signals, SIGINT);
+        sigaddset(&signals, SIGTERM);
+        pthread_sigmask(SIG_BLOCK, &signals, NULL);
+        
+        PredictionServer server(holder, budget, maxBatch);
+        if (!server.listen(argv[3])) return 1;
+        
+        cout << "Serving " << argv[2] << " on " << argv[3] << endl;
+        int signal;
+        sigwait(&signals, &signal);
+        
+        server.stop();
+        server.printStatistics(cout);
+        return 0;
+    }
+    
+    //-------------------------------------------------------------------------
+    // Load generator mode
+    if (argc >= 5 && string(argv[1]) == "load")
+    {
+        int maxPoints = (argc > 5) ? atoi(argv[5]) : MAX_POINTS;
+        return generateLoad(argv[2], atoi(argv[3]), atoi(argv[4]), maxPoints, NULL) ? 0 : 1;
+    }
+    
+    //-------------------------------------------------------------------------
+    // Local mode: server and load generator in this process
+    int nClients  = (argc > 1) ? atoi(argv[1]) : N_CLIENTS;
+    int nRequests = (argc > 2) ? atoi(argv[2]) : N_REQUESTS;
+    
+    ostringstream modelFile, socketFile;
+    modelFile << P_tmpdir << "/psgp_model_" << getpid() << ".it";
+    socketFile << P_tmpdir << "/psgp_server_" << getpid() << ".sock";
+    
+    if (!trainModel(modelFile.str())) return 1;
+    
+    CovarianceFunction* kernel = new GaussianCF(1.0, 1.0);
+    PSGPSnapshot* snapshot = PSGPSnapshot::read(modelFile.str(), kernel);
+    remove(modelFile.str().c_str());
+    if (!snapshot) 
+    {
+        delete kernel;
+        return 1;
+    }
+    
+    PSGPSnapshotHolder holder;
+    holder.publish(snapshot);
+    SnapshotReader reference(holder);
+    
+    bool ok = true;
+    for (int pass = 0; pass < 2; pass++)
+    {
+        double budget = (pass == 0) ? 0.0 : LATENCY_BUDGET;
+        int maxBatch  = (pass == 0) ? 1 : MAX_BATCH;
+        
+        cout << endl << (pass == 0 ? "Without coalescing" : "With coalescing") 
+             << " (budget " << 1e3*budget << " ms, " << nClients << " clients, "  
+             << nRequests << " requests each)" << endl;
+        
+        PredictionServer server(holder, budget, maxBatch);
+        if (!server.listen(socketFile.str())) return 1;
+        
+        ok = generateLoad(socketFile.str(), nClients, nRequests, MAX_POINTS, &*reference) && ok;
+        
+        server.stop();
+        server.printStatistics(cout);
+    }
+    
+    return ok ? 0 : 1;
+}
+
+
+/**
+ * Fit the demonstration model and write its snapshot to filename
+ */
+bool trainModel(const string filename)
+{
+    RNG_reset(123);
+    
+    mat X = 10.0*randu(N_OBS, 2);
+    vec Y(N_OBS);
+    for (int i=0; i<N_OBS; i++) 
+    {
+        Y(i) = sin(X(i,0)) + cos(X(i,1)) + sqrt(NUGGET)*randn();
+    }
+    
+    GaussianCF kernel(1.5, 1.0);
+    GaussianLikelihood lik(NUGGET);
+    PSGP psgp(X, Y, kernel, N_ACTIVE);
+    psgp.computePosterior(lik);
+    
+    PSGPSnapshot snapshot(psgp, new GaussianCF(1.0, 1.0));
+    return snapshot.write(filename);
+}
+
+
+/**
+ * Constructor - starts the batch thread
+ */
+PredictionServer::PredictionServer(PSGPSnapshotHolder& holder, double latencyBudget, int maxBatch)
+: holder(holder), latencyBudget(latencyBudget), maxBatch(maxBatch)
+{
+    assert(maxBatch > 0);
+    
+    listenFd = -1;
+    listening = false;
+    stopping = false;
+    queuedPoints = 0;
+    
+    nBatches = nRequests = nPoints = 0;
+    largestBatch = 0;
+    
+    // Batch deadlines are measured with the monotonic clock
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    
+    pthread_mutex_init(&mutex, NULL);
+    pthread_cond_init(&queueChanged, &attr);
+    pthread_cond_init(&requestsDone, NULL);
+    pthread_condattr_destroy(&attr);
+    
+    pthread_create(&batchThread, NULL, PredictionServer::batchLoop, this);
+}
+
+
+/**
+ * Destructor
+ */
+PredictionServer::~PredictionServer()
+{
+    stop();
+    
+    pthread_mutex_destroy(&mutex);
+    pthread_cond_destroy(&queueChanged);
+    pthread_cond_destroy(&requestsDone);
+}
+
+
+/**
+ * Listen on a Unix domain socket, and serve each connection in its own
+ * thread
+ */
+bool PredictionServer::listen(const string path)
+{
+    assert(!listening);
+    
+    sockaddr_un address;
+    if (path.length() >= sizeof(address.sun_path))
+    {
+        cerr << "Socket path " << path << " is too long." << endl;
+        return false;
+    }
+    
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, path.c_str());
+    
+    listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+    unlink(path.c_str());
+    if (listenFd < 0 || bind(listenFd, (sockaddr*) &address, sizeof(address)) != 0 
+        || ::listen(listenFd, 64) != 0)
+    {
+        cerr << "Could not listen on " << path << ": " << strerror(errno) << endl;
+        if (listenFd >= 0) close(listenFd);
+        return false;
+    }
+    
+    socketPath = path;
+    listening = true;
+    pthread_create(&acceptThread, NULL, PredictionServer::acceptLoop, this);
+    
+    return true;
+}
+
+
+/**
+ * Serve requests read from inFd, writing the responses to outFd, until 
+ * the end of the input
+ */
+void PredictionServer::serveStream(int inFd, int outFd)
+{
+    Connection* connection = new Connection;
+    connection->inFd = inFd;
+    connection->outFd = outFd;
+    connection->pending = 0;
+    pthread_mutex_init(&connection->writeMutex, NULL);
+    
+    pthread_mutex_lock(&mutex);
+    connections.insert(connection);
+    pthread_mutex_unlock(&mutex);
+    
+    serveConnection(connection);
+}
+
+
+/**
+ * Stop accepting connections, close the open ones once their pending 
+ * requests are answered, and stop the batch thread
+ */
+void PredictionServer::stop()
+{
+    if (listening)
+    {
+        // Shutting down the socket makes accept return
+        shutdown(listenFd, SHUT_RDWR);
+        pthread_join(acceptThread, NULL);
+        close(listenFd);
+        unlink(socketPath.c_str());
+        listening = false;
+    }
+    
+    pthread_mutex_lock(&mutex);
+    if (stopping) 
+    {
+        pthread_mutex_unlock(&mutex);
+        return;
+    }
+    
+    for (set<Connection*>::iterator c = connections.begin(); c != connections.end(); c++)
+    {
+        shutdown((*c)->inFd, SHUT_RD);
+    }
+    while (!connections.empty()) pthread_cond_wait(&requestsDone, &mutex);
+    
+    stopping = true;
+    pthread_cond_signal(&queueChanged);
+    pthread_mutex_unlock(&mutex);
+    
+    pthread_join(batchThread, NULL);
+}
+
+
+/**
+ * Print the number of batches and their average size
+ */
+void PredictionServer::printStatistics(ostream& out) const
+{
+    pthread_mutex_lock(&mutex);
+    out << "Server: " << nRequests << " requests (" << nPoints << " points) in " 
+        << nBatches << " batches";
+    if (nBatches > 0) 
+    {
+        out << ", " << (double) nRequests / nBatches << " requests and " 
+            << (double) nPoints / nBatches << " points per batch on average, "
+            << largestBatch << " points at most";
+    }
+    out << endl;
+    pthread_mutex_unlock(&mutex);
+}
+
+
+/**
+ * Accept connections until the listening socket is shut down
+ */
+void* PredictionServer::acceptLoop(void* arg)
+{
+    PredictionServer* server = (PredictionServer*) arg;
+    
+    while (true)
+    {
+        int fd = accept(server->listenFd, NULL, NULL);
+        if (fd < 0)
+        {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            break;
+        }
+        
+        ConnectionThreadArg* threadArg = new ConnectionThreadArg;
+        threadArg->server = server;
+        threadArg->connection = new Connection;
+        threadArg->connection->inFd = fd;
+        threadArg->connection->outFd = fd;
+        threadArg->connection->pending = 0;
+        pthread_mutex_init(&threadArg->connection->writeMutex, NULL);
+        
+        pthread_mutex_lock(&server->mutex);
+        server->connections.insert(threadArg->connection);
+        pthread_mutex_unlock(&server->mutex);
+        
+        pthread_t thread;
+        pthread_create(&thread, NULL, PredictionServer::connectionLoop, threadArg);
+        pthread_detach(thread);
+    }
+    
+    return NULL;
+}
+
+
+/**
+ * Connection thread
+ */
+void* PredictionServer::connectionLoop(void* arg)
+{
+    ConnectionThreadArg* threadArg = (ConnectionThreadArg*) arg;
+    threadArg->server->serveConnection(threadArg->connection);
+    delete threadArg;
+    
+    return NULL;
+}
+
+
+/**
+ * Read the requests of a connection and queue them for the batch thread.
+ * At the end of the input, wait for the pending requests to be answered 
+ * and close the connection.
+ */
+void PredictionServer::serveConnection(Connection* connection)
+{
+    int dim;
+    {
+        SnapshotReader snapshot(holder);
+        dim = snapshot.valid() ? snapshot->getInputDimensions() : 0;
+    }
+    
+    uint32_t hello = dim;
+    bool ok = (dim > 0) && writeFully(connection->outFd, &hello, sizeof(hello));
+    
+    vector<double> buffer;
+    RequestHeader header;
+    
+    while (ok && readFully(connection->inFd, &header, sizeof(header)))
+    {
+        if (header.nPoints == 0 || header.nPoints > MAX_REQUEST_POINTS)
+        {
+            cerr << "Invalid request size " << header.nPoints << ", closing connection." << endl;
+            break;
+        }
+        
+        int n = header.nPoints;
+        buffer.resize(n*dim);
+        if (!readFully(connection->inFd, &buffer[0], n*dim*sizeof(double))) break;
+        
+        Request* request = new Request;
+        request->connection = connection;
+        request->id = header.id;
+        request->X.set_size(n, dim);
+        for (int i=0; i<n; i++)
+        {
+            for (int j=0; j<dim; j++) request->X(i,j) = buffer[i*dim+j];
+        }
+        request->arrival = now();
+        
+        pthread_mutex_lock(&mutex);
+        connection->pending++;
+        queue.push_back(request);
+        queuedPoints += n;
+        pthread_cond_signal(&queueChanged);
+        pthread_mutex_unlock(&mutex);
+    }
+    
+    pthread_mutex_lock(&mutex);
+    while (connection->pending > 0) pthread_cond_wait(&requestsDone, &mutex);
+    connections.erase(connection);
+    pthread_cond_broadcast(&requestsDone);
+    pthread_mutex_unlock(&mutex);
+    
+    // Sockets are closed, standard streams are left to the caller
+    if (connection->inFd == connection->outFd) close(connection->inFd);
+    pthread_mutex_destroy(&connection->writeMutex);
+    delete connection;
+}
+
+
+/**
+ * Batch thread: wait for requests, coalesce them and process the batches
+ */
+void* PredictionServer::batchLoop(void* arg)
+{
+    PredictionServer* server = (PredictionServer*) arg;
+    vector<Request*> batch;
+    
+    pthread_mutex_lock(&server->mutex);
+    while (true)
+    {
+        while (server->queue.empty() && !server->stopping) 
+        {
+            pthread_cond_wait(&server->queueChanged, &server->mutex);
+        }
+        if (server->queue.empty()) break;
+        
+        // Wait for more requests, until the oldest one has used its budget
+        // or the batch is full
+        double deadline = server->queue.front()->arrival + server->latencyBudget;
+        timespec t;
+        t.tv_sec  = (time_t) floor(deadline);
+        t.tv_nsec = (long) (1e9*(deadline - floor(deadline)));
+        
+        while (!server->stopping && server->queuedPoints < server->maxBatch && now() < deadline)
+        {
+            pthread_cond_timedwait(&server->queueChanged, &server->mutex, &t);
+        }
+        
+        // Take requests in order of arrival, up to maxBatch points (and at
+        // least one request)
+        int points = 0;
+        batch.clear();
+        while (!server->queue.empty() 
+               && (batch.empty() || points + server->queue.front()->X.rows() <= server->maxBatch))
+        {
+            points += server->queue.front()->X.rows();
+            batch.push_back(server->queue.front());
+            server->queue.pop_front();
+        }
+        server->queuedPoints -= points;
+        
+        server->nBatches++;
+        server->nRequests += batch.size();
+        server->nPoints += points;
+        server->largestBatch = max(server->largestBatch, points);
+        
+        pthread_mutex_unlock(&server->mutex);
+        server->processBatch(batch);
+        pthread_mutex_lock(&server->mutex);
+        
+        for (unsigned int i=0; i<batch.size(); i++) 
+        {
+            batch[i]->connection->pending--;
+            delete batch[i];
+        }
+        pthread_cond_broadcast(&server->requestsDone);
+    }
+    pthread_mutex_unlock(&server->mutex);
+    
+    return NULL;
+}
+
+
+/**
+ * Make the predictions for a batch of requests in a single call, and send
+ * the responses
+ */
+void PredictionServer::processBatch(const vector<Request*>& batch)
+{
+    SnapshotReader snapshot(holder);
+    
+    int n = 0;
+    for (unsigned int k=0; k<batch.size(); k++) n += batch[k]->X.rows();
+    
+    mat X(n, snapshot->getInputDimensions());
+    for (unsigned int k=0, offset=0; k<batch.size(); k++) 
+    {
+        X.set_submatrix(offset, 0, batch[k]->X);
+        offset += batch[k]->X.rows();
+    }
+    
+    vec mean(n), var(n);
+    snapshot->makePredictions(mean, var, X);
+    
+    vector<char> response;
+    for (unsigned int k=0, offset=0; k<batch.size(); k++) 
+    {
+        int nk = batch[k]->X.rows();
+        response.resize(sizeof(ResponseHeader) + 2*nk*sizeof(double));
+        
+        ResponseHeader* header = (ResponseHeader*) &response[0];
+        header->id = batch[k]->id;
+        header->nPoints = nk;
+        
+        double* values = (double*) &response[sizeof(ResponseHeader)];
+        for (int i=0; i<nk; i++)
+        {
+            values[2*i]   = mean(offset+i);
+            values[2*i+1] = var(offset+i);
+        }
+        offset += nk;
+        
+        // A failed write means the client has gone, its connection 
+        // thread will close the connection
+        Connection* connection = batch[k]->connection;
+        pthread_mutex_lock(&connection->writeMutex);
+        writeFully(connection->outFd, &response[0], response.size());
+        pthread_mutex_unlock(&connection->writeMutex);
+    }
+}
+
+
+/**
+ * Load generator client
+ */
+void* runLoadClient(void* arg)
+{
+    LoadClient* client = (LoadClient*) arg;
+    client->ok = false;
+    client->maxError = 0.0;
+    
+    sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strncpy(address.sun_path, client->socketPath.c_str(), sizeof(address.sun_path)-1);
+    
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    uint32_t dim;
+    if (fd < 0 || connect(fd, (sockaddr*) &address, sizeof(address)) != 0 
+        || !readFully(fd, &dim, sizeof(dim)))
+    {
+        cerr << "Could not connect to " << client->socketPath << endl;
+        if (fd >= 0) close(fd);
+        return NULL;
+    }
+    
+    vector<char> request;
+    vector<double> response;
+    vec mean, var;
+    
+    int k;
+    for (k=0; k<client->nRequests; k++)
+    {
+        int n = 1 + rand_r(&client->seed) % client->maxPoints;
+        
+        request.resize(sizeof(RequestHeader) + n*dim*sizeof(double));
+        RequestHeader* header = (RequestHeader*) &request[0];
+        header->id = k;
+        header->nPoints = n;
+        
+        mat X(n, dim);
+        double* x = (double*) &request[sizeof(RequestHeader)];
+        for (int i=0; i<n; i++)
+        {
+            for (unsigned int j=0; j<dim; j++) 
+            {
+                X(i,j) = x[i*dim+j] = 10.0*rand_r(&client->seed)/RAND_MAX;
+            }
+        }
+        
+        double start = now();
+        ResponseHeader answer;
+        response.resize(2*n);
+        if (!writeFully(fd, &request[0], request.size()) 
+            || !readFully(fd, &answer, sizeof(answer))
+            || answer.id != (uint32_t) k || answer.nPoints != (uint32_t) n
+            || !readFully(fd, &response[0], 2*n*sizeof(double))) break;
+        
+        client->latencies.push_back(now() - start);
+        
+        if (client->reference)
+        {
+            mean.set_size(n);
+            var.set_size(n);
+            client->reference->makePredictions(mean, var, X);
+            for (int i=0; i<n; i++)
+            {
+                client->maxError = max(client->maxError, fabs(response[2*i] - mean(i)));
+                client->maxError = max(client->maxError, fabs(response[2*i+1] - var(i)));
+            }
+        }
+    }
+    
+    close(fd);
+    client->ok = (k == client->nRequests);
+    
+    return NULL;
+}
+
+
+/**
+ * Run nClients load generator clients in parallel and print the latency
+ * distribution
+ */
+bool generateLoad(const string socketPath, int nClients, int nRequests, int maxPoints, 
+                  const PSGPSnapshot* reference)
+{
+    vector<LoadClient> clients(nClients);
+    vector<pthread_t> threads(nClients);
+    
+    double start = now();
+    for (int i=0; i<nClients; i++)
+    {
+        clients[i].socketPath = socketPath;
+        clients[i].nRequests = nRequests;
+        clients[i].maxPoints = maxPoints;
+        clients[i].seed = 1234 + i;
+        clients[i].reference = reference;
+        pthread_create(&threads[i], NULL, runLoadClient, &clients[i]);
+    }
+    
+    bool ok = true;
+    double maxError = 0.0;
+    vector<double> latencies;
+    for (int i=0; i<nClients; i++)
+    {
+        pthread_join(threads[i], NULL);
+        ok = ok && clients[i].ok;
+        maxError = max(maxError, clients[i].maxError);
+        latencies.insert(latencies.end(), clients[i].latencies.begin(), clients[i].latencies.end());
+    }
+    double elapsed = now() - start;
+    
+    if (!ok) cerr << "Some clients failed." << endl;
+    
+    cout << "Load: " << latencies.size() << " requests in " << elapsed << " s (" 
+         << latencies.size() / elapsed << " requests/s)" << endl;
+    if (reference) 
+    {
+        cout << "Max difference with direct predictions: " << maxError << endl;
+    }
+    printLatencies(latencies);
+    
+    return ok;
+}
+
+
+/**
+ * Print latency percentiles and a histogram with logarithmic bins
+ * (powers of 2 in microseconds)
+ */
+void printLatencies(vector<double> latencies)
+{
+    if (latencies.empty()) return;
+    
+    sort(latencies.begin(), latencies.end());
+    int n = latencies.size();
+    
+    double mean = 0.0;
+    for (int i=0; i<n; i++) mean += latencies[i];
+    mean /= n;
+    
+    cout << "Latency (us): mean " << 1e6*mean 
+         << ", p50 " << 1e6*latencies[n/2] 
+         << ", p90 " << 1e6*latencies[(9*n)/10]
+         << ", p99 " << 1e6*latencies[(99*n)/100]
+         << ", max " << 1e6*latencies[n-1] << endl;
+    
+    int first = (int) floor(log2(max(1e6*latencies[0], 1.0)));
+    int last  = (int) floor(log2(max(1e6*latencies[n-1], 1.0)));
+    vector<int> counts(last-first+1, 0);
+    for (int i=0; i<n; i++) 
+    {
+        counts[(int) floor(log2(max(1e6*latencies[i], 1.0))) - first]++;
+    }
+    
+    int largest = *max_element(counts.begin(), counts.end());
+    for (int b=0; b<=last-first; b++)
+    {
+        printf("  %8d - %8d us %7d ", 1 << (first+b), 1 << (first+b+1), counts[b]);
+        cout << string((50*counts[b] + largest-1) / largest, '#') << endl;
+    }
+}
@@ -0,0 +1,174 @@
+#ifndef DEMO_PREDICTION_SERVER_H_
+#define DEMO_PREDICTION_SERVER_H_
+
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <deque>
+#include <set>
+#include <string>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <csignal>
+#include <cerrno>
+
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include <itpp/itbase.h>
+
+#include "gaussian_processes/PSGP.h"
+#include "gaussian_processes/PSGPSnapshot.h"
+#include "likelihood_models/GaussianLikelihood.h"
+
+#include "covariance_functions/GaussianCF.h"
+
+using namespace std;
+using namespace itpp;
+
+/**
+ * Binary protocol (native byte order, for local use). On connection, the
+ * server sends the input dimension d as a uint32. Each request is a 
+ * RequestHeader followed by nPoints*d doubles (one point after the other),
+ * and is answered by a ResponseHeader with the same id followed by nPoints 
+ * (mean, variance) pairs. Requests can be pipelined; responses to a 
+ * connection come back in request order. A malformed request (no points, 
+ * or more than MAX_REQUEST_POINTS) closes the connection.
+ */
+struct RequestHeader
+{
+    uint32_t id;
+    uint32_t nPoints;
+};
+
+struct ResponseHeader
+{
+    uint32_t id;
+    uint32_t nPoints;
+};
+
+#define MAX_REQUEST_POINTS 10000
+
+
+/**
+ * Client connection to the server (a socket, or stdin/stdout)
+ */
+struct Connection
+{
+    int inFd, outFd;
+    int pending;                    // Requests queued or being processed
+    pthread_mutex_t writeMutex;
+};
+
+/**
+ * Request waiting in the server queue
+ */
+struct Request
+{
+    Connection* connection;
+    uint32_t id;
+    mat X;
+    double arrival;                 // Arrival time (seconds)
+};
+
+
+/**
+ * Prediction server. Connection threads read requests and put them in a
+ * queue. A single batch thread coalesces the queued requests into 
+ * micro-batches: it waits for up to latencyBudget seconds after the 
+ * arrival of the oldest queued request, or until maxBatch points are 
+ * queued, then makes the predictions for the whole batch in one call 
+ * (so the covariance with the active set and its product with C are 
+ * computed once per batch rather than once per request) and writes the
+ * responses. Predictions use the current snapshot of holder, so the 
+ * model can be swapped while the server runs.
+ */
+class PredictionServer
+{
+public:
+    PredictionServer(PSGPSnapshotHolder& holder, double latencyBudget, int maxBatch);
+    virtual ~PredictionServer();
+    
+    bool listen(const string socketPath);       // Serve a Unix domain socket
+    void serveStream(int inFd, int outFd);      // Serve a single stream (blocks until EOF)
+    void stop();
+    
+    void printStatistics(ostream& out) const;
+    
+private:
+    static void* acceptLoop(void* server);
+    static void* connectionLoop(void* arg);
+    static void* batchLoop(void* server);
+    
+    void serveConnection(Connection* connection);
+    void processBatch(const vector<Request*>& batch);
+    
+    PSGPSnapshotHolder& holder;
+    double latencyBudget;
+    int    maxBatch;
+    
+    string socketPath;
+    int    listenFd;
+    bool   stopping;
+    
+    deque<Request*> queue;
+    int queuedPoints;
+    set<Connection*> connections;
+    
+    pthread_t acceptThread, batchThread;
+    bool      listening;
+    
+    mutable pthread_mutex_t mutex;
+    pthread_cond_t queueChanged;        // Request queued or server stopping
+    pthread_cond_t requestsDone;        // Batch processed or connection closed
+    
+    // Statistics
+    long nBatches, nRequests, nPoints;
+    int  largestBatch;
+};
+
+
+/**
+ * Load generator client: sends nRequests requests of 1 to maxPoints random
+ * locations, one at a time, and records the latency of each. If reference
+ * is given, the responses are checked against its predictions.
+ */
+struct LoadClient
+{
+    string socketPath;
+    int nRequests;
+    int maxPoints;
+    unsigned int seed;
+    const PSGPSnapshot* reference;
+    
+    vector<double> latencies;
+    double maxError;
+    bool ok;
+};
+
+void* runLoadClient(void* client);
+
+/**
+ * Run nClients load generator clients in parallel and print the latency
+ * distribution. Returns false if any client failed.
+ */
+bool generateLoad(const string socketPath, int nClients, int nRequests, int maxPoints, 
+                  const PSGPSnapshot* reference);
+
+/**
+ * Print latency percentiles and a histogram with logarithmic bins
+ */
+void printLatencies(vector<double> latencies);
+
+/**
+ * Fit the demonstration model and write its snapshot to filename
+ */
+bool trainModel(const string filename);
+
+#endif /*DEMO_PREDICTION_SERVER_H_*/
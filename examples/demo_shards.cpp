@@ -0,0 +1,138 @@
+/**
+ * This demonstration program illustrates the computation of the PSGP 
+ * posterior over data shards in separate processes (or machines). The 
+ * active set is chosen up front (using a design over all observations) and
+ * shared by all shards. Each shard computes its posterior for the fixed 
+ * active set and writes its site contributions to a file. These are then 
+ * merged to obtain the posterior for the whole data set. The comparison 
+ * with the posterior computed in a single process is in tests/TestPSGPShards.
+ * 
+ * Usage:
+ *   demo_shards design activeset_file
+ *       chooses the shared active set and writes it to activeset_file
+ *   demo_shards shard i nShards activeset_file output_file
+ *       computes the contributions of shard i (e.g. on another machine), 
+ *       for the active set stored in activeset_file
+ *   demo_shards merge output_file file1 file2 ...
+ *       merges shard files and writes predictions on a test grid
+ * 
+ * For example, with 4 shards:
+ *   demo_shards design active.it
+ *   for i in 0 1 2 3; do demo_shards shard $i 4 active.it shard$i.it & done; wait
+ *   demo_shards merge predictions.it shard0.it shard1.it shard2.it shard3.it
+ **/
+
+#include "demo_shards.h"
+
+#define N_OBS    3000
+#define N_ACTIVE 100
+#define NUGGET   0.01
+
+// Covariance function shared by all processes
+GaussianCF kernel(1.5, 1.0);
+
+int main(int argc, char* argv[])
+{
+    mat X;
+    vec Y;
+    generateData(X, Y);
+    
+    //-------------------------------------------------------------------------
+    // Design mode: choose the shared active set
+    if (argc == 3 && string(argv[1]) == "design")
+    {
+        GreedyMaxMinDesign design(1.0);
+        mat activeSet = X.get_rows(design.subsample(X, N_ACTIVE));
+        
+        it_file file;
+        file.open(argv[2], true);
+        file << Name("activeSet") << activeSet;
+        file.close();
+        return 0;
+    }
+    
+    //-------------------------------------------------------------------------
+    // Single shard mode
+    if (argc == 6 && string(argv[1]) == "shard")
+    {
+        mat activeSet;
+        it_ifile file;
+        file.open(argv[4]);
+        file >> Name("activeSet") >> activeSet;
+        file.close();
+        
+        if (activeSet.rows() == 0)
+        {
+            cerr << "No active set in " << argv[4] << " (see demo_shards design)." << endl;
+            return 1;
+        }
+        
+        runShard(atoi(argv[2]), atoi(argv[3]), activeSet, argv[5]);
+        return 0;
+    }
+    
+    //-------------------------------------------------------------------------
+    // Merge mode
+    if (argc >= 4 && string(argv[1]) == "merge")
+    {
+        vector<string> files;
+        for (int i=3; i<argc; i++) files.push_back(argv[i]);
+        
+        mat Xnone(0, X.cols());
+        vec Ynone(0);
+        PSGP psgp(Xnone, Ynone, kernel, N_ACTIVE);
+        if (!psgp.mergeSiteContributions(files)) return 1;
+        
+        mat Xtst = 10.0*randu(500, 2);
+        vec mean(500), var(500);
+        psgp.makePredictions(mean, var, Xtst);
+        
+        it_file out;
+        out.open(argv[2], true);
+        out << Name("X") << Xtst << Name("mean") << mean << Name("var") << var;
+        out.close();
+        return 0;
+    }
+    
+    cerr << "Usage: " << argv[0] << " design activeset_file" << endl
+         << "       " << argv[0] << " shard i nShards activeset_file output_file" << endl
+         << "       " << argv[0] << " merge output_file file1 file2 ..." << endl;
+    return 1;
+}
+
+void generateData(mat& X, vec& Y)
+{
+    RNG_reset(123);
+    
+    X = 10.0*randu(N_OBS, 2);
+    Y.set_size(N_OBS);
+    for (int i=0; i<N_OBS; i++) 
+    {
+        Y(i) = sin(X(i,0)) + cos(X(i,1)) + sqrt(NUGGET)*randn();
+    }
+}
+
+
+void runShard(int iShard, int nShards, const mat& activeSet, const string filename)
+{
+    mat X;
+    vec Y;
+    generateData(X, Y);
+    
+    // Observations iShard, iShard + nShards, ...
+    ivec idx;
+    for (int i=iShard; i<X.rows(); i+=nShards) 
+    {
+        idx.set_size(idx.length()+1, true);
+        idx(idx.length()-1) = i;
+    }
+    
+    mat Xshard = X.get_rows(idx);
+    vec Yshard = Y(idx);
+    
+    GaussianLikelihood lik(NUGGET);
+    PSGP psgp(Xshard, Yshard, kernel, activeSet.rows());
+    psgp.computePosteriorFixedActiveSet(lik, activeSet);
+    
+    if (!psgp.writeSiteContributions(filename)) exit(1);
+}
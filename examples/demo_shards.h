@@ -0,0 +1,35 @@
+#ifndef DEMO_SHARDS_H_
+#define DEMO_SHARDS_H_
+
+#include <iostream>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+
+#include <itpp/itbase.h>
+
+#include "itppext/itppext.h"
+
+#include "gaussian_processes/PSGP.h"
+#include "likelihood_models/GaussianLikelihood.h"
+
+#include "covariance_functions/GaussianCF.h"
+
+#include "design/GreedyMaxMinDesign.h"
+
+using namespace std;
+using namespace itpp;
+
+/**
+ * Generate the (synthetic) data set. This is seeded, so that all processes
+ * see the same data.
+ */
+void generateData(mat& X, vec& Y);
+
+/**
+ * Compute the posterior for shard number iShard (out of nShards) and
+ * write its contributions to filename
+ */
+void runShard(int iShard, int nShards, const mat& activeSet, const string filename);
+
+#endif /*DEMO_SHARDS_H_*/
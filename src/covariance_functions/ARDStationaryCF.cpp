@@ -0,0 +1,335 @@
+/*
+ * ARDStationaryCF.cpp
+ *
+ *  Stationary covariance function with automatic relevance determination
+ *  (one length scale per input dimension).
+ */
+
+#include "ARDStationaryCF.h"
+#include "itppext/atomics.h"
+
+/**
+ * Default constructor
+ *
+ * @param name         Identifier of the covariance function
+ * @param lengthScales Correlation length scale for each input dimension
+ * @param _variance    Process variance
+ */
+ARDStationaryCF::ARDStationaryCF(string name, const vec& lengthScales, double _variance)
+: CovarianceFunction(name, lengthScales.size()+1),
+  dimensions(lengthScales.size()), variance(parameters[lengthScales.size()])
+{
+    assert(dimensions > 0);
+
+    for (int k=0; k<dimensions; k++)
+    {
+        parameters[k] = lengthScales(k);
+
+        ostringstream label;
+        label << "length scale " << (k+1);
+        parametersNames[k] = label.str();
+    }
+
+    variance = _variance;
+    parametersNames[dimensions] = "variance";
+
+    cacheValid = false;
+    cacheBusy = 0;
+}
+
+
+/**
+ * Default destructor
+ */
+ARDStationaryCF::~ARDStationaryCF()
+{
+}
+
+
+/**
+ * Set the value of a given parameter. This invalidates the cached
+ * scaled inputs.
+ *
+ * @param p     the parameter number
+ * @param value the new value of the parameter
+ */
+void ARDStationaryCF::setParameter(const int p, const double value)
+{
+    CovarianceFunction::setParameter(p, value);
+    cacheValid = false;
+}
+
+
+/**
+ * Returns the number of input dimensions (i.e. of length scales)
+ */
+int ARDStationaryCF::getInputDimensions() const
+{
+    return dimensions;
+}
+
+
+/**
+ * Computes the covariance between inputs u and v
+ *
+ * @param u the first input
+ * @param v the second input
+ * @return the covariance between u and v
+ */
+double ARDStationaryCF::computeElement(const vec& u, const vec& v) const
+{
+    assert(u.size() == dimensions && v.size() == dimensions);
+
+    double r2 = 0.0;
+    for (int k=0; k<dimensions; k++) r2 += sqr((u(k)-v(k)) / parameters[k]);
+
+    return variance * correlation(r2);
+}
+
+
+/**
+ * Auto-covariance of input u, i.e. the process variance
+ */
+double ARDStationaryCF::computeDiagonalElement(const vec& /* u */) const
+{
+    return variance * correlation(0.0);
+}
+
+
+/**
+ * Computes the symmetric covariance matrix between all inputs in X.
+ *
+ * @param C the covariance matrix cov(X,X)
+ * @param X a set of (row) inputs
+ */
+void ARDStationaryCF::covariance(mat& C, const mat& X) const
+{
+    mat Z, local;
+    bool cached;
+    scaleInputs(Z, X);
+    const mat& D = scaledSqDistances(Z, local, cached);
+
+    int n = X.rows();
+    C.set_size(n, n);
+
+    for (int j=0; j<n; j++) {
+        for (int i=j; i<n; i++) {
+            double c = variance * correlation(D(i,j));
+            C(i,j) = c;
+            C(j,i) = c;
+        }
+    }
+
+    if (cached) releaseCache();
+}
+
+
+/**
+ * Computes the covariance matrix between two sets of inputs X1 and X2.
+ * Both sets are scaled once before the distances are accumulated.
+ *
+ * @param C  the nxm covariance matrix cov(X1,X2)
+ * @param X1 a set of n (row) inputs
+ * @param X2 a set of m (row) inputs
+ */
+void ARDStationaryCF::covariance(mat& C, const mat& X1, const mat& X2) const
+{
+    mat Z1, Z2;
+    scaleInputs(Z1, X1);
+    scaleInputs(Z2, X2);
+
+    StationaryCF::sqDistMatrix(C, Z1, Z2);
+
+    for (int j=0; j<C.cols(); j++) {
+        for (int i=0; i<C.rows(); i++) {
+            C(i,j) = variance * correlation(C(i,j));
+        }
+    }
+}
+
+
+/**
+ * Diagonal of the covariance matrix cov(X,X), i.e. the process variance
+ *
+ * @param C the vector of variances
+ * @param X a set of (row) inputs
+ */
+void ARDStationaryCF::computeDiagonal(vec& C, const mat& X) const
+{
+    C.set_size(X.rows());
+    C = variance * correlation(0.0);
+}
+
+
+/**
+ * Gradient of the covariance matrix with respect to a given parameter.
+ * For a length scale l_k, the gradient is obtained in a single pass over
+ * the cached scaled distances, weighted by the scaled squared difference
+ * along dimension k:
+ *
+ *   d/dl_k sigma*k(r2) = -2 sigma k'(r2) (u_k - v_k)^2 / l_k^3
+ *
+ * @param G      the gradient of cov(X,X) with respect to parameter p
+ * @param p      the parameter number
+ * @param X      a set of inputs
+ */
+void ARDStationaryCF::covarianceGradient(mat& G, const int p, const mat& X) const
+{
+    assert(p>=0 && p<numberParameters);
+
+    mat Z, local;
+    bool cached;
+    scaleInputs(Z, X);
+    const mat& D = scaledSqDistances(Z, local, cached);
+
+    int n = X.rows();
+    G.set_size(n, n);
+
+    Transform* t = getTransform(p);
+    double gradientTransform = t->gradientTransform(parameters[p]);
+
+    if (p == dimensions)
+    {
+        // Gradient with respect to the variance is the correlation
+        for (int j=0; j<n; j++) {
+            for (int i=j; i<n; i++) {
+                double g = gradientTransform * correlation(D(i,j));
+                G(i,j) = g;
+                G(j,i) = g;
+            }
+        }
+    }
+    else
+    {
+        double scale = -2.0 * variance * gradientTransform / parameters[p];
+
+        for (int j=0; j<n; j++) {
+            G(j,j) = 0.0;
+            for (int i=j+1; i<n; i++) {
+                double r2 = D(i,j);
+                double g = 0.0;
+                if (r2 > 0.0) g = scale * correlationDerivative(r2) * sqr(Z(i,p) - Z(j,p));
+                G(i,j) = g;
+                G(j,i) = g;
+            }
+        }
+    }
+
+    if (cached) releaseCache();
+}
+
+
+/**
+ * Gradient of the covariance between two sets of inputs with respect to
+ * a given parameter. As for the cross-covariance, the inputs are scaled
+ * here rather than cached.
+ *
+ * @param G      the nxm gradient of cov(X1,X2) with respect to parameter p
+ * @param p      the parameter number
+ * @param X1     a set of n inputs
+ * @param X2     a set of m inputs
+ */
+void ARDStationaryCF::covarianceGradient(mat& G, const int p, const mat& X1, const mat& X2) const
+{
+    assert(p>=0 && p<numberParameters);
+
+    mat Z1, Z2;
+    scaleInputs(Z1, X1);
+    scaleInputs(Z2, X2);
+
+    StationaryCF::sqDistMatrix(G, Z1, Z2);
+
+    Transform* t = getTransform(p);
+    double gradientTransform = t->gradientTransform(parameters[p]);
+
+    if (p == dimensions)
+    {
+        // Gradient with respect to the variance is the correlation
+        for (int j=0; j<G.cols(); j++) {
+            for (int i=0; i<G.rows(); i++) G(i,j) = gradientTransform * correlation(G(i,j));
+        }
+        return;
+    }
+
+    double scale = -2.0 * variance * gradientTransform / parameters[p];
+
+    for (int j=0; j<G.cols(); j++) {
+        for (int i=0; i<G.rows(); i++) {
+            double r2 = G(i,j);
+            double g = 0.0;
+            if (r2 > 0.0) g = scale * correlationDerivative(r2) * sqr(Z1(i,p) - Z2(j,p));
+            G(i,j) = g;
+        }
+    }
+}
+
+
+/**
+ * Inputs divided by the length scale of each dimension
+ *
+ * @param Z the scaled inputs
+ * @param X a set of (row) inputs
+ */
+void ARDStationaryCF::scaleInputs(mat& Z, const mat& X) const
+{
+    assert(X.cols() == dimensions);
+
+    Z = X;
+    for (int k=0; k<dimensions; k++) {
+        for (int i=0; i<Z.rows(); i++) Z(i,k) /= parameters[k];
+    }
+}
+
+
+/**
+ * Squared distances between scaled inputs Z. If Z is small enough and the
+ * cache is not in use by another thread, the cache is acquired (cached is
+ * set, and releaseCache must be called once the distances are no longer 
+ * needed) and updated unless it already holds Z. Otherwise, the distances
+ * are computed into local.
+ *
+ * @param Z      a set of scaled (row) inputs
+ * @param local  storage for the distances when the cache is not used
+ * @param cached set if the returned matrix is the cache
+ * @return the matrix of squared distances between the rows of Z
+ */
+const mat& ARDStationaryCF::scaledSqDistances(const mat& Z, mat& local, bool& cached) const
+{
+    cached = Z.rows() <= ARD_CACHE_MAX_INPUTS && itppext::atomic_try_acquire(&cacheBusy);
+
+    if (!cached)
+    {
+        StationaryCF::sqDistMatrix(local, Z);
+        return local;
+    }
+
+    if (!(cacheValid && Z.rows() == scaledInputs.rows() && Z == scaledInputs))
+    {
+        scaledInputs = Z;
+        StationaryCF::sqDistMatrix(scaledSqDist, Z);
+        cacheValid = true;
+    }
+    return scaledSqDist;
+}
+
+
+/**
+ * Release the cache acquired by scaledSqDistances
+ */
+void ARDStationaryCF::releaseCache() const
+{
+    itppext::atomic_release(&cacheBusy);
+}
+
+
+/**
+ * Free the cached distances (e.g. once training is finished)
+ */
+void ARDStationaryCF::clearCache()
+{
+    assert(cacheBusy == 0);
+
+    cacheValid = false;
+    scaledInputs.set_size(0, 0);
+    scaledSqDist.set_size(0, 0);
+}
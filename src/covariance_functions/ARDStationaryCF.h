@@ -0,0 +1,88 @@
+/**
+ * ARDStationaryCF.h
+ *
+ *  Stationary covariance function with automatic relevance determination
+ *  (one length scale per input dimension).
+ */
+
+#ifndef ARDSTATIONARYCF_H_
+#define ARDSTATIONARYCF_H_
+
+#include "CovarianceFunction.h"
+#include "StationaryCF.h"
+#include "parameter_transforms/LogTransform.h"
+
+#include <cmath>
+#include <cassert>
+#include <sstream>
+#include <itpp/itbase.h>
+
+using namespace std;
+using namespace itpp;
+
+#define ARD_CACHE_MAX_INPUTS 2000    // Largest set of inputs whose distances are cached
+
+/**
+ * Base class for stationary covariance functions with automatic relevance
+ * determination (ARD), i.e. of the form sigma * k(r2), where
+ *
+ *   r2 = sum_k (u_k - v_k)^2 / l_k^2
+ *
+ * is the squared distance between inputs u and v scaled by a length scale
+ * l_k for each input dimension. Parameters 0 to d-1 are the length scales
+ * and parameter d is the process variance.
+ *
+ * The inputs are scaled once per call. The scaled squared distances of the
+ * last set of (at most ARD_CACHE_MAX_INPUTS) scaled inputs are cached and 
+ * only recomputed when the inputs or the parameters change, so that the 
+ * covariance matrix and all gradient matrices for a given parameter 
+ * setting share the same distance computation. The cache is only used by 
+ * one thread at a time: a thread which finds it in use computes the 
+ * distances itself, so that concurrent calls are safe (as long as the 
+ * parameters are not changed at the same time). 
+ */
+class ARDStationaryCF : public CovarianceFunction
+{
+public:
+    ARDStationaryCF(string name, const vec& lengthScales, double variance);
+    virtual ~ARDStationaryCF();
+
+    using CovarianceFunction::covariance;
+    using CovarianceFunction::computeDiagonal;
+
+    virtual void covariance(mat& C, const mat& X) const;
+    virtual void covariance(mat& C, const mat& X1, const mat& X2) const;
+    virtual void computeDiagonal(vec& C, const mat& X) const;
+
+    virtual void covarianceGradient(mat& grad, const int parameterNumber, const mat& X) const;
+    virtual void covarianceGradient(mat& grad, const int parameterNumber, const mat& X1, const mat& X2) const;
+
+    virtual void setParameter(const int parameterNumber, const double value);
+
+    int getInputDimensions() const;
+    void clearCache();
+
+protected:
+    virtual double computeElement(const vec& u, const vec& v) const;
+    virtual double computeDiagonalElement(const vec& u) const;
+
+    // Correlation as a function of the scaled squared distance r2, and
+    // its derivative with respect to r2
+    virtual double correlation(double r2) const = 0;
+    virtual double correlationDerivative(double r2) const = 0;
+
+    int dimensions;          // Number of input dimensions
+    double &variance;        // Process variance (last parameter)
+
+private:
+    void scaleInputs(mat& Z, const mat& X) const;
+    const mat& scaledSqDistances(const mat& Z, mat& local, bool& cached) const;
+    void releaseCache() const;
+
+    mutable int cacheBusy;       // Set while a thread uses the cache
+    mutable bool cacheValid;
+    mutable mat scaledInputs;    // Scaled inputs for which the cache was computed
+    mutable mat scaledSqDist;    // Scaled squared distances between these inputs
+};
+
+#endif /* ARDSTATIONARYCF_H_ */
@@ -41,3 +41,14 @@ void ConstantCF::covarianceGradient(mat& grad, const int parameterNumber, const
 		}
 	}
 }
+
+/**
+ * Gradient of the covariance between two sets of inputs (constant)
+ */
+void ConstantCF::covarianceGradient(mat& grad, const int parameterNumber, const mat& X1, const mat& X2) const
+{
+	assert(parameterNumber == 0);
+
+	Transform* t = getTransform(parameterNumber);
+	grad = t->gradientTransform(getParameter(parameterNumber)) * ones(X1.rows(), X2.rows());
+}
@@ -43,6 +43,7 @@ public:
 	inline double computeDiagonalElement(const vec& A) const;
 	
 	virtual void covarianceGradient(mat& grad, const int parameterNumber, const mat& X) const;
+	virtual void covarianceGradient(mat& grad, const int parameterNumber, const mat& X1, const mat& X2) const;
 
 private:
 	double &bias;
@@ -152,6 +152,77 @@ void CovarianceFunction::covariance(mat& C, const mat& X1, const mat& X2) const
 }
 
 
+/**
+ * Covariance matrix of a set of inputs, given the matrix of squared distances
+ * between these inputs (e.g. from a DistanceCache). Covariance functions which
+ * only depend on the distance between inputs (see StationaryCF) should
+ * override this to avoid recomputing the distances. By default, the distances
+ * are ignored and covariance(C, X) is used.
+ *
+ * @param C The covariance matrix of X
+ * @param X A matrix of inputs (one input per row)
+ * @param D The matrix of squared distances between the inputs in X
+ */
+void CovarianceFunction::covarianceFromSqDist(mat& C, const mat& X, const mat& /* D */) const
+{
+    covariance(C, X);
+}
+
+
+/**
+ * Gradient of the covariance matrix of a set of inputs, given the matrix of
+ * squared distances between these inputs. By default, the distances are ignored
+ * and covarianceGradient(G, p, X) is used.
+ *
+ * @param G The gradient of cov(X,X) with respect to parameter p
+ * @param p The parameter number
+ * @param X A matrix of inputs (one input per row)
+ * @param D The matrix of squared distances between the inputs in X
+ */
+void CovarianceFunction::covarianceGradientFromSqDist(mat& G, const int p, const mat& X, const mat& /* D */) const
+{
+    covarianceGradient(G, p, X);
+}
+
+
+/**
+ * Gradient of the covariance between two sets of inputs X1 and X2, i.e. 
+ * d/dp cov(X1,X2). By default, this is computed tile by tile: for tiles
+ * of CROSS_GRADIENT_TILE_SIZE inputs of X1 and X2, the off-diagonal block
+ * of the gradient for the stacked tiles is copied into G. The work is 
+ * about four times that of the n x m block, and only small gradient 
+ * matrices are formed. Covariance functions override this with a direct 
+ * computation which, like the cross-covariance, does not use any cache, 
+ * so that it can be called from several threads at once.
+ *
+ * @param G  The nxm gradient of cov(X1,X2) with respect to parameter p
+ * @param p  The parameter number
+ * @param X1 A set of n inputs
+ * @param X2 A set of m inputs
+ */
+void CovarianceFunction::covarianceGradient(mat& G, const int p, const mat& X1, const mat& X2) const
+{
+    int n = X1.rows(), m = X2.rows();
+    G.set_size(n, m);
+
+    mat Gtile;
+    for (int i1 = 0; i1 < n; i1 += CROSS_GRADIENT_TILE_SIZE)
+    {
+        int i2 = min(i1 + CROSS_GRADIENT_TILE_SIZE, n) - 1;
+        mat X1tile = X1.get_rows(i1, i2);
+
+        for (int j1 = 0; j1 < m; j1 += CROSS_GRADIENT_TILE_SIZE)
+        {
+            int j2 = min(j1 + CROSS_GRADIENT_TILE_SIZE, m) - 1;
+            int ni = i2 - i1 + 1, nj = j2 - j1 + 1;
+
+            covarianceGradient(Gtile, p, concat_vertical(X1tile, X2.get_rows(j1, j2)));
+            G.set_submatrix(i1, j1, Gtile.get(0, ni-1, ni, ni+nj-1));
+        }
+    }
+}
+
+
 /**
  * Compute the variance of a diagonal element, i.e. cov(A,A)
  * This is the default and returns computeElement(A,A). This should
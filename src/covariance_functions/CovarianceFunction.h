@@ -41,6 +41,8 @@
 using namespace std;
 using namespace itpp;
 
+#define CROSS_GRADIENT_TILE_SIZE 64   // Inputs per tile in the default cross-covariance gradient
+
 /**
  * Abstract class for covariance function objects. This should be overloaded
  * by specific covariance functions.
@@ -51,6 +53,12 @@ using namespace itpp;
  * the whole real space. Specific covariance should overload the setDefaultTransforms()
  * method to set sensible transforms for all parameters (e.g. one could use a LogTransform
  * to constrain some parameters to remain positive).
+ *
+ * The const methods (covariance, computeDiagonal, gradients) may be called 
+ * from several threads at once, e.g. by PSGP::makeBlockPredictions or 
+ * PSGPPredictiveCovariance, as long as the parameters are not changed at 
+ * the same time. Covariance functions which keep internal caches must 
+ * guard them (see ARDStationaryCF).
  */
 class CovarianceFunction
 {
@@ -68,6 +76,10 @@ public:
     virtual void covariance(mat& C, const mat& X1, const mat& X2) const;
 
     virtual void covarianceGradient(mat& grad, const int parameterNumber, const mat& X) const = 0;
+    virtual void covarianceGradient(mat& grad, const int parameterNumber, const mat& X1, const mat& X2) const;
+
+    virtual void covarianceFromSqDist(mat& C, const mat& X, const mat& D) const;
+    virtual void covarianceGradientFromSqDist(mat& grad, const int parameterNumber, const mat& X, const mat& D) const;
 
     virtual void computeDiagonal(mat& C, const mat& X) const;
     virtual void computeDiagonal(vec& C, const mat& X) const;
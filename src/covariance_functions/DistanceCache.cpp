@@ -0,0 +1,50 @@
+#include "DistanceCache.h"
+#include "StationaryCF.h"
+
+/**
+ * Default constructor (empty cache)
+ */
+DistanceCache::DistanceCache()
+{
+    valid = false;
+}
+
+
+/**
+ * Destructor
+ */
+DistanceCache::~DistanceCache()
+{
+}
+
+
+/**
+ * Return the matrix of squared distances between the inputs in X. The
+ * distances are only recomputed if X differs from the inputs of the
+ * previous call.
+ *
+ * @param X a set of (row) inputs
+ * @return the matrix of squared distances between inputs in X
+ */
+const mat& DistanceCache::sqDistMatrix(const mat& X)
+{
+    if (!valid || !(X == inputs))
+    {
+        inputs = X;
+        StationaryCF::sqDistMatrix(sqDist, X);
+        valid = true;
+    }
+
+    return sqDist;
+}
+
+
+/**
+ * Empty the cache
+ */
+void DistanceCache::clear()
+{
+    inputs.set_size(0, 0);
+    sqDist.set_size(0, 0);
+    valid = false;
+}
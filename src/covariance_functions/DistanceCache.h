@@ -0,0 +1,34 @@
+#ifndef DISTANCECACHE_H_
+#define DISTANCECACHE_H_
+
+#include <itpp/itbase.h>
+
+using namespace itpp;
+
+/**
+ * Cache for the matrix of squared distances between a set of inputs.
+ *
+ * During parameter optimisation, the inputs at which the covariance matrix
+ * is evaluated (e.g. the active set of a PSGP) do not change, so the squared
+ * distances between them only need computing once. The cache keeps a copy
+ * of the inputs and recomputes the distances whenever it is queried with
+ * different inputs. The distances can then be passed to
+ * CovarianceFunction::covarianceFromSqDist and
+ * CovarianceFunction::covarianceGradientFromSqDist.
+ */
+class DistanceCache
+{
+public:
+    DistanceCache();
+    virtual ~DistanceCache();
+
+    const mat& sqDistMatrix(const mat& X);
+    void clear();
+
+private:
+    mat  inputs;        // Inputs for which the distances are currently stored
+    mat  sqDist;        // Squared distances between the inputs
+    bool valid;         // Whether the cache holds any distances
+};
+
+#endif /* DISTANCECACHE_H_ */
@@ -0,0 +1,51 @@
+/*
+ * ExponentialARDCF.cpp
+ *
+ *  Exponential correlation function, with one length scale per input dimension.
+ */
+
+#include "ExponentialARDCF.h"
+
+/**
+ * Default constructor
+ *
+ * @param lengthScales  the correlation length scale for each input dimension
+ * @param variance      the process variance
+ */
+ExponentialARDCF::ExponentialARDCF(const vec& lengthScales, double variance)
+: ARDStationaryCF("Exponential with ARD", lengthScales, variance)
+{
+}
+
+
+/**
+ * Default destructor
+ */
+ExponentialARDCF::~ExponentialARDCF()
+{
+}
+
+
+/**
+ * Correlation between two inputs
+ *
+ * @param r2 the scaled squared distance between the two inputs
+ * @return the correlation between the two inputs
+ */
+double ExponentialARDCF::correlation(double r2) const
+{
+    return exp(-0.5 * sqrt(r2));
+}
+
+
+/**
+ * Derivative of the correlation with respect to the scaled squared distance
+ *
+ * @param r2 the scaled squared distance between the two inputs (r2 > 0)
+ * @return the derivative of the correlation with respect to r2
+ */
+double ExponentialARDCF::correlationDerivative(double r2) const
+{
+    double r = sqrt(r2);
+    return -0.25 * exp(-0.5 * r) / r;
+}
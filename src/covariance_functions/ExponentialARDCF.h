@@ -0,0 +1,28 @@
+/**
+ * ExponentialARDCF.h
+ *
+ *  Exponential correlation function, with one length scale per input dimension.
+ */
+
+#ifndef EXPONENTIALARDCF_H_
+#define EXPONENTIALARDCF_H_
+
+#include "ARDStationaryCF.h"
+
+/**
+ * Exponential correlation function with automatic relevance determination.
+ * See ARDStationaryCF for the definition of the scaled squared distance r2
+ * and the parameter indexing.
+ */
+class ExponentialARDCF : public ARDStationaryCF
+{
+public:
+    ExponentialARDCF(const vec& lengthScales, double variance);
+    virtual ~ExponentialARDCF();
+
+protected:
+    virtual double correlation(double r2) const;
+    virtual double correlationDerivative(double r2) const;
+};
+
+#endif /* EXPONENTIALARDCF_H_ */
@@ -51,3 +51,15 @@ double ExponentialCF::correlationGradient(int p, double sqDist) const
 		return 0.0;
 	}
 }
+
+
+/**
+ * Sample frequencies from the spectral density of the exponential 
+ * correlation function with unit length scale. This is exp(-r/2), a Matern
+ * correlation of order 1/2 with length scale 2, whose spectral density is
+ * a (multivariate) Cauchy density.
+ */
+void ExponentialCF::sampleSpectralDensity(mat& W, int nFrequencies, int nDims) const
+{
+	sampleStudentT(W, nFrequencies, nDims, 1, 2.0);
+}
@@ -44,6 +44,8 @@ public:
 	ExponentialCF(double lengthScale, double variance);
 	virtual ~ExponentialCF();
 	
+	virtual void sampleSpectralDensity(mat& W, int nFrequencies, int nDims) const;
+	
 	virtual double correlation(double sqDist) const;
 	virtual double correlationGradient(int parameterNumber, double sqDist) const;
 };
@@ -0,0 +1,50 @@
+/*
+ * GaussianARDCF.cpp
+ *
+ *  Gaussian (squared exponential) correlation function, with one length scale per input dimension.
+ */
+
+#include "GaussianARDCF.h"
+
+/**
+ * Default constructor
+ *
+ * @param lengthScales  the correlation length scale for each input dimension
+ * @param variance      the process variance
+ */
+GaussianARDCF::GaussianARDCF(const vec& lengthScales, double variance)
+: ARDStationaryCF("Gaussian (squared exponential) with ARD", lengthScales, variance)
+{
+}
+
+
+/**
+ * Default destructor
+ */
+GaussianARDCF::~GaussianARDCF()
+{
+}
+
+
+/**
+ * Correlation between two inputs
+ *
+ * @param r2 the scaled squared distance between the two inputs
+ * @return the correlation between the two inputs
+ */
+double GaussianARDCF::correlation(double r2) const
+{
+    return exp(-0.5 * r2);
+}
+
+
+/**
+ * Derivative of the correlation with respect to the scaled squared distance
+ *
+ * @param r2 the scaled squared distance between the two inputs (r2 > 0)
+ * @return the derivative of the correlation with respect to r2
+ */
+double GaussianARDCF::correlationDerivative(double r2) const
+{
+    return -0.5 * exp(-0.5 * r2);
+}
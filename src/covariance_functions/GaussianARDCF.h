@@ -0,0 +1,28 @@
+/**
+ * GaussianARDCF.h
+ *
+ *  Gaussian (squared exponential) correlation function, with one length scale per input dimension.
+ */
+
+#ifndef GAUSSIANARDCF_H_
+#define GAUSSIANARDCF_H_
+
+#include "ARDStationaryCF.h"
+
+/**
+ * Gaussian (squared exponential) correlation function with automatic relevance determination.
+ * See ARDStationaryCF for the definition of the scaled squared distance r2
+ * and the parameter indexing.
+ */
+class GaussianARDCF : public ARDStationaryCF
+{
+public:
+    GaussianARDCF(const vec& lengthScales, double variance);
+    virtual ~GaussianARDCF();
+
+protected:
+    virtual double correlation(double r2) const;
+    virtual double correlationDerivative(double r2) const;
+};
+
+#endif /* GAUSSIANARDCF_H_ */
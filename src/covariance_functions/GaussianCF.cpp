@@ -63,3 +63,12 @@ double GaussianCF::correlationGradient(int p, double sqDist) const
     }
 }
 
+
+/**
+ * Sample frequencies from the spectral density of the Gaussian correlation
+ * function with unit length scale, i.e. a standard normal density
+ */
+void GaussianCF::sampleSpectralDensity(mat& W, int nFrequencies, int nDims) const
+{
+    W = randn(nFrequencies, nDims);
+}
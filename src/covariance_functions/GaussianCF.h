@@ -15,6 +15,8 @@ public:
     GaussianCF(double lengthScale, double variance);
     virtual ~GaussianCF();
 
+    virtual void sampleSpectralDensity(mat& W, int nFrequencies, int nDims) const;
+
 protected:
     virtual double correlation(double sqDist) const;
     virtual double correlationGradient(int parameterNumber, double sqDist) const;
@@ -0,0 +1,206 @@
+#include "InputSelectCF.h"
+
+/**
+ * Constructor
+ *
+ * @param cf   the covariance function to restrict
+ * @param dims the input dimensions (column indices) cf acts on
+ */
+InputSelectCF::InputSelectCF(CovarianceFunction& cf, const ivec& dims)
+: CovarianceFunction("Input selection", 0)
+{
+	assert(dims.size() > 0);
+
+	covFunction = &cf;
+	dimensions = dims;
+	numberParameters = cf.getNumberParameters();
+}
+
+
+/**
+ * Destructor
+ */
+InputSelectCF::~InputSelectCF()
+{
+}
+
+
+/**
+ * The selected dimensions of a set of inputs. If all the columns of X are
+ * selected, in order, X itself is returned. Otherwise the selected columns
+ * are copied into selected, which is returned.
+ *
+ * @param X        a set of inputs
+ * @param selected storage for the selected columns of X
+ * @return the inputs restricted to the selected dimensions
+ */
+const mat& InputSelectCF::selectInputs(const mat& X, mat& selected) const
+{
+    bool all = (dimensions.size() == X.cols());
+    for (int i=0; all && i<dimensions.size(); i++) all = (dimensions(i) == i);
+
+    if (all) return X;
+
+    selected = X.get_cols(dimensions);
+    return selected;
+}
+
+
+/**
+ * Computes the covariance between the selected dimensions of inputs A and B
+ *
+ * @param A the first input
+ * @param B the second input
+ * @return the covariance between A and B
+ */
+inline double InputSelectCF::computeElement(const vec& A, const vec& B) const
+{
+	return covFunction->computeElement(A(dimensions), B(dimensions));
+}
+
+
+/**
+ * Computes the variance of an input A
+ *
+ * @param A an input
+ * @return the variance of A
+ */
+inline double InputSelectCF::computeDiagonalElement(const vec& A) const
+{
+	return covFunction->computeDiagonalElement(A(dimensions));
+}
+
+
+/**
+ * Covariance matrix of a set of inputs, restricted to the selected dimensions
+ *
+ * @param C      the covariance matrix cov(X,X)
+ * @param X      a set of inputs
+ */
+void InputSelectCF::covariance(mat& C, const mat& X) const
+{
+    mat selected;
+    C.set_size(X.rows(), X.rows());
+    covFunction->covariance(C, selectInputs(X, selected));
+}
+
+
+/**
+ * Covariance matrix between two sets of inputs, restricted to the
+ * selected dimensions
+ *
+ * @param C      the covariance matrix cov(X1,X2)
+ * @param X1     the first set of inputs
+ * @param X2     the second set of inputs
+ */
+void InputSelectCF::covariance(mat& C, const mat& X1, const mat& X2) const
+{
+    mat selected1, selected2;
+    C.set_size(X1.rows(), X2.rows());
+    covFunction->covariance(C, selectInputs(X1, selected1), selectInputs(X2, selected2));
+}
+
+
+/**
+ * Diagonal of the covariance matrix cov(X,X)
+ *
+ * @param C      the vector of variances C_i = cov(X_i, X_i)
+ * @param X      a set of inputs
+ */
+void InputSelectCF::computeDiagonal(vec& C, const mat& X) const
+{
+    mat selected;
+    C.set_size(X.rows());
+    covFunction->computeDiagonal(C, selectInputs(X, selected));
+}
+
+
+/**
+ * Gradient of the covariance matrix with respect to a given parameter
+ *
+ * @param G      the gradient of cov(X,X) with respect to parameter number p
+ * @param p      the parameter number
+ * @param X      a set of inputs
+ */
+void InputSelectCF::covarianceGradient(mat& G, const int p, const mat& X) const
+{
+    mat selected;
+    G.set_size(X.rows(), X.rows());
+    covFunction->covarianceGradient(G, p, selectInputs(X, selected));
+}
+
+
+/**
+ * Gradient of the covariance between two sets of inputs with respect to
+ * a given parameter
+ *
+ * @param G      the gradient of cov(X1,X2) with respect to parameter p
+ * @param p      the parameter number
+ * @param X1     a set of inputs
+ * @param X2     a set of inputs
+ */
+void InputSelectCF::covarianceGradient(mat& G, const int p, const mat& X1, const mat& X2) const
+{
+    mat selected1, selected2;
+    G.set_size(X1.rows(), X2.rows());
+    covFunction->covarianceGradient(G, p, selectInputs(X1, selected1), selectInputs(X2, selected2));
+}
+
+
+/**
+ * Display information about the current parameters of the covariance function.
+ *
+ * @param nspaces Number of space characters to indent by.
+ */
+void InputSelectCF::displayCovarianceParameters(int nspaces) const
+{
+	string space(nspaces, ' ');
+
+	cout << space << "Covariance function : Input selection " << dimensions << endl;
+	covFunction->displayCovarianceParameters(nspaces+2);
+}
+
+
+/*
+ * Parameter access is forwarded to the wrapped covariance function
+ */
+Transform* InputSelectCF::getTransform(int p) const
+{
+    return covFunction->getTransform(p);
+}
+
+
+void InputSelectCF::setTransform(int p, Transform* t)
+{
+    covFunction->setTransform(p, t);
+}
+
+
+void InputSelectCF::setTransformedParameters(const vec p)
+{
+    covFunction->setTransformedParameters(p);
+}
+
+
+vec InputSelectCF::getTransformedParameters()
+{
+    return covFunction->getTransformedParameters();
+}
+
+
+void InputSelectCF::setParameter(const int p, const double value)
+{
+    covFunction->setParameter(p, value);
+}
+
+
+double InputSelectCF::getParameter(const int p) const
+{
+    return covFunction->getParameter(p);
+}
+
+
+string InputSelectCF::getParameterName(const int p) const
+{
+    return covFunction->getParameterName(p);
+}
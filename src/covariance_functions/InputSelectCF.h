@@ -0,0 +1,96 @@
+/***************************************************************************
+ *   AstonGeostats, algorithms for low-rank geostatistical models          *
+ *                                                                         *
+ *   Copyright (C) Ben Ingram, 2008                                        *
+ *                                                                         *
+ *   Ben Ingram, IngramBR@Aston.ac.uk                                      *
+ *   Neural Computing Research Group,                                      *
+ *   Aston University,                                                     *
+ *   Aston Street, Aston Triangle,                                         *
+ *   Birmingham. B4 7ET.                                                   *
+ *   United Kingdom                                                        *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#ifndef INPUTSELECTCF_H_
+#define INPUTSELECTCF_H_
+
+#include "CovarianceFunction.h"
+#include "parameter_transforms/Transform.h"
+
+#include <cassert>
+#include <itpp/itbase.h>
+
+using namespace std;
+using namespace itpp;
+
+/**
+ * Wrapper restricting a covariance function to a subset of the input
+ * dimensions (columns of the input matrices). The wrapped covariance
+ * function is evaluated on the selected columns only, using its own
+ * matrix routines. The wrapper has the same parameters as the wrapped
+ * covariance function.
+ *
+ * For instance, with inputs (x, y, t), a separable space-time covariance
+ * function is obtained as:
+ *
+ *   InputSelectCF space(spaceCF, "0 1");
+ *   InputSelectCF time(timeCF, "2");
+ *   ProductCF cf(space);
+ *   cf.add(time);
+ */
+class InputSelectCF : public CovarianceFunction
+{
+public:
+	InputSelectCF(CovarianceFunction& cf, const ivec& dims);
+	~InputSelectCF();
+
+	inline double computeElement(const vec& A, const vec& B) const;
+	inline double computeDiagonalElement(const vec& A) const;
+
+	using CovarianceFunction::covariance;
+	using CovarianceFunction::computeDiagonal;
+
+	void covariance(mat& C, const mat& X) const;
+	void covariance(mat& C, const mat& X1, const mat& X2) const;
+	void computeDiagonal(vec& C, const mat& X) const;
+
+	void covarianceGradient(mat& G, const int p, const mat& X) const;
+	void covarianceGradient(mat& G, const int p, const mat& X1, const mat& X2) const;
+
+	// Parameters are those of the wrapped covariance function
+	void   setParameter(const int parameterNumber, const double value);
+	double getParameter(const int parameterNumber) const;
+	string getParameterName(const int parameterNumber) const;
+
+	void   setTransformedParameters(const vec p);
+	vec    getTransformedParameters();
+
+	void setTransform(int parameterNumber, Transform* newTransform);
+	Transform* getTransform(int parameterNumber) const;
+
+	void displayCovarianceParameters(int nspaces = 0) const;
+
+	const mat& selectInputs(const mat& X, mat& selected) const;
+	CovarianceFunction* getCovarianceFunction() const { return covFunction; }
+
+private:
+	CovarianceFunction *covFunction;
+	ivec dimensions;
+};
+
+#endif /*INPUTSELECTCF_H_*/
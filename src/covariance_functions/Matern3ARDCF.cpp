@@ -0,0 +1,52 @@
+/*
+ * Matern3ARDCF.cpp
+ *
+ *  Matern 3/2 correlation function, with one length scale per input dimension.
+ */
+
+#include "Matern3ARDCF.h"
+
+/**
+ * Default constructor
+ *
+ * @param lengthScales  the correlation length scale for each input dimension
+ * @param variance      the process variance
+ */
+Matern3ARDCF::Matern3ARDCF(const vec& lengthScales, double variance)
+: ARDStationaryCF("Matern 3/2 with ARD", lengthScales, variance)
+{
+}
+
+
+/**
+ * Default destructor
+ */
+Matern3ARDCF::~Matern3ARDCF()
+{
+}
+
+
+/**
+ * Correlation between two inputs
+ *
+ * @param r2 the scaled squared distance between the two inputs
+ * @return the correlation between the two inputs
+ */
+double Matern3ARDCF::correlation(double r2) const
+{
+    double r = sqrt(3.0 * r2);
+    return (1.0+r) * exp(-r);
+}
+
+
+/**
+ * Derivative of the correlation with respect to the scaled squared distance
+ *
+ * @param r2 the scaled squared distance between the two inputs (r2 > 0)
+ * @return the derivative of the correlation with respect to r2
+ */
+double Matern3ARDCF::correlationDerivative(double r2) const
+{
+    double r = sqrt(3.0 * r2);
+    return -1.5 * exp(-r);
+}
@@ -0,0 +1,28 @@
+/**
+ * Matern3ARDCF.h
+ *
+ *  Matern 3/2 correlation function, with one length scale per input dimension.
+ */
+
+#ifndef MATERN3ARDCF_H_
+#define MATERN3ARDCF_H_
+
+#include "ARDStationaryCF.h"
+
+/**
+ * Matern 3/2 correlation function with automatic relevance determination.
+ * See ARDStationaryCF for the definition of the scaled squared distance r2
+ * and the parameter indexing.
+ */
+class Matern3ARDCF : public ARDStationaryCF
+{
+public:
+    Matern3ARDCF(const vec& lengthScales, double variance);
+    virtual ~Matern3ARDCF();
+
+protected:
+    virtual double correlation(double r2) const;
+    virtual double correlationDerivative(double r2) const;
+};
+
+#endif /* MATERN3ARDCF_H_ */
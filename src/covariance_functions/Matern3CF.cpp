@@ -56,3 +56,13 @@ double Matern3CF::correlationGradient(int p, double sqDist) const
     }
 }
 
+
+/**
+ * Sample frequencies from the spectral density of the Matern 3/2 
+ * correlation function with unit length scale, i.e. a Student-t density
+ * with 3 degrees of freedom
+ */
+void Matern3CF::sampleSpectralDensity(mat& W, int nFrequencies, int nDims) const
+{
+    sampleStudentT(W, nFrequencies, nDims, 3, 1.0);
+}
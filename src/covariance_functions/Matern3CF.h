@@ -17,6 +17,8 @@ public:
     Matern3CF(double variance, double lengthScale);
     virtual ~Matern3CF();
 
+    virtual void sampleSpectralDensity(mat& W, int nFrequencies, int nDims) const;
+
 protected:
     virtual double correlation(double sqDist) const;
     virtual double correlationGradient(int parameterNumber, double sqDist) const;
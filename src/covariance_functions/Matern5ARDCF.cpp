@@ -0,0 +1,52 @@
+/*
+ * Matern5ARDCF.cpp
+ *
+ *  Matern 5/2 correlation function, with one length scale per input dimension.
+ */
+
+#include "Matern5ARDCF.h"
+
+/**
+ * Default constructor
+ *
+ * @param lengthScales  the correlation length scale for each input dimension
+ * @param variance      the process variance
+ */
+Matern5ARDCF::Matern5ARDCF(const vec& lengthScales, double variance)
+: ARDStationaryCF("Matern 5/2 with ARD", lengthScales, variance)
+{
+}
+
+
+/**
+ * Default destructor
+ */
+Matern5ARDCF::~Matern5ARDCF()
+{
+}
+
+
+/**
+ * Correlation between two inputs
+ *
+ * @param r2 the scaled squared distance between the two inputs
+ * @return the correlation between the two inputs
+ */
+double Matern5ARDCF::correlation(double r2) const
+{
+    double r = sqrt(5.0 * r2);
+    return ( 1.0 + r + sqr(r)/3.0 ) * exp(-r);
+}
+
+
+/**
+ * Derivative of the correlation with respect to the scaled squared distance
+ *
+ * @param r2 the scaled squared distance between the two inputs (r2 > 0)
+ * @return the derivative of the correlation with respect to r2
+ */
+double Matern5ARDCF::correlationDerivative(double r2) const
+{
+    double r = sqrt(5.0 * r2);
+    return -5.0/6.0 * (1.0+r) * exp(-r);
+}
@@ -0,0 +1,28 @@
+/**
+ * Matern5ARDCF.h
+ *
+ *  Matern 5/2 correlation function, with one length scale per input dimension.
+ */
+
+#ifndef MATERN5ARDCF_H_
+#define MATERN5ARDCF_H_
+
+#include "ARDStationaryCF.h"
+
+/**
+ * Matern 5/2 correlation function with automatic relevance determination.
+ * See ARDStationaryCF for the definition of the scaled squared distance r2
+ * and the parameter indexing.
+ */
+class Matern5ARDCF : public ARDStationaryCF
+{
+public:
+    Matern5ARDCF(const vec& lengthScales, double variance);
+    virtual ~Matern5ARDCF();
+
+protected:
+    virtual double correlation(double r2) const;
+    virtual double correlationDerivative(double r2) const;
+};
+
+#endif /* MATERN5ARDCF_H_ */
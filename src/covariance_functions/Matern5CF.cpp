@@ -56,3 +56,12 @@ double Matern5CF::correlationGradient(int p, double sqDist) const
 }
 
 
+/**
+ * Sample frequencies from the spectral density of the Matern 5/2 
+ * correlation function with unit length scale, i.e. a Student-t density
+ * with 5 degrees of freedom
+ */
+void Matern5CF::sampleSpectralDensity(mat& W, int nFrequencies, int nDims) const
+{
+    sampleStudentT(W, nFrequencies, nDims, 5, 1.0);
+}
@@ -15,6 +15,8 @@ public:
     Matern5CF(double variance, double lengthScale);
     virtual ~Matern5CF();
 
+    virtual void sampleSpectralDensity(mat& W, int nFrequencies, int nDims) const;
+
 protected:
     virtual double correlation(double sqDist) const;
     virtual double correlationGradient(int parameterNumber, double sqDist) const;
@@ -1,4 +1,5 @@
 #include "NeuralNetCF.h"
+#include "itppext/atomics.h"
 
 /*
  * Constructor - pass in the length scale, variance and offset
@@ -8,7 +9,7 @@ NeuralNetCF::NeuralNetCF(double ls, double var, double offst)
 variance(parameters[1]), offset(parameters[2])
 {
     // Make sure parameters are positive 
-    assert( ls > 0.0 && var > 0.0 && offset > 0.0);  
+    assert( ls > 0.0 && var > 0.0 && offst >= 0.0);  
     
     sigma2 = ls;   // Length scale
     variance = var;
@@ -18,6 +19,9 @@ variance(parameters[1]), offset(parameters[2])
     parametersNames[0] = "sigma2";
     parametersNames[1] = "variance";
     parametersNames[2] = "offset";
+
+    gramValid = false;
+    cacheBusy = 0;
 }
 
 
@@ -48,8 +52,77 @@ inline double NeuralNetCF::computeElement(const vec& A, const vec& B) const
     return variance * asin( u / v) * 2/M_PI;
 }
 
+/**
+ * Covariance matrix of a set of inputs. The inner products between inputs
+ * are obtained from a single matrix product X*X', after which the arcsine
+ * is applied in one pass over the lower triangle.
+ *
+ * @param C the covariance matrix cov(X,X)
+ * @param X a set of (row) inputs
+ */
+void NeuralNetCF::covariance(mat& C, const mat& X) const
+{
+    mat local;
+    bool cached;
+    const mat& XX = gramMatrix(X, local, cached);
+
+    int n = X.rows();
+    double scale = variance * 2/M_PI;
+
+    // 1/sqrt(1 + offset + sigma2*|x_i|^2) for each input
+    vec s(n);
+    for (int i=0; i<n; i++) s(i) = 1.0 / sqrt(1.0 + offset + sigma2*XX(i,i));
+
+    C.set_size(n, n);
+
+    for (int j=0; j<n; j++) {
+        for (int i=j; i<n; i++) {
+            double c = scale * asin( (offset + sigma2*XX(i,j)) * s(i) * s(j) );
+            C(i,j) = c;
+            C(j,i) = c;
+        }
+    }
+
+    if (cached) releaseCache();
+}
+
+
+/**
+ * Covariance matrix between two sets of inputs, computed from the matrix
+ * product X1*X2' and the squared norms of the inputs.
+ *
+ * @param C  the nxm covariance matrix cov(X1,X2)
+ * @param X1 a set of n (row) inputs
+ * @param X2 a set of m (row) inputs
+ */
+void NeuralNetCF::covariance(mat& C, const mat& X1, const mat& X2) const
+{
+    assert(X1.cols() == X2.cols());
+
+    int n1 = X1.rows();
+    int n2 = X2.rows();
+    double scale = variance * 2/M_PI;
+
+    // Squared norm of each input (row sums of squares)
+    vec s1 = sum_sqr(X1, 2);
+    vec s2 = sum_sqr(X2, 2);
+    for (int i=0; i<n1; i++) s1(i) = 1.0 / sqrt(1.0 + offset + sigma2*s1(i));
+    for (int j=0; j<n2; j++) s2(j) = 1.0 / sqrt(1.0 + offset + sigma2*s2(j));
+
+    C = X1 * X2.transpose();
+
+    for (int j=0; j<n2; j++) {
+        for (int i=0; i<n1; i++) {
+            C(i,j) = scale * asin( (offset + sigma2*C(i,j)) * s1(i) * s2(j) );
+        }
+    }
+}
+
+
 /** 
- * Gradient of cov(X) w.r.t. given parameter number
+ * Gradient of cov(X) w.r.t. given parameter number. The gradients with
+ * respect to sigma2 and offset are obtained from the Gram matrix X*X'
+ * (shared with the covariance matrix) in a single pass.
  */
 void NeuralNetCF::covarianceGradient(mat& grad, const int parameterNumber, const mat& X) const
 {
@@ -59,79 +132,171 @@ void NeuralNetCF::covarianceGradient(mat& grad, const int parameterNumber, const
     Transform* t = getTransform(parameterNumber);
     double gradientModifier = t->gradientTransform(getParameter(parameterNumber));
 
-    switch(parameterNumber)
+    if (parameterNumber == 1)
     {
-        // Derivative with respect to sigma2
-		case 0 :
+        // Derivative with respect to variance
+        covariance(grad, X);
+        grad *= gradientModifier / variance;
+        return;
+    }
+
+    mat local;
+    bool cached;
+    const mat& XX = gramMatrix(X, local, cached);
+
+    int n = X.rows();
+    double scale = gradientModifier * variance * 2/M_PI;
+
+    // Squared norm of each input (a) and v_i = 1 + offset + sigma2*a_i
+    vec a(n), vA(n);
+    for (int i=0; i<n; i++)
+    {
+        a(i) = XX(i,i);
+        vA(i) = 1.0 + offset + sigma2*a(i);
+    }
+
+    grad.set_size(n, n);
+
+    // d/dtheta asin(u/v) = (du*v - u*dv) / (v*sqrt(v^2 - u^2)), with
+    // u = offset + sigma2*x_i'x_j and v = sqrt(v_i*v_j)
+    for (int j=0; j<n; j++)
+    {
+        for (int i=j; i<n; i++)
         {
-            vec Xi, Xj;
-            
-            for (int i=0; i<X.rows(); i++)
+            double u = offset + sigma2*XX(i,j);
+            double v = sqrt(vA(i)*vA(j));
+            double du, dv;
+
+            if (parameterNumber == 0)
+            {
+                // Derivative with respect to sigma2
+                du = XX(i,j);
+                dv = 0.5 * (a(i)*vA(j) + vA(i)*a(j)) / v;
+            }
+            else
             {
-                Xi = X.get_row(i);
-                
-                double vA = 1 + offset + dot(Xi, Xi) * sigma2;
-                double dvA = dot(Xi, Xi);
-                
-                for (int j=0; j<=i; j++) 
-                {
-                    Xj = X.get_row(j);
-                    
-                    double u = offset+dot(Xi,Xj)*sigma2;
-                    double vB = 1 + offset + dot(Xj, Xj) * sigma2;
-                    double v = sqrt(vA*vB);
-                    
-                    double du = dot(Xi,Xj);
-                    double dvB = dot(Xj, Xj);
-                    double dv = 0.5 * (dvA*vB + vA*dvB) / v;
-                    
-                    grad(i,j) = (du*v - u*dv) / (v*sqrt(v*v - u*u));
-                    grad(j,i) = grad(i,j);
-                }
+                // Derivative with respect to offset
+                du = 1.0;
+                dv = 0.5 * (vA(j) + vA(i)) / v;
             }
-            grad *= variance * 2/M_PI;
 
-            break;
+            double g = scale * (du*v - u*dv) / (v*sqrt(v*v - u*u));
+            grad(i,j) = g;
+            grad(j,i) = g;
         }
+    }
+
+    if (cached) releaseCache();
+}
+
 
+/**
+ * Gradient of cov(X1,X2) w.r.t. given parameter number, from the product 
+ * X1*X2' (no cache, as for the cross-covariance)
+ */
+void NeuralNetCF::covarianceGradient(mat& grad, const int parameterNumber, const mat& X1, const mat& X2) const
+{
+    assert(parameterNumber < getNumberParameters());
+    assert(parameterNumber >= 0);
+    assert(X1.cols() == X2.cols());
+
+    Transform* t = getTransform(parameterNumber);
+    double gradientModifier = t->gradientTransform(getParameter(parameterNumber));
+
+    if (parameterNumber == 1)
+    {
         // Derivative with respect to variance
-        case 1 :
+        grad.set_size(X1.rows(), X2.rows());
+        covariance(grad, X1, X2);
+        grad *= gradientModifier / variance;
+        return;
+    }
+
+    int n1 = X1.rows();
+    int n2 = X2.rows();
+    double scale = gradientModifier * variance * 2/M_PI;
+
+    // Squared norm of each input (a) and v_i = 1 + offset + sigma2*a_i
+    vec a1 = sum_sqr(X1, 2);
+    vec a2 = sum_sqr(X2, 2);
+    vec vA1 = 1.0 + offset + sigma2*a1;
+    vec vA2 = 1.0 + offset + sigma2*a2;
+
+    grad = X1 * X2.transpose();
+
+    for (int j=0; j<n2; j++)
+    {
+        for (int i=0; i<n1; i++)
         {
-            covariance(grad, X);
-            grad /= variance;
-            break;
+            double u = offset + sigma2*grad(i,j);
+            double v = sqrt(vA1(i)*vA2(j));
+            double du, dv;
+
+            if (parameterNumber == 0)
+            {
+                du = grad(i,j);
+                dv = 0.5 * (a1(i)*vA2(j) + vA1(i)*a2(j)) / v;
+            }
+            else
+            {
+                du = 1.0;
+                dv = 0.5 * (vA2(j) + vA1(i)) / v;
+            }
+
+            grad(i,j) = scale * (du*v - u*dv) / (v*sqrt(v*v - u*u));
         }
+    }
+}
 
-        // Derivative with respect to offset
-        case 2:
-        	vec Xi, Xj;
 
-        	for (int i=0; i<X.rows(); i++)
-        	{
-        		Xi = X.get_row(i);
+/**
+ * Gram matrix X*X'. If X is small enough and the cache is not in use by
+ * another thread, the cache is acquired (cached is set, and releaseCache
+ * must be called once the matrix is no longer needed) and updated unless 
+ * it already holds X. Otherwise, the matrix is computed into local.
+ *
+ * @param X      a set of (row) inputs
+ * @param local  storage for the Gram matrix when the cache is not used
+ * @param cached set if the returned matrix is the cache
+ * @return the Gram matrix X*X'
+ */
+const mat& NeuralNetCF::gramMatrix(const mat& X, mat& local, bool& cached) const
+{
+    cached = X.rows() <= NEURALNET_CACHE_MAX_INPUTS && itppext::atomic_try_acquire(&cacheBusy);
 
-        		double vA = 1 + offset + dot(Xi, Xi) * sigma2;
+    if (!cached)
+    {
+        local = X * X.transpose();
+        return local;
+    }
 
-        		for (int j=0; j<=i; j++) 
-        		{
-        			Xj = X.get_row(j);
+    if (!(gramValid && X.rows() == gramInputs.rows() && X.cols() == gramInputs.cols() && X == gramInputs))
+    {
+        gramInputs = X;
+        gram = X * X.transpose();
+        gramValid = true;
+    }
+    return gram;
+}
 
-        			double u = offset+dot(Xi,Xj)*sigma2;
-        			double vB = 1 + offset + dot(Xj, Xj) * sigma2;
-        			double v = sqrt(vA*vB);
 
-        			double dv = 0.5 * (vB + vA) / v;
+/**
+ * Release the cache acquired by gramMatrix
+ */
+void NeuralNetCF::releaseCache() const
+{
+    itppext::atomic_release(&cacheBusy);
+}
 
-        			grad(i,j) = (v - u*dv) / (v*sqrt(v*v - u*u));
-        			grad(j,i) = grad(i,j);
-        		}
-        	}
-        	grad *= variance * 2/M_PI;
 
-        	break;
-    }
-    
-    
-    grad *= gradientModifier;
+/**
+ * Free the cached Gram matrix (e.g. once training is finished)
+ */
+void NeuralNetCF::clearCache()
+{
+    assert(cacheBusy == 0);
 
+    gramValid = false;
+    gramInputs.set_size(0, 0);
+    gram.set_size(0, 0);
 }
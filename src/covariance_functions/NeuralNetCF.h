@@ -3,6 +3,8 @@
 
 #include "CovarianceFunction.h"
 
+#define NEURALNET_CACHE_MAX_INPUTS 2000    // Largest set of inputs whose Gram matrix is cached
+
 /**
  * Neural network covariance function
  * 
@@ -12,6 +14,13 @@
  * 
  * where r = 1/(lengthscale^2) and s = variance is a scaling factor.
  * 
+ * The Gram matrix X*X' of the last set of (at most NEURALNET_CACHE_MAX_INPUTS)
+ * inputs is cached, so that the covariance matrix and its gradients for 
+ * the same inputs share a single matrix product. The cache is only used by
+ * one thread at a time: a thread which finds it in use computes the Gram 
+ * matrix itself, so that concurrent calls are safe (as long as the 
+ * parameters are not changed at the same time). 
+ * 
  * (C) 2009 Remi Barillec <r.barillec@aston.ac.uk>
  */
 class NeuralNetCF : public CovarianceFunction
@@ -22,9 +31,27 @@ public:
 
 	inline double computeElement(const vec& A, const vec& B) const;
 
+	using CovarianceFunction::covariance;
+
+	virtual void covariance(mat& C, const mat& X) const;
+	virtual void covariance(mat& C, const mat& X1, const mat& X2) const;
+
 	virtual void covarianceGradient(mat& grad, const int parameterNumber, const mat& X) const;
+	virtual void covarianceGradient(mat& grad, const int parameterNumber, const mat& X1, const mat& X2) const;
+
+	void clearCache();
 
 private:
+    const mat& gramMatrix(const mat& X, mat& local, bool& cached) const;
+    void releaseCache() const;
+
+    // Gram matrix X*X' of the last set of inputs. This does not depend on
+    // the parameters, so it is shared by the covariance and all gradients.
+    mutable int cacheBusy;          // Set while a thread uses the cache
+    mutable bool gramValid;
+    mutable mat gramInputs;
+    mutable mat gram;
+
     double &sigma2;                		// Controls the scaling on the x axis
     double &offset;                     // Controls the offset to the origin
     double &variance;                   // Controls the process variance
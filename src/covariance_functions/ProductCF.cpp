@@ -0,0 +1,545 @@
+#include "ProductCF.h"
+#include "InputSelectCF.h"
+
+/**
+ * Constructor
+ */
+ProductCF::ProductCF()
+: CovarianceFunction("Product Covariance",0)
+{
+	covFunctions.clear();
+}
+
+ProductCF::ProductCF(CovarianceFunction& cf)
+: CovarianceFunction("Product Covariance", 0)
+{
+	covFunctions.clear();
+	add(cf);
+}
+
+
+
+/**
+ * Destructor
+ */
+ProductCF::~ProductCF()
+{
+}
+
+
+/**
+ * Add a covariance function to the product
+ *
+ * @param cf a covariance function object
+ */
+void ProductCF::add(CovarianceFunction& cf)
+{
+	covFunctions.push_back(&cf);
+	numberParameters += cf.getNumberParameters();
+}
+
+
+/**
+ * Computes the covariance between inputs A and B
+ *
+ * @param A the first input
+ * @param B the second input
+ * @return the covariance between A and B
+ */
+inline double ProductCF::computeElement(const vec& A, const vec& B) const
+{
+	double k = 1.0;
+
+	for(std::vector<CovarianceFunction *>::size_type i = 0; i < covFunctions.size(); i++)
+	{
+		k = k * covFunctions[i]->computeElement(A, B);
+	}
+
+	return k;
+}
+
+
+/**
+ * Computes the variance of an input A
+ *
+ * @param A an input
+ * @return the variance of A
+ */
+inline double ProductCF::computeDiagonalElement(const vec& A) const
+{
+	double k = 1.0;
+
+	for(std::vector<CovarianceFunction *>::size_type i = 0; i < covFunctions.size(); i++)
+	{
+		k = k * covFunctions[i]->computeDiagonalElement(A);
+	}
+
+	return k;
+}
+
+
+/**
+ * Covariance matrix of a set of inputs (fused evaluation, see fusedProduct)
+ *
+ * @param C      the covariance matrix cov(X,X)
+ * @param X      a set of inputs
+ */
+void ProductCF::covariance(mat& C, const mat& X) const
+{
+    assert(covFunctions.size() > 0);
+
+    if (covFunctions.size() == 1)
+    {
+        C.set_size(X.rows(), X.rows());
+        covFunctions[0]->covariance(C, X);
+        return;
+    }
+
+    fusedProduct(C, X, NULL, -1, 0);
+}
+
+
+/**
+ * Covariance matrix between two sets of inputs (fused evaluation, see 
+ * fusedProduct)
+ *
+ * @param C      the covariance matrix cov(X1,X2)
+ * @param X1     the first set of inputs
+ * @param X2     the second set of inputs
+ */
+void ProductCF::covariance(mat& C, const mat& X1, const mat& X2) const
+{
+    assert(covFunctions.size() > 0);
+
+    if (covFunctions.size() == 1)
+    {
+        C.set_size(X1.rows(), X2.rows());
+        covFunctions[0]->covariance(C, X1, X2);
+        return;
+    }
+
+    fusedProduct(C, X1, &X2, -1, 0);
+}
+
+
+/**
+ * Diagonal of the covariance matrix cov(X,X)
+ *
+ * @param C      the vector of variances C_i = cov(X_i, X_i)
+ * @param X      a set of inputs
+ */
+void ProductCF::computeDiagonal(vec& C, const mat& X) const
+{
+    assert(covFunctions.size() > 0);
+
+    C.set_size(X.rows());
+    covFunctions[0]->computeDiagonal(C, X);
+
+    if (covFunctions.size() == 1) return;
+
+    vec K(X.rows());
+
+    for(std::vector<CovarianceFunction *>::size_type i = 1; i < covFunctions.size(); i++)
+    {
+        covFunctions[i]->computeDiagonal(K, X);
+        for (int j=0; j<C.size(); j++) C(j) *= K(j);
+    }
+}
+
+
+/**
+ * Covariance matrix of a set of inputs from a precomputed matrix of squared
+ * distances, which is passed on to each covariance function in the product.
+ * Unlike covariance(), this is not fused: the covariance functions only 
+ * accept the distances for a whole (symmetric) set of inputs, so each of 
+ * them fills a full work matrix, which is multiplied into C.
+ *
+ * @param C      the covariance matrix cov(X,X)
+ * @param X      a set of inputs
+ * @param D      the matrix of squared distances between inputs in X
+ */
+void ProductCF::covarianceFromSqDist(mat& C, const mat& X, const mat& D) const
+{
+    assert(covFunctions.size() > 0);
+
+    C.set_size(X.rows(), X.rows());
+    covFunctions[0]->covarianceFromSqDist(C, X, D);
+
+    if (covFunctions.size() == 1) return;
+
+    mat K(X.rows(), X.rows());
+
+    for(std::vector<CovarianceFunction *>::size_type i = 1; i < covFunctions.size(); i++)
+    {
+        covFunctions[i]->covarianceFromSqDist(K, X, D);
+        multiplyElements(C, K);
+    }
+}
+
+
+/**
+ * Display information about the current parameters of the covariance functions.
+ * This can be indented by an optional number of space characters (useful
+ * for mixtures of nested covariance functions).
+ *
+ * @param nspaces Number of space characters to indent by.
+ */
+void ProductCF::displayCovarianceParameters(int nspaces) const
+{
+	string space(nspaces, ' ');
+
+    cout << space << "Covariance function : Product" << endl;
+	for(std::vector<CovarianceFunction *>::size_type i = 0; i < covFunctions.size(); i++)
+	{
+		cout << space << "* Component: " << (i+1) << endl;
+		covFunctions[i]->displayCovarianceParameters(nspaces+2);
+	}
+}
+
+
+/**
+ * Gradient of the covariance matrix with respect to a given
+ * parameter, i.e. d/dparameter cov(X,X). By the product rule, this is the
+ * gradient of the covariance function owning the parameter, multiplied
+ * element-wise by the covariance matrices of all other functions.
+ *
+ * @param G      the gradient of the covariance matrix cov(X,X) with respect
+ *               to parameter number p
+ * @param p      the parameter number
+ * @param X      a set of inputs
+ */
+void ProductCF::covarianceGradient(mat& G, const int p, const mat& X) const
+{
+    gradient(G, p, X, NULL);
+}
+
+
+/**
+ * Gradient of the covariance between two sets of inputs with respect to
+ * parameter p (product rule, as above)
+ *
+ * @param G      the gradient of cov(X1,X2) with respect to parameter p
+ * @param p      the parameter number
+ * @param X1     a set of inputs
+ * @param X2     a set of inputs
+ */
+void ProductCF::covarianceGradient(mat& G, const int p, const mat& X1, const mat& X2) const
+{
+    int cfIndex;
+    int parcfIndex;
+
+    reindex(cfIndex, parcfIndex, p);
+
+    if (covFunctions.size() == 1)
+    {
+        G.set_size(X1.rows(), X2.rows());
+        covFunctions[cfIndex]->covarianceGradient(G, parcfIndex, X1, X2);
+        return;
+    }
+
+    fusedProduct(G, X1, &X2, cfIndex, parcfIndex);
+}
+
+
+/**
+ * Gradient of the covariance matrix with respect to parameter p, from a
+ * precomputed matrix of squared distances.
+ *
+ * @param G      the gradient of cov(X,X) with respect to parameter number p
+ * @param p      the parameter number
+ * @param X      a set of inputs
+ * @param D      the matrix of squared distances between inputs in X
+ */
+void ProductCF::covarianceGradientFromSqDist(mat& G, const int p, const mat& X, const mat& D) const
+{
+    gradient(G, p, X, &D);
+}
+
+
+/**
+ * Product rule for the gradient with respect to parameter p. If D is not
+ * NULL, it is passed on to the covariance functions as the matrix of
+ * squared distances between inputs in X (with full work matrices, as in
+ * covarianceFromSqDist), otherwise the evaluation is fused.
+ */
+void ProductCF::gradient(mat& G, const int p, const mat& X, const mat* D) const
+{
+    int cfIndex;
+    int parcfIndex;
+
+    reindex(cfIndex, parcfIndex, p);
+
+    if (!D && covFunctions.size() > 1)
+    {
+        fusedProduct(G, X, NULL, cfIndex, parcfIndex);
+        return;
+    }
+
+    G.set_size(X.rows(), X.rows());
+    if (D) covFunctions[cfIndex]->covarianceGradientFromSqDist(G, parcfIndex, X, *D);
+    else   covFunctions[cfIndex]->covarianceGradient(G, parcfIndex, X);
+
+    if (covFunctions.size() == 1) return;
+
+    mat K(X.rows(), X.rows());
+
+    for(std::vector<CovarianceFunction *>::size_type i = 0; i < covFunctions.size(); i++)
+    {
+        if ((int) i == cfIndex) continue;
+
+        if (D) covFunctions[i]->covarianceFromSqDist(K, X, *D);
+        else   covFunctions[i]->covariance(K, X);
+        multiplyElements(G, K);
+    }
+}
+
+
+/**
+ * Fused evaluation of the product between the inputs X1 and X2, or between
+ * the inputs in X1 if X2 is NULL. If cfIndex >= 0, the factor of that 
+ * covariance function is replaced by its gradient with respect to its 
+ * parameter parcfIndex (product rule).
+ * 
+ * C is filled one tile of PRODUCT_CF_TILE_SIZE rows at a time: each 
+ * covariance function computes its factor for the tile with its own 
+ * (cross-covariance) routine, and the factors are multiplied into the 
+ * tile while it is in cache. No full matrix is formed per covariance 
+ * function. Covariance functions restricted to some input dimensions by
+ * an InputSelectCF are evaluated directly on their columns, which are 
+ * selected once for the whole matrix. For a symmetric matrix, only the 
+ * tiles on and above the diagonal are computed.
+ *
+ * @param C          the covariance matrix (or its gradient)
+ * @param X1         the first set of inputs
+ * @param X2         the second set of inputs (NULL for cov(X1,X1))
+ * @param cfIndex    the covariance function differentiated (-1 for none)
+ * @param parcfIndex the parameter of that covariance function
+ */
+void ProductCF::fusedProduct(mat& C, const mat& X1, const mat* X2, int cfIndex, int parcfIndex) const
+{
+    int nFactors = covFunctions.size();
+    int n1 = X1.rows();
+    int n2 = X2 ? X2->rows() : n1;
+
+    // Covariance function and inputs for each factor
+    vector<const CovarianceFunction *> factors(nFactors);
+    vector<mat> selected1(nFactors), selected2(nFactors);
+    vector<const mat *> inputs1(nFactors), inputs2(nFactors);
+
+    for (int k = 0; k < nFactors; k++)
+    {
+        const InputSelectCF *select = dynamic_cast<const InputSelectCF *>(covFunctions[k]);
+
+        factors[k] = select ? select->getCovarianceFunction() : covFunctions[k];
+        inputs1[k] = select ? &(select->selectInputs(X1, selected1[k])) : &X1;
+
+        if (!X2)         inputs2[k] = inputs1[k];
+        else if (select) inputs2[k] = &(select->selectInputs(*X2, selected2[k]));
+        else             inputs2[k] = X2;
+    }
+
+    C.set_size(n1, n2);
+
+    mat tile, factor, A, B;
+    for (int i1 = 0; i1 < n1; i1 += PRODUCT_CF_TILE_SIZE)
+    {
+        int i2 = min(i1 + PRODUCT_CF_TILE_SIZE, n1) - 1;
+        int j1 = X2 ? 0 : i1;
+
+        for (int k = 0; k < nFactors; k++)
+        {
+            A = inputs1[k]->get_rows(i1, i2);
+            if (j1 > 0) B = inputs2[k]->get_rows(j1, n2 - 1);
+            const mat& Bk = (j1 > 0) ? B : *inputs2[k];
+
+            mat& T = (k == 0) ? tile : factor;
+            T.set_size(A.rows(), Bk.rows());
+
+            if (k == cfIndex) factors[k]->covarianceGradient(T, parcfIndex, A, Bk);
+            else              factors[k]->covariance(T, A, Bk);
+
+            if (k > 0) multiplyElements(tile, factor);
+        }
+
+        C.set_submatrix(i1, j1, tile);
+
+        if (!X2)
+        {
+            // Lower triangle: transpose of the tile, and of the upper 
+            // triangle of its diagonal block
+            if (i2 < n2 - 1) C.set_submatrix(i2 + 1, i1, tile.get_cols(i2 - i1 + 1, tile.cols() - 1).transpose());
+
+            for (int i = i1; i <= i2; i++)
+            {
+                for (int j = i + 1; j <= i2; j++) C(j,i) = C(i,j);
+            }
+        }
+    }
+}
+
+
+/**
+ * Element-wise product C = C .* K, done in place
+ */
+void ProductCF::multiplyElements(mat& C, const mat& K)
+{
+    assert(C.rows() == K.rows() && C.cols() == K.cols());
+
+    for (int j=0; j<C.cols(); j++) {
+        for (int i=0; i<C.rows(); i++) {
+            C(i,j) *= K(i,j);
+        }
+    }
+}
+
+
+/**
+ * Return the transform for parameter number p
+ *
+ * @param p the parameter number
+ * @return a pointer to the transform object for p
+ */
+Transform* ProductCF::getTransform(int p) const
+{
+    int cfIndex;
+    int parcfIndex;
+
+    reindex(cfIndex, parcfIndex, p);
+
+    return covFunctions[cfIndex]->getTransform(parcfIndex);
+}
+
+
+/**
+ * Set the transform for parameter number p
+ *
+ * @param p the parameter number
+ * @param t a pointer to the new transform for parameter number p
+ */
+void ProductCF::setTransform(int p, Transform* t)
+{
+    int cfIndex;
+    int parcfIndex;
+
+    reindex(cfIndex, parcfIndex, p);
+
+    covFunctions[cfIndex]->setTransform(parcfIndex, t);
+}
+
+
+/**
+ * Set all parameters from a vector of transformed values
+ *
+ * @param pvec a vector of parameter values (in transformed space, e.g. log of the
+ *             actual value for log-transformed parameters)
+ */
+void ProductCF::setTransformedParameters(const vec pvec)
+{
+	int parFrom = 0;
+	int parTo = 0;
+	vector<CovarianceFunction*>::iterator cf;
+
+	for (cf = covFunctions.begin(); cf != covFunctions.end(); cf++)
+	{
+	    parFrom = parTo;
+	    parTo += (*cf)->getNumberParameters();
+	    (*cf)->setTransformedParameters( pvec(parFrom, parTo-1) );
+	}
+}
+
+
+/**
+ * Get a vector of transformed parameter values
+ *
+ * @return a vector of transformed parameter values (e.g. log of the parameter
+ *         value if the parameter has a log-transform)
+ */
+vec ProductCF::getTransformedParameters()
+{
+	vec transPar;
+	vector<CovarianceFunction*>::iterator cf;
+
+	for (cf = covFunctions.begin(); cf != covFunctions.end(); cf++)
+	{
+		transPar = concat(transPar, (*cf)->getTransformedParameters());
+	}
+
+	return transPar;
+}
+
+
+/**
+ * Set the value for a given parameter
+ *
+ * @param p      the parameter number, between 0 and the total number of parameters
+ *               (from all covariance functions)
+ * @param value  the new value for the parameter
+ */
+void ProductCF::setParameter(const int p, const double value)
+{
+    int cfIndex;
+    int parcfIndex;
+
+    reindex(cfIndex, parcfIndex, p);
+    covFunctions[cfIndex]->setParameter(parcfIndex, value);
+}
+
+
+/**
+ * Get a given parameter (out of the parameters from all covariance functions)
+ *
+ * @param p the parameter number, between 0 and the total number of parameters
+ * @return the value of parameter p
+ */
+double ProductCF::getParameter(const int p) const
+{
+	int cfIndex;
+	int parcfIndex;
+
+	reindex(cfIndex, parcfIndex, p);
+
+	return covFunctions[cfIndex]->getParameter(parcfIndex);
+}
+
+
+/**
+ * Return the name of the given parameter
+ *
+ * @param p the parameter number, between 0 and the total number of parameters
+ *          (from all covariance functions)
+ * @return the name of the parameter
+ */
+string ProductCF::getParameterName(const int p) const
+{
+    int cfIndex;
+    int parcfIndex;
+
+    reindex(cfIndex, parcfIndex, p);
+
+    return (covFunctions[cfIndex]->getParameterName(parcfIndex));
+}
+
+
+/**
+ * Retrieve the index of the covariance function and of the parameter within
+ * from the given parameter number.
+ *
+ * @see SumCF::reindex
+ */
+void ProductCF::reindex(int& cfIndex, int& parcfIndex, int parIndex) const
+{
+    assert(parIndex >= 0 && parIndex < getNumberParameters());
+
+    int p = parIndex;
+    int i = 0;
+    int npar = covFunctions[i++]->getNumberParameters();
+
+    while ( p >=  npar )
+    {
+        p -= npar;
+        npar = covFunctions[i++]->getNumberParameters();
+    }
+
+    cfIndex = i-1;
+    parcfIndex = p;
+}
@@ -7,6 +7,63 @@
 
 #include "StationaryCF.h"
 
+
+/*
+ * Squared distance computations, specialised on the input dimension.
+ * Inputs are stored one per row in column-major matrices, so element k of
+ * input i is found at x[i + k*ld]. The input dimension D is a template
+ * parameter so that, for D = 1, 2 or 3 (i.e. most spatial problems), the
+ * inner loop is fully unrolled. D = 0 is the generic version, where the
+ * dimension is only known at run time. The dispatch on the dimension is
+ * done once per matrix.
+ */
+template<int D>
+static inline double sqDistRows(const double *x1, int ld1, const double *x2, int ld2, int dim)
+{
+    const int nDims = (D > 0) ? D : dim;
+    double d = 0.0;
+
+    for (int k=0; k<nDims; k++)
+    {
+        double t = x1[k*ld1] - x2[k*ld2];
+        d += t*t;
+    }
+    return d;
+}
+
+template<int D>
+static void sqDistSymmetric(mat& Dm, const mat& X)
+{
+    int n = X.rows();
+    int dim = X.cols();
+    const double *x = X._data();
+
+    for (int j=0; j<n; j++) {
+        Dm(j,j) = 0.0;
+        for (int i=j+1; i<n; i++) {
+            double d = sqDistRows<D>(x+i, n, x+j, n, dim);
+            Dm(i,j) = d;
+            Dm(j,i) = d;
+        }
+    }
+}
+
+template<int D>
+static void sqDistCross(mat& Dm, const mat& X1, const mat& X2)
+{
+    int n1 = X1.rows();
+    int n2 = X2.rows();
+    int dim = X1.cols();
+    const double *x1 = X1._data();
+    const double *x2 = X2._data();
+
+    for (int j=0; j<n2; j++) {
+        for (int i=0; i<n1; i++) {
+            Dm(i,j) = sqDistRows<D>(x1+i, n1, x2+j, n2, dim);
+        }
+    }
+}
+
 /**
  * Default constructor
  *
@@ -82,11 +139,42 @@ void StationaryCF::covariance(mat& C, const mat& X) const
     // Compute matrix of squared distances
     sqDistMatrix(C, X);
 
-    // Apply correlation function
-    applyCorrelation(C);
+    // Apply correlation function and scale by process variance
+    applyCovarianceSymmetric(C, C);
+}
+
 
-    // Finally, scale by process variance
-    C *= variance;
+/**
+ * Computes the covariance matrix between two sets of inputs X1 and X2.
+ * The squared distances are accumulated directly from the input matrices.
+ *
+ * @param C  the nxm covariance matrix cov(X1,X2)
+ * @param X1 a set of n (row) inputs
+ * @param X2 a set of m (row) inputs
+ */
+void StationaryCF::covariance(mat& C, const mat& X1, const mat& X2) const
+{
+    sqDistMatrix(C, X1, X2);
+
+    for (int j=0; j<C.cols(); j++) {
+        for (int i=0; i<C.rows(); i++) {
+            C(i,j) = variance * correlation(C(i,j));
+        }
+    }
+}
+
+
+/**
+ * Diagonal of the covariance matrix cov(X,X). For a stationary covariance
+ * function, this is constant and equal to the process variance.
+ *
+ * @param C the vector of variances C_i = cov(X_i, X_i)
+ * @param X a set of (row) inputs
+ */
+void StationaryCF::computeDiagonal(vec& C, const mat& X) const
+{
+    C.set_size(X.rows());
+    C = variance * correlation(0.0);
 }
 
 
@@ -106,24 +194,138 @@ void StationaryCF::covarianceGradient(mat& D, const int p, const mat& X) const
     // Compute matrix of squared distances
     sqDistMatrix(D, X);
 
+    applyCovarianceGradientSymmetric(p, D, D);
+}
+
+
+/**
+ * Gradient of the covariance between two sets of inputs with respect to
+ * a given parameter, i.e. d/dp cov(X1,X2)
+ *
+ * @param G      the nxm gradient of cov(X1,X2) with respect to parameter p
+ * @param p      the parameter number
+ * @param X1     a set of n inputs
+ * @param X2     a set of m inputs
+ */
+void StationaryCF::covarianceGradient(mat& G, const int p, const mat& X1, const mat& X2) const
+{
+    assert(p>=0 && p<numberParameters);
+
+    sqDistMatrix(G, X1, X2);
+
+    Transform* t = getTransform(p);
+    double gradientTransform = t->gradientTransform(parameters[p]);
+
+    for (int j=0; j<G.cols(); j++) {
+        for (int i=0; i<G.rows(); i++) {
+            if (p == 0) G(i,j) = variance * gradientTransform * correlationGradient(p, G(i,j));
+            else        G(i,j) = gradientTransform * correlation(G(i,j));
+        }
+    }
+}
+
+
+/**
+ * Computes the symmetric covariance matrix between all inputs in X from
+ * a precomputed matrix of squared distances between these inputs. This
+ * only requires a single pass over the distances.
+ *
+ * @param C the covariance matrix cov(X,X)
+ * @param X a set of (row) inputs
+ * @param D the matrix of squared distances between inputs in X
+ * @see DistanceCache
+ */
+void StationaryCF::covarianceFromSqDist(mat& C, const mat& X, const mat& D) const
+{
+    assert(D.rows() == X.rows() && D.cols() == X.rows());
+
+    C.set_size(D.rows(), D.cols());
+    applyCovarianceSymmetric(C, D);
+}
+
+
+/**
+ * Gradient of the covariance matrix with respect to a given parameter,
+ * computed from a precomputed matrix of squared distances.
+ *
+ * @param G      the gradient of cov(X,X) with respect to parameter number p
+ * @param p      the parameter number
+ * @param X      a set of inputs
+ * @param D      the matrix of squared distances between inputs in X
+ * @see DistanceCache
+ */
+void StationaryCF::covarianceGradientFromSqDist(mat& G, const int p, const mat& X, const mat& D) const
+{
+    assert(p>=0 && p<numberParameters);
+    assert(D.rows() == X.rows() && D.cols() == X.rows());
+
+    G.set_size(D.rows(), D.cols());
+    applyCovarianceGradientSymmetric(p, G, D);
+}
+
+
+/**
+ * Fill the symmetric covariance matrix C from a symmetric matrix of squared
+ * distances D. Only the lower triangle of D is read, so D and C can be the
+ * same matrix.
+ *
+ * @param C the covariance matrix (must have the same size as D)
+ * @param D a symmetric matrix of squared distances
+ */
+void StationaryCF::applyCovarianceSymmetric(mat& C, const mat& D) const
+{
+    int n = D.rows();
+
+    for (int j=0; j<n; j++) {
+        for (int i=j; i<n; i++) {
+            double c = variance * correlation(D(i,j));
+            C(i,j) = c;
+            C(j,i) = c;
+        }
+    }
+}
+
+
+/**
+ * Fill the symmetric gradient matrix G (with respect to parameter p) from a
+ * symmetric matrix of squared distances D. As for applyCovarianceSymmetric,
+ * G and D can be the same matrix.
+ *
+ * @param p the parameter number
+ * @param G the gradient matrix (must have the same size as D)
+ * @param D a symmetric matrix of squared distances
+ */
+void StationaryCF::applyCovarianceGradientSymmetric(int p, mat& G, const mat& D) const
+{
+    int n = D.rows();
+
     Transform* t = getTransform(p);
     double gradientTransform = t->gradientTransform(parameters[p]);
 
     switch (p)
     {
     case 0:
-        applyCorrelationGradient(p, D);        // Compute gradient of correlation matrix
-        D *= variance;                           // Multiply by variance
+        // Gradient of correlation function, scaled by the variance
+        for (int j=0; j<n; j++) {
+            for (int i=j; i<n; i++) {
+                double g = variance * gradientTransform * correlationGradient(p, D(i,j));
+                G(i,j) = g;
+                G(j,i) = g;
+            }
+        }
         break;
 
     case 1:
-        applyCorrelation(D);
+        // Gradient with respect to the variance is the correlation
+        for (int j=0; j<n; j++) {
+            for (int i=j; i<n; i++) {
+                double g = gradientTransform * correlation(D(i,j));
+                G(i,j) = g;
+                G(j,i) = g;
+            }
+        }
         break;
-
     }
-
-    // Multiply by the gradient of the transform
-    D *= gradientTransform;
 }
 
 
@@ -169,13 +371,20 @@ void StationaryCF::applyCorrelationGradient(int p, mat& D) const
  * @param v the second vector
  * @return the squared distance between u and v
  */
-double StationaryCF::sqDist(vec u,vec v)
+double StationaryCF::sqDist(const vec& u, const vec& v)
 {
     assert(length(u) == length(v));
 
-    double d = 0.0;
-    for (int i=0; i<length(u); i++) d += (u(i)-v(i))*(u(i)-v(i));
-    return d;
+    const double *pu = u._data();
+    const double *pv = v._data();
+
+    switch (length(u))
+    {
+    case 1:  return sqDistRows<1>(pu, 1, pv, 1, 1);
+    case 2:  return sqDistRows<2>(pu, 1, pv, 1, 2);
+    case 3:  return sqDistRows<3>(pu, 1, pv, 1, 3);
+    default: return sqDistRows<0>(pu, 1, pv, 1, length(u));
+    }
 }
 
 
@@ -185,14 +394,98 @@ double StationaryCF::sqDist(vec u,vec v)
  * @param D  the matrix of squared distances
  * @param X  a set of (row) inputs
  */
-void StationaryCF::sqDistMatrix(mat &D, const mat X)
+void StationaryCF::sqDistMatrix(mat &D, const mat& X)
 {
-    D = zeros(X.rows(), X.rows());
+    D.set_size(X.rows(), X.rows());
 
-    for (int i=0; i<X.rows(); i++) {
-        for(int j=0; j<i; j++) {
-            D(i,j) = sqDist(X.get_row(i), X.get_row(j));
-            D(j,i) = D(i,j);
+    switch (X.cols())
+    {
+    case 1:  sqDistSymmetric<1>(D, X); break;
+    case 2:  sqDistSymmetric<2>(D, X); break;
+    case 3:  sqDistSymmetric<3>(D, X); break;
+    default: sqDistSymmetric<0>(D, X); break;
+    }
+}
+
+
+/**
+ * Computes the matrix of square distances between inputs in X1 and X2.
+ *
+ * @param D  the matrix of squared distances (size n1 x n2)
+ * @param X1 a set of n1 (row) inputs
+ * @param X2 a set of n2 (row) inputs
+ */
+void StationaryCF::sqDistMatrix(mat &D, const mat& X1, const mat& X2)
+{
+    assert(X1.cols() == X2.cols());
+
+    D.set_size(X1.rows(), X2.rows());
+
+    switch (X1.cols())
+    {
+    case 1:  sqDistCross<1>(D, X1, X2); break;
+    case 2:  sqDistCross<2>(D, X1, X2); break;
+    case 3:  sqDistCross<3>(D, X1, X2); break;
+    default: sqDistCross<0>(D, X1, X2); break;
+    }
+}
+
+
+/**
+ * Sample frequencies from the spectral density of the correlation function
+ * with unit length scale (by Bochner's theorem, the correlation is the 
+ * Fourier transform of this density). The frequencies for length scale l 
+ * are W / l. This is used by random feature approximations (see 
+ * RandomFeatureGP) and must be overridden by correlation functions which 
+ * support them - the default implementation raises an error.
+ *
+ * @param W            the frequencies, one per row (nFrequencies x nDims)
+ * @param nFrequencies the number of frequencies
+ * @param nDims        the input dimension
+ */
+void StationaryCF::sampleSpectralDensity(mat& /* W */, int /* nFrequencies */, int /* nDims */) const
+{
+    it_error("Spectral density not available for covariance function " + covarianceName);
+}
+
+
+/**
+ * Covariance between two nodes of a regular 2D grid, for all pairs of lags
+ * along the axes of the grid. The covariance matrix of the grid only 
+ * depends on these (it is block Toeplitz with Toeplitz blocks), so this 
+ * table is all that is needed to compute products with it by FFT (see 
+ * KISSGP).
+ *
+ * @param C     the covariances C(i,j) = cov(lags0(i), lags1(j))
+ * @param lags0 the lags along the first axis
+ * @param lags1 the lags along the second axis
+ */
+void StationaryCF::gridCovariance(mat& C, const vec& lags0, const vec& lags1) const
+{
+    C.set_size(lags0.size(), lags1.size());
+
+    for (int j=0; j<lags1.size(); j++) {
+        for (int i=0; i<lags0.size(); i++) {
+            C(i,j) = variance * correlation(lags0(i) * lags0(i) + lags1(j) * lags1(j));
         }
     }
 }
+
+
+/**
+ * Sample frequencies from a multivariate Student-t density with dof degrees
+ * of freedom and scale matrix I/scale^2, i.e. the spectral density of a 
+ * Matern correlation function of order dof/2 and length scale "scale" 
+ * (with unit length scale in the Matern parameterisation). dof = 1 gives 
+ * the Cauchy density of the exponential correlation function.
+ */
+void StationaryCF::sampleStudentT(mat& W, int nFrequencies, int nDims, int dof, double scale)
+{
+    W = randn(nFrequencies, nDims);
+
+    for (int i=0; i<nFrequencies; i++)
+    {
+        double g = sum_sqr(randn(dof));        // chi-square with dof degrees of freedom
+        W.set_row(i, W.get_row(i) * sqrt(dof / g) / scale);
+    }
+}
@@ -23,11 +23,24 @@ public:
     StationaryCF(string name, double variance, double lengthScale);
     virtual ~StationaryCF();
 
+    using CovarianceFunction::covariance;
+    using CovarianceFunction::computeDiagonal;
+
     virtual void covariance(mat& C, const mat& X) const;
+    virtual void covariance(mat& C, const mat& X1, const mat& X2) const;
+    virtual void computeDiagonal(vec& C, const mat& X) const;
     virtual void covarianceGradient(mat& grad, const int parameterNumber, const mat& X) const;
+    virtual void covarianceGradient(mat& grad, const int parameterNumber, const mat& X1, const mat& X2) const;
+
+    virtual void covarianceFromSqDist(mat& C, const mat& X, const mat& D) const;
+    virtual void covarianceGradientFromSqDist(mat& grad, const int parameterNumber, const mat& X, const mat& D) const;
+
+    virtual void sampleSpectralDensity(mat& W, int nFrequencies, int nDims) const;
+    void gridCovariance(mat& C, const vec& lags0, const vec& lags1) const;
 
-    static void sqDistMatrix(mat &D, const mat X);
-    static double sqDist(vec u, vec v);
+    static void sqDistMatrix(mat &D, const mat& X);
+    static void sqDistMatrix(mat &D, const mat& X1, const mat& X2);
+    static double sqDist(const vec& u, const vec& v);
 
 protected:
     double &variance;        // Process variance
@@ -43,6 +56,11 @@ protected:
     void applyCorrelation(mat &sqDist) const;
     void applyCorrelationGradient(int paramNumber, mat &sqDist) const;
 
+    static void sampleStudentT(mat& W, int nFrequencies, int nDims, int dof, double scale);
+
+    void applyCovarianceSymmetric(mat &C, const mat &sqDist) const;
+    void applyCovarianceGradientSymmetric(int paramNumber, mat &G, const mat &sqDist) const;
+
 };
 
 #endif /* STATIONARYCF_H_ */
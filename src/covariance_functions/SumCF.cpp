@@ -77,6 +77,86 @@ inline double SumCF::computeDiagonalElement(const vec& A) const
 }
 
 
+/**
+ * Covariance matrix of a set of inputs. Each covariance function in the sum
+ * computes its own matrix (using its optimised routine, if any), which is
+ * accumulated into C.
+ *
+ * @param C      the covariance matrix cov(X,X)
+ * @param X      a set of inputs
+ */
+void SumCF::covariance(mat& C, const mat& X) const
+{
+    assert(covFunctions.size() > 0);
+
+    C.set_size(X.rows(), X.rows());
+    covFunctions[0]->covariance(C, X);
+
+    if (covFunctions.size() == 1) return;
+
+    mat Ci(X.rows(), X.rows());
+
+    for(std::vector<CovarianceFunction *>::size_type i = 1; i < covFunctions.size(); i++)
+    {
+        covFunctions[i]->covariance(Ci, X);
+        C += Ci;
+    }
+}
+
+
+/**
+ * Covariance matrix between two sets of inputs, accumulated from the
+ * matrix routine of each covariance function in the sum.
+ *
+ * @param C      the covariance matrix cov(X1,X2)
+ * @param X1     the first set of inputs
+ * @param X2     the second set of inputs
+ */
+void SumCF::covariance(mat& C, const mat& X1, const mat& X2) const
+{
+    assert(covFunctions.size() > 0);
+
+    C.set_size(X1.rows(), X2.rows());
+    covFunctions[0]->covariance(C, X1, X2);
+
+    if (covFunctions.size() == 1) return;
+
+    mat Ci(X1.rows(), X2.rows());
+
+    for(std::vector<CovarianceFunction *>::size_type i = 1; i < covFunctions.size(); i++)
+    {
+        covFunctions[i]->covariance(Ci, X1, X2);
+        C += Ci;
+    }
+}
+
+
+/**
+ * Diagonal of the covariance matrix cov(X,X), accumulated from the
+ * diagonal of each covariance function in the sum.
+ *
+ * @param C      the vector of variances C_i = cov(X_i, X_i)
+ * @param X      a set of inputs
+ */
+void SumCF::computeDiagonal(vec& C, const mat& X) const
+{
+    assert(covFunctions.size() > 0);
+
+    C.set_size(X.rows());
+    covFunctions[0]->computeDiagonal(C, X);
+
+    if (covFunctions.size() == 1) return;
+
+    vec Ci(X.rows());
+
+    for(std::vector<CovarianceFunction *>::size_type i = 1; i < covFunctions.size(); i++)
+    {
+        covFunctions[i]->computeDiagonal(Ci, X);
+        C += Ci;
+    }
+}
+
+
 /**
  * Display information about the current parameters of the covariance functions.
  * This can be indented by an optional number of space characters (useful
@@ -116,6 +196,71 @@ void SumCF::covarianceGradient(mat& D, const int p, const mat& X) const
 }
 
 
+/**
+ * Gradient of the covariance between two sets of inputs with respect to
+ * parameter p, i.e. d/dparameter cov(X1,X2)
+ *
+ * @param G      the gradient of cov(X1,X2) with respect to parameter p
+ * @param p      the parameter number
+ * @param X1     a set of inputs
+ * @param X2     a set of inputs
+ */
+void SumCF::covarianceGradient(mat& G, const int p, const mat& X1, const mat& X2) const
+{
+    int cfIndex;
+    int parcfIndex;
+
+    reindex(cfIndex, parcfIndex, p);
+    covFunctions[cfIndex]->covarianceGradient(G, parcfIndex, X1, X2);
+}
+
+
+/**
+ * Covariance matrix of a set of inputs from a precomputed matrix of squared
+ * distances. The distances are passed on to each covariance function in the sum.
+ *
+ * @param C      the covariance matrix cov(X,X)
+ * @param X      a set of inputs
+ * @param D      the matrix of squared distances between inputs in X
+ */
+void SumCF::covarianceFromSqDist(mat& C, const mat& X, const mat& D) const
+{
+    assert(covFunctions.size() > 0);
+
+    C.set_size(X.rows(), X.rows());
+    covFunctions[0]->covarianceFromSqDist(C, X, D);
+
+    if (covFunctions.size() == 1) return;
+
+    mat Ci(X.rows(), X.rows());
+
+    for(std::vector<CovarianceFunction *>::size_type i = 1; i < covFunctions.size(); i++)
+    {
+        covFunctions[i]->covarianceFromSqDist(Ci, X, D);
+        C += Ci;
+    }
+}
+
+
+/**
+ * Gradient of the covariance matrix with respect to parameter p, from a
+ * precomputed matrix of squared distances.
+ *
+ * @param G      the gradient of cov(X,X) with respect to parameter number p
+ * @param p      the parameter number
+ * @param X      a set of inputs
+ * @param D      the matrix of squared distances between inputs in X
+ */
+void SumCF::covarianceGradientFromSqDist(mat& G, const int p, const mat& X, const mat& D) const
+{
+    int cfIndex;
+    int parcfIndex;
+
+    reindex(cfIndex, parcfIndex, p);
+    covFunctions[cfIndex]->covarianceGradientFromSqDist(G, parcfIndex, X, D);
+}
+
+
 /**
  * Return the transform for parameter number p
  *
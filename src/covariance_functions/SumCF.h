@@ -54,8 +54,19 @@ public:
 	inline double computeElement(const vec& A, const vec& B) const;
 	inline double computeDiagonalElement(const vec& A) const;
 	
+	using CovarianceFunction::covariance;
+	using CovarianceFunction::computeDiagonal;
+
+	void covariance(mat& C, const mat& X) const;
+	void covariance(mat& C, const mat& X1, const mat& X2) const;
+	void computeDiagonal(vec& C, const mat& X) const;
+
 	void covarianceGradient(mat& G, const int p, const mat& X) const;
+	void covarianceGradient(mat& G, const int p, const mat& X1, const mat& X2) const;
 	
+	void covarianceFromSqDist(mat& C, const mat& X, const mat& D) const;
+	void covarianceGradientFromSqDist(mat& G, const int p, const mat& X, const mat& D) const;
+
 
 	// We need to override all methods dealing with parameter indexes,
 	// as these will be different
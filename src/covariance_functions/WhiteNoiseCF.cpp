@@ -1,5 +1,7 @@
 #include "WhiteNoiseCF.h"
 
+#include <algorithm>
+
 /**
  * Constructor
  *
@@ -46,6 +48,78 @@ inline double WhiteNoiseCF::computeDiagonalElement(const vec& A) const
 }
 
 
+namespace
+{
+    /**
+     * Lexicographic order of the rows of a matrix, used to find identical
+     * inputs without comparing every pair
+     */
+    struct RowLess
+    {
+        const mat& X;
+        RowLess(const mat& X) : X(X) {}
+
+        bool operator()(int i, int j) const
+        {
+            for (int k=0; k<X.cols(); k++)
+            {
+                if (X(i,k) != X(j,k)) return X(i,k) < X(j,k);
+            }
+            return false;
+        }
+    };
+}
+
+
+/**
+ * Covariance matrix of a set of inputs. This is consistent with 
+ * computeElement: the noise variance is set on the diagonal and between
+ * any two identical inputs. Identical inputs are found by sorting the 
+ * rows of X (O(n log n) comparisons), rather than comparing all pairs.
+ *
+ * @param C    the covariance matrix cov(X,X)
+ * @param X    a set of (row) inputs
+ */
+void WhiteNoiseCF::covariance(mat& C, const mat& X) const
+{
+	int n = X.rows();
+	C.set_size(n, n);
+	C.zeros();
+
+	std::vector<int> order(n);
+	for (int i=0; i<n; i++) order[i] = i;
+	RowLess less(X);
+	std::sort(order.begin(), order.end(), less);
+
+	// Runs of identical inputs in sorted order (usually of length 1)
+	int first = 0;
+	for (int r=1; r<=n; r++)
+	{
+		if (r < n && !less(order[first], order[r])) continue;
+
+		for (int a=first; a<r; a++)
+		{
+			for (int b=first; b<r; b++) C(order[a], order[b]) = variance;
+		}
+		first = r;
+	}
+}
+
+
+/**
+ * Diagonal of the covariance matrix cov(X,X), i.e. the noise variance
+ * for each input.
+ *
+ * @param C    the vector of variances
+ * @param X    a set of (row) inputs
+ */
+void WhiteNoiseCF::computeDiagonal(vec& C, const mat& X) const
+{
+	C.set_size(X.rows());
+	C = variance;
+}
+
+
 /**
  * Gradient of the covariance matrix for a set of inputs, with respect to
  * a given parameter.
@@ -72,3 +146,35 @@ void WhiteNoiseCF::covarianceGradient(mat& G, const int p, const mat& X) const
 		}
 	}
 }
+
+
+/**
+ * Gradient of the covariance between two sets of inputs. As for the 
+ * covariance (see computeElement), this is non-zero for identical inputs.
+ *
+ * @param G    the gradient of cov(X1,X2) with respect to parameter p
+ * @param p    the parameter number
+ * @param X1   a set of (row) inputs
+ * @param X2   a set of (row) inputs
+ */
+void WhiteNoiseCF::covarianceGradient(mat& G, const int p, const mat& X1, const mat& X2) const
+{
+	assert(p == 0);
+	assert(X1.cols() == X2.cols());
+
+	Transform* t = getTransform(p);
+	double gradientModifier = t->gradientTransform(parameters[p]);
+
+	G.set_size(X1.rows(), X2.rows());
+	G.zeros();
+
+	for (int j=0; j<X2.rows(); j++)
+	{
+		for (int i=0; i<X1.rows(); i++)
+		{
+			bool identical = true;
+			for (int k=0; k<X1.cols() && identical; k++) identical = (X1(i,k) == X2(j,k));
+			if (identical) G(i,j) = gradientModifier;
+		}
+	}
+}
@@ -45,7 +45,14 @@ public:
 	inline double computeElement(const vec& A, const vec& B) const;
 	inline double computeDiagonalElement(const vec& A) const;
 	
+	using CovarianceFunction::covariance;
+	using CovarianceFunction::computeDiagonal;
+	
+	void covariance(mat& C, const mat& X) const;
+	void computeDiagonal(vec& C, const mat& X) const;
+	
 	void covarianceGradient(mat& G, const int p, const mat& X) const;
+	void covarianceGradient(mat& G, const int p, const mat& X1, const mat& X2) const;
 	
 private:
 	double& variance;
@@ -0,0 +1,56 @@
+#include "CrossValidation.h"
+
+/**
+ * Scores of the Gaussian predictive distributions N(Mean, Variance) 
+ * for the observations Y
+ */
+CrossValidationScores validationScores(const vec& Y, const vec& Mean, const vec& Variance)
+{
+    assert(Y.length() == Mean.length() && Y.length() == Variance.length());
+    
+    int n = Y.length();
+    double meanY = mean(Y);
+    double varY  = variance(Y);
+    
+    double sse = 0.0, sll = 0.0, scrps = 0.0;
+    
+    for (int i=0; i<n; i++)
+    {
+        double e = Y(i) - Mean(i);
+        double v = Variance(i);
+        double sd = sqrt(v);
+        double z = e / sd;
+        double e0 = Y(i) - meanY;
+        
+        sse += e * e;
+        sll += 0.5 * (log(v / varY) + e*e/v - e0*e0/varY);
+        
+        // CRPS of a Gaussian (Gneiting and Raftery, 2007)
+        double cdf = 0.5 * erfc(-z / sqrt(2.0));
+        double pdf = exp(-0.5 * z * z) / sqrt(2.0 * pi);
+        scrps += sd * (z * (2.0 * cdf - 1.0) + 2.0 * pdf - 1.0 / sqrt(pi));
+    }
+    
+    CrossValidationScores scores;
+    scores.rmse = sqrt(sse / n);
+    scores.msll = sll / n;
+    scores.crps = scrps / n;
+    
+    return scores;
+}
+
+
+/**
+ * Random assignment of n observations to nFolds folds
+ */
+ivec crossValidationFolds(int n, int nFolds)
+{
+    assert(nFolds > 0 && nFolds <= n);
+    
+    ivec perm = itppext::randperm(n);
+    ivec folds(n);
+    
+    for (int i=0; i<n; i++) folds(perm(i)) = i % nFolds;
+    
+    return folds;
+}
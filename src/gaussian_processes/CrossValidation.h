@@ -0,0 +1,62 @@
+/***************************************************************************
+ *   AstonGeostats, algorithms for low-rank geostatistical models          *
+ *                                                                         *
+ *   Copyright (C) Remi Barillec, Ben Ingram, 2008-2009                    *
+ *                                                                         *
+ *   Remi Barillec, r.barillec@aston.ac.uk
+ *   Ben Ingram, IngramBR@Aston.ac.uk                                      *
+ *   Neural Computing Research Group,                                      *
+ *   Aston University,                                                     *
+ *   Aston Street, Aston Triangle,                                         *
+ *   Birmingham. B4 7ET.                                                   *
+ *   United Kingdom                                                        *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+#ifndef CROSSVALIDATION_H_
+#define CROSSVALIDATION_H_
+
+#include <itpp/itbase.h>
+
+#include "itppext/itppext.h"
+
+using namespace itpp;
+
+/**
+ * Scores of a set of (cross-validation) predictions, for model selection:
+ *   rmse - root mean squared error
+ *   msll - mean standardised log loss (negative log predictive density, 
+ *          minus that of a Gaussian with the mean and variance of the 
+ *          observations). Lower is better, 0 is the trivial model.
+ *   crps - mean continuous ranked probability score of the Gaussian
+ *          predictive distributions. Lower is better.
+ */
+struct CrossValidationScores
+{
+    double rmse;
+    double msll;
+    double crps;
+};
+
+CrossValidationScores validationScores(const vec& Y, const vec& Mean, const vec& Variance);
+
+/**
+ * Random assignment of n observations to nFolds folds of (nearly) equal 
+ * size. Returns the fold number of each observation.
+ */
+ivec crossValidationFolds(int n, int nFolds);
+
+#endif /*CROSSVALIDATION_H_*/
@@ -7,6 +7,7 @@ GaussianProcess::GaussianProcess(int Inputs, int Outputs, mat& Xdata, vec& ydata
 {
 	assert(Locations.rows() == Observations.size());
 
+	cacheDistances = true;
 }
 
 GaussianProcess::~GaussianProcess()
@@ -84,7 +85,7 @@ double GaussianProcess::loglikelihood() const
 	mat Sigma(Observations.size(), Observations.size());
 	mat cholSigma(Observations.size(), Observations.size());
 
-	covFunc.covariance(Sigma, Locations);
+	locationCovariance(Sigma);
 
 	cholSigma = computeCholesky(Sigma);
 
@@ -141,7 +142,7 @@ vec GaussianProcess::gradient() const
 	mat Sigma(Observations.size(), Observations.size());
 	mat cholSigma(Observations.size(), Observations.size());
 
-	covFunc.covariance(Sigma, Locations);
+	locationCovariance(Sigma);
 	cholSigma = computeCholesky(Sigma);
 	mat invSigma = computeInverseFromCholesky(Sigma);
 	vec alpha = invSigma * Observations;
@@ -154,7 +155,7 @@ vec GaussianProcess::gradient() const
 
 	for(int i = 0; i < covFunc.getNumberParameters(); i++)
 	{
-		covFunc.covarianceGradient(partialDeriv, i, Locations);
+		locationCovarianceGradient(partialDeriv, i);
 		//grads(i) = sum(sum(elem_mult(W, partialDeriv))) / 2;
 		grads(i) = elem_mult_sum(W, partialDeriv) / 2;
 // official - but slower		grads(i) = sum(diag(W * partialDeriv)) / 2;
@@ -166,6 +167,113 @@ vec GaussianProcess::gradient() const
 
 
 
+/**
+ * Leave-one-out predictive means and variances. With K the covariance of
+ * the observations and a = K^{-1} y, the prediction of observation i from
+ * the others is N(y_i - a_i / [K^{-1}]_ii, 1 / [K^{-1}]_ii) (Rasmussen and
+ * Williams, Sec. 5.4.2).
+ */
+void GaussianProcess::leaveOneOut(vec& Mean, vec& Variance) const
+{
+	int n = Observations.size();
+
+	mat Sigma(n, n);
+	locationCovariance(Sigma);
+
+	// K^{-1} = R * R', with R the (upper triangular) inverse of the Cholesky factor
+	mat R = backslash(computeCholesky(Sigma), eye(n));
+	vec alpha = R * (R.transpose() * Observations);
+
+	Mean.set_size(n);
+	Variance.set_size(n);
+
+#pragma omp parallel for schedule(dynamic)
+	for (int i = 0; i < n; i++)
+	{
+		// R is upper triangular: row i has non zero elements from i to n-1
+		double invDiag = 0.0;
+		for (int j = i; j < n; j++) invDiag += R(i,j) * R(i,j);
+
+		Variance(i) = 1.0 / invDiag;
+		Mean(i) = Observations(i) - alpha(i) * Variance(i);
+	}
+}
+
+
+/**
+ * k-fold cross-validation predictive means and variances. The prediction 
+ * of the observations I of a fold from the other folds has covariance 
+ * inv([K^{-1}]_II) and mean y_I - inv([K^{-1}]_II) * a_I.
+ */
+void GaussianProcess::crossValidation(vec& Mean, vec& Variance, const ivec& folds) const
+{
+	int n = Observations.size();
+	assert(folds.length() == n);
+
+	mat Sigma(n, n);
+	locationCovariance(Sigma);
+
+	mat R = backslash(computeCholesky(Sigma), eye(n));
+	vec alpha = R * (R.transpose() * Observations);
+
+	Mean.set_size(n);
+	Variance.set_size(n);
+
+	for (int k = 0; k <= max(folds); k++)
+	{
+		ivec idx = find(folds == k);
+		if (idx.length() == 0) continue;
+
+		mat Rk = R.get_rows(idx);
+		mat covFold = inv(Rk * Rk.transpose());
+
+		vec meanFold = Observations(idx) - covFold * alpha(idx);
+		for (int i = 0; i < idx.length(); i++)
+		{
+			Mean(idx(i)) = meanFold(i);
+			Variance(idx(i)) = covFold(i,i);
+		}
+	}
+}
+
+
+/**
+ * Enable or disable the cache of squared distances between the locations.
+ * Disabling the cache frees its memory.
+ */
+void GaussianProcess::setDistanceCache(bool enabled)
+{
+	cacheDistances = enabled;
+	if (!enabled) locationDistances.clear();
+}
+
+
+/**
+ * Covariance matrix of the locations, from the cached squared distances 
+ * if enabled
+ */
+void GaussianProcess::locationCovariance(mat& Sigma) const
+{
+	if (cacheDistances)
+		covFunc.covarianceFromSqDist(Sigma, Locations, locationDistances.sqDistMatrix(Locations));
+	else
+		covFunc.covariance(Sigma, Locations);
+}
+
+
+/**
+ * Gradient of the covariance matrix of the locations with respect to 
+ * parameter p, from the cached squared distances if enabled
+ */
+void GaussianProcess::locationCovarianceGradient(mat& G, int p) const
+{
+	if (cacheDistances)
+		covFunc.covarianceGradientFromSqDist(G, p, Locations, locationDistances.sqDistMatrix(Locations));
+	else
+		covFunc.covarianceGradient(G, p, Locations);
+}
+
+
 vec GaussianProcess::getGradientVector() const
 {
 	return gradient();
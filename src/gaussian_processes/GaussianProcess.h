@@ -33,6 +33,7 @@
 #include "ForwardModel.h"
 #include "optimisation/Optimisable.h"
 #include "covariance_functions/CovarianceFunction.h"
+#include "covariance_functions/DistanceCache.h"
 #include "parameter_transforms/Transform.h"
 
 #include "itpp/itbase.h"
@@ -50,6 +51,18 @@ public:
 	void   makePredictions(vec& Mean, vec& Variance, const mat& Xpred) const;
 	double loglikelihood() const;
 
+	/**
+	 * Cross-validation predictions for the observations, in closed form
+	 * from a single Cholesky factorisation of the covariance (no refits).
+	 * leaveOneOut predicts each observation from all the others; 
+	 * crossValidation predicts the observations of each fold (folds(i) is
+	 * the fold of observation i) from the other folds. The variances are
+	 * those of the observations (they include the noise term of the
+	 * covariance function).
+	 */
+	void   leaveOneOut(vec& Mean, vec& Variance) const;
+	void   crossValidation(vec& Mean, vec& Variance, const ivec& folds) const;
+
 	vec    getTransformedParameters() const;
 	void   setTransformedParameters(const vec p);
 
@@ -58,6 +71,16 @@ public:
 
 	void   estimateParameters();
 
+	/**
+	 * The squared distances between the locations are cached during 
+	 * parameter optimisation (they do not change between evaluations of 
+	 * the objective and gradient). The cache holds an n x n matrix and a 
+	 * copy of the locations, for n observations, roughly doubling the 
+	 * memory used by the model. It is enabled by default; disabling it 
+	 * frees this memory (e.g. once the parameters have been estimated).
+	 */
+	void   setDistanceCache(bool enabled);
+
 private:
 
 	mat    computeCholesky(const mat& iM) const;
@@ -65,10 +88,16 @@ private:
 
 	vec    getGradientVector() const;
 
+	void   locationCovariance(mat& Sigma) const;
+	void   locationCovarianceGradient(mat& G, int p) const;
+
 	CovarianceFunction& covFunc;
 	mat& Locations;
 	vec& Observations;
 
+	bool cacheDistances;                       // Whether locationDistances is used
+	mutable DistanceCache locationDistances;   // Squared distances between locations
+
 };
 
 #endif /*GAUSSIANPROCESS_H_*/
@@ -0,0 +1,535 @@
+#include "IterativeGaussianProcess.h"
+#include "NormalStream.h"
+
+#include <vector>
+
+using namespace std;
+using namespace itpp;
+
+IterativeGaussianProcess::IterativeGaussianProcess(int Inputs, int Outputs, mat& Xdata, vec& ydata, CovarianceFunction& cf) : ForwardModel(Inputs, Outputs), covFunc(cf), Locations(Xdata), Observations(ydata)
+{
+	assert(Locations.rows() == Observations.size());
+
+	tileSize      = ITERATIVE_GP_TILE_SIZE;
+	nProbes       = ITERATIVE_GP_PROBES;
+	tolerance     = ITERATIVE_GP_TOLERANCE;
+	maxIterations = ITERATIVE_GP_MAX_ITERATIONS;
+	rank          = ITERATIVE_GP_RANK;
+	seed          = 0;
+	iterations    = 0;
+}
+
+IterativeGaussianProcess::~IterativeGaussianProcess()
+{
+}
+
+/**
+ * Set the number of rows/columns of the kernel tiles. Each thread holds 
+ * one tile (and its gradient) at a time.
+ */
+void IterativeGaussianProcess::setTileSize(int size)
+{
+	assert(size > 0);
+	tileSize = size;
+}
+
+/**
+ * Set the number of probe vectors used to estimate the log-determinant
+ * and the gradient traces. More probes give a smaller variance of the 
+ * estimates, at the cost of more right hand sides in the solves.
+ */
+void IterativeGaussianProcess::setNumberProbes(int probes)
+{
+	assert(probes > 0);
+	nProbes = probes;
+	cachedParameters.set_size(0);
+}
+
+/**
+ * Set the relative residual ||K x - b|| / ||b|| at which CG stops
+ */
+void IterativeGaussianProcess::setTolerance(double tol)
+{
+	assert(tol > 0.0);
+	tolerance = tol;
+	cachedParameters.set_size(0);
+}
+
+void IterativeGaussianProcess::setMaxIterations(int iter)
+{
+	assert(iter > 0);
+	maxIterations = iter;
+	cachedParameters.set_size(0);
+}
+
+/**
+ * Set the rank of the pivoted Cholesky preconditioner. A rank of 0 gives
+ * a diagonal (Jacobi) preconditioner.
+ */
+void IterativeGaussianProcess::setPreconditionerRank(int r)
+{
+	assert(r >= 0);
+	rank = r;
+	cachedParameters.set_size(0);
+}
+
+/**
+ * Set the seed of the probe vectors
+ */
+void IterativeGaussianProcess::setSeed(uint64_t s)
+{
+	seed = s;
+	cachedParameters.set_size(0);
+}
+
+
+void IterativeGaussianProcess::makePredictions(vec& Mean, vec& Variance, const mat& Xpred) const
+{
+	makePredictions(Mean, Variance, Xpred, covFunc);
+}
+
+/**
+ * Predictive mean and variance at Xpred. The mean only needs K^-1 y, but
+ * the variances need a solve K^-1 k for each prediction location. These
+ * are done tileSize locations at a time.
+ */
+void IterativeGaussianProcess::makePredictions(vec& Mean, vec& Variance, const mat& Xpred, CovarianceFunction &cf) const
+{
+	assert(Mean.size() == Variance.size());
+	assert(Xpred.rows() == Mean.size());
+
+	update();
+
+	int n = Locations.rows();
+	int nTiles = (n + tileSize - 1) / tileSize;
+
+	for (int p1 = 0; p1 < Xpred.rows(); p1 += tileSize)
+	{
+		int p2 = min(p1 + tileSize, Xpred.rows()) - 1;
+		mat Xp = Xpred.get_rows(p1, p2);
+		mat Kp(n, Xp.rows());                                       // k = k(X,x*)
+
+#pragma omp parallel for schedule(dynamic)
+		for (int I = 0; I < nTiles; I++)
+		{
+			int i1 = I * tileSize, i2 = min(i1 + tileSize, n) - 1;
+			mat K(i2 - i1 + 1, Xp.rows());
+			cf.covariance(K, Locations.get_rows(i1, i2), Xp);
+			Kp.set_rows(i1, K);
+		}
+
+		vec kstar(Xp.rows());
+		cf.computeDiagonal(kstar, Xp);                              // k* = K(x*,x*)
+
+		mat V;
+		solve(V, Kp);                                               // v = K^{-1} * k
+
+		Mean.set_subvector(p1, Kp.transpose() * alpha);             // mu* = k' * K^{-1} * y
+		Variance.set_subvector(p1, kstar - sum(elem_mult(Kp, V)));  // k* - k' * K^{-1} * k
+	}
+}
+
+/**
+ * Negative log-likelihood of the observations, with the log-determinant 
+ * estimated by stochastic Lanczos quadrature
+ */
+double IterativeGaussianProcess::loglikelihood() const
+{
+	update();
+
+	double out1 = 0.5 * dot(Observations, alpha);
+	double out2 = 0.5 * logDet;
+
+	return out1 + out2 + 0.5*Observations.size()*log(2*pi);
+}
+
+vec IterativeGaussianProcess::getTransformedParameters() const
+{
+	return covFunc.getTransformedParameters();
+}
+
+void IterativeGaussianProcess::setTransformedParameters(const vec pvec)
+{
+	covFunc.setTransformedParameters(pvec);
+}
+
+double IterativeGaussianProcess::objective() const
+{
+	return loglikelihood();
+}
+
+/**
+ * Gradient of the negative log-likelihood
+ *   dL/dp = 0.5 * tr(K^-1 dK/dp) - 0.5 * a' dK/dp a,   a = K^-1 y
+ * where the trace is the average of (K^-1 z)' dK/dp (P^-1 z) over the 
+ * probes. The quadratic forms are accumulated tile by tile, so dK/dp is 
+ * never formed. Tiles (I,J) and (J,I) are the transpose of each other, 
+ * so only J >= I is computed.
+ */
+vec IterativeGaussianProcess::gradient() const
+{
+	update();
+
+	int n = Locations.rows();
+	int nTiles = (n + tileSize - 1) / tileSize;
+	int nParams = covFunc.getNumberParameters();
+
+	// Quadratic forms u' dK v for the columns of U and V
+	mat U = concat_horizontal(mat(alpha), probeSolves);
+	mat V = concat_horizontal(mat(alpha), probeSolvesP);
+	mat quad(nParams, U.cols());
+	quad.zeros();
+
+#pragma omp parallel
+	{
+		mat local(nParams, U.cols());
+		local.zeros();
+		mat G;
+
+#pragma omp for schedule(dynamic)
+		for (int I = 0; I < nTiles; I++)
+		{
+			int i1 = I * tileSize, i2 = min(i1 + tileSize, n) - 1;
+			mat XI = Locations.get_rows(i1, i2);
+			mat UI = U.get_rows(i1, i2), VI = V.get_rows(i1, i2);
+
+			for (int J = I; J < nTiles; J++)
+			{
+				int j1 = J * tileSize, j2 = min(j1 + tileSize, n) - 1;
+				mat XJ = Locations.get_rows(j1, j2);
+				mat UJ = U.get_rows(j1, j2), VJ = V.get_rows(j1, j2);
+
+				for (int p = 0; p < nParams; p++)
+				{
+					covFunc.covarianceGradient(G, p, XI, XJ);
+					vec q = sum(elem_mult(UI, G * VJ));
+					if (J > I) q += sum(elem_mult(VI, G * UJ));
+					local.set_row(p, local.get_row(p) + q);
+				}
+			}
+		}
+
+#pragma omp critical
+		quad += local;
+	}
+
+	vec grads(nParams);
+	for (int p = 0; p < nParams; p++)
+	{
+		double trace = sum(quad.get_row(p).right(nProbes)) / (double) nProbes;
+		grads(p) = 0.5 * trace - 0.5 * quad(p, 0);
+	}
+	return grads;
+}
+
+
+/**
+ * Product KV = K * V of the covariance of the observations with the 
+ * columns of V. K is computed tile by tile, each thread computing a block
+ * of rows of KV.
+ */
+void IterativeGaussianProcess::kernelProduct(mat& KV, const mat& V) const
+{
+	int n = Locations.rows();
+	int nTiles = (n + tileSize - 1) / tileSize;
+
+	assert(V.rows() == n);
+	KV.set_size(n, V.cols());
+
+#pragma omp parallel for schedule(dynamic)
+	for (int I = 0; I < nTiles; I++)
+	{
+		int i1 = I * tileSize, i2 = min(i1 + tileSize, n) - 1;
+		mat XI = Locations.get_rows(i1, i2);
+		mat KVI(XI.rows(), V.cols());
+		KVI.zeros();
+
+		for (int J = 0; J < nTiles; J++)
+		{
+			int j1 = J * tileSize, j2 = min(j1 + tileSize, n) - 1;
+			mat K(XI.rows(), j2 - j1 + 1);
+			covFunc.covariance(K, XI, Locations.get_rows(j1, j2));
+			KVI += K * V.get_rows(j1, j2);
+		}
+
+		KV.set_rows(i1, KVI);
+	}
+}
+
+
+/**
+ * Pivoted (partial) Cholesky factorisation K ~ L*L' of rank at most r: 
+ * at each step, the observation with the largest residual variance 
+ * becomes a pivot and its column of K is added to L. This stops early if 
+ * the residual variances are all negligible. The residual diagonal D is 
+ * kept (floored away from zero) so that P = L*L' + D is positive definite.
+ */
+void IterativeGaussianProcess::buildPreconditioner() const
+{
+	int n = Locations.rows();
+	int nTiles = (n + tileSize - 1) / tileSize;
+	int r = min(rank, n);
+
+	vec d(n);
+	covFunc.computeDiagonal(d, Locations);
+	double minResidual = 1e-6 * max(d);
+
+	mat Lfull(n, max(r, 1));
+	vec col(n);
+	mat xpivot;
+	int k = 0;
+
+	for (k = 0; k < r; k++)
+	{
+		int pivot = max_index(d);
+		if (d(pivot) <= minResidual) break;
+
+		xpivot = Locations.get_rows(pivot, pivot);
+
+#pragma omp parallel for schedule(dynamic)
+		for (int I = 0; I < nTiles; I++)
+		{
+			int i1 = I * tileSize, i2 = min(i1 + tileSize, n) - 1;
+			mat K(i2 - i1 + 1, 1);
+			covFunc.covariance(K, Locations.get_rows(i1, i2), xpivot);
+			col.set_subvector(i1, K.get_col(0));
+		}
+
+		if (k > 0) col -= Lfull.get_cols(0, k-1) * Lfull.get_row(pivot).left(k);
+		col /= sqrt(d(pivot));
+
+		Lfull.set_col(k, col);
+		d -= elem_mult(col, col);
+		d(pivot) = 0.0;
+	}
+
+	D.set_size(n);
+	for (int i = 0; i < n; i++) D(i) = max(d(i), minResidual);
+	logDetP = sum(log(D));
+
+	if (k == 0)
+	{
+		L.set_size(n, 0);
+		invDL.set_size(n, 0);
+		invA.set_size(0, 0);
+		return;
+	}
+
+	L = Lfull.get_cols(0, k-1);
+	invDL = L;
+	for (int i = 0; i < n; i++) invDL.set_row(i, L.get_row(i) / D(i));
+
+	mat A = eye(k) + L.transpose() * invDL;
+	logDetP += 2.0 * sum(log(diag(chol(A))));
+	invA = inv(A);
+}
+
+/**
+ * Z = P^-1 R = D^-1 R - D^-1 L A^-1 L' D^-1 R   (Woodbury identity)
+ */
+void IterativeGaussianProcess::applyPreconditioner(mat& Z, const mat& R) const
+{
+	Z = R;
+	for (int j = 0; j < Z.cols(); j++)
+	{
+		double* z = Z._data() + j * Z.rows();
+		for (int i = 0; i < Z.rows(); i++) z[i] /= D(i);
+	}
+
+	if (L.cols() > 0) Z -= invDL * (invA * (L.transpose() * Z));
+}
+
+/**
+ * Probe vectors z ~ N(0,P), one per column, as z = L e1 + D^1/2 e2 with 
+ * e1, e2 standard normal. Each probe has its own stream of the seed, so 
+ * the probes are the same at every call.
+ */
+mat IterativeGaussianProcess::sampleProbes() const
+{
+	int n = Locations.rows();
+	int r = L.cols();
+	mat Z(n, nProbes);
+
+	for (int j = 0; j < nProbes; j++)
+	{
+		NormalStream normal(seed, j);
+		vec e1(r), e2(n);
+		for (int i = 0; i < r; i++) e1(i) = normal();
+		for (int i = 0; i < n; i++) e2(i) = normal() * sqrt(D(i));
+
+		if (r > 0) e2 += L * e1;
+		Z.set_col(j, e2);
+	}
+
+	return Z;
+}
+
+
+/**
+ * Solve K X = B with preconditioned conjugate gradients, for all columns 
+ * of B at once (one product with K per iteration for all columns). Each 
+ * column stops when its relative residual is below the tolerance.
+ * 
+ * If Z0 is given, it returns P^-1 B. If logQuadrature is given, it returns
+ * for each column b the Lanczos quadrature estimate of (b' P^-1 b) * 
+ * e1' log(T) e1, where T is the Lanczos tridiagonal matrix of the 
+ * preconditioned system, recovered from the CG coefficients. For b ~ N(0,P)
+ * this is an unbiased estimate of log|P^-1/2 K P^-1/2|.
+ * 
+ * @return the number of iterations
+ */
+int IterativeGaussianProcess::solve(mat& Xsol, const mat& B, mat* Z0, vec* logQuadrature) const
+{
+	int n = B.rows(), m = B.cols();
+
+	mat R = B, Z, Q;
+	applyPreconditioner(Z, R);
+	if (Z0) *Z0 = Z;
+
+	mat Pdir = Z;
+	Xsol.set_size(n, m);
+	Xsol.zeros();
+
+	vec rz(m), rz0(m), bnorm(m);
+	vector<bool> active(m, true);
+	vector< vector<double> > alphas(m), betas(m);
+	int nActive = m;
+
+	for (int j = 0; j < m; j++)
+	{
+		rz(j) = dot(R.get_col(j), Z.get_col(j));
+		bnorm(j) = norm(B.get_col(j));
+		if (bnorm(j) == 0.0) { active[j] = false; nActive--; }
+	}
+	rz0 = rz;
+
+	int it;
+	for (it = 0; it < maxIterations && nActive > 0; it++)
+	{
+		kernelProduct(Q, Pdir);
+
+		for (int j = 0; j < m; j++)
+		{
+			if (!active[j]) continue;
+
+			double* x = Xsol._data() + j * n;
+			double* r = R._data() + j * n;
+			double* p = Pdir._data() + j * n;
+			double* q = Q._data() + j * n;
+
+			double pq = 0.0;
+			for (int i = 0; i < n; i++) pq += p[i] * q[i];
+
+			double a = rz(j) / pq;
+			double rr = 0.0;
+			for (int i = 0; i < n; i++)
+			{
+				x[i] += a * p[i];
+				r[i] -= a * q[i];
+				rr += r[i] * r[i];
+			}
+			alphas[j].push_back(a);
+
+			if (sqrt(rr) <= tolerance * bnorm(j))
+			{
+				active[j] = false;
+				nActive--;
+				for (int i = 0; i < n; i++) p[i] = 0.0;     // Nothing left to do for this column
+			}
+		}
+
+		if (nActive == 0) break;
+
+		applyPreconditioner(Z, R);
+
+		for (int j = 0; j < m; j++)
+		{
+			if (!active[j]) continue;
+
+			double* z = Z._data() + j * n;
+			double* r = R._data() + j * n;
+			double* p = Pdir._data() + j * n;
+
+			double rzNew = 0.0;
+			for (int i = 0; i < n; i++) rzNew += r[i] * z[i];
+
+			double beta = rzNew / rz(j);
+			for (int i = 0; i < n; i++) p[i] = z[i] + beta * p[i];
+
+			betas[j].push_back(beta);
+			rz(j) = rzNew;
+		}
+	}
+
+	if (nActive > 0)
+	{
+		cerr << "IterativeGaussianProcess: " << nActive << " of " << m << " CG solves did not converge in "
+		     << maxIterations << " iterations" << endl;
+	}
+
+	iterations = it;
+
+	if (logQuadrature)
+	{
+		logQuadrature->set_size(m);
+		logQuadrature->zeros();
+
+		for (int j = 0; j < m; j++)
+		{
+			int k = alphas[j].size();
+			if (k == 0) continue;
+
+			mat T(k, k);
+			T.zeros();
+			for (int i = 0; i < k; i++)
+			{
+				T(i, i) = 1.0 / alphas[j][i];
+				if (i > 0)
+				{
+					T(i, i) += betas[j][i-1] / alphas[j][i-1];
+					T(i, i-1) = T(i-1, i) = sqrt(betas[j][i-1]) / alphas[j][i-1];
+				}
+			}
+
+			vec lambda;
+			mat W;
+			eig_sym(T, lambda, W);
+
+			double quadrature = 0.0;
+			for (int i = 0; i < k; i++) quadrature += W(0, i) * W(0, i) * log(lambda(i));
+			(*logQuadrature)(j) = rz0(j) * quadrature;
+		}
+	}
+
+	return it;
+}
+
+
+/**
+ * Compute the preconditioner, K^-1 y, the probe solves and the estimate
+ * of log|K| for the current parameters, unless they are already cached.
+ */
+void IterativeGaussianProcess::update() const
+{
+	vec params = covFunc.getTransformedParameters();
+	if (cachedParameters.size() == params.size() && cachedParameters == params) return;
+
+	int n = Locations.rows();
+
+	buildPreconditioner();
+
+	mat B(n, nProbes + 1);
+	B.set_col(0, Observations);
+	B.set_submatrix(0, 1, sampleProbes());
+
+	mat Xsol, Z0;
+	vec logQuadrature;
+	solve(Xsol, B, &Z0, &logQuadrature);
+
+	alpha = Xsol.get_col(0);
+	probeSolves = Xsol.get_cols(1, nProbes);
+	probeSolvesP = Z0.get_cols(1, nProbes);
+	logDet = logDetP + sum(logQuadrature.right(nProbes)) / (double) nProbes;
+
+	cachedParameters = params;
+}
@@ -0,0 +1,134 @@
+/***************************************************************************
+ *   AstonGeostats, algorithms for low-rank geostatistical models          *
+ *                                                                         *
+ *   Copyright (C) Remi Barillec, Ben Ingram, 2008-2009                    *
+ *                                                                         *
+ *   Remi Barillec, r.barillec@aston.ac.uk
+ *   Ben Ingram, IngramBR@Aston.ac.uk                                      *
+ *   Neural Computing Research Group,                                      *
+ *   Aston University,                                                     *
+ *   Aston Street, Aston Triangle,                                         *
+ *   Birmingham. B4 7ET.                                                   *
+ *   United Kingdom                                                        *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#ifndef ITERATIVEGAUSSIANPROCESS_H_
+#define ITERATIVEGAUSSIANPROCESS_H_
+
+#include "ForwardModel.h"
+#include "optimisation/Optimisable.h"
+#include "covariance_functions/CovarianceFunction.h"
+
+#include "itpp/itbase.h"
+
+#include <stdint.h>
+#include <cassert>
+
+using namespace itpp;
+
+#define ITERATIVE_GP_TILE_SIZE      256     // Rows/columns of the kernel tiles
+#define ITERATIVE_GP_PROBES         10      // Number of probe vectors (log-det and traces)
+#define ITERATIVE_GP_TOLERANCE      1e-6    // Relative residual for the CG solves
+#define ITERATIVE_GP_MAX_ITERATIONS 1000    // Max number of CG iterations
+#define ITERATIVE_GP_RANK           100     // Rank of the pivoted Cholesky preconditioner
+
+/**
+ * Exact GP regression using iterative solvers, for datasets too large for 
+ * the dense factorisations of GaussianProcess. The covariance matrix K is 
+ * never formed: it is only used through products K*V, computed tile by 
+ * tile (in parallel with OpenMP), so that memory is O(n) for n observations.
+ * 
+ * - Linear systems K*x = b are solved with preconditioned conjugate 
+ *   gradients (PCG), several right hand sides at once.
+ * - The preconditioner is P = L*L' + D, where L is the rank r pivoted 
+ *   Cholesky factor of K and D is the diagonal of K - L*L'. The pivots are
+ *   greedily selected, most informative observations (an active set), and 
+ *   P is applied with the Woodbury identity in O(n*r).
+ * - log|K| = log|P| + log|P^-1/2 K P^-1/2| is estimated with stochastic 
+ *   Lanczos quadrature: the tridiagonal Lanczos matrices are recovered from
+ *   the CG coefficients of the solves K^-1 z for probe vectors z ~ N(0,P).
+ * - The traces tr(K^-1 dK/dp) of the gradient are estimated with the 
+ *   Hutchinson estimator (K^-1 z)' dK/dp (P^-1 z) on the same probes.
+ * 
+ * The probes are drawn from a fixed seed, so that objective() and 
+ * gradient() are deterministic functions of the parameters (as required by
+ * the SCG optimiser). Both are computed from the same set of solves, which
+ * are cached until the parameters change.
+ */
+class IterativeGaussianProcess : public ForwardModel, public Optimisable
+{
+public:
+	IterativeGaussianProcess(int Inputs, int Outputs, mat& Xdata, vec& ydata, CovarianceFunction& cf);
+	virtual ~IterativeGaussianProcess();
+
+	void   makePredictions(vec& Mean, vec& Variance, const mat& Xpred, CovarianceFunction &cf) const;
+	void   makePredictions(vec& Mean, vec& Variance, const mat& Xpred) const;
+	double loglikelihood() const;
+
+	vec    getTransformedParameters() const;
+	void   setTransformedParameters(const vec p);
+
+	double objective() const;
+	vec    gradient() const;
+
+	void   setTileSize(int size);
+	void   setNumberProbes(int probes);
+	void   setTolerance(double tol);
+	void   setMaxIterations(int iterations);
+	void   setPreconditionerRank(int rank);
+	void   setSeed(uint64_t s);
+
+	int    getNumberIterations() const { return iterations; }
+
+private:
+
+	void   kernelProduct(mat& KV, const mat& V) const;
+	void   buildPreconditioner() const;
+	void   applyPreconditioner(mat& Z, const mat& R) const;
+	mat    sampleProbes() const;
+	int    solve(mat& Xsol, const mat& B, mat* Z0 = NULL, vec* logQuadrature = NULL) const;
+	void   update() const;
+
+	CovarianceFunction& covFunc;
+	mat& Locations;
+	vec& Observations;
+
+	int      tileSize;
+	int      nProbes;
+	double   tolerance;
+	int      maxIterations;
+	int      rank;
+	uint64_t seed;
+
+	// Solves for the current parameters (see update)
+	mutable vec    cachedParameters;
+	mutable vec    alpha;          // K^-1 y
+	mutable mat    probeSolves;    // K^-1 z for each probe z (one per column)
+	mutable mat    probeSolvesP;   // P^-1 z
+	mutable double logDet;         // Estimate of log|K|
+	mutable int    iterations;     // CG iterations of the last solve
+
+	// Preconditioner P = L*L' + diag(D), P^-1 = D^-1 - D^-1 L A^-1 L' D^-1
+	mutable mat    L;
+	mutable vec    D;
+	mutable mat    invDL;          // D^-1 L
+	mutable mat    invA;           // A = I + L' D^-1 L
+	mutable double logDetP;
+};
+
+#endif /*ITERATIVEGAUSSIANPROCESS_H_*/
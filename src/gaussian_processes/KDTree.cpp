@@ -0,0 +1,156 @@
+#include "KDTree.h"
+
+#include <algorithm>
+
+/**
+ * Orders point indices by one coordinate
+ */
+struct CoordinateLess
+{
+    CoordinateLess(const mat& P, int dim) : P(P), dim(dim) {}
+    bool operator()(int a, int b) const { return P(a, dim) < P(b, dim); }
+    
+    const mat& P;
+    int dim;
+};
+
+/**
+ * Build the tree for the points in X (one per row)
+ */
+KDTree::KDTree(const mat& X) : points(X)
+{
+    index.resize(X.rows());
+    for (int i = 0; i < X.rows(); i++) index[i] = i;
+    
+    if (X.rows() > 0) build(0, X.rows());
+}
+
+KDTree::~KDTree()
+{
+}
+
+/**
+ * Build the subtree for the points index[begin..end-1], splitting at the 
+ * median of the dimension with the widest spread. Returns the node number.
+ */
+int KDTree::build(int begin, int end)
+{
+    int d = points.cols();
+    
+    Node node;
+    node.begin = begin;
+    node.end = end;
+    node.left = node.right = -1;
+    node.dim = 0;
+    node.minIndex = index[begin];
+    node.lower = points.get_row(index[begin]);
+    node.upper = node.lower;
+    
+    for (int i = begin + 1; i < end; i++)
+    {
+        int p = index[i];
+        node.minIndex = min(node.minIndex, p);
+        for (int j = 0; j < d; j++)
+        {
+            node.lower(j) = min(node.lower(j), points(p, j));
+            node.upper(j) = max(node.upper(j), points(p, j));
+        }
+    }
+    
+    int id = nodes.size();
+    nodes.push_back(node);
+    
+    if (end - begin <= KDTREE_LEAF_SIZE) return id;
+    
+    int dim = max_index(node.upper - node.lower);
+    int mid = (begin + end) / 2;
+    nodes[id].dim = dim;
+    nth_element(index.begin() + begin, index.begin() + mid, index.begin() + end,
+                CoordinateLess(points, dim));
+    
+    int left = build(begin, mid);
+    int right = build(mid, end);
+    nodes[id].left = left;
+    nodes[id].right = right;
+    
+    return id;
+}
+
+/**
+ * Find the k nearest points to x (Euclidean distance). 
+ * 
+ * @param indices    the indices (rows of X) of the neighbours, nearest 
+ *                   first. There are fewer than k if fewer points qualify.
+ * @param x          the query point
+ * @param k          the number of neighbours
+ * @param before     if non-negative, only points with index < before are 
+ *                   considered
+ * @param excludeIdentical  if true, points identical to x are skipped
+ */
+void KDTree::nearest(ivec& indices, const vec& x, int k, int before, bool excludeIdentical) const
+{
+    assert(x.size() == points.cols());
+    
+    if (before < 0) before = points.rows();
+    
+    vector< pair<double,int> > heap;     // Max-heap on the distance
+    if (k > 0 && !nodes.empty()) search(0, x, k, before, excludeIdentical, heap);
+    
+    sort_heap(heap.begin(), heap.end());
+    indices.set_size(heap.size());
+    for (unsigned int i = 0; i < heap.size(); i++) indices(i) = heap[i].second;
+}
+
+void KDTree::search(int id, const vec& x, int k, int before, bool excludeIdentical, 
+                    vector< pair<double,int> >& heap) const
+{
+    const Node& node = nodes[id];
+    if (node.minIndex >= before) return;
+    
+    // Squared distance from x to the bounding box
+    double boxDist = 0.0;
+    for (int j = 0; j < x.size(); j++)
+    {
+        double e = 0.0;
+        if (x(j) < node.lower(j)) e = node.lower(j) - x(j);
+        else if (x(j) > node.upper(j)) e = x(j) - node.upper(j);
+        boxDist += e * e;
+    }
+    if ((int) heap.size() == k && boxDist >= heap.front().first) return;
+    
+    if (node.left < 0)
+    {
+        for (int i = node.begin; i < node.end; i++)
+        {
+            int p = index[i];
+            if (p >= before) continue;
+            
+            double dist = 0.0;
+            for (int j = 0; j < x.size(); j++) 
+            {
+                double e = points(p, j) - x(j);
+                dist += e * e;
+            }
+            if (excludeIdentical && dist == 0.0) continue;
+            
+            if ((int) heap.size() < k)
+            {
+                heap.push_back(make_pair(dist, p));
+                push_heap(heap.begin(), heap.end());
+            }
+            else if (dist < heap.front().first)
+            {
+                pop_heap(heap.begin(), heap.end());
+                heap.back() = make_pair(dist, p);
+                push_heap(heap.begin(), heap.end());
+            }
+        }
+        return;
+    }
+    
+    // Visit the nearest child first
+    bool leftFirst = (x(node.dim) <= nodes[node.left].upper(node.dim));
+    
+    search(leftFirst ? node.left : node.right, x, k, before, excludeIdentical, heap);
+    search(leftFirst ? node.right : node.left, x, k, before, excludeIdentical, heap);
+}
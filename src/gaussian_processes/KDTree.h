@@ -0,0 +1,80 @@
+/***************************************************************************
+ *   AstonGeostats, algorithms for low-rank geostatistical models          *
+ *                                                                         *
+ *   Copyright (C) Remi Barillec, Ben Ingram, 2008-2009                    *
+ *                                                                         *
+ *   Remi Barillec, r.barillec@aston.ac.uk
+ *   Ben Ingram, IngramBR@Aston.ac.uk                                      *
+ *   Neural Computing Research Group,                                      *
+ *   Aston University,                                                     *
+ *   Aston Street, Aston Triangle,                                         *
+ *   Birmingham. B4 7ET.                                                   *
+ *   United Kingdom                                                        *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#ifndef KDTREE_H_
+#define KDTREE_H_
+
+#include <itpp/itbase.h>
+
+#include <vector>
+#include <cassert>
+
+using namespace std;
+using namespace itpp;
+
+#define KDTREE_LEAF_SIZE 16     // Max number of points in a leaf
+
+/**
+ * k-d tree for nearest neighbour queries on a fixed set of points (one 
+ * per row). Each node keeps the bounding box of its points, so that whole
+ * subtrees further than the current k-th neighbour are skipped, and the
+ * smallest point index it contains, so that queries can be restricted to
+ * the points with an index below a bound (the "previous" points of an 
+ * ordering) without visiting the others.
+ */
+class KDTree
+{
+public:
+    KDTree(const mat& X);
+    virtual ~KDTree();
+
+    void nearest(ivec& indices, const vec& x, int k, int before = -1, bool excludeIdentical = false) const;
+
+    int size() const { return points.rows(); }
+
+private:
+    struct Node
+    {
+        int begin, end;        // Points index[begin..end-1]
+        int left, right;       // Children (-1 for a leaf)
+        int dim;               // Split dimension
+        int minIndex;          // Smallest point index in this node
+        vec lower, upper;      // Bounding box
+    };
+
+    int build(int begin, int end);
+    void search(int node, const vec& x, int k, int before, bool excludeIdentical,
+                vector< pair<double,int> >& heap) const;
+
+    mat points;
+    vector<int> index;
+    vector<Node> nodes;
+};
+
+#endif /*KDTREE_H_*/
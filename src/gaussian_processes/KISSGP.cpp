@@ -0,0 +1,471 @@
+#include "KISSGP.h"
+#include "NormalStream.h"
+
+#include <itpp/itsignal.h>
+
+using namespace std;
+using namespace itpp;
+
+KISSGP::KISSGP(int Inputs, int Outputs, mat& Xdata, vec& ydata, StationaryCF& cf,
+               double s2, int gridSize0, int gridSize1)
+: ForwardModel(Inputs, Outputs), covFunc(cf), Locations(Xdata), Observations(ydata)
+{
+	assert(Locations.rows() == Observations.size());
+	assert(Locations.cols() == 2);
+	assert(gridSize0 >= 4 && gridSize1 >= 4);
+	assert(s2 > 0.0);
+
+	noiseVariance     = s2;
+	tolerance         = KISSGP_TOLERANCE;
+	lanczosIterations = KISSGP_LANCZOS;
+	nIterations       = 0;
+
+	gridSize.set_size(2);
+	gridSize(0) = gridSize0;
+	gridSize(1) = gridSize1;
+
+	vec lower(2), upper(2);
+	for (int a = 0; a < 2; a++)
+	{
+		lower(a) = min(Locations.get_col(a));
+		upper(a) = max(Locations.get_col(a));
+	}
+	setGrid(lower, upper);
+}
+
+KISSGP::~KISSGP()
+{
+}
+
+/**
+ * Place the grid so that its interior (all but one node on each side,
+ * needed by the cubic interpolation) covers the box [lower, upper]. This
+ * should include the prediction locations as well as the observations.
+ */
+void KISSGP::setGrid(const vec& lower, const vec& upper)
+{
+	assert(lower.size() == 2 && upper.size() == 2);
+
+	gridOrigin.set_size(2);
+	gridSpacing.set_size(2);
+
+	for (int a = 0; a < 2; a++)
+	{
+		double range = upper(a) - lower(a);
+		gridSpacing(a) = (range > 0.0) ? range / (gridSize(a) - 3) : 1.0;
+		gridOrigin(a) = lower(a) - gridSpacing(a);
+	}
+
+	interpolationWeights(dataIndex, dataWeights, Locations);
+	cachedParameters.set_size(0);
+}
+
+void KISSGP::setNoiseVariance(double s2)
+{
+	assert(s2 > 0.0);
+	noiseVariance = s2;
+	cachedParameters.set_size(0);
+}
+
+/**
+ * Set the number of Lanczos iterations used for the predictive variances
+ * (the rank of their correction to the prior variance)
+ */
+void KISSGP::setLanczosIterations(int k)
+{
+	assert(k > 0);
+	lanczosIterations = k;
+	cachedParameters.set_size(0);
+}
+
+
+/**
+ * Cubic convolution weights (Keys, 1981) of the inputs X on the grid. For
+ * each input, the 4x4 nodes around it are stored in a row of KISSGP_WEIGHTS
+ * entries of index (node i0 + n0*i1 of the grid) and weights.
+ */
+void KISSGP::interpolationWeights(ivec& index, vec& weights, const mat& X) const
+{
+	int n = X.rows();
+	index.set_size(n * KISSGP_WEIGHTS);
+	weights.set_size(n * KISSGP_WEIGHTS);
+
+#pragma omp parallel for schedule(dynamic, 1000)
+	for (int i = 0; i < n; i++)
+	{
+		int k[2];
+		double w[2][4];
+
+		for (int a = 0; a < 2; a++)
+		{
+			// Position on the grid, snapped to its interior
+			double u = (X(i, a) - gridOrigin(a)) / gridSpacing(a);
+			u = std::max(1.0, std::min(u, gridSize(a) - 2.0));
+			k[a] = std::min(int(floor(u)), gridSize(a) - 3);
+
+			double t = u - k[a];
+			w[a][0] = ((-0.5 * t + 1.0) * t - 0.5) * t;
+			w[a][1] = (1.5 * t - 2.5) * t * t + 1.0;
+			w[a][2] = ((-1.5 * t + 2.0) * t + 0.5) * t;
+			w[a][3] = (0.5 * t - 0.5) * t * t;
+		}
+
+		int* idx = index._data() + i * KISSGP_WEIGHTS;
+		double* wts = weights._data() + i * KISSGP_WEIGHTS;
+
+		for (int q = 0; q < 4; q++)
+		{
+			for (int p = 0; p < 4; p++)
+			{
+				idx[4*q + p] = (k[0] - 1 + p) + gridSize(0) * (k[1] - 1 + q);
+				wts[4*q + p] = w[0][p] * w[1][q];
+			}
+		}
+	}
+}
+
+
+/**
+ * Interpolate values u on the grid at the observations, v = W u
+ */
+void KISSGP::interpolate(vec& v, const vec& u) const
+{
+	int n = Locations.rows();
+	v.set_size(n);
+
+	const int* idx = dataIndex._data();
+	const double* wts = dataWeights._data();
+
+#pragma omp parallel for schedule(static)
+	for (int i = 0; i < n; i++)
+	{
+		double s = 0.0;
+		for (int k = i * KISSGP_WEIGHTS; k < (i + 1) * KISSGP_WEIGHTS; k++) s += wts[k] * u[idx[k]];
+		v[i] = s;
+	}
+}
+
+
+/**
+ * Spread values v at the observations onto the grid, u = W' v. This is
+ * done serially, as neighbouring observations write to the same nodes.
+ */
+void KISSGP::spread(vec& u, const vec& v) const
+{
+	int n = Locations.rows();
+	u.set_size(gridSize(0) * gridSize(1));
+	u.zeros();
+
+	const int* idx = dataIndex._data();
+	const double* wts = dataWeights._data();
+
+	for (int i = 0; i < n; i++)
+	{
+		for (int k = i * KISSGP_WEIGHTS; k < (i + 1) * KISSGP_WEIGHTS; k++) u[idx[k]] += wts[k] * v[i];
+	}
+}
+
+
+/**
+ * 2D FFT of a complex matrix (1D FFTs of the columns, then of the rows)
+ */
+static void fft2(cmat& A, bool inverse)
+{
+	for (int j=0; j<A.cols(); j++) A.set_col(j, inverse ? ifft(A.get_col(j)) : fft(A.get_col(j)));
+	for (int i=0; i<A.rows(); i++) A.set_row(i, inverse ? ifft(A.get_row(i)) : fft(A.get_row(i)));
+}
+
+
+/**
+ * Size of the circulant embedding along a grid dimension of n nodes
+ * (a power of 2, for the FFT)
+ */
+static int embeddingSize(int n)
+{
+	int M = 2;
+	while (M < 2 * (n - 1)) M *= 2;
+	return M;
+}
+
+
+/**
+ * Products KU = K_UU U with the covariance matrix of the grid, for each
+ * column of U (values at the nodes). The grid is zero-padded to the
+ * circulant embedding, which is diagonalised by the FFT. As K_UU is real,
+ * two columns are multiplied at once, as the real and imaginary parts of
+ * the same complex matrix.
+ */
+void KISSGP::kernelProduct(mat& KU, const mat& U) const
+{
+	int n0 = gridSize(0), n1 = gridSize(1);
+	int M0 = eigenvalues.rows(), M1 = eigenvalues.cols();
+	assert(U.rows() == n0 * n1);
+
+	KU.set_size(U.rows(), U.cols());
+	cmat Z(M0, M1);
+
+	for (int j = 0; j < U.cols(); j += 2)
+	{
+		bool pair = (j + 1 < U.cols());
+
+		Z.zeros();
+		for (int i1 = 0; i1 < n1; i1++)
+		{
+			for (int i0 = 0; i0 < n0; i0++)
+			{
+				Z(i0, i1) = complex<double>(U(i0 + n0*i1, j), pair ? U(i0 + n0*i1, j + 1) : 0.0);
+			}
+		}
+
+		fft2(Z, false);
+		for (int j1 = 0; j1 < M1; j1++)
+		{
+			for (int j0 = 0; j0 < M0; j0++) Z(j0, j1) *= eigenvalues(j0, j1);
+		}
+		fft2(Z, true);
+
+		for (int i1 = 0; i1 < n1; i1++)
+		{
+			for (int i0 = 0; i0 < n0; i0++)
+			{
+				KU(i0 + n0*i1, j) = Z(i0, i1).real();
+				if (pair) KU(i0 + n0*i1, j + 1) = Z(i0, i1).imag();
+			}
+		}
+	}
+}
+
+
+/**
+ * Product with the system matrix, Av = (W K_UU W' + s2 I) v
+ */
+void KISSGP::systemProduct(vec& Av, const vec& v) const
+{
+	vec u;
+	mat Ku;
+
+	spread(u, v);
+	kernelProduct(Ku, u);
+	interpolate(Av, Ku.get_col(0));
+	Av += noiseVariance * v;
+}
+
+
+/**
+ * Interpolated prior variance w' K_UU w of an input with the given
+ * interpolation weights, from the covariance at the lags between nodes
+ */
+double KISSGP::gridCovariance(const int* index, const double* weights) const
+{
+	int n0 = gridSize(0);
+	double c = 0.0;
+
+	for (int a = 0; a < KISSGP_WEIGHTS; a++)
+	{
+		int a0 = index[a] % n0, a1 = index[a] / n0;
+		double s = 0.0;
+
+		for (int b = 0; b < KISSGP_WEIGHTS; b++)
+		{
+			int b0 = index[b] % n0, b1 = index[b] / n0;
+			s += weights[b] * lagCovariance(abs(a0 - b0), abs(a1 - b1));
+		}
+		c += weights[a] * s;
+	}
+
+	return c;
+}
+
+
+/**
+ * Solve the system for the current parameters, unless they are already
+ * cached:
+ * 1. Eigenvalues of the circulant embedding of K_UU (FFT of its first row)
+ * 2. a = (W K_UU W' + s2 I)^-1 y by CG, with a diagonal preconditioner,
+ *    and the mean on the grid K_UU W' a
+ * 3. k Lanczos iterations on the system matrix (with full
+ *    reorthogonalisation), and the factor R of the predictive variances.
+ *    The start vector is random (from a fixed seed), so that the Krylov 
+ *    space is not biased towards the direction of y, and the variances
+ *    are reproducible.
+ */
+void KISSGP::update() const
+{
+	vec params = concat(covFunc.getTransformedParameters(), log(noiseVariance));
+	if (cachedParameters.size() == params.size() && cachedParameters == params) return;
+
+	int n = Locations.rows();
+	int n0 = gridSize(0), n1 = gridSize(1);
+	int M0 = embeddingSize(n0), M1 = embeddingSize(n1);
+
+	// First row of the circulant matrix: covariance at all (periodic) lags
+	vec lags0(M0), lags1(M1);
+	for (int j0 = 0; j0 < M0; j0++) lags0(j0) = ((j0 <= M0/2) ? j0 : j0 - M0) * gridSpacing(0);
+	for (int j1 = 0; j1 < M1; j1++) lags1(j1) = ((j1 <= M1/2) ? j1 : j1 - M1) * gridSpacing(1);
+
+	mat c;
+	covFunc.gridCovariance(c, lags0, lags1);
+	lagCovariance = c.get(0, n0 - 1, 0, n1 - 1);
+
+	cmat lambda(M0, M1);
+	for (int j1 = 0; j1 < M1; j1++)
+	{
+		for (int j0 = 0; j0 < M0; j0++) lambda(j0, j1) = c(j0, j1);
+	}
+	fft2(lambda, false);
+
+	eigenvalues.set_size(M0, M1);
+	for (int j1 = 0; j1 < M1; j1++)
+	{
+		for (int j0 = 0; j0 < M0; j0++) eigenvalues(j0, j1) = lambda(j0, j1).real();
+	}
+
+	// Diagonal preconditioner
+	vec diagonal(n);
+#pragma omp parallel for schedule(dynamic, 1000)
+	for (int i = 0; i < n; i++)
+	{
+		diagonal(i) = gridCovariance(dataIndex._data() + i * KISSGP_WEIGHTS,
+		                             dataWeights._data() + i * KISSGP_WEIGHTS) + noiseVariance;
+	}
+
+	// Preconditioned conjugate gradients
+	vec alpha(n), r = Observations, Ap;
+	alpha.zeros();
+	vec z = elem_div(r, diagonal);
+	vec p = z;
+	double rz = dot(r, z);
+	double threshold = tolerance * norm(Observations);
+
+	nIterations = 0;
+	while (norm(r) > threshold && nIterations < KISSGP_MAX_ITERATIONS)
+	{
+		systemProduct(Ap, p);
+		double step = rz / dot(p, Ap);
+		alpha += step * p;
+		r -= step * Ap;
+
+		z = elem_div(r, diagonal);
+		double rzNew = dot(r, z);
+		p = z + (rzNew / rz) * p;
+		rz = rzNew;
+		nIterations++;
+	}
+
+	if (norm(r) > threshold)
+	{
+		cerr << "KISSGP: CG solve did not converge in " << KISSGP_MAX_ITERATIONS
+		     << " iterations (relative residual " << norm(r) / norm(Observations) << ")" << endl;
+	}
+
+	vec u;
+	mat Ku;
+	spread(u, alpha);
+	kernelProduct(Ku, u);
+	gridMean = Ku.get_col(0);
+
+	// Lanczos iterations A Q = Q T
+	int k = std::min(lanczosIterations, n);
+	mat Q(n, k);
+	vec diagT(k), offDiagT(k);
+	vec q(n), Aq;
+	NormalStream normal(0, 0);
+	for (int i = 0; i < n; i++) q(i) = normal();
+	q /= norm(q);
+
+	int m = 0;
+	while (m < k)
+	{
+		Q.set_col(m, q);
+		systemProduct(Aq, q);
+		diagT(m) = dot(q, Aq);
+
+		vec w = Aq - diagT(m) * q;
+		if (m > 0) w -= offDiagT(m - 1) * Q.get_col(m - 1);
+		for (int j = 0; j <= m; j++) w -= dot(w, Q.get_col(j)) * Q.get_col(j);
+
+		offDiagT(m) = norm(w);
+		m++;
+		if (offDiagT(m - 1) < 1e-10 * std::abs(diagT(m - 1))) break;
+		q = w / offDiagT(m - 1);
+	}
+
+	mat T(m, m);
+	T.zeros();
+	for (int j = 0; j < m; j++)
+	{
+		T(j, j) = diagT(j);
+		if (j + 1 < m) T(j, j + 1) = T(j + 1, j) = offDiagT(j);
+	}
+
+	// R = K_UU W' Q U^-1, with U'U = T, stored transposed (one column per node)
+	mat WQ(n0 * n1, m), KWQ;
+	for (int j = 0; j < m; j++)
+	{
+		spread(u, Q.get_col(j));
+		WQ.set_col(j, u);
+	}
+	kernelProduct(KWQ, WQ);
+	varianceFactor = (KWQ * inv(chol(T))).transpose();
+
+	cachedParameters = params;
+}
+
+
+/**
+ * Products KU = K_UU U with the covariance matrix of the grid of inducing 
+ * points (FFT of the circulant embedding, see kernelProduct), for the 
+ * current parameters. The nodes are ordered with the first axis running 
+ * fastest, node (i0,i1) being at getGridOrigin() + (i0,i1) * getGridSpacing().
+ */
+void KISSGP::multiplyGridCovariance(mat& KU, const mat& U) const
+{
+	assert(U.rows() == prod(gridSize));
+
+	update();
+	kernelProduct(KU, U);
+}
+
+
+/**
+ * Predictive mean and variance of the latent function at Xpred, from the
+ * interpolation weights w* of each input
+ *   mu* = w*' K_UU W' a,   var* = w*' K_UU w* - |R' w*|^2
+ */
+void KISSGP::makePredictions(vec& Mean, vec& Variance, const mat& Xpred) const
+{
+	assert(Mean.size() == Variance.size());
+	assert(Xpred.rows() == Mean.size());
+	assert(Xpred.cols() == 2);
+
+	update();
+
+	ivec index;
+	vec weights;
+	interpolationWeights(index, weights, Xpred);
+
+	int nPred = Xpred.rows();
+	int k = varianceFactor.rows();
+
+#pragma omp parallel for schedule(dynamic, 1000)
+	for (int i = 0; i < nPred; i++)
+	{
+		const int* idx = index._data() + i * KISSGP_WEIGHTS;
+		const double* wts = weights._data() + i * KISSGP_WEIGHTS;
+
+		double mean = 0.0;
+		vec r(k);
+		r.zeros();
+
+		for (int a = 0; a < KISSGP_WEIGHTS; a++)
+		{
+			mean += wts[a] * gridMean[idx[a]];
+
+			const double* R = varianceFactor._data() + idx[a] * k;
+			for (int j = 0; j < k; j++) r[j] += wts[a] * R[j];
+		}
+
+		Mean(i) = mean;
+		Variance(i) = std::max(gridCovariance(idx, wts) - dot(r, r), 0.0);
+	}
+}
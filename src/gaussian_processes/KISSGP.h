@@ -0,0 +1,132 @@
+/***************************************************************************
+ *   AstonGeostats, algorithms for low-rank geostatistical models          *
+ *                                                                         *
+ *   Copyright (C) Remi Barillec, Ben Ingram, 2008-2009                    *
+ *                                                                         *
+ *   Remi Barillec, r.barillec@aston.ac.uk
+ *   Ben Ingram, IngramBR@Aston.ac.uk                                      *
+ *   Neural Computing Research Group,                                      *
+ *   Aston University,                                                     *
+ *   Aston Street, Aston Triangle,                                         *
+ *   Birmingham. B4 7ET.                                                   *
+ *   United Kingdom                                                        *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#ifndef KISSGP_H_
+#define KISSGP_H_
+
+#include "ForwardModel.h"
+#include "covariance_functions/StationaryCF.h"
+
+#include "itpp/itbase.h"
+
+#include <cassert>
+
+using namespace itpp;
+
+#define KISSGP_WEIGHTS         16      // Interpolation weights per input (4x4 nodes)
+#define KISSGP_TOLERANCE       1e-6    // Relative residual for the CG solve
+#define KISSGP_MAX_ITERATIONS  1000    // Max number of CG iterations
+#define KISSGP_LANCZOS         100     // Lanczos iterations for the predictive variances
+
+/**
+ * Structured kernel interpolation (KISS-GP) for GP regression with 2D 
+ * inputs, a stationary covariance function and Gaussian noise s2. The 
+ * covariance is approximated as 
+ * 
+ *   K(X1,X2) ~ W1 * K_UU * W2'
+ * 
+ * where U is a regular grid of inducing points and each row of W holds the
+ * cubic convolution weights (Keys, 1981) of an input on the 4x4 nodes 
+ * around it. On a regular grid, K_UU is block Toeplitz with Toeplitz 
+ * blocks: it is embedded in a circulant matrix on a periodic grid twice 
+ * the size, and products K_UU * v cost O(m log m) for m nodes with the 
+ * FFT. Products with W are sparse, so the system (W K_UU W' + s2 I) a = y 
+ * is solved by preconditioned CG in O(n + m log m) per iteration.
+ * 
+ * Predictions at any input x* then cost O(1) each:
+ *   - the mean is w*' K_UU W' a, a product with a vector on the grid
+ *   - the variance is w*' K_UU w* - |R' w*|^2, where R = K_UU W' Q L^-T 
+ *     comes from k Lanczos iterations (A Q = Q T, T = L L') on the system 
+ *     matrix A (LOVE, Pleiss et al., 2018)
+ * Both are computed once, when the first predictions are made, and cached
+ * until the parameters change. As Q T^-1 Q' only approximates A^-1 on the
+ * Krylov space, the variances are overestimated when k is too small, and 
+ * converge to the (interpolated) exact ones as k increases. Storing Q takes
+ * O(n k) memory.
+ * 
+ * By default, the grid covers the bounding box of the observations (with a
+ * margin of one node for the interpolation). Inputs outside the grid are 
+ * snapped to its boundary, so use setGrid() to also cover the prediction 
+ * locations.
+ */
+class KISSGP : public ForwardModel
+{
+public:
+	KISSGP(int Inputs, int Outputs, mat& Xdata, vec& ydata, StationaryCF& cf, 
+	       double noiseVariance, int gridSize0, int gridSize1);
+	virtual ~KISSGP();
+
+	void   makePredictions(vec& Mean, vec& Variance, const mat& Xpred) const;
+	void   multiplyGridCovariance(mat& KU, const mat& U) const;
+
+	void   setGrid(const vec& lower, const vec& upper);
+	void   setNoiseVariance(double s2);
+	void   setLanczosIterations(int k);
+	void   setTolerance(double tol) { assert(tol > 0.0); tolerance = tol; }
+
+	double getNoiseVariance() const { return noiseVariance; }
+	int    getNumberIterations() const { return nIterations; }
+	vec    getGridOrigin() const { return gridOrigin; }
+	vec    getGridSpacing() const { return gridSpacing; }
+	ivec   getGridSize() const { return gridSize; }
+
+private:
+
+	void   interpolationWeights(ivec& index, vec& weights, const mat& X) const;
+	void   interpolate(vec& v, const vec& u) const;
+	void   spread(vec& u, const vec& v) const;
+	void   kernelProduct(mat& KU, const mat& U) const;
+	void   systemProduct(vec& Av, const vec& v) const;
+	double gridCovariance(const int* index, const double* weights) const;
+	void   update() const;
+
+	StationaryCF& covFunc;
+	mat& Locations;
+	vec& Observations;
+
+	ivec   gridSize;              // Number of nodes along each axis
+	vec    gridOrigin;            // Location of node (0,0)
+	vec    gridSpacing;           // Distance between nodes along each axis
+	ivec   dataIndex;             // Grid nodes around each observation (KISSGP_WEIGHTS per row)
+	vec    dataWeights;           // Interpolation weights of the observations on these nodes
+
+	double noiseVariance;
+	double tolerance;
+	int    lanczosIterations;
+
+	// Solution for the current parameters (see update)
+	mutable vec    cachedParameters;
+	mutable mat    lagCovariance;     // Covariance at all (non-negative) lags of the grid
+	mutable mat    eigenvalues;       // Eigenvalues of the circulant embedding of K_UU
+	mutable vec    gridMean;          // K_UU W' a
+	mutable mat    varianceFactor;    // R = K_UU W' Q L^-T
+	mutable int    nIterations;
+};
+
+#endif /*KISSGP_H_*/
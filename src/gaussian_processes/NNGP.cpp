@@ -0,0 +1,261 @@
+#include "NNGP.h"
+
+using namespace std;
+using namespace itpp;
+
+NNGP::NNGP(int Inputs, int Outputs, mat& Xdata, vec& ydata, CovarianceFunction& cf, int k, NNGPOrdering ordering) 
+: ForwardModel(Inputs, Outputs), covFunc(cf), Locations(Xdata), Observations(ydata), nNeighbours(k), ordering(ordering)
+{
+	assert(Locations.rows() == Observations.size());
+	assert(k > 0);
+
+	tree = NULL;
+	computeNeighbours();
+}
+
+NNGP::~NNGP()
+{
+	delete tree;
+}
+
+/**
+ * Set the number of neighbours of each observation/prediction location
+ */
+void NNGP::setNumberNeighbours(int k)
+{
+	assert(k > 0);
+	nNeighbours = k;
+	computeNeighbours();
+}
+
+void NNGP::setOrdering(NNGPOrdering o)
+{
+	ordering = o;
+	computeNeighbours();
+}
+
+/**
+ * Order the observations and find the preceding neighbours of each
+ */
+void NNGP::computeNeighbours()
+{
+	int n = Locations.rows();
+
+	switch (ordering)
+	{
+	case NNGP_ORDER_COORDINATE:
+		order = sort_index(Locations.get_col(0));
+		break;
+
+	case NNGP_ORDER_RANDOM:
+		order = sort_index(randu(n));
+		break;
+
+	case NNGP_ORDER_DATA:
+	default:
+		order.set_size(n);
+		for (int i = 0; i < n; i++) order(i) = i;
+	}
+
+	// Tree of the ordered observations: point t is observation order(t), so 
+	// the observations preceding it are the points with an index below t
+	mat ordered = Locations.get_rows(order);
+	KDTree orderedTree(ordered);
+
+	neighbours.resize(n);
+
+#pragma omp parallel for schedule(dynamic)
+	for (int t = 0; t < n; t++)
+	{
+		ivec idx;
+		orderedTree.nearest(idx, ordered.get_row(t), nNeighbours, t, true);
+		for (int j = 0; j < idx.size(); j++) idx(j) = order(idx(j));
+		removeDuplicates(idx);
+		neighbours[order(t)] = idx;
+	}
+
+	delete tree;
+	tree = new KDTree(Locations);
+}
+
+/**
+ * Remove the observations at the same location as a previous one in idx
+ */
+void NNGP::removeDuplicates(ivec& idx) const
+{
+	int kept = 0;
+	for (int j = 0; j < idx.size(); j++)
+	{
+		bool duplicate = false;
+		for (int l = 0; l < kept && !duplicate; l++)
+		{
+			duplicate = (Locations.get_row(idx(j)) == Locations.get_row(idx(l)));
+		}
+		if (!duplicate) idx(kept++) = idx(j);
+	}
+	idx.set_size(kept, true);
+}
+
+/**
+ * Negative log of the conditional density of observation i given its 
+ * neighbours N, i.e. of N(y_i | b' y_N, v) with 
+ *   b = K_NN^-1 k_Ni,   v = k_ii - k_Ni' b
+ * If grad is not NULL, the gradient with respect to the parameters of the 
+ * covariance function is added to it.
+ */
+double NNGP::conditional(int i, vec* grad) const
+{
+	const ivec& N = neighbours[i];
+	int m = N.size();
+
+	// Neighbours first, then observation i
+	mat Xs(m + 1, Locations.cols());
+	for (int j = 0; j < m; j++) Xs.set_row(j, Locations.get_row(N(j)));
+	Xs.set_row(m, Locations.get_row(i));
+
+	mat S(m + 1, m + 1);
+	covFunc.covariance(S, Xs, Xs);
+
+	vec b, u, yN;
+	double v = S(m, m);
+	double r = Observations(i);
+
+	if (m > 0)
+	{
+		mat A = S.get(0, m-1, 0, m-1);
+		vec c = S.get_col(m).left(m);
+		yN = Observations(N);
+
+		mat B(m, 2), Sol;
+		B.set_col(0, c);
+		B.set_col(1, yN);
+		if (!ls_solve_chol(A, B, Sol)) Sol = ls_solve(A, B);
+
+		b = Sol.get_col(0);         // K_NN^-1 k_Ni
+		u = Sol.get_col(1);         // K_NN^-1 y_N
+		v -= dot(c, b);
+		r -= dot(b, yN);
+	}
+
+	if (grad)
+	{
+		mat G;
+		for (int p = 0; p < covFunc.getNumberParameters(); p++)
+		{
+			covFunc.covarianceGradient(G, p, Xs, Xs);
+
+			double dv = G(m, m), dr = 0.0;
+			if (m > 0)
+			{
+				vec dc = G.get_col(m).left(m);
+				vec dAb = G.get(0, m-1, 0, m-1) * b;
+				dv += dot(b, dAb) - 2.0 * dot(dc, b);
+				dr = -dot(dc - dAb, u);
+			}
+
+			(*grad)(p) += 0.5 * dv / v * (1.0 - r * r / v) + r * dr / v;
+		}
+	}
+
+	return 0.5 * log(2 * pi * v) + 0.5 * r * r / v;
+}
+
+/**
+ * Negative log-likelihood of the observations under the nearest 
+ * neighbour approximation
+ */
+double NNGP::loglikelihood() const
+{
+	int n = Observations.size();
+	double nll = 0.0;
+
+#pragma omp parallel for schedule(dynamic, 64) reduction(+:nll)
+	for (int i = 0; i < n; i++)
+	{
+		nll += conditional(i, NULL);
+	}
+
+	return nll;
+}
+
+vec NNGP::getTransformedParameters() const
+{
+	return covFunc.getTransformedParameters();
+}
+
+void NNGP::setTransformedParameters(const vec pvec)
+{
+	covFunc.setTransformedParameters(pvec);
+}
+
+double NNGP::objective() const
+{
+	return loglikelihood();
+}
+
+vec NNGP::gradient() const
+{
+	int n = Observations.size();
+	vec grads(covFunc.getNumberParameters());
+	grads.zeros();
+
+#pragma omp parallel
+	{
+		vec local(grads.size());
+		local.zeros();
+
+#pragma omp for schedule(dynamic, 64)
+		for (int i = 0; i < n; i++)
+		{
+			conditional(i, &local);
+		}
+
+#pragma omp critical
+		grads += local;
+	}
+
+	return grads;
+}
+
+
+void NNGP::makePredictions(vec& Mean, vec& Variance, const mat& Xpred) const
+{
+	makePredictions(Mean, Variance, Xpred, covFunc);
+}
+
+/**
+ * Predictive mean and variance at Xpred, each conditioned on the k 
+ * nearest observations
+ */
+void NNGP::makePredictions(vec& Mean, vec& Variance, const mat& Xpred, CovarianceFunction &cf) const
+{
+	assert(Mean.size() == Variance.size());
+	assert(Xpred.rows() == Mean.size());
+
+#pragma omp parallel for schedule(dynamic, 64)
+	for (int i = 0; i < Xpred.rows(); i++)
+	{
+		mat x = Xpred.get_rows(i, i);
+
+		ivec N;
+		tree->nearest(N, x.get_row(0), nNeighbours);
+		removeDuplicates(N);
+		int m = N.size();
+
+		mat Xs = Locations.get_rows(N);
+		mat A(m, m), k(m, 1);
+		vec kstar(1);
+
+		covFunc.covariance(A, Xs, Xs);
+		cf.covariance(k, Xs, x);                    // k = k(X_N,x*)
+		cf.computeDiagonal(kstar, x);               // k* = K(x*,x*)
+
+		mat B(m, 2), Sol;
+		B.set_col(0, k.get_col(0));
+		B.set_col(1, Observations(N));
+		if (!ls_solve_chol(A, B, Sol)) Sol = ls_solve(A, B);
+
+		Mean(i) = dot(k.get_col(0), Sol.get_col(1));                  // k' * K_NN^{-1} * y_N
+		Variance(i) = kstar(0) - dot(k.get_col(0), Sol.get_col(0));    // k* - k' * K_NN^{-1} * k
+	}
+}
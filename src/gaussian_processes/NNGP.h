@@ -0,0 +1,105 @@
+/***************************************************************************
+ *   AstonGeostats, algorithms for low-rank geostatistical models          *
+ *                                                                         *
+ *   Copyright (C) Remi Barillec, Ben Ingram, 2008-2009                    *
+ *                                                                         *
+ *   Remi Barillec, r.barillec@aston.ac.uk
+ *   Ben Ingram, IngramBR@Aston.ac.uk                                      *
+ *   Neural Computing Research Group,                                      *
+ *   Aston University,                                                     *
+ *   Aston Street, Aston Triangle,                                         *
+ *   Birmingham. B4 7ET.                                                   *
+ *   United Kingdom                                                        *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#ifndef NNGP_H_
+#define NNGP_H_
+
+#include "ForwardModel.h"
+#include "KDTree.h"
+#include "optimisation/Optimisable.h"
+#include "covariance_functions/CovarianceFunction.h"
+
+#include "itpp/itbase.h"
+
+#include <vector>
+#include <cassert>
+
+using namespace std;
+using namespace itpp;
+
+#define NNGP_NEIGHBOURS 15      // Default number of neighbours
+
+enum NNGPOrdering { NNGP_ORDER_COORDINATE, NNGP_ORDER_RANDOM, NNGP_ORDER_DATA };
+
+/**
+ * Nearest neighbour GP (Vecchia approximation). The observations are 
+ * ordered, and the joint density is approximated by
+ *   p(y) = prod_i p(y_i | y_N(i))
+ * where N(i) are the k nearest observations preceding i in the ordering.
+ * Each term is a k x k GP problem, so the likelihood and its gradient 
+ * cost O(n k^3) and are computed in parallel over observations (OpenMP). 
+ * Predictions condition on the k nearest observations.
+ * 
+ * The ordering is by first input coordinate (default), random or that of
+ * the data. Neighbours are found with a k-d tree. Observations at the same
+ * location as the observation being conditioned (and duplicated 
+ * neighbours) are not used as neighbours, since the cross-covariance of 
+ * identical inputs includes the noise term (see WhiteNoiseCF).
+ */
+class NNGP : public ForwardModel, public Optimisable
+{
+public:
+	NNGP(int Inputs, int Outputs, mat& Xdata, vec& ydata, CovarianceFunction& cf, 
+	     int k = NNGP_NEIGHBOURS, NNGPOrdering ordering = NNGP_ORDER_COORDINATE);
+	virtual ~NNGP();
+
+	void   makePredictions(vec& Mean, vec& Variance, const mat& Xpred, CovarianceFunction &cf) const;
+	void   makePredictions(vec& Mean, vec& Variance, const mat& Xpred) const;
+	double loglikelihood() const;
+
+	vec    getTransformedParameters() const;
+	void   setTransformedParameters(const vec p);
+
+	double objective() const;
+	vec    gradient() const;
+
+	void   setNumberNeighbours(int k);
+	void   setOrdering(NNGPOrdering ordering);
+
+	const ivec& getOrder() const { return order; }
+	const ivec& getNeighbours(int i) const { return neighbours[i]; }
+
+private:
+
+	void   computeNeighbours();
+	void   removeDuplicates(ivec& idx) const;
+	double conditional(int i, vec* grad) const;
+
+	CovarianceFunction& covFunc;
+	mat& Locations;
+	vec& Observations;
+
+	int          nNeighbours;
+	NNGPOrdering ordering;
+	ivec         order;                // Observations in order
+	vector<ivec> neighbours;           // Neighbours of each observation (preceding it)
+	KDTree*      tree;                 // All observations (for predictions)
+};
+
+#endif /*NNGP_H_*/
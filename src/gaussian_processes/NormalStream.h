@@ -0,0 +1,99 @@
+/***************************************************************************
+ *   AstonGeostats, algorithms for low-rank geostatistical models          *
+ *                                                                         *
+ *   Copyright (C) Remi Barillec, Ben Ingram, 2008-2009                    *
+ *                                                                         *
+ *   Remi Barillec, r.barillec@aston.ac.uk
+ *   Ben Ingram, IngramBR@Aston.ac.uk                                      *
+ *   Neural Computing Research Group,                                      *
+ *   Aston University,                                                     *
+ *   Aston Street, Aston Triangle,                                         *
+ *   Birmingham. B4 7ET.                                                   *
+ *   United Kingdom                                                        *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#ifndef NORMALSTREAM_H_
+#define NORMALSTREAM_H_
+
+#include <stdint.h>
+#include <cmath>
+
+/**
+ * Generator of standard normal variates (xorshift128+ seeded by splitmix64, 
+ * Marsaglia's polar method). Each (seed, stream) pair gives an independent, 
+ * reproducible sequence, e.g. one stream per realisation or probe vector.
+ */
+class NormalStream
+{
+public:
+    NormalStream(uint64_t seed, uint64_t stream)
+    {
+        uint64_t x = seed ^ (0x9E3779B97F4A7C15ULL * (stream + 1));
+        s0 = splitmix(x);
+        s1 = splitmix(x);
+        hasSpare = false;
+        spare = 0.0;
+    }
+    
+    double operator()()
+    {
+        if (hasSpare)
+        {
+            hasSpare = false;
+            return spare;
+        }
+        
+        double u, v, r;
+        do 
+        {
+            u = 2.0 * uniform() - 1.0;
+            v = 2.0 * uniform() - 1.0;
+            r = u*u + v*v;
+        } 
+        while (r >= 1.0 || r == 0.0);
+        
+        double f = sqrt(-2.0 * log(r) / r);
+        spare = v * f;
+        hasSpare = true;
+        return u * f;
+    }
+    
+private:
+    static uint64_t splitmix(uint64_t& x)
+    {
+        uint64_t z = (x += 0x9E3779B97F4A7C15ULL);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
+    
+    double uniform()
+    {
+        uint64_t x = s0, y = s1;
+        s0 = y;
+        x ^= x << 23;
+        s1 = x ^ y ^ (x >> 17) ^ (y >> 26);
+        return ((s1 + y) >> 11) * (1.0 / 9007199254740992.0);   // 53 bits in [0,1)
+    }
+    
+    uint64_t s0, s1;
+    bool     hasSpare;
+    double   spare;
+};
+
+#endif /*NORMALSTREAM_H_*/
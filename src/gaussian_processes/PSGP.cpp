@@ -1,4 +1,6 @@
 #include "PSGP.h"
+#include "PSGPCheckpoint.h"
+#include "NormalStream.h"
 
 /**
  * Constructor
@@ -29,6 +31,19 @@ PSGP::PSGP(mat& X, vec& Y, CovarianceFunction& cf, int nActivePoints, int _iterC
     nObs = Locations.rows();
 
     likelihoodType = Approximate;
+    singlePrecision = false;
+    singlePrecisionTolerance = SINGLE_PRECISION_TOLERANCE;
+    
+    checkpointWriter = NULL;
+    checkpointInterval = 0;
+    
+    windowSize = 0;
+    nextSlot = 0;
+    
+    verbose = true;
+    ownPermutations = false;
+    permutationSeed = 0;
+    permutationStream = 0;
     
     resetPosterior();
     
@@ -44,6 +59,7 @@ PSGP::PSGP(mat& X, vec& Y, CovarianceFunction& cf, int nActivePoints, int _iterC
  */
 PSGP::~PSGP()
 {
+    delete checkpointWriter;
 }
 
 
@@ -73,25 +89,10 @@ void PSGP::setActiveSet(ivec activeIndexes, mat activeLocations)
  */
 void PSGP::computePosterior(const LikelihoodType& noiseModel)
 {
-    bool fixActiveSet = false;
-
-    // Cycle several times through the data, first allowing the active
-    // set to change (for iterChanging iterations) and then fixing it
-    // (for iterFixed iterations)
-    for(int cycle = 1; cycle <= (iterChanging + iterFixed); cycle++)
-    {
-        if(cycle > iterChanging) fixActiveSet = true;
-        
-        // Present observations in a random order
-        ivec randObsIndex = itppext::randperm(nObs);
-        
-        for(int i=0; i<nObs; i++)	
-        {
-            cout << "\rProcessing observation: " << i+1 << "/" << nObs  << flush;
-            processObservationEP(randObsIndex(i), noiseModel, fixActiveSet);
-        }
-        cout << endl;
-    }
+    Vec<LikelihoodType *> noiseModels(1);
+    noiseModels(0) = const_cast<LikelihoodType *>(&noiseModel);
+    
+    runEPSweeps(zeros_i(nObs), noiseModels, 1, randomPermutation(nObs), 0);
 }
 
 
@@ -103,30 +104,199 @@ void PSGP::computePosterior(const ivec& modelIndex, const Vec<LikelihoodType *>
     // Check if we have an index and a model per observation
     assert(nObs == modelIndex.length()); 
 
-    bool fixActiveSet = false;
+    runEPSweeps(modelIndex, noiseModel, 1, randomPermutation(nObs), 0);
+}
+
 
-    // Cycle several times through the data, first allowing the active
-    // set to change (for iterChanging iterations) and then fixing it
-    // (for iterFixed iterations)
-    for(int cycle = 1; cycle <= (iterChanging + iterFixed); cycle++)
+/**
+ * EP sweeps through the data, starting at position firstObs of the sweep
+ * firstCycle, in which observations are presented in the given order. 
+ * Cycle several times through the data, first allowing the active set to 
+ * change (for iterChanging iterations) and then fixing it (for iterFixed 
+ * iterations). Checkpoints are taken every checkpointInterval observations
+ * if enabled.
+ */
+void PSGP::runEPSweeps(const ivec& modelIndex, const Vec<LikelihoodType *> noiseModel, int firstCycle, ivec order, int firstObs)
+{
+    for(int cycle = firstCycle; cycle <= (iterChanging + iterFixed); cycle++)
     {
-        if(cycle > iterChanging) fixActiveSet = true;
+        bool fixActiveSet = (cycle > iterChanging);
 
         // Present observations in a random order
-        ivec randObsIndex = itppext::randperm(nObs);
+        if (cycle > firstCycle)
+        {
+            order = randomPermutation(nObs);
+            firstObs = 0;
+        }
 
-        for(int iObs=0; iObs<nObs; iObs++)	
+        for(int iObs=firstObs; iObs<nObs; iObs++)	
         {
-            int iModel = modelIndex(randObsIndex(iObs));
-            cout << "\rProcessing observation: " << iObs+1 << "/" << nObs << flush;
-            // cout << " using likelihood model " << iModel << flush;
+            int iModel = modelIndex(order(iObs));
+            if (verbose) cout << "\rProcessing observation: " << iObs+1 << "/" << nObs << flush;
             
             assert(iModel < noiseModel.length() && iModel >= 0);
             
-            processObservationEP(randObsIndex(iObs), *noiseModel(iModel), fixActiveSet);
+            processObservationEP(order(iObs), *noiseModel(iModel), fixActiveSet);
+            
+            if (checkpointWriter && (iObs + 1) % checkpointInterval == 0)
+            {
+                takeCheckpoint(order, cycle, iObs + 1);
+            }
         }
-        cout << endl;
+        if (verbose) cout << endl;
+    }
+    
+    if (checkpointWriter) checkpointWriter->wait();
+}
+
+
+/**
+ * Enable checkpoints every 'interval' observations, written to filename
+ */
+void PSGP::setCheckpoint(const string filename, int interval)
+{
+    assert(interval >= 0);
+    
+    delete checkpointWriter;
+    checkpointWriter = NULL;
+    checkpointInterval = interval;
+    
+    if (!filename.empty() && interval > 0) checkpointWriter = new CheckpointWriter(filename);
+}
+
+
+/**
+ * Copy the current state into a snapshot buffer of the checkpoint writer.
+ * The snapshot is written to disk in the background.
+ */
+void PSGP::takeCheckpoint(const ivec& order, int cycle, int position)
+{
+    PSGPCheckpoint& c = checkpointWriter->beginSnapshot();
+    
+    c.ActiveSet    = ActiveSet;
+    c.idxActiveSet = idxActiveSet;
+    c.KB           = KB;
+    c.Q            = Q;
+    c.C            = C;
+    c.P            = P;
+    c.alpha        = alpha;
+    c.meanEP       = meanEP;
+    c.varEP        = varEP;
+    c.logZ         = logZ;
+    c.order        = order;
+    c.cycle        = cycle;
+    c.position     = position;
+    c.iterChanging = iterChanging;
+    c.iterFixed    = iterFixed;
+    
+    c.kernelParameters = covFunc.getTransformedParameters();
+    c.maxActiveSet     = maxActiveSet;
+    c.algoVersion      = algoVersion;
+    c.gammaTolerance   = gammaTolerance;
+    c.windowSize       = windowSize;
+    c.nextSlot         = nextSlot;
+    
+    RNG_get_state(c.rngState);
+    c.ownPermutations   = ownPermutations;
+    c.permutationSeed   = permutationSeed;
+    c.permutationStream = permutationStream;
+    
+    checkpointWriter->endSnapshot();
+}
+
+
+/**
+ * Restore the posterior and sweep position from a checkpoint file. The 
+ * checkpoint must have been taken with the same number of observations,
+ * covariance parameters and algorithm settings.
+ */
+bool PSGP::restoreCheckpoint(const string filename, ivec& order, int& cycle, int& position)
+{
+    PSGPCheckpoint c;
+    if (!c.read(filename)) return false;
+    
+    if (c.P.rows() < nObs || c.order.length() != nObs)
+    {
+        cerr << "Checkpoint " << filename << " does not match the number of observations." << endl;
+        return false;
     }
+    
+    vec params = covFunc.getTransformedParameters();
+    if (c.kernelParameters.length() != params.length() 
+        || max(abs(c.kernelParameters - params)) > 1e-12 * (1.0 + max(abs(params))))
+    {
+        cerr << "Checkpoint " << filename << " does not match the covariance function parameters." << endl;
+        return false;
+    }
+    
+    if (c.maxActiveSet != maxActiveSet || c.algoVersion != algoVersion || c.gammaTolerance != gammaTolerance
+        || c.windowSize != windowSize)
+    {
+        cerr << "Checkpoint " << filename << " was taken with different settings (maximum active set size " 
+             << c.maxActiveSet << ", algorithm version " << c.algoVersion << ", gamma tolerance " 
+             << c.gammaTolerance << ", window size " << c.windowSize << ")." << endl;
+        return false;
+    }
+    
+    resetPosterior();
+    
+    ActiveSet     = c.ActiveSet;
+    idxActiveSet  = c.idxActiveSet;
+    sizeActiveSet = ActiveSet.rows();
+    KB            = c.KB;
+    Q             = c.Q;
+    C             = c.C;
+    P             = c.P;
+    alpha         = c.alpha;
+    meanEP        = c.meanEP;
+    varEP         = c.varEP;
+    logZ          = c.logZ;
+    iterChanging  = c.iterChanging;
+    iterFixed     = c.iterFixed;
+    nextSlot      = c.nextSlot;
+    
+    RNG_set_state(c.rngState);
+    ownPermutations   = c.ownPermutations;
+    permutationSeed   = c.permutationSeed;
+    permutationStream = c.permutationStream;
+    
+    order    = c.order;
+    cycle    = c.cycle;
+    position = c.position;
+    
+    return true;
+}
+
+
+/**
+ * Resume a posterior computation (with a single likelihood model) from a 
+ * checkpoint file
+ */
+bool PSGP::resumePosterior(const LikelihoodType& noiseModel, const string filename)
+{
+    Vec<LikelihoodType *> noiseModels(1);
+    noiseModels(0) = const_cast<LikelihoodType *>(&noiseModel);
+    
+    return resumePosterior(zeros_i(nObs), noiseModels, filename);
+}
+
+
+/**
+ * Resume a posterior computation (with a likelihood model per observation)
+ * from a checkpoint file
+ */
+bool PSGP::resumePosterior(const ivec& modelIndex, const Vec<LikelihoodType *> noiseModel, const string filename)
+{
+    assert(nObs == modelIndex.length()); 
+    
+    ivec order;
+    int cycle, position;
+    
+    if (!restoreCheckpoint(filename, order, cycle, position)) return false;
+    
+    runEPSweeps(modelIndex, noiseModel, cycle, order, position);
+    
+    return true;
 }
 
 
@@ -142,6 +312,8 @@ void PSGP::computePosterior(const ivec& modelIndex, const Vec<LikelihoodType *>
  */
 void PSGP::processObservationEP(const int iObs, const LikelihoodType &noiseModel, const bool fixActiveSet) 
 {
+    checkSiteParameters("processObservationEP");
+    
     double sigmaLoc;                // Auto-covariance of location
     vec k = zeros(sizeActiveSet);   // Covariance between location and active set
     
@@ -179,7 +351,7 @@ void PSGP::processObservationEP(const int iObs, const LikelihoodType &noiseModel
         //----------------------------------------------
         // Full update
         //----------------------------------------------
-        cout << " (full update)";
+        if (verbose) cout << " (full update)";
         
         if (sizeActiveSet < maxActiveSet)
         {
@@ -199,7 +371,7 @@ void PSGP::processObservationEP(const int iObs, const LikelihoodType &noiseModel
                 vec scores = scoreActivePoints(FullKL);
 
                 // Remove active point with lowest score, and update alpha, C, Q and P
-                int swapCandidate = min_index(scores);
+                int swapCandidate = (windowSize > 0) ? selectRemovalCandidate(scores, idxActiveSet) : min_index(scores);
                 deleteActivePoint(swapCandidate);
                 break;
             }
@@ -335,7 +507,7 @@ void PSGP::addActivePoint(int iObs, double q, double r, vec k, double sigmaLoc,
     C.set_size(sizeActiveSet, sizeActiveSet, true);
     
     // e is the unit vector for dimension sizeActiveSet
-    vec e = zeros(nObs);
+    vec e = zeros(P.rows());
     e(iObs) = 1.0;
     
     // Update P matrix
@@ -395,7 +567,7 @@ void PSGP::addActivePointAugmented_v1(int iObs, double q, double r, vec k, doubl
     ActiveSet_aug.set_row(maxActiveSet, Locations.get_row(iObs));
     
     // e is the unit vector for dimension sizeActiveSet
-    vec e = zeros(nObs);
+    vec e = zeros(P.rows());
     e(iObs) = 1.0;
     P_aug.set_col(maxActiveSet, e);
     
@@ -422,8 +594,10 @@ void PSGP::addActivePointAugmented_v1(int iObs, double q, double r, vec k, doubl
     // Compute scores for each active point
     vec scores = scoreActivePoints(FullKL);
     
-    // Remove active point with lowest score, and update alpha, C, Q and P
-    int swapCandidate = min_index(scores);
+    // Remove active point with lowest score (or an expired one in windowed 
+    // mode), and update alpha, C, Q and P
+    int swapCandidate = (windowSize > 0) ? selectRemovalCandidate(scores, idxActiveSet_aug) 
+                                         : min_index(scores);
     swapActivePoint_v1(swapCandidate);
 }
 
@@ -448,7 +622,7 @@ void PSGP::addActivePointAugmented_v2(int iObs, double q, double r, vec k, doubl
     ActiveSet_new = Locations.get_row(iObs);
     idxActiveSet_new = iObs;
     
-    P_new = zeros(nObs);
+    P_new = zeros(P.rows());
     P_new(iObs) = 1.0;
     
     alpha_new = q;
@@ -476,8 +650,10 @@ void PSGP::addActivePointAugmented_v2(int iObs, double q, double r, vec k, doubl
     // Compute scores for each active point
     vec scores = scoreActivePoints(FullKL);
 
-    // Remove active point with lowest score, and update alpha, C, Q and P
-    int swapCandidate = min_index(scores);
+    // Remove active point with lowest score (or an expired one in windowed 
+    // mode), and update alpha, C, Q and P
+    int swapCandidate = (windowSize > 0) ? selectRemovalCandidate(scores, concat(idxActiveSet, idxActiveSet_new)) 
+                                         : min_index(scores);
     swapActivePoint_v2(swapCandidate);    
 }
 
@@ -802,6 +978,12 @@ void PSGP::makePredictions(vec& Mean, vec& Variance, const mat& Xpred, Covarianc
     assert(Mean.length() == Variance.length());
     assert(Xpred.rows() == Mean.length());
 
+    if (singlePrecision)
+    {
+        makePredictionsSinglePrecision(Mean, Variance, Xpred, cf);
+        return;
+    }
+
     // Predictive mean
     mat ktest(Xpred.rows(), sizeActiveSet); 
     cf.covariance(ktest, Xpred, ActiveSet);
@@ -824,40 +1006,340 @@ void PSGP::makePredictions(vec& Mean, vec& Variance, const mat& Xpred) const
 }
 
 
+/**
+ * Single precision matrix product AB = A*B, for A (n x m) and B (m x p), all
+ * stored row by row. The product is computed by tiles of GEMM_TILE_DEPTH 
+ * rows and GEMM_TILE_COLUMNS columns of B, which stay in cache while they 
+ * are applied to all the rows of A, and four rows of A at a time, so that
+ * each element of B is loaded once for four multiply-adds. The inner loops
+ * run over contiguous floats and are vectorised.
+ */
+static void productFloat(float *AB, const float *A, const float *B, int n, int m, int p)
+{
+    for (int i=0; i<n*p; i++) AB[i] = 0.0f;
+
+    for (int j0 = 0; j0 < p; j0 += GEMM_TILE_COLUMNS)
+    {
+        int nj = min(GEMM_TILE_COLUMNS, p - j0);
+
+        for (int l0 = 0; l0 < m; l0 += GEMM_TILE_DEPTH)
+        {
+            int l1 = min(l0 + GEMM_TILE_DEPTH, m);
+            int i = 0;
+
+            for (; i+3 < n; i += 4)
+            {
+                float *c0 = AB + i*p + j0;
+                float *c1 = c0 + p;
+                float *c2 = c1 + p;
+                float *c3 = c2 + p;
+                const float *a = A + i*m;
+
+                for (int l = l0; l < l1; l++)
+                {
+                    const float a0 = a[l], a1 = a[m+l], a2 = a[2*m+l], a3 = a[3*m+l];
+                    const float *b = B + l*p + j0;
+
+#pragma omp simd
+                    for (int j = 0; j < nj; j++)
+                    {
+                        c0[j] += a0 * b[j];
+                        c1[j] += a1 * b[j];
+                        c2[j] += a2 * b[j];
+                        c3[j] += a3 * b[j];
+                    }
+                }
+            }
+
+            // Remaining rows, one at a time
+            for (; i < n; i++)
+            {
+                float *c0 = AB + i*p + j0;
+                const float *a = A + i*m;
+
+                for (int l = l0; l < l1; l++)
+                {
+                    const float a0 = a[l];
+                    const float *b = B + l*p + j0;
+
+#pragma omp simd
+                    for (int j = 0; j < nj; j++) c0[j] += a0 * b[j];
+                }
+            }
+        }
+    }
+}
+
+
+/**
+ * Single precision version of makePredictions. Alpha and C are converted
+ * to float once, and the prediction locations are processed in blocks of
+ * PREDICTION_BLOCK_SIZE, so the full ktest matrix is never stored. For each
+ * block, the covariance with the active set is converted to float (the 
+ * covariance functions only have double precision implementations, but 
+ * this is O(m) per location against O(m^2) for the product with C), the 
+ * product ktest*C is computed by the blocked float kernel productFloat, 
+ * and the mean and quadratic form ktest*C*ktest' are accumulated in double
+ * precision.
+ * 
+ * C is the (negative) correction to the prior covariance, so the variance 
+ * kstar + k*C*k' cancels near the data, where the rounding error of the 
+ * float product can exceed the variance itself. This error is bounded by 
+ * about eps * (sum_j |k_j| |C_j| |k| + |k_j| |(kC)_j|), with eps the float 
+ * precision and C_j the columns of C. Where this bound is larger than 
+ * singlePrecisionTolerance times the prior variance, the quadratic form 
+ * is recomputed in double precision from the (double) kernel block. With
+ * ill-conditioned active sets the bound is rarely met at a tolerance of a
+ * few significant digits, and the speed-up is limited to the mean; a looser
+ * tolerance trades variance accuracy for throughput. The variance is 
+ * clamped at 0.
+ * 
+ * Returns the number of locations whose variance was recomputed.
+ */
+int PSGP::makePredictionsSinglePrecision(vec& Mean, vec& Variance, const mat& Xpred, CovarianceFunction& cf) const
+{
+    int m = sizeActiveSet;
+    int nPred = Xpred.rows();
+    int nRecomputed = 0;
+
+    // Export alpha and C (C is symmetric, so its columns are also its rows)
+    vector<float> alphaF(m), CF(m*m);
+    vec normC(m);
+    for (int i=0; i<m; i++)
+    {
+        alphaF[i] = (float) alpha(i);
+        for (int j=0; j<m; j++) CF[i*m+j] = (float) C(j,i);
+        normC(i) = norm(C.get_col(i));
+    }
+
+    const double eps = numeric_limits<float>::epsilon();
+
+    vector<float> K(PREDICTION_BLOCK_SIZE*m), KC(PREDICTION_BLOCK_SIZE*m);
+    mat kblock;
+    vec kstar(nPred);
+
+    cf.computeDiagonal(kstar, Xpred);
+
+    for (int blockStart = 0; blockStart < nPred; blockStart += PREDICTION_BLOCK_SIZE)
+    {
+        int blockEnd = min(blockStart + PREDICTION_BLOCK_SIZE, nPred) - 1;
+        int nBlock = blockEnd - blockStart + 1;
+
+        kblock.set_size(nBlock, m);
+        cf.covariance(kblock, Xpred.get_rows(blockStart, blockEnd), ActiveSet);
+
+        // Store the block row by row, so that each row is contiguous
+        for (int j=0; j<m; j++)
+        {
+            for (int i=0; i<nBlock; i++) K[i*m+j] = (float) kblock(i,j);
+        }
+
+        productFloat(&KC[0], &K[0], &CF[0], nBlock, m, m);
+
+        for (int i=0; i<nBlock; i++)
+        {
+            const float *k = &K[i*m];
+            const float *kc = &KC[i*m];
+
+            double mean = 0.0, quad = 0.0, normK = 0.0, bound = 0.0;
+            for (int j=0; j<m; j++)
+            {
+                mean  += (double) k[j] * alphaF[j];
+                quad  += (double) kc[j] * k[j];
+                normK += (double) k[j] * k[j];
+                bound += fabs((double) k[j]) * (normC(j) + fabs((double) kc[j]));
+            }
+            bound *= eps * sqrt(normK);
+
+            if (bound > singlePrecisionTolerance * fabs(kstar(blockStart+i)))
+            {
+                vec krow = kblock.get_row(i);
+                quad = dot(krow, C * krow);
+                nRecomputed++;
+            }
+
+            Mean(blockStart+i) = mean;
+            Variance(blockStart+i) = max(kstar(blockStart+i) + quad, 0.0);
+        }
+    }
+
+    return nRecomputed;
+}
+
+
+/**
+ * Compare the single and double precision predictions at a set of locations.
+ * The maximum absolute differences for the mean and variance are returned,
+ * and printed together with the maximum relative differences if verbose.
+ */
+void PSGP::comparePredictionPrecision(const mat& Xpred, double& meanError, double& varianceError, bool verbose) const
+{
+    int nPred = Xpred.rows();
+    vec meanD(nPred), varD(nPred), meanF(nPred), varF(nPred);
+
+    int nRecomputed = makePredictionsSinglePrecision(meanF, varF, Xpred, covFunc);
+
+    // Double precision reference
+    mat ktest(nPred, sizeActiveSet);
+    covFunc.covariance(ktest, Xpred, ActiveSet);
+    meanD = ktest*alpha;
+    vec kstar(nPred);
+    covFunc.computeDiagonal(kstar, Xpred);
+    varD = kstar + sum(elem_mult((ktest * C), ktest), 2);
+
+    vec errMean = abs(meanF - meanD);
+    vec errVar  = abs(varF - varD);
+
+    meanError = max(errMean);
+    varianceError = max(errVar);
+
+    if (verbose)
+    {
+        cout << "Single vs double precision predictions (" << nPred << " locations, " 
+             << nRecomputed << " variances recomputed in double precision)" << endl;
+        cout << "  Mean:     max abs error " << meanError
+             << ", max rel error " << max(elem_div(errMean, abs(meanD) + 1e-300)) << endl;
+        cout << "  Variance: max abs error " << varianceError
+             << ", max rel error " << max(elem_div(errVar, abs(varD) + 1e-300)) << endl;
+    }
+}
+
+
+/**
+ * Posterior mean and variance of the average of the process over each 
+ * region. For region r with n_r locations, the average covariance with
+ * the active set g_r = mean of ktest over the region is accumulated one 
+ * block of locations at a time, giving the mean g_r'*alpha and the 
+ * low-rank variance term g_r'*C*g_r. The prior variance term, the average
+ * of cf over all pairs of locations in the region, is summed over blocks 
+ * of REGION_BLOCK_SIZE locations (diagonal entries from computeDiagonal,
+ * as in makePredictions). Regions are processed in parallel. Empty regions
+ * get a NaN mean and variance.
+ */
+void PSGP::makeBlockPredictions(vec& Mean, vec& Variance, const mat& Xpred, const ivec& region, CovarianceFunction& cf) const
+{
+    int m = sizeActiveSet;
+    int nPred = Xpred.rows();
+    int nRegions = Mean.length();
+    
+    assert(Variance.length() == nRegions);
+    assert(region.length() == nPred);
+    
+    // Locations of each region: first(r) to first(r+1)-1 in members
+    ivec first = zeros_i(nRegions+1);
+    for (int i=0; i<nPred; i++) 
+    {
+        assert(region(i) < nRegions);
+        if (region(i) >= 0) first(region(i)+1)++;
+    }
+    for (int r=0; r<nRegions; r++) first(r+1) += first(r);
+    
+    ivec members(first(nRegions)), next = first;
+    for (int i=0; i<nPred; i++) 
+    {
+        if (region(i) >= 0) members(next(region(i))++) = i;
+    }
+    
+    // Average covariance of each region with the active set
+    mat G = zeros(nRegions, m);
+    mat kblock;
+    for (int blockStart = 0; blockStart < nPred; blockStart += PREDICTION_BLOCK_SIZE)
+    {
+        int blockEnd = min(blockStart + PREDICTION_BLOCK_SIZE, nPred) - 1;
+        
+        kblock.set_size(blockEnd - blockStart + 1, m);
+        cf.covariance(kblock, Xpred.get_rows(blockStart, blockEnd), ActiveSet);
+        
+        for (int j=0; j<m; j++)
+        {
+            for (int i=blockStart; i<=blockEnd; i++)
+            {
+                if (region(i) >= 0) G(region(i), j) += kblock(i-blockStart, j);
+            }
+        }
+    }
+    
+    for (int r=0; r<nRegions; r++)
+    {
+        int n = first(r+1) - first(r);
+        if (n > 0) G.set_row(r, G.get_row(r) / (double) n);
+    }
+    
+    Mean = G*alpha;
+    Variance = sum(elem_mult(G*C, G), 2);
+    
+    // Prior term: average covariance between pairs of locations of a region
+#pragma omp parallel for schedule(dynamic)
+    for (int r=0; r<nRegions; r++)
+    {
+        int n = first(r+1) - first(r);
+        if (n == 0)
+        {
+            Mean(r) = Variance(r) = numeric_limits<double>::quiet_NaN();
+            continue;
+        }
+        
+        mat Xr = Xpred.get_rows(members.mid(first(r), n));
+        mat Kab;
+        vec kdiag;
+        double total = 0.0;
+        
+        for (int a = 0; a < n; a += REGION_BLOCK_SIZE)
+        {
+            mat Xa = Xr.get_rows(a, min(a + REGION_BLOCK_SIZE, n) - 1);
+            
+            // Diagonal block
+            Kab.set_size(Xa.rows(), Xa.rows());
+            kdiag.set_size(Xa.rows());
+            cf.covariance(Kab, Xa, Xa);
+            cf.computeDiagonal(kdiag, Xa);
+            total += sumsum(Kab) - sum(diag(Kab)) + sum(kdiag);
+            
+            // Off-diagonal blocks (counted twice, by symmetry)
+            for (int b = a + REGION_BLOCK_SIZE; b < n; b += REGION_BLOCK_SIZE)
+            {
+                mat Xb = Xr.get_rows(b, min(b + REGION_BLOCK_SIZE, n) - 1);
+                Kab.set_size(Xa.rows(), Xb.rows());
+                cf.covariance(Kab, Xa, Xb);
+                total += 2.0*sumsum(Kab);
+            }
+        }
+        
+        Variance(r) += total / ((double) n * n);
+    }
+}
+
+
+/**
+ * Same as above, using the current (stored) covariance function
+ */
+void PSGP::makeBlockPredictions(vec& Mean, vec& Variance, const mat& Xpred, const ivec& region) const
+{
+    makeBlockPredictions(Mean, Variance, Xpred, region, covFunc);
+}
+
+
 /**
  * Simulate from PSGP
  */
 vec PSGP::simulate(const mat& Xpred, bool approx) const
 {
-    mat cov, vCov, kxbv(Xpred.rows(), sizeActiveSet);
-    vec dCov, samp;
+    mat factor, kxbv(Xpred.rows(), sizeActiveSet);
 
     covFunc.covariance(kxbv, Xpred, ActiveSet);
 
     if(approx)
     {
-        cov = Q + C;
-        vCov.set_size(sizeActiveSet, sizeActiveSet);
-        dCov.set_size(sizeActiveSet);
-        eig_sym(cov, dCov, vCov);
-        vCov = kxbv * vCov;
-        samp = randn(sizeActiveSet);
+        factor = kxbv * projectedPosteriorSquareRoot();
     }
     else
     {
         mat kxx(Xpred.rows(), Xpred.rows());
         covFunc.covariance(kxx, Xpred);
-        cov = kxx + ((kxbv * C) * kxbv.transpose());
-        eig_sym(cov, dCov, vCov);
-        samp = randn(Xpred.rows());
+        factor = computeSquareRoot(kxx + ((kxbv * C) * kxbv.transpose()));
     }
 
-    dCov = sqrt(abs(dCov));
-
-    vec a1 = kxbv * alpha;
-    mat a2 = vCov * diag(dCov);
-
-    return(a1 + (a2 * samp));
+    return(kxbv * alpha + factor * randn(factor.cols()));
 }
 
 
@@ -880,30 +1362,672 @@ void PSGP::setTransformedParameters(const vec p)
 
 
 /**
- * Recompute posterior parameters
+ * Recompute posterior parameters for the current covariance function, keeping
+ * the active set and the EP site parameters (meanEP, varEP) of the previous
+ * posterior. KB, Q and P are rebuilt for the new parameters and alpha, C are
+ * recomputed from the projected site parameters (Csato, Sec. 4.2).
+ *
+ * The projection matrix P is filled in blocks of POSTERIOR_BLOCK_SIZE
+ * observations, so that the full covariance between the observations and the
+ * active set is never held in memory. P'*Lambda*P and P'*Lambda*meanEP are
+ * accumulated block by block.
  */
 void PSGP::recomputePosterior()
 {
-    cout << "Update posterior for new parameters" << endl;
-    mat KBold = KB;
-    mat Kplus(Observations.length(), sizeActiveSet);
-    covFunc.covariance(KB, ActiveSet);
-    covFunc.covariance(Kplus, Locations, ActiveSet);
+    checkSiteParameters("recomputePosterior");
     
-    // RB: P should be transpose(inv(KB)*Kplus), not inv(KB)*Kplus (size is wrong otherwise)   
-    mat Ptrans(P.cols(), P.rows());
-    backslash(KB, Kplus.transpose(), Ptrans); // output is rightmost parameter
-    P = Ptrans.transpose();
+    if (verbose) cout << "Update posterior for new parameters" << endl;
+
+    KB.set_size(sizeActiveSet, sizeActiveSet);
+    covFunc.covarianceFromSqDist(KB, ActiveSet, activeSetDistances.sqDistMatrix(ActiveSet));
+    Q = computeInverseFromCholesky(KB);
+
+    mat UU = zeros(sizeActiveSet, sizeActiveSet);    // P' * Lambda * P
+    vec projMean = zeros(sizeActiveSet);             // P' * Lambda * meanEP
+
+    mat Kblock, Pblock, LPblock;
+    P = zeros(P.rows(), sizeActiveSet);    // Spare rows (see addObservations) stay at zero
+
+    for (int blockStart = 0; blockStart < nObs; blockStart += POSTERIOR_BLOCK_SIZE)
+    {
+        int blockEnd = std::min(blockStart + POSTERIOR_BLOCK_SIZE, nObs) - 1;
+        int blockSize = blockEnd - blockStart + 1;
+
+        // Projection of the observations in the block onto the active set
+        Kblock.set_size(blockSize, sizeActiveSet);
+        covFunc.covariance(Kblock, Locations.get_rows(blockStart, blockEnd), ActiveSet);
+        Pblock = Kblock * Q;
+        P.set_submatrix(blockStart, 0, Pblock);
+
+        // Scale rows of the block by the site precisions
+        LPblock = Pblock;
+        for (int j = 0; j < sizeActiveSet; j++) {
+            for (int i = 0; i < blockSize; i++) {
+                LPblock(i,j) *= varEP(blockStart + i);
+            }
+        }
+
+        UU += Pblock.transpose() * LPblock;
+        projMean += LPblock.transpose() * meanEP(blockStart, blockEnd);
+    }
 
-    mat varEPdiag = diag(varEP);
-    mat projLam = P.transpose() * varEPdiag;
-    mat UU = projLam * P;
     mat CC = UU * KB + eye(sizeActiveSet);
-    alpha = backslash(CC, projLam * meanEP);
+    alpha = backslash(CC, projMean);
     C = -backslash(CC, UU);
+}
+
+
+/**
+ * Compute the posterior for a fixed active set, given by the indices of
+ * observations in the active set.
+ */
+void PSGP::computePosteriorFixedActiveSet(const LikelihoodType& noiseModel, ivec iActive)
+{
+    computePosteriorFixedActiveSet(noiseModel, Locations.get_rows(iActive));
+    idxActiveSet = iActive;
+}
+
+
+/**
+ * Compute the posterior for a fixed active set, given by its locations. These
+ * do not need to be observation locations (e.g. they can come from a design
+ * over a larger data set, as for shards). The posterior is initialised to
+ * the prior and iterFixed sweeps are made through the data, with the active
+ * set fixed.
+ *
+ * Note that active points which are not observation locations have no 
+ * index in idxActiveSet (set to -1), so the approximate evidence, which 
+ * relies on their observations, cannot be used.
+ */
+void PSGP::computePosteriorFixedActiveSet(const LikelihoodType& noiseModel, const mat& activeLocations)
+{
+    int m = activeLocations.rows();
+    
+    maxActiveSet = max(maxActiveSet, m);
+    resetPosterior();
+    
+    ActiveSet = activeLocations;
+    idxActiveSet = -ones_i(m);
+    sizeActiveSet = m;
+    
+    // With all site parameters at zero, this sets KB, Q and P and the 
+    // prior posterior (alpha = 0, C = 0)
+    recomputePosterior();
+    
+    recomputePosteriorFixedActiveSet(noiseModel);
+}
+
+
+/**
+ * Update the EP parameters with the current active set fixed
+ * (iterFixed sweeps through the data).
+ */
+void PSGP::recomputePosteriorFixedActiveSet(const LikelihoodType& noiseModel)
+{
+    for (int cycle = 1; cycle <= iterFixed; cycle++)
+    {
+        ivec randObsIndex = randomPermutation(nObs);
+
+        for(int i=0; i<nObs; i++)
+        {
+            if (verbose) cout << "\rProcessing observation: " << i+1 << "/" << nObs  << flush;
+            processObservationEP(randObsIndex(i), noiseModel, true);
+        }
+        if (verbose) cout << endl;
+    }
+}
+
+
+/**
+ * Contributions of the observations to the posterior natural parameters,
+ * U = P'*Lambda*P and b = P'*Lambda*meanEP, where Lambda = diag(varEP). 
+ * The posterior only depends on the data through these, so the contributions
+ * of disjoint sets of observations (for the same active set) can be summed.
+ */
+void PSGP::getSiteContributions(mat& U, vec& b) const
+{
+    checkSiteParameters("getSiteContributions");
+    
+    U = zeros(sizeActiveSet, sizeActiveSet);
+    b = zeros(sizeActiveSet);
+    
+    mat LPblock;
+
+    for (int blockStart = 0; blockStart < nObs; blockStart += POSTERIOR_BLOCK_SIZE)
+    {
+        int blockEnd = std::min(blockStart + POSTERIOR_BLOCK_SIZE, nObs) - 1;
+        int blockSize = blockEnd - blockStart + 1;
+
+        mat Pblock = P.get_rows(blockStart, blockEnd);
+        LPblock = Pblock;
+        for (int j = 0; j < sizeActiveSet; j++) {
+            for (int i = 0; i < blockSize; i++) {
+                LPblock(i,j) *= varEP(blockStart + i);
+            }
+        }
+
+        U += Pblock.transpose() * LPblock;
+        b += LPblock.transpose() * meanEP(blockStart, blockEnd);
+    }
+}
+
+
+/**
+ * Set the posterior from the (summed) site contributions U and b for the
+ * given active set, as in recomputePosterior. The observations of this
+ * PSGP object are not used.
+ */
+void PSGP::setPosteriorFromSiteContributions(const mat& activeLocations, const mat& U, const vec& b)
+{
+    int m = activeLocations.rows();
+    assert(U.rows() == m && U.cols() == m && b.length() == m);
+    
+    maxActiveSet = max(maxActiveSet, m);
+    resetPosterior();
+    
+    ActiveSet = activeLocations;
+    idxActiveSet = -ones_i(m);
+    sizeActiveSet = m;
+    
+    KB.set_size(m, m);
+    covFunc.covarianceFromSqDist(KB, ActiveSet, activeSetDistances.sqDistMatrix(ActiveSet));
     Q = computeInverseFromCholesky(KB);
+
+    mat CC = U * KB + eye(m);
+    alpha = backslash(CC, b);
+    C = -backslash(CC, U);
+    
+    mergedPosterior = true;
+}
+
+
+/**
+ * Write the active set and site contributions (see getSiteContributions)
+ * to a file (IT++ format).
+ */
+bool PSGP::writeSiteContributions(const string filename) const
+{
+    mat U;
+    vec b;
+    getSiteContributions(U, b);
+    
+    ofstream test(filename.c_str());
+    if (!test.good()) 
+    {
+        cerr << "Could not open file " << filename << " for writing." << endl;
+        return false;
+    }
+    test.close();
+    
+    it_file file;
+    file.open(filename, true);
+    file << Name("activeSet") << ActiveSet;
+    file << Name("U") << U;
+    file << Name("b") << b;
+    file.close();
+    
+    return true;
+}
+
+
+/**
+ * Read the site contributions written by several shards and set the posterior 
+ * from their sum. All shards must have used the same active set.
+ */
+bool PSGP::mergeSiteContributions(const vector<string>& filenames)
+{
+    mat activeLocations, Usum, Ushard;
+    vec bsum, bshard;
+    
+    for (vector<string>::size_type i = 0; i < filenames.size(); i++)
+    {
+        mat shardActiveSet;
+        
+        ifstream test(filenames[i].c_str());
+        if (!test.good())
+        {
+            cerr << "Could not open file " << filenames[i] << " for reading." << endl;
+            return false;
+        }
+        test.close();
+        
+        it_ifile file;
+        file.open(filenames[i]);
+        file >> Name("activeSet") >> shardActiveSet;
+        file >> Name("U") >> Ushard;
+        file >> Name("b") >> bshard;
+        file.close();
+        
+        if (i == 0) 
+        {
+            activeLocations = shardActiveSet;
+            Usum = Ushard;
+            bsum = bshard;
+            continue;
+        }
+        
+        if (shardActiveSet.rows() != activeLocations.rows() 
+            || max(max(abs(shardActiveSet - activeLocations))) > 0.0)
+        {
+            cerr << "Shard " << filenames[i] << " has a different active set." << endl;
+            return false;
+        }
+        
+        Usum += Ushard;
+        bsum += bshard;
+    }
+    
+    setPosteriorFromSiteContributions(activeLocations, Usum, bsum);
+    
+    return true;
+}
+
+
+/**
+ * Leave-one-out predictions from the EP cavities. Removing the site of 
+ * observation i updates alpha and C as in EP_removePreviousContribution,
+ * which is evaluated at the location of i without modifying the posterior.
+ */
+void PSGP::leaveOneOut(vec& Mean, vec& Variance) const
+{
+    checkSiteParameters("leaveOneOut");
+    
+    Mean.set_size(nObs);
+    Variance.set_size(nObs);
+    
+    mat kxb;
+    vec kxx;
+    
+    // Covariances are computed by blocks, so that the covariances of all
+    // observations with the active set are not held in memory
+    for (int blockStart = 0; blockStart < nObs; blockStart += POSTERIOR_BLOCK_SIZE)
+    {
+        int blockEnd = std::min(blockStart + POSTERIOR_BLOCK_SIZE, nObs) - 1;
+        mat Xblock = Locations.get_rows(blockStart, blockEnd);
+        
+        covFunc.covariance(kxb, Xblock, ActiveSet);
+        covFunc.computeDiagonal(kxx, Xblock);
+        
+#pragma omp parallel for schedule(dynamic, 16)
+        for (int i = blockStart; i <= blockEnd; i++)
+        {
+            vec k = kxb.get_row(i - blockStart);
+            
+            double mean = dot(k, alpha);
+            double var  = kxx(i - blockStart) + dot(k, C * k);
+            
+            if (varEP(i) > LAMBDA_TOLERANCE)
+            {
+                vec p  = P.get_row(i);
+                vec Kp = KB * p;
+                vec h  = C * Kp + p;
+                double nu = varEP(i) / (1.0 - varEP(i) * dot(Kp, h));
+                double kh = dot(k, h);
+                
+                mean += kh * nu * (dot(alpha, Kp) - meanEP(i));
+                var  += nu * kh * kh;
+            }
+            
+            Mean(i) = mean;
+            Variance(i) = var;
+        }
+    }
+}
+
+
+/**
+ * k-fold cross-validation predictions. The site contributions of the fold
+ * are subtracted from those of all observations (see getSiteContributions)
+ * and the posterior of the remaining folds is used to predict the fold.
+ */
+void PSGP::crossValidation(vec& Mean, vec& Variance, const ivec& folds) const
+{
+    checkSiteParameters("crossValidation");
+    
+    assert(folds.length() == nObs);
+    
+    mat U, Ufold, kxb;
+    vec b, bfold, kxx;
+    getSiteContributions(U, b);
+    
+    Mean.set_size(nObs);
+    Variance.set_size(nObs);
+    
+    for (int f = 0; f <= max(folds); f++)
+    {
+        ivec idx = find(folds == f);
+        if (idx.length() == 0) continue;
+        
+        mat Pfold = P.get_rows(idx);
+        mat LPfold = Pfold;
+        for (int j = 0; j < sizeActiveSet; j++) {
+            for (int i = 0; i < idx.length(); i++) {
+                LPfold(i,j) *= varEP(idx(i));
+            }
+        }
+        
+        Ufold = U - Pfold.transpose() * LPfold;
+        bfold = b - LPfold.transpose() * meanEP(idx);
+        
+        mat CC = Ufold * KB + eye(sizeActiveSet);
+        vec alphaFold = backslash(CC, bfold);
+        mat CFold = -backslash(CC, Ufold);
+        
+        mat Xfold = Locations.get_rows(idx);
+        covFunc.covariance(kxb, Xfold, ActiveSet);
+        covFunc.computeDiagonal(kxx, Xfold);
+        
+        vec meanFold = kxb * alphaFold;
+        vec varFold  = kxx + sum(elem_mult(kxb * CFold, kxb), 2);
+        
+        for (int i = 0; i < idx.length(); i++)
+        {
+            Mean(idx(i)) = meanFold(i);
+            Variance(idx(i)) = varFold(i);
+        }
+    }
+}
+
+
+/**
+ * Append new observations to a trained PSGP and update the posterior with
+ * them only. The locations and observations are appended to the matrix 
+ * and vector passed to the constructor, which always hold exactly 
+ * getNumberObservations() rows. The per-observation stores of the PSGP 
+ * (P and the EP site parameters) grow geometrically, so that repeated 
+ * small updates do not copy them each time: only their first 
+ * getNumberObservations() rows hold observations, the others are spare.
+ * 
+ * Each new observation goes through one EP step, with the active set 
+ * fixed unless updateActiveSet is true (new points may then be added to 
+ * the active set, or replace existing active points). localSweeps further
+ * EP sweeps (with a fixed active set) are then made over the new 
+ * observations only.
+ * 
+ * In windowed mode (see setWindow), once the window is full each new 
+ * observation replaces the oldest one, in the same storage slot.
+ */
+void PSGP::addObservations(const mat& Xnew, const vec& Ynew, const LikelihoodType& noiseModel, 
+                           bool updateActiveSet, int localSweeps)
+{
+    checkSiteParameters("addObservations");
+    
+    assert(Xnew.rows() == Ynew.length());
+    assert(Xnew.cols() == Locations.cols());
+    
+    int nNew = Xnew.rows();
+    int nOld = nObs;
+    
+    // Number of observations appended (the others replace expired ones)
+    int nAppend = nNew;
+    if (windowSize > 0) nAppend = std::min(nNew, windowSize - nObs);
+    
+    ivec slots(nNew);   // Storage index of each new observation
+    
+    if (nAppend > 0)
+    {
+        growObservationStores(nOld + nAppend);
+        
+        Locations.set_size(nOld + nAppend, Locations.cols(), true);
+        Observations.set_size(nOld + nAppend, true);
+        Locations.set_submatrix(nOld, 0, Xnew.get_rows(0, nAppend - 1));
+        Observations.set_subvector(nOld, Ynew(0, nAppend - 1));
+        nObs = nOld + nAppend;
+    
+        for (int i = 0; i < nAppend; i++)
+        {
+            slots(i) = nOld + i;
+            processObservationEP(slots(i), noiseModel, !updateActiveSet);
+        }
+    }
+    
+    for (int i = nAppend; i < nNew; i++)
+    {
+        slots(i) = nextSlot;
+        nextSlot = (nextSlot + 1) % windowSize;
+        
+        expireObservation(slots(i));
+        
+        Locations.set_row(slots(i), Xnew.get_row(i));
+        Observations(slots(i)) = Ynew(i);
+        processObservationEP(slots(i), noiseModel, !updateActiveSet);
+    }
+    
+    for (int sweep = 0; sweep < localSweeps; sweep++)
+    {
+        ivec order = randomPermutation(nNew);
+        for (int i = 0; i < nNew; i++)
+        {
+            processObservationEP(slots(order(i)), noiseModel, true);
+        }
+    }
+}
+
+
+/**
+ * Make sure the per-observation stores (P and the EP site parameters) have
+ * room for n observations. The capacity grows geometrically (up to the 
+ * window size in windowed mode), and spare rows are kept at zero. The 
+ * locations and observations belong to the caller and are not padded.
+ */
+void PSGP::growObservationStores(int n)
+{
+    int capacity = P.rows();
+    if (n <= capacity) return;
+    
+    capacity = std::max(n, 2 * capacity);
+    if (windowSize > 0) capacity = std::min(capacity, windowSize);
+    
+    mat Pgrown = zeros(capacity, P.cols());
+    vec meanGrown = zeros(capacity), varGrown = zeros(capacity), logZGrown = zeros(capacity);
+    
+    if (nObs > 0)
+    {
+        Pgrown.set_submatrix(0, 0, P.get_rows(0, nObs - 1));
+        meanGrown.set_subvector(0, meanEP(0, nObs - 1));
+        varGrown.set_subvector(0, varEP(0, nObs - 1));
+        logZGrown.set_subvector(0, logZ(0, nObs - 1));
+    }
+    
+    P      = Pgrown;
+    meanEP = meanGrown;
+    varEP  = varGrown;
+    logZ   = logZGrown;
+    
+    P_new = zeros(capacity);
+    if (algoVersion == ALGO_V2) P_aug = zeros(capacity, maxActiveSet+1);
+}
+
+
+/**
+ * Sliding window mode: keep (at most) the last windowSize observations.
+ * When the window is full, each new observation (see addObservations) 
+ * replaces the oldest one, whose site contribution is removed from the 
+ * posterior (as in EP_removePreviousContribution). Active points whose 
+ * observation has expired remain in the active set, but are replaced 
+ * first when a new point enters a full active set. While there are such
+ * active points, the approximate evidence is not available (see 
+ * getActiveSetObservations).
+ * 
+ * The current observations are assumed to be in chronological order. The 
+ * memory used is bounded by the window size. A value of 0 disables the
+ * window.
+ */
+void PSGP::setWindow(int size)
+{
+    assert(size == 0 || size >= nObs);
+    
+    windowSize = size;
+    nextSlot = 0;
+}
+
+
+/**
+ * Remove the site contribution of an observation leaving the window and 
+ * clear its storage slot
+ */
+void PSGP::expireObservation(int iObs)
+{
+    EP_removePreviousContribution(iObs);
+    
+    meanEP(iObs) = 0.0;
+    varEP(iObs)  = 0.0;
+    logZ(iObs)   = 0.0;
+    P.set_row(iObs, zeros(P.cols()));
+    
+    // Active points backed by this observation are no longer backed by data
+    for (int j = 0; j < sizeActiveSet; j++)
+    {
+        if (idxActiveSet(j) == iObs) idxActiveSet(j) = -1;
+    }
+}
+
+
+/**
+ * Observations at the active points. Active points which are not backed 
+ * by an observation (expired in windowed mode, or given by their location
+ * only, see computePosteriorFixedActiveSet) have none, in which case this
+ * is an error - the approximate evidence, which relies on these, is then 
+ * not available.
+ */
+vec PSGP::getActiveSetObservations() const
+{
+    if (sizeActiveSet > 0 && min(idxActiveSet) < 0)
+    {
+        it_error("PSGP::getActiveSetObservations: some active points are not backed by "
+                 "an observation, use the full evidence or the upper bound instead");
+    }
+    return Observations(idxActiveSet);
+}
+
+
+/**
+ * Raise an error if the posterior was set from (merged) site contributions, 
+ * see setPosteriorFromSiteContributions. The site parameters and the 
+ * projections P of the observations are then not available, so the caller,
+ * which relies on them, cannot be used.
+ */
+void PSGP::checkSiteParameters(const string caller) const
+{
+    if (mergedPosterior)
+    {
+        it_error("PSGP::" + caller + ": the posterior was set from site contributions "
+                 "and can only be used for predictions");
+    }
 }
 
+
+/**
+ * Choose the active point to remove when the (extended) active set is 
+ * too large: active points not backed by an observation (expired in 
+ * windowed mode) first, otherwise the one with the lowest score.
+ */
+int PSGP::selectRemovalCandidate(const vec& scores, const ivec& indices) const
+{
+    int candidate = -1;
+    
+    for (int j = 0; j < indices.length(); j++)
+    {
+        if (indices(j) < 0 && (candidate < 0 || scores(j) < scores(candidate))) candidate = j;
+    }
+    
+    if (candidate < 0) candidate = min_index(scores);
+    
+    return candidate;
+}
+
+
+/**
+ * Warm refresh of the posterior after a change of covariance parameters
+ * (typically after an optimisation step). The active set and EP parameters
+ * are kept, the posterior is rebuilt for the new parameters (see
+ * recomputePosterior) and a single sweep through the data is made with
+ * the active set fixed.
+ *
+ * This is much cheaper than resetPosterior() followed by computePosterior(),
+ * which discards the active set and the site parameters. If there is no
+ * posterior to start from, this falls back to computePosterior().
+ */
+void PSGP::refreshPosterior(const LikelihoodType& noiseModel)
+{
+    if (sizeActiveSet == 0)
+    {
+        computePosterior(noiseModel);
+        return;
+    }
+
+    recomputePosterior();
+
+    ivec randObsIndex = randomPermutation(nObs);
+
+    for(int i=0; i<nObs; i++)
+    {
+        if (verbose) cout << "\rRefreshing observation: " << i+1 << "/" << nObs  << flush;
+        processObservationEP(randObsIndex(i), noiseModel, true);
+    }
+    if (verbose) cout << endl;
+}
+
+
+/**
+ * Warm refresh of the posterior with a different likelihood model for
+ * each observation. See refreshPosterior(const LikelihoodType&).
+ */
+void PSGP::refreshPosterior(const ivec& modelIndex, const Vec<LikelihoodType *> noiseModel)
+{
+    assert(nObs == modelIndex.length());
+
+    if (sizeActiveSet == 0)
+    {
+        computePosterior(modelIndex, noiseModel);
+        return;
+    }
+
+    recomputePosterior();
+
+    ivec randObsIndex = randomPermutation(nObs);
+
+    for(int iObs=0; iObs<nObs; iObs++)
+    {
+        int iModel = modelIndex(randObsIndex(iObs));
+        if (verbose) cout << "\rRefreshing observation: " << iObs+1 << "/" << nObs << flush;
+
+        assert(iModel < noiseModel.length() && iModel >= 0);
+
+        processObservationEP(randObsIndex(iObs), *noiseModel(iModel), true);
+    }
+    if (verbose) cout << endl;
+}
+
+/**
+ * Draw the random orders of the EP sweeps from a stream of the given seed
+ * (see NormalStream) rather than from the global IT++ generator, which is
+ * not safe to share between threads. Each permutation uses the next stream
+ * of the seed, so the sequence of orders only depends on the seed.
+ */
+void PSGP::setPermutationSeed(uint64_t seed)
+{
+    ownPermutations = true;
+    permutationSeed = seed;
+    permutationStream = 0;
+}
+
+
+/**
+ * Random permutation of 0..n-1, from the global IT++ generator or from the
+ * permutation seed if one was set
+ */
+ivec PSGP::randomPermutation(int n)
+{
+    if (!ownPermutations) return itppext::randperm(n);
+    
+    NormalStream normal(permutationSeed, permutationStream++);
+    vec keys(n);
+    for (int i=0; i<n; i++) keys(i) = normal();
+    return sort_index(keys);
+}
+
+
 /**
  * Reset posterior representation
  */
@@ -917,6 +2041,7 @@ void PSGP::resetPosterior()
     idxActiveSet.set_size(0);
     sizeActiveSet = 0;
     P = zeros(Observations.length(), 0);
+    mergedPosterior = false;
     
     KB_aug = zeros(maxActiveSet+1, maxActiveSet+1);
     Q_aug = zeros(maxActiveSet+1, maxActiveSet+1);
@@ -954,6 +2079,8 @@ void PSGP::resetPosterior()
  */
 double PSGP::objective() const
 {
+    checkSiteParameters("objective");
+    
     double evidence;
 
     switch(likelihoodType)
@@ -990,6 +2117,8 @@ double PSGP::objective() const
  */
 vec PSGP::gradient() const
 {
+    checkSiteParameters("gradient");
+    
     vec g;
 
     switch(likelihoodType)
@@ -1023,16 +2152,21 @@ double PSGP::compEvidence() const
     cvec es;
     mat KB_new(sizeActiveSet, sizeActiveSet);
 
-    covFunc.covariance(KB_new, ActiveSet);
+    covFunc.covarianceFromSqDist(KB_new, ActiveSet, activeSetDistances.sqDistMatrix(ActiveSet));
+
+    // The site parameters and P may have spare rows (see addObservations)
+    vec lambda = varEP(0, nObs-1);
+    vec a = meanEP(0, nObs-1);
+    mat Pobs = P.get_rows(0, nObs-1);
 
-    double evid = sum(log(varEP));
+    double evid = sum(log(lambda));
 
-    evid -= sum(elem_mult(pow(meanEP, 2.0), varEP));
-    evid += 2.0 * sum(logZ);
-    evid -= varEP.length() * log(2.0 * pi);
-    mat Klp = P.transpose() * diag(varEP);
-    mat Ksm = (Klp * P) * KB_new + eye(sizeActiveSet);
-    vec Kall = Klp * meanEP;	
+    evid -= sum(elem_mult(pow(a, 2.0), lambda));
+    evid += 2.0 * sum(logZ(0, nObs-1));
+    evid -= nObs * log(2.0 * pi);
+    mat Klp = Pobs.transpose() * diag(lambda);
+    mat Ksm = (Klp * Pobs) * KB_new + eye(sizeActiveSet);
+    vec Kall = Klp * a;	
     mat Kinv= backslash(Ksm.transpose(), KB_new.transpose());
 
     evid += dot(Kall, Kinv.transpose() * Kall);
@@ -1058,9 +2192,9 @@ double PSGP::compEvidenceApproximate() const
     mat cholSigma(sizeActiveSet, sizeActiveSet);
     mat Sigma(sizeActiveSet, sizeActiveSet);
     
-    covFunc.covariance(Sigma, ActiveSet);
+    covFunc.covarianceFromSqDist(Sigma, ActiveSet, activeSetDistances.sqDistMatrix(ActiveSet));
     mat invSigma = computeInverseFromCholesky(Sigma);
-    vec obsActiveSet = Observations(idxActiveSet);
+    vec obsActiveSet = getActiveSetObservations();
     
     vec alpha = invSigma * obsActiveSet;
 
@@ -1077,7 +2211,7 @@ double PSGP::compEvidenceApproximate() const
 double PSGP::compEvidenceUpperBound() const
 {
     mat KB_new(sizeActiveSet, sizeActiveSet);
-    covFunc.covariance(KB_new, ActiveSet);
+    covFunc.covarianceFromSqDist(KB_new, ActiveSet, activeSetDistances.sqDistMatrix(ActiveSet));
 
     mat U(KB_new.rows(), KB_new.cols());
     if (!chol(KB_new, U)) { 
@@ -1123,14 +2257,17 @@ vec PSGP::gradientEvidenceApproximate() const
     mat cholSigma(sizeActiveSet, sizeActiveSet);
     mat Sigma(sizeActiveSet, sizeActiveSet);
 
-    covFunc.covariance(Sigma, ActiveSet);
+    // Distances between active points do not change during optimisation
+    const mat& D = activeSetDistances.sqDistMatrix(ActiveSet);
+
+    covFunc.covarianceFromSqDist(Sigma, ActiveSet, D);
     cholSigma = computeCholesky(Sigma);
     mat invSigma = computeInverseFromCholesky(Sigma);
     // chol(Sigma, cholSigma);
     // mat invSigma = backslash( cholSigma, eye(sizeActiveSet) );
     // invSigma *= invSigma.transpose();
     
-    vec obsActiveSet = Observations(idxActiveSet);
+    vec obsActiveSet = getActiveSetObservations();
     vec alpha = invSigma * obsActiveSet;
 
     mat W = (invSigma - outer_product(alpha, alpha, false));
@@ -1139,7 +2276,7 @@ vec PSGP::gradientEvidenceApproximate() const
 
     for(int i = 0; i < covFunc.getNumberParameters(); i++)
     {
-        covFunc.covarianceGradient(partialDeriv, i, ActiveSet);
+        covFunc.covarianceGradientFromSqDist(partialDeriv, i, ActiveSet, D);
         grads(i) = elem_mult_sum(W, partialDeriv) / 2.0;
     }
     return grads; 
@@ -1156,7 +2293,8 @@ vec PSGP::gradientEvidenceUpperBound() const
 
     mat W = eye(sizeActiveSet);
     mat KB_new(sizeActiveSet, sizeActiveSet);
-    covFunc.covariance(KB_new, ActiveSet);
+    const mat& D = activeSetDistances.sqDistMatrix(ActiveSet);
+    covFunc.covarianceFromSqDist(KB_new, ActiveSet, D);
 
     // RB: This gives the correct gradient for the length scale
     mat partialDeriv(sizeActiveSet, sizeActiveSet);
@@ -1166,7 +2304,7 @@ vec PSGP::gradientEvidenceUpperBound() const
 
     for(int i = 0; i < covFunc.getNumberParameters(); i++)
     {
-        covFunc.covarianceGradient(partialDeriv, i, ActiveSet);
+        covFunc.covarianceGradientFromSqDist(partialDeriv, i, ActiveSet, D);
         mat V1 = backslash(KB_new,partialDeriv);
         mat V2 = W*backslash(KB_new,partialDeriv*U);
 
@@ -1201,8 +2339,8 @@ void PSGP::displayModelParameters() const
     cout << "  projection alpha           : " << meanEP.size() << endl;
     cout << "  log evidence vector        : " << logZ.size() << endl;
     cout << "  ----------------------------" << endl;
-    cout << "  Predicion locations        : " << Locations.rows() << " x " << Locations.cols() << endl;
-    cout << "  Observations               : " << Observations.size() << endl;
+    cout << "  Predicion locations        : " << nObs << " x " << Locations.cols() << endl;
+    cout << "  Observations               : " << nObs << endl;
     cout << "  Active set size            : " << ActiveSet.rows() << " (max = " << maxActiveSet << ")" << endl;
     cout << "  Epsilon tolerance          : " << epsilonTolerance << endl;
     cout << "  Iterations Changing/Fixed  : " << iterChanging << "/" << iterFixed << endl;
@@ -1266,3 +2404,53 @@ mat PSGP::computeInverseFromCholesky(const mat& C) const
     return invChol * invChol.transpose();
 }
 
+
+/**
+ * Square root F = V * diag(sqrt(d)) of a symmetric positive semi-definite
+ * matrix S = V * diag(d) * V', so that F * F' = S. Negative eigenvalues
+ * (from round-off, or an indefinite approximation of S) are set to 0, 
+ * with a warning if they are not negligible.
+ */
+mat PSGP::computeSquareRoot(const mat& S) const
+{
+    mat V;
+    vec d;
+    eig_sym(S, d, V);
+    
+    double dMax = max(abs(d));
+    int nNegative = 0;
+    double dMin = 0.0;
+    
+    // Scale the eigenvectors in place rather than multiplying by diag(d)
+    for (int j=0; j<d.length(); j++)
+    {
+        if (d(j) < -SQRT_EIGENVALUE_TOLERANCE * dMax)
+        {
+            nNegative++;
+            dMin = min(dMin, d(j));
+        }
+        
+        double s = sqrt(max(d(j), 0.0));
+        double* col = V._data() + j * V.rows();
+        for (int i=0; i<V.rows(); i++) col[i] *= s;
+    }
+    
+    if (nNegative > 0)
+    {
+        cerr << "Warning: " << nNegative << " negative eigenvalue(s) (down to " << dMin 
+             << ") set to 0 in the square root of a covariance matrix." << endl;
+    }
+    
+    return V;
+}
+
+
+/**
+ * Square root of the posterior covariance Q + C of the projected process
+ * (see computeSquareRoot)
+ */
+mat PSGP::projectedPosteriorSquareRoot() const
+{
+    return computeSquareRoot(Q + C);
+}
+
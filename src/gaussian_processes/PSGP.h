@@ -35,12 +35,25 @@
 #include "ForwardModel.h"
 #include "optimisation/Optimisable.h"
 #include "covariance_functions/CovarianceFunction.h"
+#include "covariance_functions/DistanceCache.h"
 #include "likelihood_models/LikelihoodType.h"
 #include "itppext/itppext.h"
 
 #include <cassert>
+#include <vector>
+#include <string>
+#include <fstream>
+#include <limits>
+#include <stdint.h>
 
 #define LAMBDA_TOLERANCE 1e-10
+#define POSTERIOR_BLOCK_SIZE 1000   // Number of observations per block when rebuilding P
+#define PREDICTION_BLOCK_SIZE 1000  // Number of prediction locations per block (single precision)
+#define GEMM_TILE_COLUMNS 256       // Columns of C per tile of the single precision product k*C
+#define GEMM_TILE_DEPTH 128         // Rows of C per tile of the single precision product k*C
+#define SINGLE_PRECISION_TOLERANCE 1e-4 // Default max rounding error of single precision variances (relative to the prior)
+#define REGION_BLOCK_SIZE 500       // Number of locations per block in makeBlockPredictions
+#define SQRT_EIGENVALUE_TOLERANCE 1e-10 // Negative eigenvalues (relative to the largest) ignored silently in square roots
 
 using namespace std;
 using namespace itpp;
@@ -57,9 +70,16 @@ using namespace itpp;
 // of the algorith, V1 being the oldest (and least efficient) and V3
 // the newest (and most efficient). V3 is used by default.
 enum AlgoVersion { ALGO_V1, ALGO_V2, ALGO_V3 };
+
+class CheckpointWriter;
     
 class PSGP : public ForwardModel, public Optimisable
 {
+    friend class PSGPSimulator;
+    friend class PSGPSampler;
+    friend class PSGPSnapshot;
+    friend class PSGPPredictiveCovariance;
+
 public:
     PSGP(mat& X, vec& Y, CovarianceFunction& cf, int nActivePoints=400, int _iterChanging=1, int _iterFixed=2);
 	virtual ~PSGP();
@@ -68,10 +88,55 @@ public:
 	void computePosterior(const ivec& LikelihoodModel, const Vec<LikelihoodType *> noiseModels);
 	void resetPosterior();
 	void recomputePosterior();
+	void refreshPosterior(const LikelihoodType& noiseModel);
+	void refreshPosterior(const ivec& LikelihoodModel, const Vec<LikelihoodType *> noiseModels);
 	
 	void computePosteriorFixedActiveSet(const LikelihoodType& noiseModel, ivec iActive);
+	void computePosteriorFixedActiveSet(const LikelihoodType& noiseModel, const mat& activeLocations);
 	void recomputePosteriorFixedActiveSet(const LikelihoodType& noiseModel);
 	
+	void addObservations(const mat& Xnew, const vec& Ynew, const LikelihoodType& noiseModel, 
+	                     bool updateActiveSet=false, int localSweeps=0);
+	void setWindow(int size);
+	int  getWindowSize() const { return windowSize; }
+	
+	/**
+	 * Progress output of the posterior computations (on by default), and
+	 * a seed for the random orders of the EP sweeps. With a seed, the 
+	 * orders no longer use the global IT++ generator, so that PSGPs can 
+	 * be trained in parallel, reproducibly (see PSGPEnsemble).
+	 */
+	void setVerbose(bool v) { verbose = v; }
+	void setPermutationSeed(uint64_t seed);
+	
+	/**
+	 * Checkpointing of long posterior computations. With a checkpoint file 
+	 * set, computePosterior saves its state every 'interval' observations
+	 * (in a background thread, see CheckpointWriter). After a crash, 
+	 * resumePosterior continues the computation from the last checkpoint,
+	 * with the same likelihood model(s). An empty filename or an interval 
+	 * of 0 disables checkpointing.
+	 */
+	void setCheckpoint(const string filename, int interval);
+	bool resumePosterior(const LikelihoodType& noiseModel, const string filename);
+	bool resumePosterior(const ivec& LikelihoodModel, const Vec<LikelihoodType *> noiseModels, const string filename);
+	
+	/**
+	 * Posterior computation over data shards. Each shard (typically in a 
+	 * separate process) computes its posterior for a shared, fixed active set
+	 * (see computePosteriorFixedActiveSet) and writes its site contributions 
+	 * P'*Lambda*P and P'*Lambda*meanEP to a file. These are summed by 
+	 * mergeSiteContributions to give the posterior for the whole data set.
+	 * The merged PSGP can be used for prediction only: the site parameters
+	 * of the observations are not known, so EP updates, cross-validation,
+	 * the evidence and a new posterior for other parameters are errors 
+	 * until a posterior is computed again (e.g. computePosterior).
+	 */
+	void getSiteContributions(mat& U, vec& b) const;
+	void setPosteriorFromSiteContributions(const mat& activeLocations, const mat& U, const vec& b);
+	bool writeSiteContributions(const string filename) const;
+	bool mergeSiteContributions(const vector<string>& filenames);
+	
 	/**
 	 * Make predictions at a set of locations Xpred. The mean and variance
 	 * are returned in the Mean and Variance vectors. To use a different  
@@ -81,10 +146,58 @@ public:
 	void makePredictions(vec& Mean, vec& Variance, const mat& Xpred, CovarianceFunction &cf) const;
 	void makePredictions(vec& Mean, vec& Variance, const mat& Xpred) const;
 	
+	/**
+	 * Use single precision (float) arithmetic for the products with alpha
+	 * and C in makePredictions. This halves the memory traffic, at the
+	 * cost of about 7 significant digits in the products (the results are
+	 * accumulated in double precision). The variance kstar + k*C*k' can 
+	 * cancel badly near the data, so it is recomputed in double precision
+	 * wherever its rounding error could exceed varianceTolerance times the
+	 * prior variance (a looser tolerance recomputes fewer variances). 
+	 * comparePredictionPrecision returns (and optionally prints) the largest
+	 * absolute differences from the double precision predictions on a given
+	 * set of locations.
+	 */
+	void setSinglePrecisionPredictions(bool useSinglePrecision, double varianceTolerance = SINGLE_PRECISION_TOLERANCE) 
+	{ 
+		singlePrecision = useSinglePrecision; 
+		singlePrecisionTolerance = varianceTolerance;
+	}
+	void comparePredictionPrecision(const mat& Xpred, double& meanError, double& varianceError, bool verbose=true) const;
+	
+	/**
+	 * Block predictions: posterior mean and variance of the average of the
+	 * process over regions. region(i) is the region of location i (-1 to 
+	 * leave it out), Mean and Variance must have one entry per region. The 
+	 * covariance between the locations is never stored: the low-rank term 
+	 * only needs the average covariance of each region with the active 
+	 * set, and the prior term is summed block by block, in 
+	 * O(sum of squared region sizes). Use PSGPPredictiveCovariance for the
+	 * covariance between individual locations.
+	 */
+	void makeBlockPredictions(vec& Mean, vec& Variance, const mat& Xpred, const ivec& region, CovarianceFunction& cf) const;
+	void makeBlockPredictions(vec& Mean, vec& Variance, const mat& Xpred, const ivec& region) const;
+	
+	/**
+	 * Cross-validation predictions of the latent process at the observation
+	 * locations, from the current posterior (no refits). leaveOneOut uses 
+	 * the EP cavity of each observation, i.e. the posterior with its site 
+	 * removed. crossValidation removes the sites of each fold at once 
+	 * (folds(i) is the fold of observation i). The active set is kept. Add 
+	 * the noise variance to get predictive variances for the observations.
+	 */
+	void leaveOneOut(vec& Mean, vec& Variance) const;
+	void crossValidation(vec& Mean, vec& Variance, const ivec& folds) const;
+	
 	
 	void setAlgoVersion(AlgoVersion version) { algoVersion = version; }
 	void setGammaTolerance(double gammaMin) { gammaTolerance = gammaMin; }
 	
+	/**
+	 * Draw a single realisation of the posterior at Xpred. The exact version
+	 * decomposes the full covariance of Xpred - use PSGPSimulator for large
+	 * sets of locations, grids or many realisations.
+	 */
 	vec simulate(const mat& Xpred, bool approx) const;
 
 	// Set/Get/Print methods for covariance parameters
@@ -99,10 +212,11 @@ public:
 	/**
 	 * Accessors/Modifiers
 	 */
+	int  getNumberObservations() const { return nObs; }
 	int  getSizeActiveSet()      { return sizeActiveSet; }
 	ivec getActiveSetIndices()   { return idxActiveSet; }
 	mat  getActiveSetLocations() { return ActiveSet; }
-	vec  getActiveSetObservations() { return Observations(idxActiveSet); }
+	vec  getActiveSetObservations() const;
 
 	void setActiveSetSize(int n) { maxActiveSet = n; }
 	void setActiveSet(ivec activeIndexes, mat activeLocations);
@@ -143,6 +257,10 @@ private:
     mat     ActiveSet;     // Active set
     ivec    idxActiveSet;  // Indexes of observations in active set 
 
+    // Squared distances between active points (the active set is fixed
+    // during parameter optimisation, so these are only computed once)
+    mutable DistanceCache activeSetDistances;
+
     mat P;              // projection coefficient matrix (full obs onto active set)
     vec meanEP;         // EP mean parameter (a)
     vec varEP;          // EP variance parameter(lambda)
@@ -179,9 +297,33 @@ private:
     
     LikelihoodCalculation likelihoodType;
     
+    bool singlePrecision;   // Single precision predictions
+    double singlePrecisionTolerance; // Max rounding error of single precision variances
+    
+    CheckpointWriter* checkpointWriter;   // Checkpoint writer (NULL if disabled)
+    int checkpointInterval;               // Observations between checkpoints
+    
+    int windowSize;     // Maximum number of observations kept (0 for no limit)
+    int nextSlot;       // Storage slot of the oldest observation (when the window is full)
+    
+    bool verbose;                 // Progress output
+    bool ownPermutations;         // Sweep orders from permutationSeed (not the IT++ RNG)
+    uint64_t permutationSeed;     // Seed of the sweep orders
+    uint64_t permutationStream;   // Stream of the next sweep order
+    
+    bool mergedPosterior;         // Posterior set from site contributions (prediction only)
+    
     
     
 	// These methods provide the core algorithm
+    void runEPSweeps(const ivec& modelIndex, const Vec<LikelihoodType *> noiseModel, int firstCycle, ivec order, int firstObs);
+    void takeCheckpoint(const ivec& order, int cycle, int position);
+    bool restoreCheckpoint(const string filename, ivec& order, int& cycle, int& position);
+    void growObservationStores(int n);
+    ivec randomPermutation(int n);
+    void expireObservation(int iObs);
+    int  selectRemovalCandidate(const vec& scores, const ivec& indices) const;
+    void checkSiteParameters(const string caller) const;
     void processObservationEP(const int iObs, const LikelihoodType &noiseModel, const bool fixActiveSet);
     void EP_removePreviousContribution(int iObs);
     void EP_updateIntermediateComputations(double &cavityMean, double &cavityVar, double &sigmaLoc,
@@ -213,9 +355,14 @@ private:
 	vec gradientEvidenceApproximate() const;
 	vec gradientEvidenceUpperBound() const;
 
+	// Single precision prediction engine
+	int makePredictionsSinglePrecision(vec& Mean, vec& Variance, const mat& Xpred, CovarianceFunction& cf) const;
+
 	// Numerical tools
 	mat computeCholesky(const mat& iM) const;
 	mat computeInverseFromCholesky(const mat& C) const;
+	mat computeSquareRoot(const mat& S) const;
+	mat projectedPosteriorSquareRoot() const;
 };
 
 #endif /*PSGP_H_*/
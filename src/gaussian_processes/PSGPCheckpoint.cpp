@@ -0,0 +1,242 @@
+#include "PSGPCheckpoint.h"
+
+#include <fstream>
+#include <cstdio>
+
+/**
+ * Write the checkpoint to a file (IT++ format). The data is written to 
+ * a temporary file, which then replaces the checkpoint file (rename is 
+ * atomic), so that a crash during the write leaves the previous 
+ * checkpoint intact.
+ */
+bool PSGPCheckpoint::write(const string filename) const
+{
+    string tmpFilename = filename + ".tmp";
+    
+    ofstream test(tmpFilename.c_str());
+    if (!test.good()) 
+    {
+        cerr << "Could not open file " << tmpFilename << " for writing." << endl;
+        return false;
+    }
+    test.close();
+    
+    ivec sweep(4);
+    sweep(0) = cycle;
+    sweep(1) = position;
+    sweep(2) = iterChanging;
+    sweep(3) = iterFixed;
+    
+    vec settings(3);
+    settings(0) = maxActiveSet;
+    settings(1) = algoVersion;
+    settings(2) = gammaTolerance;
+    
+    ivec window(2);
+    window(0) = windowSize;
+    window(1) = nextSlot;
+    
+    // 64 bit seed and stream as pairs of 32 bit integers
+    ivec permutation(5);
+    permutation(0) = ownPermutations;
+    permutation(1) = (int) (uint32_t) (permutationSeed >> 32);
+    permutation(2) = (int) (uint32_t) permutationSeed;
+    permutation(3) = (int) (uint32_t) (permutationStream >> 32);
+    permutation(4) = (int) (uint32_t) permutationStream;
+    
+    it_file file;
+    file.open(tmpFilename, true);
+    file << Name("activeSet") << ActiveSet;
+    file << Name("idxActiveSet") << idxActiveSet;
+    file << Name("KB") << KB;
+    file << Name("Q") << Q;
+    file << Name("C") << C;
+    file << Name("P") << P;
+    file << Name("alpha") << alpha;
+    file << Name("meanEP") << meanEP;
+    file << Name("varEP") << varEP;
+    file << Name("logZ") << logZ;
+    file << Name("order") << order;
+    file << Name("sweep") << sweep;
+    file << Name("kernelParameters") << kernelParameters;
+    file << Name("settings") << settings;
+    file << Name("window") << window;
+    file << Name("rngState") << rngState;
+    file << Name("permutation") << permutation;
+    file.close();
+    
+    if (rename(tmpFilename.c_str(), filename.c_str()) != 0)
+    {
+        cerr << "Could not rename " << tmpFilename << " to " << filename << "." << endl;
+        return false;
+    }
+    
+    return true;
+}
+
+
+/**
+ * Read a checkpoint from a file
+ */
+bool PSGPCheckpoint::read(const string filename)
+{
+    ifstream test(filename.c_str());
+    if (!test.good())
+    {
+        cerr << "Could not open file " << filename << " for reading." << endl;
+        return false;
+    }
+    test.close();
+    
+    ivec sweep, window, permutation;
+    vec settings;
+    
+    it_ifile file;
+    file.open(filename);
+    file >> Name("activeSet") >> ActiveSet;
+    file >> Name("idxActiveSet") >> idxActiveSet;
+    file >> Name("KB") >> KB;
+    file >> Name("Q") >> Q;
+    file >> Name("C") >> C;
+    file >> Name("P") >> P;
+    file >> Name("alpha") >> alpha;
+    file >> Name("meanEP") >> meanEP;
+    file >> Name("varEP") >> varEP;
+    file >> Name("logZ") >> logZ;
+    file >> Name("order") >> order;
+    file >> Name("sweep") >> sweep;
+    file >> Name("kernelParameters") >> kernelParameters;
+    file >> Name("settings") >> settings;
+    file >> Name("window") >> window;
+    file >> Name("rngState") >> rngState;
+    file >> Name("permutation") >> permutation;
+    file.close();
+    
+    if (sweep.length() != 4 || settings.length() != 3 || window.length() != 2 
+        || permutation.length() != 5)
+    {
+        cerr << "Checkpoint " << filename << " is incomplete." << endl;
+        return false;
+    }
+    
+    cycle        = sweep(0);
+    position     = sweep(1);
+    iterChanging = sweep(2);
+    iterFixed    = sweep(3);
+    
+    maxActiveSet   = (int) settings(0);
+    algoVersion    = (int) settings(1);
+    gammaTolerance = settings(2);
+    
+    windowSize = window(0);
+    nextSlot   = window(1);
+    
+    ownPermutations   = (permutation(0) != 0);
+    permutationSeed   = ((uint64_t) (uint32_t) permutation(1) << 32) | (uint32_t) permutation(2);
+    permutationStream = ((uint64_t) (uint32_t) permutation(3) << 32) | (uint32_t) permutation(4);
+    
+    return true;
+}
+
+
+/**
+ * Constructor - starts the writer thread
+ */
+CheckpointWriter::CheckpointWriter(const string filename) : filename(filename)
+{
+    filling = -1;
+    writing = -1;
+    pending = -1;
+    stop = false;
+    
+    pthread_mutex_init(&mutex, NULL);
+    pthread_cond_init(&changed, NULL);
+    pthread_create(&thread, NULL, CheckpointWriter::run, this);
+}
+
+
+/**
+ * Destructor - writes the pending snapshot and stops the writer thread
+ */
+CheckpointWriter::~CheckpointWriter()
+{
+    wait();
+    
+    pthread_mutex_lock(&mutex);
+    stop = true;
+    pthread_cond_broadcast(&changed);
+    pthread_mutex_unlock(&mutex);
+    
+    pthread_join(thread, NULL);
+    pthread_cond_destroy(&changed);
+    pthread_mutex_destroy(&mutex);
+}
+
+
+/**
+ * Return a snapshot buffer to fill - this is never the buffer being 
+ * written. A snapshot still waiting to be written in that buffer is 
+ * dropped.
+ */
+PSGPCheckpoint& CheckpointWriter::beginSnapshot()
+{
+    pthread_mutex_lock(&mutex);
+    filling = (writing == 0) ? 1 : 0;
+    if (pending == filling) pending = -1;
+    pthread_mutex_unlock(&mutex);
+    
+    return buffers[filling];
+}
+
+
+/**
+ * Hand the filled snapshot over to the writer thread
+ */
+void CheckpointWriter::endSnapshot()
+{
+    pthread_mutex_lock(&mutex);
+    pending = filling;
+    filling = -1;
+    pthread_cond_broadcast(&changed);
+    pthread_mutex_unlock(&mutex);
+}
+
+
+/**
+ * Wait until there is no snapshot left to write
+ */
+void CheckpointWriter::wait()
+{
+    pthread_mutex_lock(&mutex);
+    while (pending != -1 || writing != -1) pthread_cond_wait(&changed, &mutex);
+    pthread_mutex_unlock(&mutex);
+}
+
+
+/**
+ * Writer thread: write pending snapshots until stopped
+ */
+void* CheckpointWriter::run(void* arg)
+{
+    CheckpointWriter* w = static_cast<CheckpointWriter*>(arg);
+    
+    pthread_mutex_lock(&w->mutex);
+    while (true)
+    {
+        while (w->pending == -1 && !w->stop) pthread_cond_wait(&w->changed, &w->mutex);
+        if (w->pending == -1) break;   // Stopped, nothing left to write
+        
+        w->writing = w->pending;
+        w->pending = -1;
+        pthread_mutex_unlock(&w->mutex);
+        
+        w->buffers[w->writing].write(w->filename);
+        
+        pthread_mutex_lock(&w->mutex);
+        w->writing = -1;
+        pthread_cond_broadcast(&w->changed);
+    }
+    pthread_mutex_unlock(&w->mutex);
+    
+    return NULL;
+}
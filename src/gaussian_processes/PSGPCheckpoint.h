@@ -0,0 +1,124 @@
+/***************************************************************************
+ *   AstonGeostats, algorithms for low-rank geostatistical models          *
+ *                                                                         *
+ *   Copyright (C) Remi Barillec, Ben Ingram, 2008-2009                    *
+ *                                                                         *
+ *   Remi Barillec, r.barillec@aston.ac.uk
+ *   Ben Ingram, IngramBR@Aston.ac.uk                                      *
+ *   Neural Computing Research Group,                                      *
+ *   Aston University,                                                     *
+ *   Aston Street, Aston Triangle,                                         *
+ *   Birmingham. B4 7ET.                                                   *
+ *   United Kingdom                                                        *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#ifndef PSGPCHECKPOINT_H_
+#define PSGPCHECKPOINT_H_
+
+#include <itpp/itbase.h>
+
+#include <string>
+#include <stdint.h>
+#include <pthread.h>
+
+using namespace std;
+using namespace itpp;
+
+/**
+ * Snapshot of the state of a PSGP posterior computation, taken during the
+ * EP sweeps through the data: active set, EP site parameters, posterior 
+ * parameters, the order of the current sweep with the position in it, and
+ * the state of the random number generators (used for the next sweeps).
+ * The covariance parameters and the settings of the algorithm are stored 
+ * too, so that a checkpoint is only resumed with the same model.
+ */
+struct PSGPCheckpoint
+{
+    mat  ActiveSet;
+    ivec idxActiveSet;
+    mat  KB, Q, C, P;
+    vec  alpha;
+    vec  meanEP, varEP, logZ;
+    
+    ivec order;         // Order of the observations in the current sweep
+    int  cycle;         // Current sweep (1 to iterChanging + iterFixed)
+    int  position;      // Number of observations already processed in this sweep
+    int  iterChanging;
+    int  iterFixed;
+    
+    vec    kernelParameters;    // Transformed covariance function parameters
+    int    maxActiveSet;
+    int    algoVersion;
+    double gammaTolerance;
+    int    windowSize;          // Sliding window (see PSGP::setWindow)
+    int    nextSlot;
+    
+    ivec     rngState;          // IT++ random number generator state
+    bool     ownPermutations;   // Sweep orders from the permutation seed (see PSGP::setPermutationSeed)
+    uint64_t permutationSeed;
+    uint64_t permutationStream;
+    
+    bool write(const string filename) const;
+    bool read(const string filename);
+};
+
+
+/**
+ * Writes checkpoints to a file in a background thread, so that the EP 
+ * sweeps are not stalled by disk writes. There are two snapshot buffers:
+ * the sweep fills one while the other is being written. If a new snapshot
+ * is taken before the previous one was written, the older one is dropped.
+ * 
+ * Checkpoints are written to a temporary file which is then renamed, so 
+ * the checkpoint file is always complete.
+ * 
+ * Usage: 
+ *   PSGPCheckpoint& c = writer.beginSnapshot();
+ *   ... fill c ...
+ *   writer.endSnapshot();
+ */
+class CheckpointWriter
+{
+public:
+    CheckpointWriter(const string filename);
+    virtual ~CheckpointWriter();
+    
+    PSGPCheckpoint& beginSnapshot();
+    void endSnapshot();
+    
+    void wait();   // Wait until all snapshots have been written
+    
+    string getFilename() const { return filename; }
+    
+private:
+    static void* run(void* writer);
+    
+    string filename;
+    PSGPCheckpoint buffers[2];
+    
+    int  filling;    // Buffer being filled (-1 if none)
+    int  writing;    // Buffer being written (-1 if none)
+    int  pending;    // Buffer waiting to be written (-1 if none)
+    bool stop;
+    
+    pthread_t       thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t  changed;
+};
+
+#endif /*PSGPCHECKPOINT_H_*/
@@ -0,0 +1,279 @@
+#include "PSGPEnsemble.h"
+
+#include "covariance_functions/StationaryCF.h"
+#include "design/GreedyMaxMinDesign.h"
+#include "optimisation/SCGModelTrainer.h"
+
+#define KMEANS_ITERATIONS 20
+
+/**
+ * Constructor
+ *
+ * Parameters
+ *
+ * X             Matrix of inputs (locations)
+ * Y             Vector outputs (observations)
+ * covFunctions  One covariance function per expert (the number of experts
+ *               is the number of covariance functions)
+ * nActivePoints Maximum number of active points for each expert
+ */
+PSGPEnsemble::PSGPEnsemble(mat& X, vec& Y, const vector<CovarianceFunction *>& cfs, int nActivePoints)
+: Locations(X), Observations(Y), covFunctions(cfs)
+{
+    assert(Locations.rows() == Observations.size());
+    assert(covFunctions.size() > 0);
+
+    nExperts = covFunctions.size();
+    nNeighbours = min(3, nExperts);
+    nNonEmptyRegions = 0;
+
+    partition();
+
+    // Build the data set and PSGP for each region
+    expertLocations.resize(nExperts, NULL);
+    expertObservations.resize(nExperts, NULL);
+    experts.resize(nExperts, NULL);
+
+    for (int e=0; e<nExperts; e++)
+    {
+        ivec idx = find(region == e);
+
+        if (idx.length() == 0)
+        {
+            cerr << "Warning: region " << e << " of the ensemble has no observations." << endl;
+            continue;
+        }
+
+        expertLocations[e] = new mat(Locations.get_rows(idx));
+        expertObservations[e] = new vec(Observations(idx));
+        experts[e] = new PSGP(*expertLocations[e], *expertObservations[e], *covFunctions[e],
+                              min(nActivePoints, idx.length()));
+        experts[e]->setVerbose(false);
+        nNonEmptyRegions++;
+    }
+}
+
+
+/**
+ * Destructor
+ */
+PSGPEnsemble::~PSGPEnsemble()
+{
+    for (int e=0; e<nExperts; e++)
+    {
+        delete experts[e];
+        delete expertLocations[e];
+        delete expertObservations[e];
+    }
+}
+
+
+/**
+ * Compute the posterior of each expert, for the current parameters
+ */
+void PSGPEnsemble::computePosterior(const LikelihoodType& noiseModel)
+{
+    seedExperts();
+    
+#pragma omp parallel for schedule(dynamic)
+    for (int e=0; e<nExperts; e++)
+    {
+        if (experts[e]) experts[e]->computePosterior(noiseModel);
+    }
+}
+
+
+/**
+ * Estimate the parameters of each expert. As in the single PSGP case, this
+ * alternates nOuterLoops times between nIterations of parameter optimisation
+ * and a refresh of the posterior.
+ */
+void PSGPEnsemble::learnParameters(const LikelihoodType& noiseModel, int nOuterLoops, int nIterations)
+{
+    seedExperts();
+    
+#pragma omp parallel for schedule(dynamic)
+    for (int e=0; e<nExperts; e++)
+    {
+        if (!experts[e]) continue;
+
+        experts[e]->computePosterior(noiseModel);
+
+        SCGModelTrainer trainer(*experts[e]);
+        trainer.setAnalyticGradients(true);
+        trainer.setCheckGradient(false);
+        trainer.setDisplay(false);
+
+        for (int i=0; i<nOuterLoops; i++)
+        {
+            trainer.Train(nIterations);
+            experts[e]->refreshPosterior(noiseModel);
+        }
+    }
+}
+
+
+/**
+ * Make predictions at a set of locations Xpred. For each location, the
+ * predictions of the nNeighbours experts with the nearest region centres
+ * are combined with the robust Bayesian committee machine:
+ *
+ *   1/v = sum_k beta_k/v_k + (1 - sum_k beta_k)/v_prior
+ *   m   = v * sum_k beta_k*m_k/v_k
+ *
+ * where m_k, v_k are the mean and variance predicted by expert k and
+ * beta_k = 0.5*(log v_prior - log v_k) is the reduction in entropy from
+ * the prior to the expert's posterior. Regions left empty by the 
+ * partition have no expert and are never selected.
+ */
+void PSGPEnsemble::makePredictions(vec& Mean, vec& Variance, const mat& Xpred) const
+{
+    assert(Mean.length() == Variance.length());
+    assert(Xpred.rows() == Mean.length());
+
+    int nPred = Xpred.rows();
+    int nUsed = min(nNeighbours, nNonEmptyRegions);
+
+    // Select the experts used at each location
+    mat D;
+    StationaryCF::sqDistMatrix(D, Xpred, centres);
+    
+    for (int e=0; e<nExperts; e++)
+    {
+        if (!experts[e]) D.set_col(e, numeric_limits<double>::infinity() * ones(nPred));
+    }
+
+    imat neighbours(nPred, nUsed);
+    for (int i=0; i<nPred; i++) neighbours.set_row(i, nearestRegions(D.get_row(i), nUsed));
+
+    // Predictions of each expert at the locations where it is used
+    vector<ivec> used(nExperts);
+    vector<vec> expertMean(nExperts), expertVar(nExperts), priorVar(nExperts);
+
+    for (int i=0; i<nPred; i++)
+    {
+        for (int k=0; k<nUsed; k++)
+        {
+            int e = neighbours(i,k);
+            used[e].set_size(used[e].length()+1, true);
+            used[e](used[e].length()-1) = i;
+        }
+    }
+
+#pragma omp parallel for schedule(dynamic)
+    for (int e=0; e<nExperts; e++)
+    {
+        int n = used[e].length();
+        if (n == 0 || !experts[e]) continue;
+
+        mat Xe = Xpred.get_rows(used[e]);
+        expertMean[e].set_size(n);
+        expertVar[e].set_size(n);
+        priorVar[e].set_size(n);
+
+        experts[e]->makePredictions(expertMean[e], expertVar[e], Xe);
+        covFunctions[e]->computeDiagonal(priorVar[e], Xe);
+    }
+
+    // Combine the predictions
+    vec precision = zeros(nPred);
+    vec weightedMean = zeros(nPred);
+    vec sumBeta = zeros(nPred);
+    vec prior = zeros(nPred);
+
+    for (int e=0; e<nExperts; e++)
+    {
+        if (!experts[e]) continue;
+
+        for (int j=0; j<used[e].length(); j++)
+        {
+            int i = used[e](j);
+            double v = max(expertVar[e](j), LAMBDA_TOLERANCE);
+            double beta = 0.5 * (log(priorVar[e](j)) - log(v));
+
+            precision(i) += beta / v;
+            weightedMean(i) += beta * expertMean[e](j) / v;
+            sumBeta(i) += beta;
+
+            // Prior variance taken from the nearest expert
+            if (neighbours(i,0) == e) prior(i) = priorVar[e](j);
+        }
+    }
+
+    for (int i=0; i<nPred; i++)
+    {
+        precision(i) += (1.0 - sumBeta(i)) / prior(i);
+        Variance(i) = 1.0 / precision(i);
+        Mean(i) = Variance(i) * weightedMean(i);
+    }
+}
+
+
+/**
+ * Partition the observation locations into nExperts regions using k-means,
+ * initialised with a greedy max-min design (well spread centres).
+ */
+void PSGPEnsemble::partition()
+{
+    GreedyMaxMinDesign design(1.0);
+    centres = Locations.get_rows(design.subsample(Locations, nExperts));
+
+    region = -ones_i(Locations.rows());
+    mat D;
+
+    for (int iter=0; iter<KMEANS_ITERATIONS; iter++)
+    {
+        // Assign each observation to the nearest centre
+        StationaryCF::sqDistMatrix(D, Locations, centres);
+
+        bool changed = false;
+        for (int i=0; i<Locations.rows(); i++)
+        {
+            int nearest;
+            min(D.get_row(i), nearest);
+            if (nearest != region(i))
+            {
+                region(i) = nearest;
+                changed = true;
+            }
+        }
+
+        if (!changed) break;
+
+        // Move centres to the mean of their region
+        for (int e=0; e<nExperts; e++)
+        {
+            ivec idx = find(region == e);
+            if (idx.length() > 0) centres.set_row(e, sum(Locations.get_rows(idx), 1) / double(idx.length()));
+        }
+    }
+}
+
+
+/**
+ * Indices of the n regions with the smallest (squared) distance
+ */
+ivec PSGPEnsemble::nearestRegions(const vec& sqDistances, int n) const
+{
+    ivec sorted = sort_index(sqDistances);
+    return sorted.left(n);
+}
+
+
+/**
+ * Give each expert its own seed for the random orders of its EP sweeps.
+ * The seeds are drawn (in order) from the IT++ generator before the experts
+ * are trained in parallel, so the training is reproducible and independent
+ * of the number of threads.
+ */
+void PSGPEnsemble::seedExperts()
+{
+    for (int e=0; e<nExperts; e++)
+    {
+        if (!experts[e]) continue;
+        
+        uint64_t seed = (uint64_t) (randu() * 4294967296.0);
+        seed = (seed << 32) | (uint64_t) (randu() * 4294967296.0);
+        experts[e]->setPermutationSeed(seed);
+    }
+}
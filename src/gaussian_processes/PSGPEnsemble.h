@@ -0,0 +1,100 @@
+/***************************************************************************
+ *   AstonGeostats, algorithms for low-rank geostatistical models          *
+ *                                                                         *
+ *   Copyright (C) Remi Barillec, Ben Ingram, 2008-2009                    *
+ *                                                                         *
+ *   Remi Barillec, r.barillec@aston.ac.uk
+ *   Ben Ingram, IngramBR@Aston.ac.uk                                      *
+ *   Neural Computing Research Group,                                      *
+ *   Aston University,                                                     *
+ *   Aston Street, Aston Triangle,                                         *
+ *   Birmingham. B4 7ET.                                                   *
+ *   United Kingdom                                                        *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#ifndef PSGPENSEMBLE_H_
+#define PSGPENSEMBLE_H_
+
+#include <itpp/itbase.h>
+
+#include "PSGP.h"
+#include "covariance_functions/CovarianceFunction.h"
+#include "likelihood_models/LikelihoodType.h"
+
+#include <vector>
+#include <cassert>
+
+using namespace std;
+using namespace itpp;
+
+/**
+ * Ensemble of local PSGP experts. The input domain is partitioned into
+ * regions by k-means clustering of the observation locations, and a PSGP
+ * with its own active set (and covariance function) is trained on the
+ * observations of each region. Predictions are combined with a robust
+ * Bayesian committee machine (rBCM), using only the experts whose region
+ * centres are closest to each prediction location.
+ *
+ * Training and prediction of the experts are independent and run in
+ * parallel when the library is compiled with OpenMP.
+ *
+ * One covariance function must be provided per expert, as each expert
+ * optimises its own parameters. A region can be left empty by the 
+ * partition (e.g. with duplicated locations), in which case it has no 
+ * expert (getExpert returns NULL) and is ignored in the predictions.
+ */
+class PSGPEnsemble
+{
+public:
+    PSGPEnsemble(mat& X, vec& Y, const vector<CovarianceFunction *>& covFunctions, int nActivePoints=100);
+    virtual ~PSGPEnsemble();
+
+    void computePosterior(const LikelihoodType& noiseModel);
+    void learnParameters(const LikelihoodType& noiseModel, int nOuterLoops, int nIterations);
+
+    void makePredictions(vec& Mean, vec& Variance, const mat& Xpred) const;
+
+    void setNumberNeighbours(int n) { nNeighbours = n; }
+
+    int   getNumberExperts() const { return nExperts; }
+    ivec  getRegions() const { return region; }
+    mat   getRegionCentres() const { return centres; }
+    PSGP* getExpert(int i) { return experts[i]; }
+
+private:
+    void partition();
+    void seedExperts();
+    ivec nearestRegions(const vec& sqDistances, int n) const;
+
+    mat& Locations;
+    vec& Observations;
+
+    int nExperts;
+    int nNeighbours;                            // Experts used for each prediction
+    int nNonEmptyRegions;                       // Regions with an expert
+
+    vector<CovarianceFunction *> covFunctions;  // One per expert
+    mat  centres;                               // Region centres (one per row)
+    ivec region;                                // Region of each observation
+
+    vector<mat *>  expertLocations;
+    vector<vec *>  expertObservations;
+    vector<PSGP *> experts;
+};
+
+#endif /*PSGPENSEMBLE_H_*/
@@ -0,0 +1,154 @@
+#include "PSGPPredictiveCovariance.h"
+
+/**
+ * Constructor - computes the covariance between the prediction locations
+ * and the active set, using covariance function cf
+ */
+PSGPPredictiveCovariance::PSGPPredictiveCovariance(const PSGP& psgp, const mat& Xpred, CovarianceFunction& cf)
+: Xpred(Xpred), cf(cf), C(psgp.C)
+{
+    Ktest.set_size(Xpred.rows(), psgp.sizeActiveSet);
+    cf.covariance(Ktest, Xpred, psgp.ActiveSet);
+}
+
+
+/**
+ * Constructor - same as above, using the PSGP covariance function
+ */
+PSGPPredictiveCovariance::PSGPPredictiveCovariance(const PSGP& psgp, const mat& Xpred)
+: Xpred(Xpred), cf(psgp.covFunc), C(psgp.C)
+{
+    Ktest.set_size(Xpred.rows(), psgp.sizeActiveSet);
+    cf.covariance(Ktest, Xpred, psgp.ActiveSet);
+}
+
+
+/**
+ * Destructor
+ */
+PSGPPredictiveCovariance::~PSGPPredictiveCovariance()
+{
+}
+
+
+/**
+ * Prior covariance between X1 and X2. If symmetric (X1 and X2 are the 
+ * same locations), the diagonal is replaced by computeDiagonal.
+ */
+void PSGPPredictiveCovariance::computePrior(mat& K, const mat& X1, const mat& X2, bool symmetric) const
+{
+    K.set_size(X1.rows(), X2.rows());
+    cf.covariance(K, X1, X2);
+    
+    if (symmetric)
+    {
+        vec kdiag(X1.rows());
+        cf.computeDiagonal(kdiag, X1);
+        for (int i=0; i<X1.rows(); i++) K(i,i) = kdiag(i);
+    }
+}
+
+
+/**
+ * Posterior covariance between prediction locations i and j
+ */
+double PSGPPredictiveCovariance::element(int i, int j) const
+{
+    mat K;
+    computePrior(K, Xpred.get_rows(i,i), Xpred.get_rows(j,j), i == j);
+    
+    vec ki = Ktest.get_row(i);
+    vec kj = Ktest.get_row(j);
+    return K(0,0) + dot(ki, C*kj);
+}
+
+
+/**
+ * Posterior covariance between the prediction locations given by rows and
+ * those given by cols
+ */
+mat PSGPPredictiveCovariance::block(const ivec& rows, const ivec& cols) const
+{
+    mat K;
+    computePrior(K, Xpred.get_rows(rows), Xpred.get_rows(cols), false);
+    
+    // Prior diagonal entries, wherever a location appears in rows and cols
+    vec kdiag(1);
+    for (int a=0; a<rows.length(); a++)
+    {
+        for (int b=0; b<cols.length(); b++)
+        {
+            if (rows(a) == cols(b))
+            {
+                cf.computeDiagonal(kdiag, Xpred.get_rows(rows(a), rows(a)));
+                K(a,b) = kdiag(0);
+            }
+        }
+    }
+    
+    mat Krows = Ktest.get_rows(rows);
+    mat Kcols = Ktest.get_rows(cols);
+    return K + Krows * C * Kcols.transpose();
+}
+
+
+/**
+ * Posterior variances (same as PSGP::makePredictions)
+ */
+vec PSGPPredictiveCovariance::diagonal() const
+{
+    vec kstar(Xpred.rows());
+    cf.computeDiagonal(kstar, Xpred);
+    return kstar + sum(elem_mult(Ktest * C, Ktest), 2);
+}
+
+
+/**
+ * Full posterior covariance matrix (n x n)
+ */
+mat PSGPPredictiveCovariance::full() const
+{
+    mat K;
+    computePrior(K, Xpred, Xpred, true);
+    return K + Ktest * C * Ktest.transpose();
+}
+
+
+/**
+ * Product of the posterior covariance with x. The prior term is computed
+ * in blocks of REGION_BLOCK_SIZE rows (in parallel), the low-rank term as
+ * Ktest * (C * (Ktest' * x)).
+ */
+vec PSGPPredictiveCovariance::multiply(const vec& x) const
+{
+    int n = Xpred.rows();
+    assert(x.length() == n);
+    
+    vec y = Ktest * (C * (Ktest.transpose() * x));
+    
+    int nBlocks = (n + REGION_BLOCK_SIZE - 1) / REGION_BLOCK_SIZE;
+    
+#pragma omp parallel for schedule(dynamic)
+    for (int a=0; a<nBlocks; a++)
+    {
+        int start = a*REGION_BLOCK_SIZE;
+        int end = min(start + REGION_BLOCK_SIZE, n) - 1;
+        
+        mat Xa = Xpred.get_rows(start, end);
+        mat K;
+        vec ya = zeros(end - start + 1);
+        
+        for (int b=0; b<nBlocks; b++)
+        {
+            int startB = b*REGION_BLOCK_SIZE;
+            int endB = min(startB + REGION_BLOCK_SIZE, n) - 1;
+            
+            computePrior(K, Xa, Xpred.get_rows(startB, endB), a == b);
+            ya += K * x.mid(startB, endB - startB + 1);
+        }
+        
+        for (int i=start; i<=end; i++) y(i) += ya(i - start);
+    }
+    
+    return y;
+}
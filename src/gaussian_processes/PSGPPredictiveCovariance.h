@@ -0,0 +1,87 @@
+/***************************************************************************
+ *   AstonGeostats, algorithms for low-rank geostatistical models          *
+ *                                                                         *
+ *   Copyright (C) Remi Barillec, Ben Ingram, 2008-2009                    *
+ *                                                                         *
+ *   Remi Barillec, r.barillec@aston.ac.uk
+ *   Ben Ingram, IngramBR@Aston.ac.uk                                      *
+ *   Neural Computing Research Group,                                      *
+ *   Aston University,                                                     *
+ *   Aston Street, Aston Triangle,                                         *
+ *   Birmingham. B4 7ET.                                                   *
+ *   United Kingdom                                                        *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#ifndef PSGPPREDICTIVECOVARIANCE_H_
+#define PSGPPREDICTIVECOVARIANCE_H_
+
+#include <itpp/itbase.h>
+
+#include "PSGP.h"
+#include "covariance_functions/CovarianceFunction.h"
+
+#include <cassert>
+
+using namespace std;
+using namespace itpp;
+
+/**
+ * Posterior covariance of a PSGP at a set of prediction locations, in 
+ * factored form:
+ *   cov(Xpred) = K + Ktest * C * Ktest'
+ * where K = cf(Xpred, Xpred) is the prior covariance and Ktest = 
+ * cf(Xpred, ActiveSet) is n x m. Only Ktest and C are stored: entries 
+ * and blocks of K are computed on demand and products with the covariance
+ * are done block by block, so the n x n matrix is never formed (except by
+ * full(), for small n).
+ * 
+ * The prior term uses the cross-covariance of cf (with the diagonal from 
+ * computeDiagonal, as in makePredictions), so the diagonal of cov(Xpred) 
+ * is the predictive variance of PSGP::makePredictions.
+ * 
+ * For averages over regions, PSGP::makeBlockPredictions does not store 
+ * Ktest either.
+ */
+class PSGPPredictiveCovariance
+{
+public:
+    PSGPPredictiveCovariance(const PSGP& psgp, const mat& Xpred, CovarianceFunction& cf);
+    PSGPPredictiveCovariance(const PSGP& psgp, const mat& Xpred);
+    virtual ~PSGPPredictiveCovariance();
+    
+    const mat& getCrossCovariance() const { return Ktest; }
+    const mat& getC() const { return C; }
+    int size() const { return Xpred.rows(); }
+    
+    double element(int i, int j) const;
+    mat block(const ivec& rows, const ivec& cols) const;
+    vec diagonal() const;
+    mat full() const;
+    
+    vec multiply(const vec& x) const;
+    
+private:
+    void computePrior(mat& K, const mat& X1, const mat& X2, bool symmetric) const;
+    
+    mat Xpred;
+    CovarianceFunction& cf;
+    mat Ktest;
+    mat C;
+};
+
+#endif /*PSGPPREDICTIVECOVARIANCE_H_*/
@@ -0,0 +1,77 @@
+#include "PSGPSampler.h"
+#include "NormalStream.h"
+
+/**
+ * Constructor - computes the posterior mean and the square root of the 
+ * posterior covariance at Xpred
+ */
+PSGPSampler::PSGPSampler(const PSGP& psgp, const mat& Xpred, bool approx, uint64_t seed) 
+: seed(seed)
+{
+    nextRealisation = 0;
+    
+    mat kxbv;
+    
+    psgp.covFunc.covariance(kxbv, Xpred, psgp.ActiveSet);
+    mean = kxbv * psgp.alpha;
+    
+    if (approx)
+    {
+        factor = kxbv * psgp.projectedPosteriorSquareRoot();
+    }
+    else
+    {
+        mat kxx;
+        psgp.covFunc.covariance(kxx, Xpred);
+        factor = psgp.computeSquareRoot(kxx + (kxbv * psgp.C) * kxbv.transpose());
+    }
+}
+
+
+/**
+ * Destructor
+ */
+PSGPSampler::~PSGPSampler()
+{
+}
+
+
+/**
+ * Draw the next nSamples realisations (one per column)
+ */
+mat PSGPSampler::sample(int nSamples)
+{
+    mat samples = sample(nextRealisation, nSamples);
+    nextRealisation += nSamples;
+    return samples;
+}
+
+
+/**
+ * Draw realisations first, ..., first + nSamples - 1 (one per column). 
+ * The same realisation numbers always give the same realisations for a 
+ * given seed.
+ */
+mat PSGPSampler::sample(int first, int nSamples) const
+{
+    int r = factor.cols();
+    mat Z(r, nSamples);
+    
+#pragma omp parallel for
+    for (int j=0; j<nSamples; j++)
+    {
+        NormalStream normal(seed, first + j);
+        double* col = Z._data() + j * r;
+        for (int i=0; i<r; i++) col[i] = normal();
+    }
+    
+    mat samples = factor * Z;
+    
+    for (int j=0; j<nSamples; j++)
+    {
+        double* col = samples._data() + j * samples.rows();
+        for (int i=0; i<samples.rows(); i++) col[i] += mean(i);
+    }
+    
+    return samples;
+}
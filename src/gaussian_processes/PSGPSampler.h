@@ -0,0 +1,81 @@
+/***************************************************************************
+ *   AstonGeostats, algorithms for low-rank geostatistical models          *
+ *                                                                         *
+ *   Copyright (C) Remi Barillec, Ben Ingram, 2008-2009                    *
+ *                                                                         *
+ *   Remi Barillec, r.barillec@aston.ac.uk
+ *   Ben Ingram, IngramBR@Aston.ac.uk                                      *
+ *   Neural Computing Research Group,                                      *
+ *   Aston University,                                                     *
+ *   Aston Street, Aston Triangle,                                         *
+ *   Birmingham. B4 7ET.                                                   *
+ *   United Kingdom                                                        *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+#ifndef PSGPSAMPLER_H_
+#define PSGPSAMPLER_H_
+
+#include <itpp/itbase.h>
+
+#include "PSGP.h"
+
+#include <stdint.h>
+#include <cassert>
+
+using namespace std;
+using namespace itpp;
+
+/**
+ * Draws realisations of a PSGP posterior at a fixed set of prediction 
+ * locations. The posterior mean and a square root F of the posterior 
+ * covariance are computed once, when the sampler is created, and a batch 
+ * of K realisations is then a single product F * Z with a r x K matrix 
+ * of standard normal variates Z.
+ * 
+ * With approx=true (as in PSGP::simulate), F = k(X,B) * sqrt(Q + C) has
+ * r = m columns (the size of the active set). Otherwise F is the square 
+ * root of the full covariance of the prediction locations (r = n), which 
+ * is only practical for a few thousand locations.
+ * 
+ * Normal variates come from a generator of our own rather than the IT++ 
+ * one, which has a single global state. Realisation number j uses its own
+ * stream, seeded from (seed, j), so that an ensemble is reproducible for 
+ * a given seed, regardless of the batch sizes and number of threads.
+ */
+class PSGPSampler
+{
+public:
+    PSGPSampler(const PSGP& psgp, const mat& Xpred, bool approx=true, uint64_t seed=0);
+    virtual ~PSGPSampler();
+    
+    mat sample(int nSamples);
+    mat sample(int first, int nSamples) const;
+    
+    void setSeed(uint64_t newSeed) { seed = newSeed; nextRealisation = 0; }
+    
+    vec getMean() const { return mean; }
+    int getRank() const { return factor.cols(); }
+    
+private:
+    vec mean;         // Posterior mean at the prediction locations
+    mat factor;       // Square root of the posterior covariance
+    
+    uint64_t seed;
+    int nextRealisation;
+};
+
+#endif /*PSGPSAMPLER_H_*/
@@ -0,0 +1,395 @@
+#include "PSGPSimulator.h"
+
+#include <itpp/itsignal.h>
+
+/**
+ * Constructor - factorises the posterior of the projected process
+ */
+PSGPSimulator::PSGPSimulator(const PSGP& psgp) : psgp(psgp)
+{
+    embeddingPadding = 1.0;
+    update();
+}
+
+
+/**
+ * Destructor
+ */
+PSGPSimulator::~PSGPSimulator()
+{
+}
+
+
+/**
+ * Recompute the square root of Q + C, the covariance of the projected 
+ * process coefficients. This must be called whenever the posterior of
+ * the PSGP changes.
+ */
+void PSGPSimulator::update()
+{
+    postFactor = psgp.projectedPosteriorSquareRoot();
+}
+
+
+/**
+ * Simulate nSamples realisations of the posterior at scattered locations.
+ * Returns a matrix with one realisation per column.
+ */
+mat PSGPSimulator::simulate(const mat& Xpred, int nSamples, ResidualMethod residual) const
+{
+    int n = Xpred.rows();
+    mat samples(n, nSamples);
+    mat W = sampleProjectedPosterior(nSamples);
+    mat kxb;
+    
+    for (int start = 0; start < n; start += SIMULATION_BLOCK_SIZE)
+    {
+        int end = std::min(start + SIMULATION_BLOCK_SIZE, n) - 1;
+        
+        psgp.covFunc.covariance(kxb, Xpred.get_rows(start, end), psgp.ActiveSet);
+        samples.set_submatrix(start, 0, kxb * W);
+    }
+    
+    if (residual != NoResidual)
+    {
+        ivec idx(n);
+        for (int i=0; i<n; i++) idx(i) = i;
+        sampleResidual(samples, Xpred, idx, residual);
+    }
+    
+    return samples;
+}
+
+
+/**
+ * Simulate nSamples realisations of the posterior on a regular grid of 
+ * gridSize(0) x gridSize(1) nodes (1 or 2 dimensions), with the first node 
+ * at origin. Realisations are returned one per column, with the first grid
+ * dimension running fastest (the order of gridLocations).
+ */
+mat PSGPSimulator::simulateGrid(const vec& origin, const vec& spacing, const ivec& gridSize, int nSamples) const
+{
+    int d = origin.length();
+    assert(d == 1 || d == 2);
+    assert(spacing.length() == d && gridSize.length() == d);
+    assert(psgp.ActiveSet.cols() == d);
+    
+    // Snap the active points to the grid, extending it where needed
+    int m = psgp.sizeActiveSet;
+    imat activeNodes(m, d);
+    ivec lo = zeros_i(d), hi = gridSize - 1;
+    
+    for (int i=0; i<m; i++)
+    {
+        for (int k=0; k<d; k++)
+        {
+            activeNodes(i,k) = round_i((psgp.ActiveSet(i,k) - origin(k)) / spacing(k));
+            lo(k) = std::min(lo(k), activeNodes(i,k));
+            hi(k) = std::max(hi(k), activeNodes(i,k));
+        }
+    }
+    
+    ivec extSize = hi - lo + 1;
+    vec extOrigin = origin + elem_mult(to_vec(lo), spacing);
+    int extRows = extSize(0);
+    
+    // Prior realisations on the extended grid, and at the active points
+    mat H = samplePriorGrid(extOrigin, spacing, extSize, nSamples);
+    
+    ivec activeIdx(m);
+    for (int i=0; i<m; i++)
+    {
+        activeIdx(i) = activeNodes(i,0) - lo(0);
+        if (d == 2) activeIdx(i) += extRows * (activeNodes(i,1) - lo(1));
+    }
+    
+    mat W = sampleProjectedPosterior(nSamples) - psgp.Q * H.get_rows(activeIdx);
+    
+    // Combine the prior realisations with the low rank update, by blocks of grid nodes
+    int n = prod(gridSize);
+    int rows = gridSize(0);
+    mat samples(n, nSamples);
+    mat Xblock, kxb;
+    
+    for (int start = 0; start < n; start += SIMULATION_BLOCK_SIZE)
+    {
+        int end = std::min(start + SIMULATION_BLOCK_SIZE, n) - 1;
+        
+        Xblock.set_size(end - start + 1, d);
+        ivec extIdx(end - start + 1);
+        
+        for (int i = start; i <= end; i++)
+        {
+            int i0 = i % rows, i1 = i / rows;
+            
+            Xblock(i - start, 0) = origin(0) + i0 * spacing(0);
+            extIdx(i - start) = i0 - lo(0);
+            
+            if (d == 2) 
+            {
+                Xblock(i - start, 1) = origin(1) + i1 * spacing(1);
+                extIdx(i - start) += extRows * (i1 - lo(1));
+            }
+        }
+        
+        psgp.covFunc.covariance(kxb, Xblock, psgp.ActiveSet);
+        samples.set_submatrix(start, 0, kxb * W + H.get_rows(extIdx));
+    }
+    
+    return samples;
+}
+
+
+/**
+ * Locations of the nodes of a regular grid, in the order used by 
+ * simulateGrid (first dimension running fastest)
+ */
+mat PSGPSimulator::gridLocations(const vec& origin, const vec& spacing, const ivec& gridSize)
+{
+    int d = origin.length();
+    assert(d == 1 || d == 2);
+    
+    int n = prod(gridSize);
+    mat X(n, d);
+    
+    for (int i=0; i<n; i++)
+    {
+        X(i,0) = origin(0) + (i % gridSize(0)) * spacing(0);
+        if (d == 2) X(i,1) = origin(1) + (i / gridSize(0)) * spacing(1);
+    }
+    
+    return X;
+}
+
+
+/**
+ * Sample the coefficients alpha + w of the projected process, with
+ * w ~ N(0, Q + C)
+ */
+mat PSGPSimulator::sampleProjectedPosterior(int nSamples) const
+{
+    mat W = postFactor * randn(psgp.sizeActiveSet, nSamples);
+    
+    for (int j=0; j<nSamples; j++) W.set_col(j, W.get_col(j) + psgp.alpha);
+    
+    return W;
+}
+
+
+/**
+ * 2D FFT of a complex matrix (1D FFTs of the columns, then of the rows)
+ */
+static void fft2(cmat& A)
+{
+    if (A.rows() > 1)
+    {
+        for (int j=0; j<A.cols(); j++) A.set_col(j, fft(A.get_col(j)));
+    }
+    if (A.cols() > 1) 
+    {
+        for (int i=0; i<A.rows(); i++) A.set_row(i, fft(A.get_row(i)));
+    }
+}
+
+
+/**
+ * Size of the circulant embedding along a grid dimension of n nodes 
+ * (a power of 2, for the FFT)
+ */
+static int embeddingSize(int n, double padding)
+{
+    if (n == 1) return 1;
+    
+    int M = 2;
+    while (M < padding * 2 * (n - 1)) M *= 2;
+    return M;
+}
+
+
+/**
+ * Simulate realisations of the prior on a regular grid by circulant 
+ * embedding (Dietrich and Newsam, 1997). The covariance matrix of the grid 
+ * is embedded in a circulant matrix on a larger, periodic grid, which is 
+ * diagonalised by the FFT. Each FFT of complex white noise scaled by the 
+ * square root of the eigenvalues gives two independent realisations (real
+ * and imaginary parts).
+ */
+mat PSGPSimulator::samplePriorGrid(const vec& origin, const vec& spacing, const ivec& gridSize, int nSamples) const
+{
+    int d = origin.length();
+    int n0 = gridSize(0);
+    int n1 = (d == 2) ? gridSize(1) : 1;
+    int M0 = embeddingSize(n0, embeddingPadding);
+    int M1 = embeddingSize(n1, embeddingPadding);
+    
+    // First row of the circulant matrix: covariance at all (periodic) lags
+    mat lags(M0 * M1, d);
+    for (int j1=0; j1<M1; j1++)
+    {
+        for (int j0=0; j0<M0; j0++)
+        {
+            lags(j0 + M0*j1, 0) = ((j0 <= M0/2) ? j0 : j0 - M0) * spacing(0);
+            if (d == 2) lags(j0 + M0*j1, 1) = ((j1 <= M1/2) ? j1 : j1 - M1) * spacing(1);
+        }
+    }
+    
+    mat c;
+    psgp.covFunc.covariance(c, zeros(1, d), lags);
+    
+    cmat lambda(M0, M1);
+    for (int j1=0; j1<M1; j1++)
+    {
+        for (int j0=0; j0<M0; j0++) lambda(j0, j1) = c(0, j0 + M0*j1);
+    }
+    fft2(lambda);
+    
+    // Eigenvalues of the embedding - these should be non-negative
+    mat sqrtLambda(M0, M1);
+    double maxEig = 0.0, minEig = 0.0;
+    
+    for (int j1=0; j1<M1; j1++)
+    {
+        for (int j0=0; j0<M0; j0++)
+        {
+            double e = lambda(j0, j1).real();
+            maxEig = std::max(maxEig, e);
+            minEig = std::min(minEig, e);
+            sqrtLambda(j0, j1) = sqrt(std::max(e, 0.0) / double(M0 * M1));
+        }
+    }
+    
+    if (minEig < -1e-6 * maxEig)
+    {
+        cerr << "Warning: circulant embedding is not positive definite (eigenvalue " 
+             << minEig << "), increase the embedding padding." << endl;
+    }
+    
+    // Realisations, two at a time
+    mat samples(n0 * n1, nSamples);
+    cmat Z(M0, M1);
+    
+    for (int s = 0; s < nSamples; s += 2)
+    {
+        mat re = randn(M0, M1);
+        mat im = randn(M0, M1);
+        
+        for (int j1=0; j1<M1; j1++)
+        {
+            for (int j0=0; j0<M0; j0++) 
+            {
+                Z(j0, j1) = complex<double>(sqrtLambda(j0, j1) * re(j0, j1), sqrtLambda(j0, j1) * im(j0, j1));
+            }
+        }
+        fft2(Z);
+        
+        for (int i1=0; i1<n1; i1++)
+        {
+            for (int i0=0; i0<n0; i0++)
+            {
+                samples(i0 + n0*i1, s) = Z(i0, i1).real();
+                if (s + 1 < nSamples) samples(i0 + n0*i1, s + 1) = Z(i0, i1).imag();
+            }
+        }
+    }
+    
+    return samples;
+}
+
+
+/**
+ * Add the residual h(X) - k(X,B)*Q*h(B) to the realisations at the 
+ * locations Xpred(idx). Its covariance is K(X,X) - k(X,B)*Q*k(B,X).
+ */
+void PSGPSimulator::sampleResidual(mat& samples, const mat& Xpred, const ivec& idx, ResidualMethod residual) const
+{
+    int nSamples = samples.cols();
+    mat kxb, Kxx, R;
+    
+    if (residual == DiagonalResidual)
+    {
+        vec kxx;
+        
+        for (int start = 0; start < idx.length(); start += SIMULATION_BLOCK_SIZE)
+        {
+            int end = std::min(start + SIMULATION_BLOCK_SIZE, idx.length()) - 1;
+            mat Xblock = Xpred.get_rows(idx(start, end));
+            
+            psgp.covFunc.computeDiagonal(kxx, Xblock);
+            psgp.covFunc.covariance(kxb, Xblock, psgp.ActiveSet);
+            mat kq = kxb * psgp.Q;
+            
+            for (int i = start; i <= end; i++)
+            {
+                double var = kxx(i - start) - dot(kq.get_row(i - start), kxb.get_row(i - start));
+                double sd = sqrt(std::max(var, 0.0));
+                
+                for (int j=0; j<nSamples; j++) samples(idx(i), j) += sd * randn();
+            }
+        }
+        return;
+    }
+    
+    // Local residual: joint within blocks of neighbouring locations
+    vector<ivec> blocks;
+    partition(Xpred, idx, blocks);
+    
+    for (unsigned int b=0; b<blocks.size(); b++)
+    {
+        mat Xblock = Xpred.get_rows(blocks[b]);
+        int nb = Xblock.rows();
+        
+        psgp.covFunc.covariance(Kxx, Xblock);
+        psgp.covFunc.covariance(kxb, Xblock, psgp.ActiveSet);
+        Kxx -= kxb * psgp.Q * kxb.transpose();
+        
+        // The residual covariance is often close to singular (e.g. near
+        // active points), so add a small jitter if needed
+        double jitter = 1e-10 * std::max(trace(Kxx) / nb, 1e-300);
+        while (!chol(Kxx, R))
+        {
+            Kxx += jitter * eye(nb);
+            jitter *= 10.0;
+        }
+        
+        mat r = R.transpose() * randn(nb, nSamples);
+        for (int i=0; i<nb; i++)
+        {
+            for (int j=0; j<nSamples; j++) samples(blocks[b](i), j) += r(i,j);
+        }
+    }
+}
+
+
+/**
+ * Partition the locations Xpred(idx) into spatial blocks of at most 
+ * RESIDUAL_BLOCK_SIZE points, by recursively splitting at the median of 
+ * the coordinate with the widest range
+ */
+void PSGPSimulator::partition(const mat& Xpred, const ivec& idx, vector<ivec>& blocks) const
+{
+    if (idx.length() <= RESIDUAL_BLOCK_SIZE)
+    {
+        blocks.push_back(idx);
+        return;
+    }
+    
+    mat X = Xpred.get_rows(idx);
+    int widest = 0;
+    double widestRange = -1.0;
+    
+    for (int k=0; k<X.cols(); k++)
+    {
+        double range = max(X.get_col(k)) - min(X.get_col(k));
+        if (range > widestRange)
+        {
+            widestRange = range;
+            widest = k;
+        }
+    }
+    
+    ivec order = sort_index(X.get_col(widest));
+    int half = idx.length() / 2;
+    
+    partition(Xpred, idx(order(0, half - 1)), blocks);
+    partition(Xpred, idx(order(half, idx.length() - 1)), blocks);
+}
@@ -0,0 +1,100 @@
+/***************************************************************************
+ *   AstonGeostats, algorithms for low-rank geostatistical models          *
+ *                                                                         *
+ *   Copyright (C) Remi Barillec, Ben Ingram, 2008-2009                    *
+ *                                                                         *
+ *   Remi Barillec, r.barillec@aston.ac.uk
+ *   Ben Ingram, IngramBR@Aston.ac.uk                                      *
+ *   Neural Computing Research Group,                                      *
+ *   Aston University,                                                     *
+ *   Aston Street, Aston Triangle,                                         *
+ *   Birmingham. B4 7ET.                                                   *
+ *   United Kingdom                                                        *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#ifndef PSGPSIMULATOR_H_
+#define PSGPSIMULATOR_H_
+
+#include <itpp/itbase.h>
+
+#include "PSGP.h"
+
+#include <cassert>
+
+#define SIMULATION_BLOCK_SIZE 1000  // Number of locations per block of samples
+#define RESIDUAL_BLOCK_SIZE   500   // Maximum number of locations in a local residual block
+
+using namespace std;
+using namespace itpp;
+
+/**
+ * How the residual (the part of the prior not explained by the active 
+ * set) is simulated at scattered locations:
+ *   NoResidual       - ignore it (same as PSGP::simulate with approx=true)
+ *   DiagonalResidual - independent residuals with the exact variances
+ *   LocalResidual    - residuals sampled jointly within spatial blocks of 
+ *                      at most RESIDUAL_BLOCK_SIZE neighbouring locations
+ */
+enum ResidualMethod { NoResidual, DiagonalResidual, LocalResidual };
+
+/**
+ * Conditional simulation from a PSGP posterior. A realisation at locations
+ * X is written as
+ * 
+ *   f(X) = k(X,B) * (alpha + w - Q*h(B)) + h(X)
+ * 
+ * where B is the active set, w ~ N(0, Q + C) is the posterior of the 
+ * projected process and h is an independent realisation of the prior. 
+ * The factorisation of Q + C is computed once, when the simulator is 
+ * created (call update() if the posterior changes), and every call 
+ * returns a matrix of realisations (one per column).
+ * 
+ * On a regular grid, h is simulated exactly by circulant embedding (the 
+ * covariance function must be stationary). The grid is extended to 
+ * cover the active set, whose points are snapped to the nearest node. 
+ * At scattered locations, the residual h(X) - k(X,B)*Q*h(B) is simulated 
+ * according to the chosen ResidualMethod.
+ */
+class PSGPSimulator
+{
+public:
+    PSGPSimulator(const PSGP& psgp);
+    virtual ~PSGPSimulator();
+    
+    void update();
+    
+    mat simulate(const mat& Xpred, int nSamples, ResidualMethod residual=LocalResidual) const;
+    mat simulateGrid(const vec& origin, const vec& spacing, const ivec& gridSize, int nSamples) const;
+    mat samplePriorGrid(const vec& origin, const vec& spacing, const ivec& gridSize, int nSamples) const;
+    
+    static mat gridLocations(const vec& origin, const vec& spacing, const ivec& gridSize);
+    
+    void setEmbeddingPadding(double padding) { assert(padding >= 1.0); embeddingPadding = padding; }
+    
+private:
+    mat  sampleProjectedPosterior(int nSamples) const;
+    void sampleResidual(mat& samples, const mat& Xpred, const ivec& idx, ResidualMethod residual) const;
+    void partition(const mat& Xpred, const ivec& idx, vector<ivec>& blocks) const;
+    
+    const PSGP& psgp;
+    
+    mat    postFactor;          // Square root of Q + C
+    double embeddingPadding;    // Size of the embedding grid relative to the simulation grid
+};
+
+#endif /*PSGPSIMULATOR_H_*/
@@ -0,0 +1,251 @@
+#include "PSGPSnapshot.h"
+#include "itppext/atomics.h"
+
+#include <fstream>
+#include <cstdio>
+
+volatile int PSGPSnapshot::numberAlive = 0;
+
+/**
+ * Constructor - copies the prediction state of the PSGP, and freezes the
+ * current covariance parameters into kernel (which the snapshot owns)
+ */
+PSGPSnapshot::PSGPSnapshot(const PSGP& psgp, CovarianceFunction* kernel) 
+: ActiveSet(psgp.ActiveSet), alpha(psgp.alpha), C(psgp.C), kernel(kernel)
+{
+    assert(kernel != NULL);
+    assert(kernel->getNumberParameters() == psgp.covFunc.getNumberParameters());
+    
+    kernel->setTransformedParameters(psgp.getTransformedParameters());
+    
+    version = 0;
+    references = 0;
+    itppext::atomic_add(&numberAlive, 1);
+}
+
+
+/**
+ * Constructor for read - empty prediction state
+ */
+PSGPSnapshot::PSGPSnapshot(CovarianceFunction* kernel) : kernel(kernel)
+{
+    version = 0;
+    references = 0;
+    itppext::atomic_add(&numberAlive, 1);
+}
+
+
+/**
+ * Destructor
+ */
+PSGPSnapshot::~PSGPSnapshot()
+{
+    delete kernel;
+    itppext::atomic_add(&numberAlive, -1);
+}
+
+
+/**
+ * Predictive mean and variance at Xpred (as PSGP::makePredictions). The 
+ * prediction locations are processed in blocks of PREDICTION_BLOCK_SIZE, 
+ * so that the memory used for a large batch of requests is bounded.
+ */
+void PSGPSnapshot::makePredictions(vec& Mean, vec& Variance, const mat& Xpred) const
+{
+    int nPred = Xpred.rows();
+    
+    Mean.set_size(nPred);
+    Variance.set_size(nPred);
+    
+    mat ktest;
+    vec kstar;
+    for (int blockStart = 0; blockStart < nPred; blockStart += PREDICTION_BLOCK_SIZE)
+    {
+        int blockEnd = min(blockStart + PREDICTION_BLOCK_SIZE, nPred) - 1;
+        mat Xblock = Xpred.get_rows(blockStart, blockEnd);
+        
+        ktest.set_size(Xblock.rows(), ActiveSet.rows());
+        kernel->covariance(ktest, Xblock, ActiveSet);
+        Mean.set_subvector(blockStart, ktest*alpha);
+        
+        kstar.set_size(Xblock.rows());
+        kernel->computeDiagonal(kstar, Xblock);
+        Variance.set_subvector(blockStart, kstar + sum(elem_mult((ktest * C), ktest), 2));
+    }
+}
+
+
+/**
+ * Write the prediction state and covariance parameters to a file (IT++ 
+ * format). As for checkpoints, the data is written to a temporary file
+ * which then replaces filename, so that a server reading the file never
+ * sees a partial snapshot.
+ */
+bool PSGPSnapshot::write(const string filename) const
+{
+    string tmpFilename = filename + ".tmp";
+    
+    ofstream test(tmpFilename.c_str());
+    if (!test.good()) 
+    {
+        cerr << "Could not open file " << tmpFilename << " for writing." << endl;
+        return false;
+    }
+    test.close();
+    
+    it_file file;
+    file.open(tmpFilename, true);
+    file << Name("activeSet") << ActiveSet;
+    file << Name("alpha") << alpha;
+    file << Name("C") << C;
+    file << Name("parameters") << kernel->getTransformedParameters();
+    file.close();
+    
+    if (rename(tmpFilename.c_str(), filename.c_str()) != 0)
+    {
+        cerr << "Could not rename " << tmpFilename << " to " << filename << "." << endl;
+        return false;
+    }
+    
+    return true;
+}
+
+
+/**
+ * Read a snapshot from a file. kernel must have the same form as the 
+ * covariance function of the written snapshot: the stored parameters are
+ * copied into it and the new snapshot takes ownership of it. Returns NULL
+ * (and leaves kernel to the caller) if the file cannot be read or does 
+ * not match kernel.
+ */
+PSGPSnapshot* PSGPSnapshot::read(const string filename, CovarianceFunction* kernel)
+{
+    assert(kernel != NULL);
+    
+    ifstream test(filename.c_str());
+    if (!test.good())
+    {
+        cerr << "Could not open file " << filename << " for reading." << endl;
+        return NULL;
+    }
+    test.close();
+    
+    mat ActiveSet, C;
+    vec alpha, parameters;
+    
+    it_ifile file;
+    file.open(filename);
+    file >> Name("activeSet") >> ActiveSet;
+    file >> Name("alpha") >> alpha;
+    file >> Name("C") >> C;
+    file >> Name("parameters") >> parameters;
+    file.close();
+    
+    int m = ActiveSet.rows();
+    if (alpha.length() != m || C.rows() != m || C.cols() != m 
+        || parameters.length() != kernel->getNumberParameters())
+    {
+        cerr << "Snapshot in " << filename << " does not match the covariance function." << endl;
+        return NULL;
+    }
+    
+    kernel->setTransformedParameters(parameters);
+    
+    PSGPSnapshot* snapshot = new PSGPSnapshot(kernel);
+    snapshot->ActiveSet = ActiveSet;
+    snapshot->alpha = alpha;
+    snapshot->C = C;
+    
+    return snapshot;
+}
+
+
+/**
+ * Number of snapshots created and not yet deleted
+ */
+int PSGPSnapshot::getNumberAlive()
+{
+    return itppext::atomic_load(&numberAlive);
+}
+
+
+/**
+ * Constructor - no snapshot published yet
+ */
+PSGPSnapshotHolder::PSGPSnapshotHolder()
+{
+    current = NULL;
+    lastVersion = 0;
+    pthread_mutex_init(&mutex, NULL);
+}
+
+
+/**
+ * Destructor - releases the current snapshot (it is deleted once the 
+ * readers still using it release it)
+ */
+PSGPSnapshotHolder::~PSGPSnapshotHolder()
+{
+    if (current) release(current);
+    pthread_mutex_destroy(&mutex);
+}
+
+
+/**
+ * Make snapshot the current one, and return its version number. The 
+ * holder takes ownership of the snapshot. The previous snapshot is 
+ * deleted when no reader uses it anymore.
+ */
+int PSGPSnapshotHolder::publish(PSGPSnapshot* snapshot)
+{
+    assert(snapshot != NULL && snapshot->references == 0);
+    
+    snapshot->references = 1;   // Reference held by the holder
+    
+    pthread_mutex_lock(&mutex);
+    snapshot->version = ++lastVersion;
+    PSGPSnapshot* previous = current;
+    current = snapshot;
+    pthread_mutex_unlock(&mutex);
+    
+    if (previous) release(previous);
+    
+    return snapshot->version;
+}
+
+
+/**
+ * Current snapshot, with its reference count incremented (NULL if none has
+ * been published). Must be released after use.
+ */
+const PSGPSnapshot* PSGPSnapshotHolder::acquire() const
+{
+    pthread_mutex_lock(&mutex);
+    PSGPSnapshot* snapshot = current;
+    if (snapshot) itppext::atomic_add(&snapshot->references, 1);
+    pthread_mutex_unlock(&mutex);
+    
+    return snapshot;
+}
+
+
+/**
+ * Release a reference to a snapshot, deleting it if this was the last one
+ */
+void PSGPSnapshotHolder::release(const PSGPSnapshot* snapshot)
+{
+    if (itppext::atomic_add(&snapshot->references, -1) == 0) delete snapshot;
+}
+
+
+/**
+ * Version of the current snapshot (0 if none)
+ */
+int PSGPSnapshotHolder::getVersion() const
+{
+    pthread_mutex_lock(&mutex);
+    int version = current ? current->version : 0;
+    pthread_mutex_unlock(&mutex);
+    
+    return version;
+}
@@ -0,0 +1,161 @@
+/***************************************************************************
+ *   AstonGeostats, algorithms for low-rank geostatistical models          *
+ *                                                                         *
+ *   Copyright (C) Remi Barillec, Ben Ingram, 2008-2009                    *
+ *                                                                         *
+ *   Remi Barillec, r.barillec@aston.ac.uk
+ *   Ben Ingram, IngramBR@Aston.ac.uk                                      *
+ *   Neural Computing Research Group,                                      *
+ *   Aston University,                                                     *
+ *   Aston Street, Aston Triangle,                                         *
+ *   Birmingham. B4 7ET.                                                   *
+ *   United Kingdom                                                        *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#ifndef PSGPSNAPSHOT_H_
+#define PSGPSNAPSHOT_H_
+
+#include <itpp/itbase.h>
+
+#include "PSGP.h"
+#include "covariance_functions/CovarianceFunction.h"
+
+#include <string>
+#include <pthread.h>
+#include <cassert>
+
+using namespace std;
+using namespace itpp;
+
+/**
+ * Immutable copy of the prediction state of a PSGP (active set, alpha, C)
+ * together with a frozen covariance function, for use by prediction 
+ * threads while the PSGP itself is retrained.
+ * 
+ * The covariance function passed to the constructor must have the same 
+ * form as that of the PSGP. The snapshot takes ownership of it (it is 
+ * deleted with the snapshot) and copies the current PSGP parameters into
+ * it. It must not be modified afterwards. Only the cross-covariance and 
+ * diagonal are used for predictions, so several threads can predict 
+ * from the same snapshot.
+ * 
+ * Snapshots are reference counted, see PSGPSnapshotHolder. They can be 
+ * written to a file and read back (e.g. by a prediction server), in which
+ * case the covariance function form must again be supplied by the reader.
+ */
+class PSGPSnapshot
+{
+public:
+    PSGPSnapshot(const PSGP& psgp, CovarianceFunction* kernel);
+    virtual ~PSGPSnapshot();
+    
+    void makePredictions(vec& Mean, vec& Variance, const mat& Xpred) const;
+    
+    bool write(const string filename) const;
+    static PSGPSnapshot* read(const string filename, CovarianceFunction* kernel);
+    
+    int getVersion() const { return version; }
+    int getSizeActiveSet() const { return ActiveSet.rows(); }
+    int getInputDimensions() const { return ActiveSet.cols(); }
+    
+    static int getNumberAlive();   // Number of snapshots not yet reclaimed
+    
+private:
+    friend class PSGPSnapshotHolder;
+    
+    PSGPSnapshot(CovarianceFunction* kernel);
+    
+    // Not copyable
+    PSGPSnapshot(const PSGPSnapshot&);
+    PSGPSnapshot& operator=(const PSGPSnapshot&);
+    
+    mat ActiveSet;
+    vec alpha;
+    mat C;
+    CovarianceFunction* kernel;
+    
+    int version;                    // Set when published
+    mutable volatile int references;
+    
+    static volatile int numberAlive;
+};
+
+
+/**
+ * Versioned holder of the current PSGPSnapshot, for hot swaps of the 
+ * posterior in a prediction service. 
+ * 
+ * Readers acquire the current snapshot (which increments its reference 
+ * count) for a batch of predictions, and release it when done. A writer 
+ * publishes a new snapshot by swapping the current pointer. This is a 
+ * mutex and reference count scheme, not lock-free read-copy-update: the 
+ * mutex protects the pointer swap and the reference increment, so readers
+ * only wait for these, never for predictions or for the construction of a
+ * new snapshot. A replaced snapshot is deleted when its last reader 
+ * releases it.
+ * 
+ * Usage (reader):
+ *   SnapshotReader snapshot(holder);
+ *   snapshot->makePredictions(mean, var, X);
+ */
+class PSGPSnapshotHolder
+{
+public:
+    PSGPSnapshotHolder();
+    virtual ~PSGPSnapshotHolder();
+    
+    int publish(PSGPSnapshot* snapshot);
+    
+    const PSGPSnapshot* acquire() const;
+    static void release(const PSGPSnapshot* snapshot);
+    
+    int getVersion() const;
+    
+private:
+    PSGPSnapshotHolder(const PSGPSnapshotHolder&);
+    PSGPSnapshotHolder& operator=(const PSGPSnapshotHolder&);
+    
+    PSGPSnapshot* current;
+    int lastVersion;
+    
+    mutable pthread_mutex_t mutex;
+};
+
+
+/**
+ * Scoped reference to the current snapshot of a holder (released on 
+ * destruction)
+ */
+class SnapshotReader
+{
+public:
+    SnapshotReader(const PSGPSnapshotHolder& holder) : snapshot(holder.acquire()) {}
+    ~SnapshotReader() { if (snapshot) PSGPSnapshotHolder::release(snapshot); }
+    
+    bool valid() const { return snapshot != NULL; }
+    const PSGPSnapshot* operator->() const { assert(snapshot); return snapshot; }
+    const PSGPSnapshot& operator*() const { assert(snapshot); return *snapshot; }
+    
+private:
+    SnapshotReader(const SnapshotReader&);
+    SnapshotReader& operator=(const SnapshotReader&);
+    
+    const PSGPSnapshot* snapshot;
+};
+
+#endif /*PSGPSNAPSHOT_H_*/
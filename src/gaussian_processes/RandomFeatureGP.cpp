@@ -0,0 +1,270 @@
+#include "RandomFeatureGP.h"
+
+using namespace std;
+using namespace itpp;
+
+RandomFeatureGP::RandomFeatureGP(int Inputs, int Outputs, mat& Xdata, vec& ydata, StationaryCF& cf, 
+                                 int nFrequencies, double s2) 
+: ForwardModel(Inputs, Outputs), covFunc(cf), Locations(Xdata), Observations(ydata)
+{
+	assert(Locations.rows() == Observations.size());
+	assert(nFrequencies > 0);
+	assert(s2 > 0.0);
+
+	nFreq         = nFrequencies;
+	noiseVariance = s2;
+	chunkSize     = RANDOM_FEATURES_CHUNK_SIZE;
+
+	resampleFrequencies();
+}
+
+RandomFeatureGP::~RandomFeatureGP()
+{
+}
+
+void RandomFeatureGP::setChunkSize(int size)
+{
+	assert(size > 0);
+	chunkSize = size;
+}
+
+/**
+ * Draw a new set of frequencies from the spectral density of the 
+ * covariance function
+ */
+void RandomFeatureGP::resampleFrequencies()
+{
+	covFunc.sampleSpectralDensity(frequencies, nFreq, Locations.cols());
+	cachedParameters.set_size(0);
+}
+
+void RandomFeatureGP::setNoiseVariance(double s2)
+{
+	assert(s2 > 0.0);
+	noiseVariance = s2;
+	cachedParameters.set_size(0);
+}
+
+
+vec RandomFeatureGP::getTransformedParameters() const
+{
+	return concat(covFunc.getTransformedParameters(), log(noiseVariance));
+}
+
+void RandomFeatureGP::setTransformedParameters(const vec p)
+{
+	int nParams = covFunc.getNumberParameters();
+	assert(p.size() == nParams + 1);
+
+	covFunc.setTransformedParameters(p.left(nParams));
+	noiseVariance = exp(p(nParams));
+}
+
+double RandomFeatureGP::objective() const
+{
+	return loglikelihood();
+}
+
+/**
+ * Negative log marginal likelihood of the observations under the random
+ * feature model, -log N(y | 0, Phi Phi' + s2 I)
+ */
+double RandomFeatureGP::loglikelihood() const
+{
+	update();
+	return negLogLik;
+}
+
+
+/**
+ * Features of the inputs X (one row per input), together with the phases
+ * Theta = X W' / lengthScale. The cosine features are in the first F 
+ * columns and the sine features in the last F, so that each is a single 
+ * contiguous array, and both are computed in one loop the compiler can 
+ * vectorise.
+ */
+void RandomFeatureGP::features(mat& Phi, mat& Theta, const mat& X) const
+{
+	// Parameters of StationaryCF: length scale, then variance
+	double lengthScale = covFunc.getParameter(0);
+	double amplitude = sqrt(covFunc.getParameter(1) / nFreq);
+
+	Theta = X * frequencies.transpose() / lengthScale;
+	Phi.set_size(X.rows(), 2 * nFreq);
+
+	int size = X.rows() * nFreq;
+	const double* theta = Theta._data();
+	double* c = Phi._data();
+	double* s = c + size;
+
+#pragma omp simd
+	for (int i = 0; i < size; i++)
+	{
+		c[i] = amplitude * cos(theta[i]);
+		s[i] = amplitude * sin(theta[i]);
+	}
+}
+
+
+/**
+ * Solve the normal equations for the current parameters, unless they are
+ * already cached. With A = Phi'Phi + s2 I and b = Phi'y,
+ *   log|Phi Phi' + s2 I| = log|A| + (n - 2F) log(s2)
+ *   y' (Phi Phi' + s2 I)^-1 y = (y'y - b' A^-1 b) / s2
+ */
+void RandomFeatureGP::update() const
+{
+	vec params = getTransformedParameters();
+	if (cachedParameters.size() == params.size() && cachedParameters == params) return;
+
+	int n = Locations.rows();
+	int nFeatures = 2 * nFreq;
+	int nChunks = (n + chunkSize - 1) / chunkSize;
+
+	mat A(nFeatures, nFeatures);
+	vec b(nFeatures);
+	double yy = 0.0;
+	A.zeros();
+	b.zeros();
+
+#pragma omp parallel
+	{
+		mat localA(nFeatures, nFeatures);
+		vec localb(nFeatures);
+		double localyy = 0.0;
+		localA.zeros();
+		localb.zeros();
+
+		mat Phi, Theta;
+
+#pragma omp for schedule(dynamic)
+		for (int c = 0; c < nChunks; c++)
+		{
+			int i1 = c * chunkSize, i2 = min(i1 + chunkSize, n) - 1;
+			vec yc = Observations.mid(i1, i2 - i1 + 1);
+
+			features(Phi, Theta, Locations.get_rows(i1, i2));
+			localA += Phi.transpose() * Phi;
+			localb += Phi.transpose() * yc;
+			localyy += dot(yc, yc);
+		}
+
+#pragma omp critical
+		{
+			A += localA;
+			b += localb;
+			yy += localyy;
+		}
+	}
+
+	A += noiseVariance * eye(nFeatures);
+	mat U = chol(A);
+	mat invU = inv(U);
+	invA = invU * invU.transpose();
+	weights = invA * b;
+
+	double logDetA = 2.0 * sum(log(diag(U)));
+	negLogLik = 0.5 * ((yy - dot(b, weights)) / noiseVariance + logDetA 
+	                   + (n - nFeatures) * log(noiseVariance) + n * log(2 * pi));
+
+	cachedParameters = params;
+}
+
+
+/**
+ * Gradient of the objective. With C = Phi Phi' + s2 I and a = C^-1 y, 
+ *   dL = <(C^-1 - a a') Phi, dPhi> + tr(C^-1 - a a') ds2 / 2
+ * where (C^-1 - a a') Phi = Phi A^-1 - a weights'. The phases scale as 
+ * 1/lengthScale and the features as sqrt(variance).
+ */
+vec RandomFeatureGP::gradient() const
+{
+	update();
+
+	int n = Locations.rows();
+	int nFeatures = 2 * nFreq;
+	int nChunks = (n + chunkSize - 1) / chunkSize;
+
+	double gradLength = 0.0, gradVariance = 0.0, sumAlpha2 = 0.0;
+
+#pragma omp parallel
+	{
+		double localLength = 0.0, localVariance = 0.0, localAlpha2 = 0.0;
+		mat Phi, Theta;
+
+#pragma omp for schedule(dynamic)
+		for (int c = 0; c < nChunks; c++)
+		{
+			int i1 = c * chunkSize, i2 = min(i1 + chunkSize, n) - 1;
+			vec yc = Observations.mid(i1, i2 - i1 + 1);
+
+			features(Phi, Theta, Locations.get_rows(i1, i2));
+
+			vec alpha = (yc - Phi * weights) / noiseVariance;
+			mat M = Phi * invA - outer_product(alpha, weights);
+
+			localVariance += elem_mult_sum(M, Phi);
+			localAlpha2 += dot(alpha, alpha);
+
+			// d cos(theta) = sin(theta) theta / l, d sin(theta) = -cos(theta) theta / l
+			int size = Theta.rows() * nFreq;
+			const double* theta = Theta._data();
+			const double* pc = Phi._data();
+			const double* ps = pc + size;
+			const double* mc = M._data();
+			const double* ms = mc + size;
+			for (int i = 0; i < size; i++)
+			{
+				localLength += (mc[i] * ps[i] - ms[i] * pc[i]) * theta[i];
+			}
+		}
+
+#pragma omp critical
+		{
+			gradLength += localLength;
+			gradVariance += localVariance;
+			sumAlpha2 += localAlpha2;
+		}
+	}
+
+	double lengthScale = covFunc.getParameter(0);
+	double variance = covFunc.getParameter(1);
+
+	vec grads(covFunc.getNumberParameters() + 1);
+	grads(0) = gradLength / lengthScale * covFunc.getTransform(0)->gradientTransform(lengthScale);
+	grads(1) = gradVariance / (2.0 * variance) * covFunc.getTransform(1)->gradientTransform(variance);
+
+	// Noise variance (log-transformed)
+	double trace = (n - nFeatures) / noiseVariance + sum(diag(invA));
+	grads(2) = 0.5 * (trace - sumAlpha2) * noiseVariance;
+
+	return grads;
+}
+
+
+/**
+ * Predictive mean and variance of the latent function at Xpred
+ *   mu* = phi*' weights,   var* = s2 phi*' A^-1 phi*
+ */
+void RandomFeatureGP::makePredictions(vec& Mean, vec& Variance, const mat& Xpred) const
+{
+	assert(Mean.size() == Variance.size());
+	assert(Xpred.rows() == Mean.size());
+
+	update();
+
+	int nPred = Xpred.rows();
+	int nChunks = (nPred + chunkSize - 1) / chunkSize;
+
+#pragma omp parallel for schedule(dynamic)
+	for (int c = 0; c < nChunks; c++)
+	{
+		int i1 = c * chunkSize, i2 = min(i1 + chunkSize, nPred) - 1;
+		mat Phi, Theta;
+
+		features(Phi, Theta, Xpred.get_rows(i1, i2));
+
+		Mean.set_subvector(i1, Phi * weights);
+		Variance.set_subvector(i1, noiseVariance * sum(elem_mult(Phi * invA, Phi), 2));
+	}
+}
@@ -0,0 +1,111 @@
+/***************************************************************************
+ *   AstonGeostats, algorithms for low-rank geostatistical models          *
+ *                                                                         *
+ *   Copyright (C) Remi Barillec, Ben Ingram, 2008-2009                    *
+ *                                                                         *
+ *   Remi Barillec, r.barillec@aston.ac.uk
+ *   Ben Ingram, IngramBR@Aston.ac.uk                                      *
+ *   Neural Computing Research Group,                                      *
+ *   Aston University,                                                     *
+ *   Aston Street, Aston Triangle,                                         *
+ *   Birmingham. B4 7ET.                                                   *
+ *   United Kingdom                                                        *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#ifndef RANDOMFEATUREGP_H_
+#define RANDOMFEATUREGP_H_
+
+#include "ForwardModel.h"
+#include "optimisation/Optimisable.h"
+#include "covariance_functions/StationaryCF.h"
+
+#include "itpp/itbase.h"
+
+#include <cassert>
+
+using namespace itpp;
+
+#define RANDOM_FEATURES_CHUNK_SIZE 2000     // Observations per block of features
+
+/**
+ * Random Fourier feature approximation of a GP with a stationary 
+ * covariance function and Gaussian noise s2. With F frequencies w_k 
+ * sampled from the spectral density of the covariance function, the 
+ * features
+ *   phi(x) = sqrt(variance / F) [cos(w_k' x), sin(w_k' x)]_k
+ * give phi(x)' phi(x') ~ cov(x,x'), and the model is the Bayesian linear
+ * regression y = Phi a + e, a ~ N(0,I), e ~ N(0,s2 I). Fitting costs 
+ * O(n F^2): the 2F x 2F normal equations Phi'Phi + s2 I are accumulated over
+ * blocks of observations in parallel, and predictions are a product with
+ * the posterior mean of the weights.
+ * 
+ * The frequencies are sampled once for unit length scale and divided by 
+ * the current length scale, so the objective (negative log marginal 
+ * likelihood) is a smooth function of the parameters of the covariance 
+ * function, with analytic gradients, and can be optimised with a 
+ * ModelTrainer. The covariance function is shared, so the parameters can 
+ * then be used for e.g. a PSGP.
+ * 
+ * The transformed parameters are those of the covariance function, then 
+ * log(s2).
+ */
+class RandomFeatureGP : public ForwardModel, public Optimisable
+{
+public:
+	RandomFeatureGP(int Inputs, int Outputs, mat& Xdata, vec& ydata, StationaryCF& cf, 
+	                int nFrequencies, double noiseVariance);
+	virtual ~RandomFeatureGP();
+
+	void   makePredictions(vec& Mean, vec& Variance, const mat& Xpred) const;
+	double loglikelihood() const;
+
+	vec    getTransformedParameters() const;
+	void   setTransformedParameters(const vec p);
+
+	double objective() const;
+	vec    gradient() const;
+
+	void   setChunkSize(int size);
+	void   resampleFrequencies();
+
+	void   setNoiseVariance(double s2);
+	double getNoiseVariance() const { return noiseVariance; }
+	const vec& getWeights() const { update(); return weights; }
+
+private:
+
+	void   features(mat& Phi, mat& Theta, const mat& X) const;
+	void   update() const;
+
+	StationaryCF& covFunc;
+	mat& Locations;
+	vec& Observations;
+
+	int    nFreq;
+	mat    frequencies;           // Frequencies for unit length scale (one per row)
+	double noiseVariance;
+	int    chunkSize;
+
+	// Posterior for the current parameters (see update)
+	mutable vec    cachedParameters;
+	mutable mat    invA;          // A = Phi'Phi + s2 I
+	mutable vec    weights;       // Posterior mean of the weights, A^-1 Phi'y
+	mutable double negLogLik;
+};
+
+#endif /*RANDOMFEATUREGP_H_*/
@@ -0,0 +1,412 @@
+#include "SparseGaussianProcess.h"
+
+using namespace std;
+using namespace itpp;
+
+SparseGaussianProcess::SparseGaussianProcess(int Inputs, int Outputs, mat& Xdata, vec& ydata, CovarianceFunction& cf, 
+                                             const mat& Xinducing, double s2, SparseApproximation approx) 
+: ForwardModel(Inputs, Outputs), covFunc(cf), Locations(Xdata), Observations(ydata), Xu(Xinducing)
+{
+	assert(Locations.rows() == Observations.size());
+	assert(Xu.cols() == Locations.cols());
+	assert(s2 > 0.0);
+
+	noiseVariance    = s2;
+	approximation    = approx;
+	chunkSize        = SPARSE_GP_CHUNK_SIZE;
+	optimiseInducing = false;
+}
+
+SparseGaussianProcess::~SparseGaussianProcess()
+{
+}
+
+void SparseGaussianProcess::setChunkSize(int size)
+{
+	assert(size > 0);
+	chunkSize = size;
+}
+
+/**
+ * Whether the inducing inputs are part of the (transformed) parameters,
+ * and hence optimised by a ModelTrainer
+ */
+void SparseGaussianProcess::setOptimiseInducingInputs(bool optimise)
+{
+	optimiseInducing = optimise;
+	cachedParameters.set_size(0);
+}
+
+void SparseGaussianProcess::setApproximation(SparseApproximation approx)
+{
+	approximation = approx;
+	cachedParameters.set_size(0);
+}
+
+void SparseGaussianProcess::setInducingInputs(const mat& Xinducing)
+{
+	assert(Xinducing.cols() == Locations.cols());
+	Xu = Xinducing;
+	cachedParameters.set_size(0);
+}
+
+void SparseGaussianProcess::setNoiseVariance(double s2)
+{
+	assert(s2 > 0.0);
+	noiseVariance = s2;
+	cachedParameters.set_size(0);
+}
+
+
+vec SparseGaussianProcess::getTransformedParameters() const
+{
+	vec p = concat(covFunc.getTransformedParameters(), log(noiseVariance));
+
+	if (optimiseInducing)
+	{
+		vec u(Xu.rows() * Xu.cols());
+		for (int a = 0; a < Xu.rows(); a++)
+			for (int d = 0; d < Xu.cols(); d++) u(a * Xu.cols() + d) = Xu(a, d);
+		p = concat(p, u);
+	}
+
+	return p;
+}
+
+void SparseGaussianProcess::setTransformedParameters(const vec p)
+{
+	int nParams = covFunc.getNumberParameters();
+	assert(p.size() == nParams + 1 + (optimiseInducing ? Xu.rows() * Xu.cols() : 0));
+
+	covFunc.setTransformedParameters(p.left(nParams));
+	noiseVariance = exp(p(nParams));
+
+	if (optimiseInducing)
+	{
+		for (int a = 0; a < Xu.rows(); a++)
+			for (int d = 0; d < Xu.cols(); d++) Xu(a, d) = p(nParams + 1 + a * Xu.cols() + d);
+	}
+}
+
+double SparseGaussianProcess::objective() const
+{
+	return loglikelihood();
+}
+
+/**
+ * Negative log marginal likelihood (FITC) or its variational bound (VFE)
+ */
+double SparseGaussianProcess::loglikelihood() const
+{
+	update();
+	return negLogLik;
+}
+
+
+/**
+ * Statistics of the observations i1..i2:
+ *   Kuf = cov(Xu, X), V = L^-1 Kuf, kd = diag(Kff), and the noise Lambda,
+ *   which is s2 (VFE) or s2 + diag(Kff - Qff) (FITC).
+ */
+void SparseGaussianProcess::chunkStatistics(mat& Kuf, mat& V, vec& Lambda, vec& kd, int i1, int i2) const
+{
+	mat Xc = Locations.get_rows(i1, i2);
+
+	Kuf.set_size(Xu.rows(), Xc.rows());
+	covFunc.covariance(Kuf, Xu, Xc);
+	V = invL * Kuf;
+
+	kd.set_size(Xc.rows());
+	covFunc.computeDiagonal(kd, Xc);
+
+	Lambda.set_size(Xc.rows());
+	Lambda = noiseVariance;
+
+	if (approximation == SPARSE_APPROX_FITC)
+	{
+		vec q = sum(elem_mult(V, V));
+		for (int i = 0; i < Xc.rows(); i++) Lambda(i) += max(kd(i) - q(i), 0.0);
+	}
+}
+
+
+/**
+ * Compute the objective and the statistics of the posterior for the 
+ * current parameters, unless they are already cached. With 
+ * A = I + V Lambda^-1 V' (accumulated over chunks) and b = V Lambda^-1 y,
+ *   log|Qff + Lambda| = log|A| + sum(log(Lambda))
+ *   y' (Qff + Lambda)^-1 y = y' Lambda^-1 y - b' A^-1 b
+ */
+void SparseGaussianProcess::update() const
+{
+	vec params = getTransformedParameters();
+	if (cachedParameters.size() == params.size() && cachedParameters == params) return;
+
+	int n = Locations.rows();
+	int m = Xu.rows();
+	int nChunks = (n + chunkSize - 1) / chunkSize;
+
+	mat Kuu(m, m);
+	covFunc.covariance(Kuu, Xu);
+	Kuu += SPARSE_GP_JITTER * mean(diag(Kuu)) * eye(m);
+	invL = inv(chol(Kuu).transpose());
+
+	mat A(m, m);
+	vec b(m);
+	double sumLogLambda = 0.0, sumYY = 0.0, sumTrace = 0.0;
+	A.zeros();
+	b.zeros();
+
+#pragma omp parallel
+	{
+		mat localA(m, m);
+		vec localb(m);
+		double localLogLambda = 0.0, localYY = 0.0, localTrace = 0.0;
+		localA.zeros();
+		localb.zeros();
+
+		mat Kuf, V;
+		vec Lambda, kd;
+
+#pragma omp for schedule(dynamic)
+		for (int c = 0; c < nChunks; c++)
+		{
+			int i1 = c * chunkSize, i2 = min(i1 + chunkSize, n) - 1;
+			chunkStatistics(Kuf, V, Lambda, kd, i1, i2);
+
+			vec yc = Observations.mid(i1, i2 - i1 + 1);
+			mat VL = V;
+			for (int i = 0; i < VL.cols(); i++) VL.set_col(i, V.get_col(i) / Lambda(i));
+
+			localA += VL * V.transpose();
+			localb += VL * yc;
+			localLogLambda += sum(log(Lambda));
+			localYY += sum(elem_div(elem_mult(yc, yc), Lambda));
+			localTrace += sum(kd) - sumsum(elem_mult(V, V));
+		}
+
+#pragma omp critical
+		{
+			A += localA;
+			b += localb;
+			sumLogLambda += localLogLambda;
+			sumYY += localYY;
+			sumTrace += localTrace;
+		}
+	}
+
+	A += eye(m);
+	mat invU = inv(chol(A));
+	invA = invU * invU.transpose();
+	double logDetA = 2.0 * sum(log(diag(chol(A))));
+
+	vec Ab = invA * b;
+	beta = invL.transpose() * Ab;
+
+	negLogLik = 0.5 * (logDetA + sumLogLambda + sumYY - dot(b, Ab) + n * log(2 * pi));
+	if (approximation == SPARSE_APPROX_VFE) negLogLik += 0.5 * sumTrace / noiseVariance;
+
+	cachedParameters = params;
+}
+
+
+/**
+ * Derivative of cov(Xu(a), X) with respect to the d-th coordinate of the 
+ * inducing input a, by central differences
+ */
+void SparseGaussianProcess::inputGradient(mat& dK, int a, int d, const mat& X) const
+{
+	mat xplus = Xu.get_rows(a, a), xminus = xplus;
+	double h = 1e-6 * (1.0 + fabs(xplus(0, d)));
+	xplus(0, d) += h;
+	xminus(0, d) -= h;
+
+	mat Kplus(1, X.rows()), Kminus(1, X.rows());
+	covFunc.covariance(Kplus, xplus, X);
+	covFunc.covariance(Kminus, xminus, X);
+	dK = (Kplus - Kminus) / (2.0 * h);
+}
+
+
+/**
+ * Gradient of the objective. Writing C = Qff + Lambda, a = C^-1 y, 
+ * W = C^-1 - a a', R = Kuu^-1 Kuf and w the weight of diag(Kff - Qff) in 
+ * the objective (W_ii/2 for FITC, 1/(2 s2) for VFE), the derivative is
+ *   <Guf, dKuf> + <Guu, dKuu> + sum_i w_i dKff_ii + g_s2 ds2
+ * with
+ *   Guf  = R W - 2 R diag(w)
+ *   Guu  = -R W R' / 2 + R diag(w) R'
+ *   g_s2 = tr(W) / 2  (- tr(Kff - Qff) / (2 s2^2) for VFE)
+ * R W = Sigma^-1 Kuf Lambda^-1 - beta a' and R W R' = Kuu^-1 - Sigma^-1 - 
+ * beta beta', where Sigma = Kuu + Kuf Lambda^-1 Kfu. Guf is only formed 
+ * for one chunk at a time.
+ */
+vec SparseGaussianProcess::gradient() const
+{
+	update();
+
+	int n = Locations.rows();
+	int m = Xu.rows();
+	int dims = Xu.cols();
+	int nChunks = (n + chunkSize - 1) / chunkSize;
+	int nParams = covFunc.getNumberParameters();
+	bool fitc = (approximation == SPARSE_APPROX_FITC);
+
+	mat invKuu = invL.transpose() * invL;
+	mat invSigmaL = invL.transpose() * invA;            // Sigma^-1 Kuf = invSigmaL * V
+	mat invSigma = invSigmaL * invL;
+
+	vec grads(nParams);
+	mat RwR(m, m), gradXu(m, dims);
+	double trW = 0.0, sumTrace = 0.0;
+	grads.zeros();
+	RwR.zeros();
+	gradXu.zeros();
+
+#pragma omp parallel
+	{
+		vec localGrads(nParams);
+		mat localRwR(m, m), localXu(m, dims);
+		double localTrW = 0.0, localTrace = 0.0;
+		localGrads.zeros();
+		localRwR.zeros();
+		localXu.zeros();
+
+		mat Kuf, V, G, dK;
+		vec Lambda, kd;
+
+#pragma omp for schedule(dynamic)
+		for (int c = 0; c < nChunks; c++)
+		{
+			int i1 = c * chunkSize, i2 = min(i1 + chunkSize, n) - 1;
+			int nc = i2 - i1 + 1;
+			mat Xc = Locations.get_rows(i1, i2);
+			vec yc = Observations.mid(i1, nc);
+
+			chunkStatistics(Kuf, V, Lambda, kd, i1, i2);
+
+			mat R = invL.transpose() * V;                     // Kuu^-1 Kuf
+			mat SK = invSigmaL * V;                           // Sigma^-1 Kuf
+			vec ac = elem_div(yc - Kuf.transpose() * beta, Lambda);
+
+			vec w(nc);
+			mat Guf = -outer_product(beta, ac);
+			mat Rw = R;
+			for (int i = 0; i < nc; i++)
+			{
+				double Wii = 1.0 / Lambda(i) - dot(Kuf.get_col(i), SK.get_col(i)) / sqr(Lambda(i)) - sqr(ac(i));
+				w(i) = fitc ? 0.5 * Wii : 0.5 / noiseVariance;
+				localTrW += Wii;
+
+				Rw.set_col(i, R.get_col(i) * w(i));
+				Guf.set_col(i, Guf.get_col(i) + SK.get_col(i) / Lambda(i) - 2.0 * Rw.get_col(i));
+			}
+
+			localRwR += Rw * R.transpose();
+			localTrace += sum(kd) - sumsum(elem_mult(V, V));
+
+			for (int p = 0; p < nParams; p++)
+			{
+				covFunc.covarianceGradient(G, p, Xu, Xc);
+				localGrads(p) += elem_mult_sum(Guf, G);
+
+				for (int i = 0; i < nc; i++)
+				{
+					mat xi = Xc.get_rows(i, i);
+					covFunc.covarianceGradient(G, p, xi, xi);  // d Kff_ii
+					localGrads(p) += w(i) * G(0, 0);
+				}
+			}
+
+			if (optimiseInducing)
+			{
+				for (int a = 0; a < m; a++)
+				{
+					for (int d = 0; d < dims; d++)
+					{
+						inputGradient(dK, a, d, Xc);
+						localXu(a, d) += dot(Guf.get_row(a), dK.get_row(0));
+					}
+				}
+			}
+		}
+
+#pragma omp critical
+		{
+			grads += localGrads;
+			RwR += localRwR;
+			gradXu += localXu;
+			trW += localTrW;
+			sumTrace += localTrace;
+		}
+	}
+
+	mat Guu = -0.5 * (invKuu - invSigma - outer_product(beta, beta)) + RwR;
+
+	mat G;
+	for (int p = 0; p < nParams; p++)
+	{
+		covFunc.covarianceGradient(G, p, Xu);
+		grads(p) += elem_mult_sum(Guu, G);
+	}
+
+	// Noise variance (log-transformed)
+	double gradNoise = 0.5 * trW;
+	if (!fitc) gradNoise -= 0.5 * sumTrace / sqr(noiseVariance);
+	grads = concat(grads, gradNoise * noiseVariance);
+
+	// Inducing inputs: Kuu depends on Xu(a) through row and column a
+	if (optimiseInducing)
+	{
+		mat dK;
+		vec gu(m * dims);
+		for (int a = 0; a < m; a++)
+		{
+			for (int d = 0; d < dims; d++)
+			{
+				inputGradient(dK, a, d, Xu);
+				gu(a * dims + d) = gradXu(a, d) + 2.0 * dot(Guu.get_row(a), dK.get_row(0));
+			}
+		}
+		grads = concat(grads, gu);
+	}
+
+	return grads;
+}
+
+
+void SparseGaussianProcess::makePredictions(vec& Mean, vec& Variance, const mat& Xpred) const
+{
+	makePredictions(Mean, Variance, Xpred, covFunc);
+}
+
+/**
+ * Predictive mean and variance of the latent function at Xpred:
+ *   mu* = K*u beta,   var* = k** - k*u' (Kuu^-1 - Sigma^-1) ku*
+ */
+void SparseGaussianProcess::makePredictions(vec& Mean, vec& Variance, const mat& Xpred, CovarianceFunction &cf) const
+{
+	assert(Mean.size() == Variance.size());
+	assert(Xpred.rows() == Mean.size());
+
+	update();
+
+	int nPred = Xpred.rows();
+	int nChunks = (nPred + chunkSize - 1) / chunkSize;
+	mat Dm = invL.transpose() * (eye(Xu.rows()) - invA) * invL;     // Kuu^-1 - Sigma^-1
+
+#pragma omp parallel for schedule(dynamic)
+	for (int c = 0; c < nChunks; c++)
+	{
+		int i1 = c * chunkSize, i2 = min(i1 + chunkSize, nPred) - 1;
+		mat Xc = Xpred.get_rows(i1, i2);
+
+		mat Kus(Xu.rows(), Xc.rows());
+		vec kstar(Xc.rows());
+		cf.covariance(Kus, Xu, Xc);
+		cf.computeDiagonal(kstar, Xc);
+
+		Mean.set_subvector(i1, Kus.transpose() * beta);
+		Variance.set_subvector(i1, kstar - sum(elem_mult(Kus, Dm * Kus)));
+	}
+}
@@ -0,0 +1,123 @@
+/***************************************************************************
+ *   AstonGeostats, algorithms for low-rank geostatistical models          *
+ *                                                                         *
+ *   Copyright (C) Remi Barillec, Ben Ingram, 2008-2009                    *
+ *                                                                         *
+ *   Remi Barillec, r.barillec@aston.ac.uk
+ *   Ben Ingram, IngramBR@Aston.ac.uk                                      *
+ *   Neural Computing Research Group,                                      *
+ *   Aston University,                                                     *
+ *   Aston Street, Aston Triangle,                                         *
+ *   Birmingham. B4 7ET.                                                   *
+ *   United Kingdom                                                        *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#ifndef SPARSEGAUSSIANPROCESS_H_
+#define SPARSEGAUSSIANPROCESS_H_
+
+#include "ForwardModel.h"
+#include "optimisation/Optimisable.h"
+#include "covariance_functions/CovarianceFunction.h"
+
+#include "itpp/itbase.h"
+
+#include <cassert>
+
+using namespace itpp;
+
+#define SPARSE_GP_CHUNK_SIZE 1000   // Observations per chunk
+#define SPARSE_GP_JITTER     1e-8   // Added to the diagonal of Kuu (relative to its mean)
+
+enum SparseApproximation { SPARSE_APPROX_VFE, SPARSE_APPROX_FITC };
+
+/**
+ * Sparse GP regression with m inducing inputs Xu and Gaussian noise, 
+ * using all the observations (unlike the approximate evidence of PSGP, 
+ * which only uses the active set). With Qff = Kfu Kuu^-1 Kuf, the 
+ * objective is the collapsed negative log marginal likelihood
+ *   VFE:  -log N(y | 0, Qff + s2 I) + tr(Kff - Qff) / (2 s2)   (Titsias)
+ *   FITC: -log N(y | 0, Qff + diag(Kff - Qff) + s2 I)
+ * It is accumulated over chunks of observations in O(n m^2), so the n x m
+ * cross-covariance is never held whole, and the chunks are processed in 
+ * parallel (OpenMP). Gradients are analytic in the covariance parameters 
+ * and the noise variance s2. Optionally, the inducing inputs are also 
+ * optimised; as covariance functions have no derivatives with respect to
+ * their inputs, these use central differences of the covariance itself 
+ * inside the analytic gradient.
+ * 
+ * The covariance function is that of the noise-free process, the noise 
+ * being s2 (as for the likelihood model of PSGP). The inducing inputs can
+ * then be used as the active set of a PSGP, e.g.
+ *   GaussianLikelihood lik(sgp.getNoiseVariance());
+ *   psgp.computePosteriorFixedActiveSet(lik, sgp.getInducingInputs());
+ * 
+ * The transformed parameters are those of the covariance function, then
+ * log(s2), then (if optimised) the inducing inputs, row by row.
+ */
+class SparseGaussianProcess : public ForwardModel, public Optimisable
+{
+public:
+	SparseGaussianProcess(int Inputs, int Outputs, mat& Xdata, vec& ydata, CovarianceFunction& cf, 
+	                      const mat& Xinducing, double noiseVariance, 
+	                      SparseApproximation approx = SPARSE_APPROX_VFE);
+	virtual ~SparseGaussianProcess();
+
+	void   makePredictions(vec& Mean, vec& Variance, const mat& Xpred, CovarianceFunction &cf) const;
+	void   makePredictions(vec& Mean, vec& Variance, const mat& Xpred) const;
+	double loglikelihood() const;
+
+	vec    getTransformedParameters() const;
+	void   setTransformedParameters(const vec p);
+
+	double objective() const;
+	vec    gradient() const;
+
+	void   setChunkSize(int size);
+	void   setOptimiseInducingInputs(bool optimise);
+	void   setApproximation(SparseApproximation approx);
+
+	void   setInducingInputs(const mat& Xinducing);
+	const mat& getInducingInputs() const { return Xu; }
+	void   setNoiseVariance(double s2);
+	double getNoiseVariance() const { return noiseVariance; }
+
+private:
+
+	void   update() const;
+	void   chunkStatistics(mat& Kuf, mat& V, vec& Lambda, vec& kd, int i1, int i2) const;
+	void   inputGradient(mat& dK, int a, int d, const mat& X) const;
+
+	CovarianceFunction& covFunc;
+	mat& Locations;
+	vec& Observations;
+
+	mat    Xu;                    // Inducing inputs
+	double noiseVariance;
+	SparseApproximation approximation;
+	int    chunkSize;
+	bool   optimiseInducing;
+
+	// Statistics for the current parameters (see update)
+	mutable vec    cachedParameters;
+	mutable mat    invL;          // Kuu = L L'
+	mutable mat    invA;          // A = I + V Lambda^-1 V',  V = L^-1 Kuf
+	mutable vec    beta;          // (Kuu + Kuf Lambda^-1 Kfu)^-1 Kuf Lambda^-1 y
+	mutable double negLogLik;
+};
+
+#endif /*SPARSEGAUSSIANPROCESS_H_*/
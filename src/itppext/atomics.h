@@ -0,0 +1,82 @@
+#ifndef ITPPEXT_ATOMICS_H_
+#define ITPPEXT_ATOMICS_H_
+
+/**
+* Atomic operations on integer counters and flags shared between threads
+* (reference counts, try-locks on caches). The library does not require
+* C++11, so std::atomic is not available: with GCC-compatible compilers
+* (GCC, Clang, Intel) these are the __sync builtins, which are full memory
+* barriers, otherwise every operation is done under a single mutex.
+*/
+#if !defined(__GNUC__)
+#include <pthread.h>
+#endif
+
+namespace itppext
+{
+
+#if !defined(__GNUC__)
+inline pthread_mutex_t* atomic_mutex()
+{
+    static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+    return &mutex;
+}
+#endif
+
+/**
+* Add delta to x and return the new value
+*/
+inline int atomic_add(volatile int* x, int delta)
+{
+#if defined(__GNUC__)
+    return __sync_add_and_fetch(x, delta);
+#else
+    pthread_mutex_lock(atomic_mutex());
+    int value = (*x += delta);
+    pthread_mutex_unlock(atomic_mutex());
+    return value;
+#endif
+}
+
+/**
+* Current value of x (with a full memory barrier)
+*/
+inline int atomic_load(volatile int* x)
+{
+    return atomic_add(x, 0);
+}
+
+/**
+* Set flag from 0 to 1 if it is 0. Returns true if it was set, i.e. if the
+* caller now holds the resource guarded by the flag.
+*/
+inline bool atomic_try_acquire(volatile int* flag)
+{
+#if defined(__GNUC__)
+    return __sync_bool_compare_and_swap(flag, 0, 1);
+#else
+    pthread_mutex_lock(atomic_mutex());
+    bool acquired = (*flag == 0);
+    if (acquired) *flag = 1;
+    pthread_mutex_unlock(atomic_mutex());
+    return acquired;
+#endif
+}
+
+/**
+* Reset a flag set by atomic_try_acquire
+*/
+inline void atomic_release(volatile int* flag)
+{
+#if defined(__GNUC__)
+    __sync_lock_release(flag);
+#else
+    pthread_mutex_lock(atomic_mutex());
+    *flag = 0;
+    pthread_mutex_unlock(atomic_mutex());
+#endif
+}
+
+} // END OF NAMESPACE ITPPEXT
+
+#endif /*ITPPEXT_ATOMICS_H_*/
@@ -0,0 +1,223 @@
+#include "TestCrossValidation.h"
+
+#define N_OBS    60
+#define N_FOLDS  5
+#define N_ACTIVE 20
+#define NUGGET   0.01
+
+namespace
+{
+  void makeData(mat &X, vec &Y)
+  {
+    RNG_reset(0);
+    X = 10.0 * randu(N_OBS, 2);
+    Y.set_size(N_OBS);
+    for (int i=0; i<N_OBS; i++) Y(i) = sin(X(i,0)) * cos(0.5*X(i,1)) + sqrt(NUGGET)*randn();
+  }
+  
+  /**
+   * Indices of the observations that are not in fold k
+   */
+  ivec otherFolds(const ivec &folds, int k)
+  {
+    return find(folds != k);
+  }
+  
+  /**
+   * GP predictions at the observations of fold k, refitted without them
+   */
+  void refitGP(vec &mean, vec &var, const mat &X, const vec &Y, const ivec &folds, int k, 
+               CovarianceFunction &cf)
+  {
+    ivec idx = find(folds == k);
+    ivec rest = otherFolds(folds, k);
+    mat Xtrain = X.get_rows(rest);
+    vec Ytrain = Y(rest);
+    
+    GaussianProcess gp(2, 1, Xtrain, Ytrain, cf);
+    mean.set_size(idx.length());
+    var.set_size(idx.length());
+    gp.makePredictions(mean, var, X.get_rows(idx));
+  }
+  
+  /**
+   * PSGP predictions at the observations of fold k, refitted without them 
+   * for the given active set
+   */
+  void refitPSGP(vec &mean, vec &var, const mat &X, const vec &Y, const ivec &folds, int k, 
+                 GaussianCF &cf, const mat &activeSet)
+  {
+    ivec idx = find(folds == k);
+    ivec rest = otherFolds(folds, k);
+    mat Xtrain = X.get_rows(rest);
+    vec Ytrain = Y(rest);
+    
+    GaussianLikelihood lik(NUGGET);
+    PSGP psgp(Xtrain, Ytrain, cf, activeSet.rows());
+    psgp.setVerbose(false);
+    psgp.computePosteriorFixedActiveSet(lik, activeSet);
+    
+    mean.set_size(idx.length());
+    var.set_size(idx.length());
+    psgp.makePredictions(mean, var, X.get_rows(idx));
+  }
+  
+  /**
+   * Largest differences between the closed form and refitted predictions
+   */
+  bool compare(const vec &mean, const vec &var, const vec &meanRefit, const vec &varRefit)
+  {
+    double meanError = max(abs(mean - meanRefit));
+    double varError = max(abs(var - varRefit));
+    cout << "(mean " << meanError << ", variance " << varError << ") ";
+    return meanError < 1e-6 && varError < 1e-6;
+  }
+  
+  /**
+   * Refitted predictions for all folds
+   */
+  void refitAllGP(vec &mean, vec &var, const mat &X, const vec &Y, const ivec &folds, 
+                  CovarianceFunction &cf)
+  {
+    mean.set_size(N_OBS);
+    var.set_size(N_OBS);
+    for (int k=0; k<=max(folds); k++)
+    {
+      vec m, v;
+      refitGP(m, v, X, Y, folds, k, cf);
+      ivec idx = find(folds == k);
+      for (int i=0; i<idx.length(); i++) { mean(idx(i)) = m(i); var(idx(i)) = v(i); }
+    }
+  }
+  
+  void refitAllPSGP(vec &mean, vec &var, const mat &X, const vec &Y, const ivec &folds, 
+                    GaussianCF &cf, const mat &activeSet)
+  {
+    mean.set_size(N_OBS);
+    var.set_size(N_OBS);
+    for (int k=0; k<=max(folds); k++)
+    {
+      vec m, v;
+      refitPSGP(m, v, X, Y, folds, k, cf, activeSet);
+      ivec idx = find(folds == k);
+      for (int i=0; i<idx.length(); i++) { mean(idx(i)) = m(i); var(idx(i)) = v(i); }
+    }
+  }
+  
+  /**
+   * PSGP on all observations, with its active set
+   */
+  PSGP *fitPSGP(mat &X, vec &Y, GaussianCF &cf)
+  {
+    GaussianLikelihood lik(NUGGET);
+    PSGP *psgp = new PSGP(X, Y, cf, N_ACTIVE, 1, 1);
+    psgp->setVerbose(false);
+    psgp->computePosterior(lik);
+    
+    // Recompute with the active set fixed, as in the refits
+    mat activeSet = psgp->getActiveSetLocations();
+    psgp->computePosteriorFixedActiveSet(lik, activeSet);
+    return psgp;
+  }
+}
+
+TestCrossValidation::TestCrossValidation() 
+{
+  header = "Test set for cross-validation predictions";
+  addTest(&testGPLeaveOneOut, "GP leave-one-out against refits");
+  addTest(&testGPKFold, "GP k-fold against refits");
+  addTest(&testPSGPLeaveOneOut, "PSGP leave-one-out against refits");
+  addTest(&testPSGPKFold, "PSGP k-fold against refits");
+}
+
+TestCrossValidation::~TestCrossValidation() {}
+
+bool TestCrossValidation::testGPLeaveOneOut()
+{
+  mat X;
+  vec Y;
+  makeData(X, Y);
+  
+  GaussianCF gauss(1.5, 1.0);
+  WhiteNoiseCF noise(NUGGET);
+  SumCF cf(gauss);
+  cf.add(noise);
+  
+  GaussianProcess gp(2, 1, X, Y, cf);
+  vec mean, var, meanRefit, varRefit;
+  gp.leaveOneOut(mean, var);
+  
+  ivec folds = to_ivec(linspace(0, N_OBS-1, N_OBS));
+  refitAllGP(meanRefit, varRefit, X, Y, folds, cf);
+  
+  return compare(mean, var, meanRefit, varRefit);
+}
+
+bool TestCrossValidation::testGPKFold()
+{
+  mat X;
+  vec Y;
+  makeData(X, Y);
+  
+  GaussianCF gauss(1.5, 1.0);
+  WhiteNoiseCF noise(NUGGET);
+  SumCF cf(gauss);
+  cf.add(noise);
+  
+  GaussianProcess gp(2, 1, X, Y, cf);
+  ivec folds = crossValidationFolds(N_OBS, N_FOLDS);
+  vec mean, var, meanRefit, varRefit;
+  gp.crossValidation(mean, var, folds);
+  
+  refitAllGP(meanRefit, varRefit, X, Y, folds, cf);
+  
+  return compare(mean, var, meanRefit, varRefit);
+}
+
+bool TestCrossValidation::testPSGPLeaveOneOut()
+{
+  mat X;
+  vec Y;
+  makeData(X, Y);
+  
+  GaussianCF cf(1.5, 1.0);
+  PSGP *psgp = fitPSGP(X, Y, cf);
+  mat activeSet = psgp->getActiveSetLocations();
+  
+  vec mean, var, meanRefit, varRefit;
+  psgp->leaveOneOut(mean, var);
+  delete psgp;
+  
+  ivec folds = to_ivec(linspace(0, N_OBS-1, N_OBS));
+  refitAllPSGP(meanRefit, varRefit, X, Y, folds, cf, activeSet);
+  
+  return compare(mean, var, meanRefit, varRefit);
+}
+
+bool TestCrossValidation::testPSGPKFold()
+{
+  mat X;
+  vec Y;
+  makeData(X, Y);
+  
+  GaussianCF cf(1.5, 1.0);
+  PSGP *psgp = fitPSGP(X, Y, cf);
+  mat activeSet = psgp->getActiveSetLocations();
+  
+  ivec folds = crossValidationFolds(N_OBS, N_FOLDS);
+  vec mean, var, meanRefit, varRefit;
+  psgp->crossValidation(mean, var, folds);
+  delete psgp;
+  
+  refitAllPSGP(meanRefit, varRefit, X, Y, folds, cf, activeSet);
+  
+  return compare(mean, var, meanRefit, varRefit);
+}
+
+/**
+ * Run the tests
+ */
+int main() {
+  TestCrossValidation test;
+  test.run();
+}
@@ -0,0 +1,41 @@
+#ifndef TESTCROSSVALIDATION_H_
+#define TESTCROSSVALIDATION_H_
+
+#include "Test.h"
+#include "gaussian_processes/GaussianProcess.h"
+#include "gaussian_processes/PSGP.h"
+#include "gaussian_processes/CrossValidation.h"
+#include "covariance_functions/GaussianCF.h"
+#include "covariance_functions/WhiteNoiseCF.h"
+#include "covariance_functions/SumCF.h"
+#include "likelihood_models/GaussianLikelihood.h"
+
+using namespace std;
+using namespace itpp;
+
+class TestCrossValidation : public Test
+{
+public:
+  TestCrossValidation();
+  virtual ~TestCrossValidation();
+  
+  /**
+   * Test that the closed form leave-one-out predictions of a GP match 
+   * explicit refits without each observation
+   */
+  static bool testGPLeaveOneOut();
+  
+  /**
+   * Test that the closed form k-fold predictions of a GP match explicit 
+   * refits without each fold
+   */
+  static bool testGPKFold();
+  
+  /**
+   * Same tests for PSGP, against refits for the same (fixed) active set
+   */
+  static bool testPSGPLeaveOneOut();
+  static bool testPSGPKFold();
+};
+
+#endif /*TESTCROSSVALIDATION_H_*/
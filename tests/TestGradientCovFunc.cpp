@@ -5,12 +5,22 @@ TestGradientCovFunc::TestGradientCovFunc()
   header = "Test set for gradient of covariance functions";
   addTest(&testGradientGaussianCF, "Gradient of Gaussian covariance function");
   addTest(&testGradientWhiteNoiseCF, "Gradient of Gaussian White Noise covariance function");
+  addTest(&testWhiteNoiseDuplicates, "White noise covariance with duplicate inputs");
   addTest(&testGradientConstantCF, "Gradient of Constant covariance functions");
   addTest(&testGradientMatern3CF, "Gradient of Matern 3/2 covariance function");
   addTest(&testGradientMatern5CF, "Gradient of Matern 5/2 covariance function");
   addTest(&testGradientSumCF, "Gradient of Sum of covariance functions");
+  addTest(&testGradientProductCF, "Gradient of Product of covariance functions");
+  addTest(&testGradientInputSelectCF, "Gradient of covariance functions on input subsets");
+  addTest(&testFusedProductCF, "Fused product of covariance functions over several tiles");
   addTest(&testGradientNeuralNetCF, "Gradient of neural network covariance function");
   addTest(&testGradientExponentialCF, "Gradient of isotropic exponential covariance function");
+  addTest(&testGradientGaussianARDCF, "Gradient of ARD Gaussian covariance function");
+  addTest(&testGradientExponentialARDCF, "Gradient of ARD exponential covariance function");
+  addTest(&testGradientMatern3ARDCF, "Gradient of ARD Matern 3/2 covariance function");
+  addTest(&testGradientMatern5ARDCF, "Gradient of ARD Matern 5/2 covariance function");
+  addTest(&testConcurrentCachedCovariance, "Concurrent covariance calls with cached intermediates");
+  addTest(&testDefaultCrossGradient, "Default (tiled) gradient of the cross-covariance");
 }
 
 TestGradientCovFunc::~TestGradientCovFunc() {}
@@ -47,6 +57,29 @@ bool TestGradientCovFunc::testGradientWhiteNoiseCF()
   return matGradCheck(cf);
 }
 
+/**
+ * Test that cov(X,X) and cov(X,X2) with X2 = X agree for white noise when
+ * some inputs are duplicated (the noise is shared by identical inputs)
+ */
+bool TestGradientCovFunc::testWhiteNoiseDuplicates()
+{
+  WhiteNoiseCF cf(4.1);
+  
+  mat X = randn(20, 2);
+  X.set_row(7, X.get_row(3));
+  X.set_row(15, X.get_row(3));
+  X.set_row(11, X.get_row(0));
+  
+  mat C, Ccross(20, 20), G, Gcross;
+  cf.covariance(C, X);
+  cf.covariance(Ccross, X, X);
+  cf.covarianceGradient(G, 0, X);
+  cf.covarianceGradient(Gcross, 0, X, X);
+  
+  return C(3,15) == 4.1 && C(11,0) == 4.1 && C(3,4) == 0.0
+      && max(max(abs(C - Ccross))) == 0.0 && max(max(abs(G - Gcross))) < 1e-12;
+}
+
 /**
  * Test gradient of sum of 2 covariance functions
  */ 
@@ -63,6 +96,90 @@ bool TestGradientCovFunc::testGradientSumCF() {
 	return matGradCheck(cf);
 }
 
+/**
+ * Test gradient of product of 2 covariance functions
+ */ 
+bool TestGradientCovFunc::testGradientProductCF() {
+	double lengthScale = 2.1;
+	double variance    = 3.3;
+	
+	GaussianCF 		cf1(variance, lengthScale);
+	Matern3CF 		cf2(1.4, 0.8);
+	ConstantCF		cf3(0.5);
+
+	ProductCF *cf = new ProductCF(cf1);
+	cf->add(cf2);
+	cf->add(cf3);
+
+	return matGradCheck(cf);
+}
+
+/**
+ * Test gradient of a product of covariance functions, each acting on
+ * a single input dimension
+ */ 
+bool TestGradientCovFunc::testGradientInputSelectCF() {
+	GaussianCF 		cf1(3.3, 2.1);
+	Matern5CF 		cf2(1.4, 0.8);
+
+	InputSelectCF	cfx(cf1, "0");
+	InputSelectCF	cfy(cf2, "1");
+	
+	ProductCF *cf = new ProductCF(cfx);
+	cf->add(cfy);
+
+	return matGradCheck(cf);
+}
+
+/**
+ * Test the fused (tiled) evaluation of a product of covariance functions 
+ * on input subsets against the element-wise product of the covariance 
+ * matrices of each function, for inputs spanning several tiles
+ */
+bool TestGradientCovFunc::testFusedProductCF() {
+	GaussianCF 		cf1(3.3, 2.1);
+	Matern5CF 		cf2(1.4, 0.8);
+	ConstantCF		cf3(0.5);
+
+	InputSelectCF	cfx(cf1, "0");
+	InputSelectCF	cfy(cf2, "1");
+
+	ProductCF cf(cfx);
+	cf.add(cfy);
+	cf.add(cf3);
+
+	mat X = 10.0*randn(2*PRODUCT_CF_TILE_SIZE + 7, 2);
+	mat X2 = 10.0*randn(PRODUCT_CF_TILE_SIZE + 3, 2);
+	mat Xx = X.get_cols(0, 0), Xy = X.get_cols(1, 1), X2x = X2.get_cols(0, 0), X2y = X2.get_cols(1, 1);
+
+	// Reference: element-wise products of full matrices
+	int n = X.rows();
+	mat K1(n, n), K2(n, n), K3(n, n), C;
+	cf1.covariance(K1, Xx);
+	cf2.covariance(K2, Xy);
+	cf3.covariance(K3, X);
+	cf.covariance(C, X);
+	double err = max(max(abs(C - elem_mult(elem_mult(K1, K2), K3))));
+	bool symmetric = (max(max(abs(C - C.transpose()))) == 0.0);
+
+	mat Kx1(n, X2.rows()), Kx2(n, X2.rows()), Kx3(n, X2.rows()), Cx;
+	cf1.covariance(Kx1, Xx, X2x);
+	cf2.covariance(Kx2, Xy, X2y);
+	cf3.covariance(Kx3, X, X2);
+	cf.covariance(Cx, X, X2);
+	err = max(err, max(max(abs(Cx - elem_mult(elem_mult(Kx1, Kx2), Kx3)))));
+
+	// Gradient with respect to the length scale of cf2 (parameter 2)
+	mat G, G2(n, n);
+	cf.covarianceGradient(G, 2, X);
+	cf2.covarianceGradient(G2, 0, Xy);
+	err = max(err, max(max(abs(G - elem_mult(elem_mult(K1, G2), K3)))));
+
+	printf("\n  Max error %g\n  ", err);
+
+	return symmetric && err < 1e-12;
+}
+
 /**
  * Test gradient of Matern 3/2 covariance function
  */
@@ -113,6 +230,46 @@ bool TestGradientCovFunc::testGradientExponentialCF()
     return matGradCheck(cf);
 }
 
+/**
+ * Test gradient of ARD Gaussian covariance function
+ */
+bool TestGradientCovFunc::testGradientGaussianARDCF()
+{
+    vec ls = "2.1 7.3";
+    GaussianARDCF *cf = new GaussianARDCF(ls, 3.7);
+    return matGradCheck(cf);
+}
+
+/**
+ * Test gradient of ARD exponential covariance function
+ */
+bool TestGradientCovFunc::testGradientExponentialARDCF()
+{
+    vec ls = "2.1 7.3";
+    ExponentialARDCF *cf = new ExponentialARDCF(ls, 3.7);
+    return matGradCheck(cf);
+}
+
+/**
+ * Test gradient of ARD Matern 3/2 covariance function
+ */
+bool TestGradientCovFunc::testGradientMatern3ARDCF()
+{
+    vec ls = "2.1 7.3";
+    Matern3ARDCF *cf = new Matern3ARDCF(ls, 3.7);
+    return matGradCheck(cf);
+}
+
+/**
+ * Test gradient of ARD Matern 5/2 covariance function
+ */
+bool TestGradientCovFunc::testGradientMatern5ARDCF()
+{
+    vec ls = "2.1 7.3";
+    Matern5ARDCF *cf = new Matern5ARDCF(ls, 3.7);
+    return matGradCheck(cf);
+}
+
 
 
 /**
@@ -132,20 +289,33 @@ bool TestGradientCovFunc::matGradCheck(CovarianceFunction *cf)
 {
   vec params = cf->getTransformedParameters();
   mat X = 10.0*randn(10,2);
-  mat gradK(X.rows(),X.rows()), gradKfd(X.rows(),X.rows());
+  mat gradK(X.rows(),X.rows()), gradKfd(X.rows(),X.rows()), gradKsd(X.rows(),X.rows());
+  
+  // Cross gradients between the two halves of X should match the
+  // corresponding off-diagonal block of the full gradient
+  int n1 = X.rows()/2;
+  mat X1 = X.get_rows(0, n1-1), X2 = X.get_rows(n1, X.rows()-1);
+  mat gradKx(X1.rows(), X2.rows());
   double max_errmean = 0.0, max_errvar = 0.0, max_errmax = 0.0;
   double tolerance = 1e-3;
   
+  // Gradients computed from precomputed squared distances should 
+  // match the standard ones
+  DistanceCache distances;
+  const mat& D = distances.sqDistMatrix(X);
+  
   // For each paramter, compute the partial derivative matrix
   // using gradient and finite difference. Compute the error 
   // between the two and print out the mean and variance of 
   // this error.
   printf("\n  MATRIX GRADCHECK: Error between gradient and finite difference\n");
-  printf("\n  Param   Mean       Var        Max       Parameter name\n");
+  printf("\n  Param   Mean       Var        Max        SqDist     Cross     Parameter name\n");
   for (int i=0; i<params.size(); i++) 
   {
     cf->covarianceGradient(gradK, i, X);
     gradKfd = gradFiniteDifferences(cf,X,i);
+    cf->covarianceGradientFromSqDist(gradKsd, i, X, D);
+    cf->covarianceGradient(gradKx, i, X1, X2);
         
     // cout << "grad analytic = " << endl << gradK << endl;
     // cout << "grad fin.diff. = " << endl << gradKfd << endl;
@@ -154,13 +324,17 @@ bool TestGradientCovFunc::matGradCheck(CovarianceFunction *cf)
     double errmean = mean(err);
     double errvar  = sum(sum(pow(err-errmean,2)))/(err.cols()*err.rows()-1);
     double errmax  = max(max(err));
+    double errsd   = max(max(abs(gradK - gradKsd)));
+    double errx    = max(max(abs(gradK.get(0, n1-1, n1, X.rows()-1) - gradKx)));
    
     // Update current max value for mean, var and max
     if (errmean > max_errmean) max_errmean = errmean;
     if (errvar  > max_errvar)  max_errvar  = errvar;
     if (errmax  > max_errmax)  max_errmax  = errmax;
+    if (errsd   > max_errmax)  max_errmax  = errsd;
+    if (errx    > max_errmax)  max_errmax  = errx;
     
-    printf("  %3d: %10.5f %10.5f %10.5f   %s\n", i, errmean, errvar, errmax,
+    printf("  %3d: %10.5f %10.5f %10.5f %10.5f %10.5f   %s\n", i, errmean, errvar, errmax, errsd, errx,
                                                (cf->getParameterName(i)).c_str());
   }
                     
@@ -169,6 +343,102 @@ bool TestGradientCovFunc::matGradCheck(CovarianceFunction *cf)
 } 
 
 
+namespace
+{
+  /**
+   * Gaussian covariance function which only provides the symmetric 
+   * gradient, so that the default cross-covariance gradient is used
+   */
+  class SymmetricGradientCF : public CovarianceFunction
+  {
+  public:
+    SymmetricGradientCF(CovarianceFunction& cf) : CovarianceFunction("Symmetric gradient only", 0), cf(cf) 
+    {
+      numberParameters = cf.getNumberParameters();
+    }
+    
+    double computeElement(const vec& A, const vec& B) const { return cf.computeElement(A, B); }
+    
+    using CovarianceFunction::covarianceGradient;
+    void covarianceGradient(mat& G, const int p, const mat& X) const { cf.covarianceGradient(G, p, X); }
+    
+  private:
+    CovarianceFunction& cf;
+  };
+  
+  /**
+   * Work for one thread: symmetric covariance and gradients of a shared
+   * covariance function, for the thread's own set of inputs
+   */
+  struct CovarianceWork
+  {
+    CovarianceFunction *cf;
+    mat X;
+    vector<mat> results;
+  };
+}
+
+/**
+ * Thread computing the covariance and all gradient matrices repeatedly
+ */
+void *TestGradientCovFunc::covarianceWorker(void *arg)
+{
+  CovarianceWork *work = (CovarianceWork *) arg;
+  int nParams = work->cf->getNumberParameters();
+  work->results.resize(nParams + 1);
+  
+  for (int it=0; it<200; it++)
+  {
+    work->cf->covariance(work->results[0], work->X);
+    for (int p=0; p<nParams; p++) work->cf->covarianceGradient(work->results[p+1], p, work->X);
+  }
+  return NULL;
+}
+
+/**
+ * Several threads share each covariance function, with different inputs,
+ * and their results are compared with those of a single thread
+ */
+bool TestGradientCovFunc::testConcurrentCachedCovariance()
+{
+  GaussianARDCF ard(vec("1.2 0.7"), 2.0);
+  NeuralNetCF nn(1.1, 3.7, 0.1);
+  CovarianceFunction *cfs[2] = { &ard, &nn };
+  
+  int nThreads = 4;
+  bool passed = true;
+  
+  for (int c=0; c<2; c++)
+  {
+    vector<CovarianceWork> work(nThreads);
+    vector<pthread_t> threads(nThreads);
+    
+    for (int t=0; t<nThreads; t++)
+    {
+      work[t].cf = cfs[c];
+      work[t].X = randn(40, 2);
+      pthread_create(&threads[t], NULL, &covarianceWorker, &work[t]);
+    }
+    for (int t=0; t<nThreads; t++) pthread_join(threads[t], NULL);
+    
+    for (int t=0; t<nThreads; t++)
+    {
+      mat C;
+      cfs[c]->covariance(C, work[t].X);
+      passed = passed && max(max(abs(C - work[t].results[0]))) < 1e-12;
+      
+      for (int p=0; p<cfs[c]->getNumberParameters(); p++)
+      {
+        cfs[c]->covarianceGradient(C, p, work[t].X);
+        passed = passed && max(max(abs(C - work[t].results[p+1]))) < 1e-12;
+      }
+    }
+  }
+  
+  return passed;
+}
+
+
 /**
  * Computes the finite difference gradient of the specified covariance function
  * with repect to parameter i. The covariance function is evaluated at point X, 
@@ -192,6 +462,32 @@ mat TestGradientCovFunc::gradFiniteDifferences(CovarianceFunction *cf, mat X, in
 }
 
 
+/**
+ * Test the default gradient of the cross-covariance (computed by tiles of
+ * stacked inputs) against the direct computation, over several tiles
+ */
+bool TestGradientCovFunc::testDefaultCrossGradient()
+{
+  GaussianCF cf(2.1, 3.3);
+  SymmetricGradientCF wrapper(cf);
+  
+  mat X1 = 10.0*randn(2*CROSS_GRADIENT_TILE_SIZE + 5, 2);
+  mat X2 = 10.0*randn(CROSS_GRADIENT_TILE_SIZE + 3, 2);
+  
+  double maxError = 0.0;
+  for (int p=0; p<cf.getNumberParameters(); p++)
+  {
+    mat G, Gdefault;
+    cf.covarianceGradient(G, p, X1, X2);
+    wrapper.covarianceGradient(Gdefault, p, X1, X2);
+    
+    if (Gdefault.rows() != G.rows() || Gdefault.cols() != G.cols()) return false;
+    maxError = max(maxError, max(max(abs(G - Gdefault))));
+  }
+  
+  return maxError < 1e-12;
+}
+
 /**
  * Run the tests
  */
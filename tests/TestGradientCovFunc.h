@@ -10,6 +10,15 @@
 #include "covariance_functions/ConstantCF.h"
 #include "covariance_functions/Matern5CF.h"
 #include "covariance_functions/NeuralNetCF.h"
+#include "covariance_functions/ProductCF.h"
+#include "covariance_functions/InputSelectCF.h"
+#include "covariance_functions/GaussianARDCF.h"
+#include "covariance_functions/ExponentialARDCF.h"
+#include "covariance_functions/Matern3ARDCF.h"
+#include "covariance_functions/Matern5ARDCF.h"
+#include "covariance_functions/DistanceCache.h"
+
+#include <pthread.h>
 
 
 using namespace std;
@@ -25,6 +34,12 @@ public:
    * Test gradient of Gaussian covariance function
    */
   static bool testGradientWhiteNoiseCF();
+
+  /**
+   * Test that the symmetric and cross covariance of white noise agree 
+   * when some inputs are duplicated
+   */
+  static bool testWhiteNoiseDuplicates();
   
   /**
    * Test gradient of WhiteNoise covariance function
@@ -41,6 +56,21 @@ public:
    */ 
   static bool testGradientSumCF();
 
+  /**
+   * Test gradient of product of 2 covariance functions
+   */
+  static bool testGradientProductCF();
+
+  /**
+   * Test gradient of covariance functions acting on a subset of the inputs
+   */
+  static bool testGradientInputSelectCF();
+
+  /**
+   * Test the fused evaluation of products over several tiles of inputs
+   */
+  static bool testFusedProductCF();
+
   /**
    * Test gradient of Matern3 covariance function
    */
@@ -60,11 +90,33 @@ public:
     * Test gradient of anisotropic exponential covariance function
     */
    static bool testGradientExponentialCF();
+
+  /**
+   * Test gradient of ARD (one length scale per dimension) covariance functions
+   */
+  static bool testGradientGaussianARDCF();
+  static bool testGradientExponentialARDCF();
+  static bool testGradientMatern3ARDCF();
+  static bool testGradientMatern5ARDCF();
+
+  /**
+   * Test that symmetric covariance and gradient calls on a shared ARD or
+   * neural network covariance function (which cache intermediate results)
+   * give the same results when made from several threads at once
+   */
+  static bool testConcurrentCachedCovariance();
+
+  /**
+   * Test the default gradient of the cross-covariance, used by covariance
+   * functions which do not provide their own
+   */
+  static bool testDefaultCrossGradient();
   
   /**
    * Computes the error between analytic gradient matrix and finite differences
    * estimate. For each parameter of the covariance function, the mean and variance 
-   * of the error (between the elements of the two gradient matrices) are displayed.
+   * of the error (between the elements of the two gradient matrices) are displayed,
+   * together with the max error of the gradient computed from squared distances.
    * Returns true if mean, var and max below fixed tolerance (1e-3)
    */
   static bool matGradCheck(CovarianceFunction *cf);
@@ -76,6 +128,8 @@ private:
    * Pass in a covariance function and its parameters
    */
   static mat gradFiniteDifferences(CovarianceFunction *cf, mat X, int paramIndex);
+
+  static void *covarianceWorker(void *arg);
   
 };
 
@@ -0,0 +1,105 @@
+#include "TestIterativeGaussianProcess.h"
+
+#define N_OBS   100
+#define N_PRED  50
+#define NUGGET  0.05
+
+namespace
+{
+  void makeData(mat &X, vec &Y)
+  {
+    RNG_reset(0);
+    X = 5.0 * randu(N_OBS, 2);
+    Y.set_size(N_OBS);
+    for (int i=0; i<N_OBS; i++) Y(i) = sin(X(i,0)) * cos(X(i,1)) + sqrt(NUGGET)*randn();
+  }
+}
+
+TestIterativeGaussianProcess::TestIterativeGaussianProcess() 
+{
+  header = "Test set for iterative GP regression";
+  addTest(&testLikelihoodMatchesExact, "Likelihood and predictions against the exact GP");
+  addTest(&testGradient, "Gradient of the likelihood against finite differences");
+}
+
+TestIterativeGaussianProcess::~TestIterativeGaussianProcess() {}
+
+bool TestIterativeGaussianProcess::testLikelihoodMatchesExact()
+{
+  mat X;
+  vec Y;
+  makeData(X, Y);
+  
+  GaussianCF   kernel(1.2, 1.0);
+  WhiteNoiseCF nugget(NUGGET);
+  SumCF        cf(kernel);
+  cf.add(nugget);
+  
+  GaussianProcess gp(2, 1, X, Y, cf);
+  IterativeGaussianProcess igp(2, 1, X, Y, cf);
+  igp.setPreconditionerRank(N_OBS);
+  igp.setTolerance(1e-10);
+  
+  mat Xpred = 5.0 * randu(N_PRED, 2);
+  vec mean1(N_PRED), var1(N_PRED), mean2(N_PRED), var2(N_PRED);
+  gp.makePredictions(mean1, var1, Xpred);
+  igp.makePredictions(mean2, var2, Xpred);
+  
+  double errLik = abs(gp.objective() - igp.objective());
+  
+  cout << endl << "  likelihood error " << errLik << ", mean error " << max(abs(mean1 - mean2)) 
+       << ", variance error " << max(abs(var1 - var2)) << endl << "  ";
+  
+  return errLik < 1e-4 && max(abs(mean1 - mean2)) < 1e-6 && max(abs(var1 - var2)) < 1e-6;
+}
+
+bool TestIterativeGaussianProcess::testGradient()
+{
+  mat X;
+  vec Y;
+  makeData(X, Y);
+  
+  GaussianCF   kernel(1.2, 1.0);
+  WhiteNoiseCF nugget(NUGGET);
+  SumCF        cf(kernel);
+  cf.add(nugget);
+  
+  IterativeGaussianProcess igp(2, 1, X, Y, cf);
+  igp.setPreconditionerRank(N_OBS);
+  igp.setTolerance(1e-10);
+  igp.setNumberProbes(500);
+  
+  vec params = igp.getTransformedParameters();
+  vec grad = igp.gradient();
+  double h = 1e-5, maxError = 0.0;
+  
+  printf("\n  Param   Analytic   Fin.diff.  Rel.error  Parameter name\n");
+  for (int i=0; i<params.size(); i++)
+  {
+    vec p = params;
+    p(i) = params(i) + h;
+    igp.setTransformedParameters(p);
+    double f1 = igp.objective();
+    p(i) = params(i) - h;
+    igp.setTransformedParameters(p);
+    double f2 = igp.objective();
+    
+    double fd = (f1 - f2) / (2.0 * h);
+    double err = abs(grad(i) - fd) / (1.0 + abs(fd));
+    if (err > maxError) maxError = err;
+    
+    printf("  %3d: %10.5f %10.5f %10.5f   %s\n", i, grad(i), fd, err, (cf.getParameterName(i)).c_str());
+  }
+  igp.setTransformedParameters(params);
+  cout << "  ";
+  
+  return maxError < 0.05;
+}
+
+/**
+ * Run the tests
+ */
+int main() {
+  TestIterativeGaussianProcess test;
+  test.run();
+}
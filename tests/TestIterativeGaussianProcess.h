@@ -0,0 +1,35 @@
+#ifndef TESTITERATIVEGAUSSIANPROCESS_H_
+#define TESTITERATIVEGAUSSIANPROCESS_H_
+
+#include "Test.h"
+#include "gaussian_processes/GaussianProcess.h"
+#include "gaussian_processes/IterativeGaussianProcess.h"
+#include "covariance_functions/GaussianCF.h"
+#include "covariance_functions/WhiteNoiseCF.h"
+#include "covariance_functions/SumCF.h"
+
+using namespace std;
+using namespace itpp;
+
+class TestIterativeGaussianProcess : public Test
+{
+public:
+  TestIterativeGaussianProcess();
+  virtual ~TestIterativeGaussianProcess();
+  
+  /**
+   * Test that the likelihood and predictions match those of the exact GP
+   * (with a preconditioner of full rank, the log-determinant estimate is
+   * exact up to the CG tolerance)
+   */
+  static bool testLikelihoodMatchesExact();
+  
+  /**
+   * Test the gradient of the likelihood against finite differences of the 
+   * objective. The traces of the gradient are stochastic estimates, so the
+   * tolerance is relative to the gradient.
+   */
+  static bool testGradient();
+};
+
+#endif /*TESTITERATIVEGAUSSIANPROCESS_H_*/
@@ -0,0 +1,120 @@
+#include "TestKISSGP.h"
+
+#define N_OBS   100
+#define N_PRED  50
+#define NUGGET  0.05
+
+namespace
+{
+  void makeData(mat &X, vec &Y)
+  {
+    RNG_reset(0);
+    X = 5.0 * randu(N_OBS, 2);
+    Y.set_size(N_OBS);
+    for (int i=0; i<N_OBS; i++) Y(i) = sin(X(i,0)) * cos(X(i,1)) + sqrt(NUGGET)*randn();
+  }
+  
+  /**
+   * Locations of the nodes of the grid of a KISSGP, in the order of 
+   * multiplyGridCovariance
+   */
+  mat gridLocations(const KISSGP &kiss)
+  {
+    ivec size = kiss.getGridSize();
+    vec origin = kiss.getGridOrigin(), spacing = kiss.getGridSpacing();
+    
+    mat U(size(0) * size(1), 2);
+    for (int i1=0; i1<size(1); i1++)
+    {
+      for (int i0=0; i0<size(0); i0++)
+      {
+        U(i0 + size(0)*i1, 0) = origin(0) + i0 * spacing(0);
+        U(i0 + size(0)*i1, 1) = origin(1) + i1 * spacing(1);
+      }
+    }
+    return U;
+  }
+  
+  /**
+   * Maximum relative difference between the FFT and dense products
+   */
+  double gridProductError(StationaryCF &cf, mat &X, vec &Y, int size0, int size1)
+  {
+    KISSGP kiss(2, 1, X, Y, cf, NUGGET, size0, size1);
+    
+    mat U = gridLocations(kiss);
+    mat K(U.rows(), U.rows());
+    cf.covariance(K, U);
+    
+    mat V = randn(U.rows(), 3);
+    mat KV;
+    kiss.multiplyGridCovariance(KV, V);
+    
+    mat dense = K * V;
+    return max(max(abs(KV - dense))) / max(max(abs(dense)));
+  }
+}
+
+TestKISSGP::TestKISSGP() 
+{
+  header = "Test set for KISS-GP regression";
+  addTest(&testGridProducts, "FFT products with the grid covariance against dense products");
+  addTest(&testPredictionsMatchExact, "Predictions against the exact GP");
+}
+
+TestKISSGP::~TestKISSGP() {}
+
+bool TestKISSGP::testGridProducts()
+{
+  mat X;
+  vec Y;
+  makeData(X, Y);
+  
+  GaussianCF gaussian(1.2, 1.0);
+  Matern5CF  matern5(1.0, 0.8);
+  
+  double err1 = gridProductError(gaussian, X, Y, 20, 13);
+  double err2 = gridProductError(matern5, X, Y, 7, 32);
+  double err3 = gridProductError(matern5, X, Y, 33, 4);
+  
+  cout << "(relative errors " << err1 << ", " << err2 << ", " << err3 << ") ";
+  
+  return err1 < 1e-12 && err2 < 1e-12 && err3 < 1e-12;
+}
+
+bool TestKISSGP::testPredictionsMatchExact()
+{
+  mat X;
+  vec Y;
+  makeData(X, Y);
+  
+  GaussianCF   kernel(1.2, 1.0);
+  WhiteNoiseCF nugget(NUGGET);
+  SumCF        cf(kernel);
+  cf.add(nugget);
+  
+  GaussianProcess gp(2, 1, X, Y, cf);
+  KISSGP kiss(2, 1, X, Y, kernel, NUGGET, 80, 80);
+  kiss.setLanczosIterations(N_OBS);
+  kiss.setTolerance(1e-10);
+  
+  // Prediction locations inside the bounding box of the observations
+  mat Xpred = 0.5 + 4.0 * randu(N_PRED, 2);
+  vec mean1(N_PRED), var1(N_PRED), mean2(N_PRED), var2(N_PRED);
+  gp.makePredictions(mean1, var1, Xpred, kernel);
+  kiss.makePredictions(mean2, var2, Xpred);
+  
+  cout << endl << "  mean error " << max(abs(mean1 - mean2)) << ", variance error " 
+       << max(abs(var1 - var2)) << " (" << kiss.getNumberIterations() << " CG iterations)" << endl << "  ";
+  
+  // The remaining error is that of the cubic interpolation on the grid
+  return max(abs(mean1 - mean2)) < 1e-4 && max(abs(var1 - var2)) < 1e-4;
+}
+
+/**
+ * Run the tests
+ */
+int main() {
+  TestKISSGP test;
+  test.run();
+}
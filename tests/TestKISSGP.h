@@ -0,0 +1,36 @@
+#ifndef TESTKISSGP_H_
+#define TESTKISSGP_H_
+
+#include "Test.h"
+#include "gaussian_processes/GaussianProcess.h"
+#include "gaussian_processes/KISSGP.h"
+#include "covariance_functions/GaussianCF.h"
+#include "covariance_functions/Matern5CF.h"
+#include "covariance_functions/WhiteNoiseCF.h"
+#include "covariance_functions/SumCF.h"
+
+using namespace std;
+using namespace itpp;
+
+class TestKISSGP : public Test
+{
+public:
+  TestKISSGP();
+  virtual ~TestKISSGP();
+  
+  /**
+   * Test that the products with the covariance of the grid computed by 
+   * FFT (circulant embedding) match the products with the dense matrix,
+   * for grids of different sizes along each axis and an odd number of 
+   * columns
+   */
+  static bool testGridProducts();
+  
+  /**
+   * Test that the predictions on a small problem (fine grid, as many 
+   * Lanczos iterations as observations) match those of the exact GP
+   */
+  static bool testPredictionsMatchExact();
+};
+
+#endif /*TESTKISSGP_H_*/
@@ -0,0 +1,179 @@
+#include "TestNNGP.h"
+
+#define N_OBS   150
+#define N_PRED  50
+#define NUGGET  0.05
+
+namespace
+{
+  void makeData(mat &X, vec &Y)
+  {
+    RNG_reset(0);
+    X = 5.0 * randu(N_OBS, 2);
+    Y.set_size(N_OBS);
+    for (int i=0; i<N_OBS; i++) Y(i) = sin(X(i,0)) * cos(X(i,1)) + sqrt(NUGGET)*randn();
+  }
+  
+  /**
+   * Sorted squared distances from x to its k nearest points of X by brute 
+   * force, with the same options as KDTree::nearest
+   */
+  vec bruteForceDistances(const mat &X, const vec &x, int k, int before, bool excludeIdentical)
+  {
+    if (before < 0) before = X.rows();
+    
+    vector<double> d;
+    for (int i=0; i<before; i++)
+    {
+      double di = sum_sqr(X.get_row(i) - x);
+      if (excludeIdentical && di == 0.0) continue;
+      d.push_back(di);
+    }
+    sort(d.begin(), d.end());
+    
+    int m = std::min(k, (int) d.size());
+    vec out(m);
+    for (int i=0; i<m; i++) out(i) = d[i];
+    return out;
+  }
+}
+
+TestNNGP::TestNNGP() 
+{
+  header = "Test set for nearest neighbour GP regression";
+  addTest(&testNearestNeighbours, "k-d tree against brute force neighbours");
+  addTest(&testAllNeighboursMatchesExact, "Likelihood and predictions with all neighbours against the exact GP");
+  addTest(&testGradient, "Gradient of the likelihood against finite differences");
+}
+
+TestNNGP::~TestNNGP() {}
+
+bool TestNNGP::testNearestNeighbours()
+{
+  RNG_reset(1);
+  int n = 2000, d = 3;
+  mat X = randu(n, d);
+  for (int i=0; i<n; i+=10) X.set_row(i + 1, X.get_row(i));    // Duplicated points
+  
+  KDTree tree(X);
+  int ks[3] = { 1, 7, 40 };
+  int nQueries = 0, nErrors = 0;
+  
+  for (int q=0; q<200; q++)
+  {
+    // Half of the queries are data points, so that identical points matter
+    vec x = (q % 2 == 0) ? vec(randu(d)) : X.get_row(randi(0, n - 1));
+    int before = (q % 3 == 0) ? -1 : randi(0, n);
+    bool excludeIdentical = (q % 4 < 2);
+    
+    for (int j=0; j<3; j++)
+    {
+      ivec idx;
+      tree.nearest(idx, x, ks[j], before, excludeIdentical);
+      vec expected = bruteForceDistances(X, x, ks[j], before, excludeIdentical);
+      
+      bool ok = (idx.length() == expected.length());
+      for (int i=0; ok && i<idx.length(); i++)
+      {
+        ok = (before < 0 || idx(i) < before) && sum_sqr(X.get_row(idx(i)) - x) == expected(i);
+        for (int l=0; ok && l<i; l++) ok = (idx(l) != idx(i));
+      }
+      
+      nQueries++;
+      if (!ok) nErrors++;
+    }
+  }
+  
+  cout << "(" << nErrors << " errors in " << nQueries << " queries) ";
+  
+  return nErrors == 0;
+}
+
+bool TestNNGP::testAllNeighboursMatchesExact()
+{
+  mat X;
+  vec Y;
+  makeData(X, Y);
+  
+  GaussianCF   kernel(1.2, 1.0);
+  WhiteNoiseCF nugget(NUGGET);
+  SumCF        cf(kernel);
+  cf.add(nugget);
+  
+  GaussianProcess gp(2, 1, X, Y, cf);
+  
+  mat Xpred = 5.0 * randu(N_PRED, 2);
+  vec mean1(N_PRED), var1(N_PRED), mean2(N_PRED), var2(N_PRED);
+  gp.makePredictions(mean1, var1, Xpred, kernel);
+  
+  NNGPOrdering orderings[3] = { NNGP_ORDER_COORDINATE, NNGP_ORDER_RANDOM, NNGP_ORDER_DATA };
+  bool ok = true;
+  
+  cout << endl;
+  for (int o=0; o<3; o++)
+  {
+    // All preceding observations as neighbours: the likelihood is exact
+    NNGP nngp(2, 1, X, Y, cf, N_OBS - 1, orderings[o]);
+    double errLik = fabs(gp.loglikelihood() - nngp.loglikelihood());
+    
+    // All observations as neighbours: the predictions are exact
+    nngp.setNumberNeighbours(N_OBS);
+    nngp.makePredictions(mean2, var2, Xpred, kernel);
+    
+    cout << "  ordering " << o << ": likelihood error " << errLik << ", mean error " 
+         << max(abs(mean1 - mean2)) << ", variance error " << max(abs(var1 - var2)) << endl;
+    
+    ok = ok && errLik < 1e-8 && max(abs(mean1 - mean2)) < 1e-8 && max(abs(var1 - var2)) < 1e-8;
+  }
+  cout << "  ";
+  
+  return ok;
+}
+
+bool TestNNGP::testGradient()
+{
+  mat X;
+  vec Y;
+  makeData(X, Y);
+  
+  GaussianCF   kernel(1.2, 1.0);
+  WhiteNoiseCF nugget(NUGGET);
+  SumCF        cf(kernel);
+  cf.add(nugget);
+  
+  NNGP nngp(2, 1, X, Y, cf, 10);
+  
+  vec params = nngp.getTransformedParameters();
+  vec grad = nngp.gradient();
+  double h = 1e-6, maxError = 0.0;
+  
+  printf("\n  Param   Analytic   Fin.diff.  Rel.error  Parameter name\n");
+  for (int i=0; i<params.size(); i++)
+  {
+    vec p = params;
+    p(i) = params(i) + h;
+    nngp.setTransformedParameters(p);
+    double f1 = nngp.objective();
+    p(i) = params(i) - h;
+    nngp.setTransformedParameters(p);
+    double f2 = nngp.objective();
+    
+    double fd = (f1 - f2) / (2.0 * h);
+    double err = abs(grad(i) - fd) / (1.0 + abs(fd));
+    if (err > maxError) maxError = err;
+    
+    printf("  %3d: %10.5f %10.5f %10.5f   %s\n", i, grad(i), fd, err, (cf.getParameterName(i)).c_str());
+  }
+  nngp.setTransformedParameters(params);
+  cout << "  ";
+  
+  return maxError < 1e-4;
+}
+
+/**
+ * Run the tests
+ */
+int main() {
+  TestNNGP test;
+  test.run();
+}
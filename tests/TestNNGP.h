@@ -0,0 +1,43 @@
+#ifndef TESTNNGP_H_
+#define TESTNNGP_H_
+
+#include "Test.h"
+#include "gaussian_processes/GaussianProcess.h"
+#include "gaussian_processes/NNGP.h"
+#include "gaussian_processes/KDTree.h"
+#include "covariance_functions/GaussianCF.h"
+#include "covariance_functions/WhiteNoiseCF.h"
+#include "covariance_functions/SumCF.h"
+
+#include <algorithm>
+
+using namespace std;
+using namespace itpp;
+
+class TestNNGP : public Test
+{
+public:
+  TestNNGP();
+  virtual ~TestNNGP();
+  
+  /**
+   * Test that the k-d tree finds the same nearest neighbours as a brute
+   * force search, with and without a bound on the point indices and the
+   * exclusion of identical points (the data has duplicated points)
+   */
+  static bool testNearestNeighbours();
+  
+  /**
+   * Test that with k >= n - 1 neighbours (all preceding observations) the
+   * likelihood is that of the exact GP, and with k = n the predictions 
+   * are those of the exact GP, for each ordering
+   */
+  static bool testAllNeighboursMatchesExact();
+  
+  /**
+   * Test the gradient of the likelihood against finite differences
+   */
+  static bool testGradient();
+};
+
+#endif /*TESTNNGP_H_*/
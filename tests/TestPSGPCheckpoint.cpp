@@ -0,0 +1,149 @@
+#include "TestPSGPCheckpoint.h"
+
+#define N_OBS      4000
+#define N_ACTIVE   100
+#define INTERVAL   100
+#define NUGGET     0.01
+
+namespace
+{
+  void makeData(mat &X, vec &Y)
+  {
+    RNG_reset(0);
+    X = 10.0 * randu(N_OBS, 2);
+    Y.set_size(N_OBS);
+    for (int i=0; i<N_OBS; i++) Y(i) = sin(X(i,0)) * cos(0.5*X(i,1)) + sqrt(NUGGET)*randn();
+  }
+  
+  string checkpointName()
+  {
+    ostringstream name;
+    name << P_tmpdir << "/psgp_test_checkpoint_" << getpid() << ".it";
+    return name.str();
+  }
+  
+  bool fileExists(const string filename)
+  {
+    return access(filename.c_str(), F_OK) == 0;
+  }
+  
+  /**
+   * Compute the posterior with checkpoints in a child process, and kill
+   * it (without warning) shortly after its first checkpoint. Returns 
+   * false if no checkpoint was written.
+   */
+  bool runAndKill(mat &X, vec &Y, GaussianCF &cf, const string filename)
+  {
+    pid_t pid = fork();
+    if (pid == 0)
+    {
+      GaussianLikelihood lik(NUGGET);
+      PSGP psgp(X, Y, cf, N_ACTIVE, 1, 1);
+      psgp.setVerbose(false);
+      psgp.setCheckpoint(filename, INTERVAL);
+      RNG_reset(1);
+      psgp.computePosterior(lik);
+      _exit(0);
+    }
+    
+    // Wait for the first checkpoint (at most 60s), then kill the child
+    for (int i=0; i<6000 && !fileExists(filename); i++) usleep(10000);
+    usleep(200000);
+    kill(pid, SIGKILL);
+    
+    int status;
+    waitpid(pid, &status, 0);
+    if (!WIFSIGNALED(status)) cout << "(finished before being killed) ";
+    
+    remove((filename + ".tmp").c_str());
+    return fileExists(filename);
+  }
+}
+
+TestPSGPCheckpoint::TestPSGPCheckpoint() 
+{
+  header = "Test set for PSGP checkpoints";
+  addTest(&testKillAndResume, "Resume after a killed process");
+  addTest(&testResumeMismatch, "Resume with a different model");
+}
+
+TestPSGPCheckpoint::~TestPSGPCheckpoint() {}
+
+bool TestPSGPCheckpoint::testKillAndResume()
+{
+  mat X;
+  vec Y;
+  makeData(X, Y);
+  GaussianCF cf(1.5, 1.0);
+  GaussianLikelihood lik(NUGGET);
+  mat Xpred = 10.0 * randu(200, 2);
+  
+  // Uninterrupted computation
+  PSGP reference(X, Y, cf, N_ACTIVE, 1, 1);
+  reference.setVerbose(false);
+  RNG_reset(1);
+  reference.computePosterior(lik);
+  
+  vec mean1(200), var1(200);
+  reference.makePredictions(mean1, var1, Xpred);
+  
+  // Killed and resumed computation
+  string filename = checkpointName();
+  if (!runAndKill(X, Y, cf, filename)) return false;
+  
+  PSGP resumed(X, Y, cf, N_ACTIVE, 1, 1);
+  resumed.setVerbose(false);
+  RNG_reset(2);     // The generator state comes from the checkpoint
+  bool ok = resumed.resumePosterior(lik, filename);
+  remove(filename.c_str());
+  if (!ok) return false;
+  
+  vec mean2(200), var2(200);
+  resumed.makePredictions(mean2, var2, Xpred);
+  
+  cout << "(mean " << max(abs(mean1 - mean2)) << ", variance " << max(abs(var1 - var2)) << ") ";
+  
+  return resumed.getSizeActiveSet() == reference.getSizeActiveSet()
+      && max(abs(mean1 - mean2)) < 1e-10 && max(abs(var1 - var2)) < 1e-10;
+}
+
+bool TestPSGPCheckpoint::testResumeMismatch()
+{
+  mat X;
+  vec Y;
+  makeData(X, Y);
+  GaussianCF cf(1.5, 1.0);
+  GaussianLikelihood lik(NUGGET);
+  
+  string filename = checkpointName();
+  if (!runAndKill(X, Y, cf, filename)) return false;
+  
+  // Different covariance parameters
+  GaussianCF cfOther(1.0, 1.0);
+  PSGP psgp1(X, Y, cfOther, N_ACTIVE, 1, 1);
+  psgp1.setVerbose(false);
+  bool resumed1 = psgp1.resumePosterior(lik, filename);
+  
+  // Different maximum active set size
+  PSGP psgp2(X, Y, cf, N_ACTIVE / 2, 1, 1);
+  psgp2.setVerbose(false);
+  bool resumed2 = psgp2.resumePosterior(lik, filename);
+  
+  // Different gamma tolerance
+  PSGP psgp3(X, Y, cf, N_ACTIVE, 1, 1);
+  psgp3.setVerbose(false);
+  psgp3.setGammaTolerance(1e-2);
+  bool resumed3 = psgp3.resumePosterior(lik, filename);
+  
+  remove(filename.c_str());
+  
+  return !resumed1 && !resumed2 && !resumed3;
+}
+
+/**
+ * Run the tests
+ */
+int main() {
+  TestPSGPCheckpoint test;
+  test.run();
+}
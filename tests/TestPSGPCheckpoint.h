@@ -0,0 +1,40 @@
+#ifndef TESTPSGPCHECKPOINT_H_
+#define TESTPSGPCHECKPOINT_H_
+
+#include "Test.h"
+#include "gaussian_processes/PSGP.h"
+#include "covariance_functions/GaussianCF.h"
+#include "likelihood_models/GaussianLikelihood.h"
+
+#include <sstream>
+#include <cstdio>
+
+#include <unistd.h>
+#include <signal.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+using namespace std;
+using namespace itpp;
+
+class TestPSGPCheckpoint : public Test
+{
+public:
+  TestPSGPCheckpoint();
+  virtual ~TestPSGPCheckpoint();
+  
+  /**
+   * Kill a process computing a posterior with checkpoints, resume from its
+   * last checkpoint and check that the posterior is the same as without
+   * the interruption
+   */
+  static bool testKillAndResume();
+  
+  /**
+   * Test that a checkpoint is not resumed with a different covariance 
+   * function or different settings
+   */
+  static bool testResumeMismatch();
+};
+
+#endif /*TESTPSGPCHECKPOINT_H_*/
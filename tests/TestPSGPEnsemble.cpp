@@ -0,0 +1,154 @@
+#include "TestPSGPEnsemble.h"
+
+namespace
+{
+  /**
+   * Covariance functions for n experts (deleted by freeCovFunctions)
+   */
+  vector<CovarianceFunction *> makeCovFunctions(int n)
+  {
+    vector<CovarianceFunction *> cfs;
+    for (int e=0; e<n; e++) cfs.push_back(new GaussianCF(1.0, 1.0));
+    return cfs;
+  }
+  
+  void freeCovFunctions(vector<CovarianceFunction *> &cfs)
+  {
+    for (unsigned int e=0; e<cfs.size(); e++) delete cfs[e];
+    cfs.clear();
+  }
+  
+  /**
+   * Noisy observations of a smooth function on [0,10]^2
+   */
+  void makeData(mat &X, vec &Y, int n)
+  {
+    RNG_reset(0);
+    X = 10.0 * randu(n, 2);
+    Y.set_size(n);
+    for (int i=0; i<n; i++) Y(i) = sin(X(i,0)) * cos(0.5*X(i,1)) + 0.1*randn();
+  }
+}
+
+TestPSGPEnsemble::TestPSGPEnsemble() 
+{
+  header = "Test set for PSGP ensembles";
+  addTest(&testPredictions, "Predictions of the ensemble");
+  addTest(&testEmptyRegion, "Ensemble with an empty region");
+  addTest(&testReproducibleTraining, "Reproducible parallel training");
+}
+
+TestPSGPEnsemble::~TestPSGPEnsemble() {}
+
+bool TestPSGPEnsemble::testPredictions()
+{
+  mat X;
+  vec Y;
+  makeData(X, Y, 800);
+  
+  vector<CovarianceFunction *> cfs = makeCovFunctions(4);
+  GaussianLikelihood lik(0.01);
+  
+  PSGPEnsemble ensemble(X, Y, cfs, 50);
+  ensemble.computePosterior(lik);
+  
+  mat Xpred = 1.0 + 8.0 * randu(200, 2);
+  vec mean(200), var(200), truth(200);
+  ensemble.makePredictions(mean, var, Xpred);
+  for (int i=0; i<200; i++) truth(i) = sin(Xpred(i,0)) * cos(0.5*Xpred(i,1));
+  
+  freeCovFunctions(cfs);
+  
+  double rmse = sqrt(sum_sqr(mean - truth) / 200.0);
+  cout << "RMSE " << rmse << " ";
+  
+  return rmse < 0.1 && min(var) > 0.0;
+}
+
+bool TestPSGPEnsemble::testEmptyRegion()
+{
+  // 3 distinct locations, each observed 30 times
+  mat X0("1 1; 5 8; 9 2");
+  mat X(90, 2);
+  vec Y(90);
+  RNG_reset(0);
+  for (int i=0; i<90; i++)
+  {
+    X.set_row(i, X0.get_row(i % 3));
+    Y(i) = X(i,0) - 0.5*X(i,1) + 0.1*randn();
+  }
+  
+  mat Xpred = 10.0 * randu(50, 2);
+  vec mean3(50), var3(50), mean4(50), var4(50);
+  GaussianLikelihood lik(0.01);
+  
+  // Reference: one expert per location
+  vector<CovarianceFunction *> cfs3 = makeCovFunctions(3);
+  PSGPEnsemble ensemble3(X, Y, cfs3, 10);
+  RNG_reset(1);
+  ensemble3.computePosterior(lik);
+  ensemble3.makePredictions(mean3, var3, Xpred);
+  
+  // Four regions, one of which must be empty
+  vector<CovarianceFunction *> cfs4 = makeCovFunctions(4);
+  PSGPEnsemble ensemble4(X, Y, cfs4, 10);
+  RNG_reset(1);
+  ensemble4.computePosterior(lik);
+  ensemble4.makePredictions(mean4, var4, Xpred);
+  
+  int nEmpty = 0;
+  for (int e=0; e<ensemble4.getNumberExperts(); e++) 
+  {
+    if (!ensemble4.getExpert(e)) nEmpty++;
+  }
+  
+  freeCovFunctions(cfs3);
+  freeCovFunctions(cfs4);
+  
+  bool finite = true;
+  for (int i=0; i<50; i++) 
+  {
+    finite = finite && std::isfinite(mean4(i)) && std::isfinite(var4(i)) && var4(i) > 0.0;
+  }
+  
+  return nEmpty == 1 && finite 
+      && max(abs(mean4 - mean3)) < 1e-12 && max(abs(var4 - var3)) < 1e-12;
+}
+
+bool TestPSGPEnsemble::testReproducibleTraining()
+{
+  mat X;
+  vec Y;
+  makeData(X, Y, 400);
+  GaussianLikelihood lik(0.01);
+  
+  mat Xpred = 10.0 * randu(100, 2);
+  vec mean[2], var[2];
+  
+  for (int run=0; run<2; run++)
+  {
+#ifdef _OPENMP
+    omp_set_num_threads(run == 0 ? 1 : 4);
+#endif
+    vector<CovarianceFunction *> cfs = makeCovFunctions(4);
+    PSGPEnsemble ensemble(X, Y, cfs, 30);
+    
+    RNG_reset(2);
+    ensemble.learnParameters(lik, 2, 5);
+    
+    mean[run].set_size(100);
+    var[run].set_size(100);
+    ensemble.makePredictions(mean[run], var[run], Xpred);
+    freeCovFunctions(cfs);
+  }
+  
+  return max(abs(mean[0] - mean[1])) == 0.0 && max(abs(var[0] - var[1])) == 0.0;
+}
+
+/**
+ * Run the tests
+ */
+int main() {
+  TestPSGPEnsemble test;
+  test.run();
+}
@@ -0,0 +1,42 @@
+#ifndef TESTPSGPENSEMBLE_H_
+#define TESTPSGPENSEMBLE_H_
+
+#include "Test.h"
+#include "gaussian_processes/PSGPEnsemble.h"
+#include "covariance_functions/GaussianCF.h"
+#include "likelihood_models/GaussianLikelihood.h"
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+using namespace std;
+using namespace itpp;
+
+class TestPSGPEnsemble : public Test
+{
+public:
+  TestPSGPEnsemble();
+  virtual ~TestPSGPEnsemble();
+  
+  /**
+   * Test that the ensemble predicts a smooth function accurately, with
+   * positive variances
+   */
+  static bool testPredictions();
+  
+  /**
+   * Test that a region left empty by the partition (here, more experts 
+   * than distinct locations) is ignored: the predictions are finite and 
+   * equal to those of the ensemble without the empty region
+   */
+  static bool testEmptyRegion();
+  
+  /**
+   * Test that parameter learning gives the same experts for the same 
+   * IT++ seed, whatever the number of threads
+   */
+  static bool testReproducibleTraining();
+};
+
+#endif /*TESTPSGPENSEMBLE_H_*/
@@ -0,0 +1,213 @@
+#include "TestPSGPOnline.h"
+
+#define N_OBS    4000
+#define N_FIRST  500
+#define N_ACTIVE 50
+#define N_WINDOW 1000
+#define NUGGET   0.01
+
+#define N_DRIFT        3000
+#define N_DRIFT_WINDOW 300
+#define N_DRIFT_ACTIVE 30
+
+namespace
+{
+  void makeData(mat &X, vec &Y, int n)
+  {
+    RNG_reset(0);
+    X = 10.0 * randu(n, 2);
+    Y.set_size(n);
+    for (int i=0; i<n; i++) Y(i) = sin(X(i,0)) * cos(0.5*X(i,1)) + sqrt(NUGGET)*randn();
+  }
+  
+  /**
+   * Observations whose first coordinate drifts across [0,10] with time,
+   * so that the active points of a sliding window must be renewed
+   */
+  void makeDriftingData(mat &X, vec &Y, int n)
+  {
+    RNG_reset(1);
+    X = 10.0 * randu(n, 2);
+    Y.set_size(n);
+    for (int i=0; i<n; i++) 
+    {
+      X(i,0) = 10.0 * (i + randu()) / n;
+      Y(i) = sin(X(i,0)) * cos(0.5*X(i,1)) + sqrt(NUGGET)*randn();
+    }
+  }
+  
+  double wallTime()
+  {
+    timeval t;
+    gettimeofday(&t, NULL);
+    return t.tv_sec + 1e-6 * t.tv_usec;
+  }
+}
+
+TestPSGPOnline::TestPSGPOnline() 
+{
+  header = "Test set for online PSGP updates";
+  addTest(&testOnlineMatchesBatch, "Online updates against batch posterior");
+  addTest(&testWindowMatchesBatch, "Sliding window against batch posterior on the window");
+  addTest(&testWindowActiveSetUpdates, "Sliding window with active set updates");
+}
+
+TestPSGPOnline::~TestPSGPOnline() {}
+
+bool TestPSGPOnline::testOnlineMatchesBatch()
+{
+  mat X;
+  vec Y;
+  makeData(X, Y, N_OBS);
+  
+  GaussianCF cf(1.5, 1.0);
+  GaussianLikelihood lik(NUGGET);
+  
+  // Batch posterior on all observations, for a fixed active set
+  PSGP batch(X, Y, cf, N_ACTIVE);
+  batch.setVerbose(false);
+  mat activeSet = X.get_rows(0, N_ACTIVE - 1);
+  batch.computePosteriorFixedActiveSet(lik, activeSet);
+  
+  // Same active set, first N_FIRST observations, then one at a time
+  mat Xonline = X.get_rows(0, N_FIRST - 1);
+  vec Yonline = Y(0, N_FIRST - 1);
+  PSGP online(Xonline, Yonline, cf, N_ACTIVE);
+  online.setVerbose(false);
+  online.computePosteriorFixedActiveSet(lik, activeSet);
+  
+  int nQuarter = (N_OBS - N_FIRST) / 4;
+  double tFirst = 0.0, tLast = 0.0;
+  for (int i = N_FIRST; i < N_OBS; i++)
+  {
+    double t0 = wallTime();
+    online.addObservations(X.get_rows(i, i), Y(i, i), lik);
+    double t = wallTime() - t0;
+    
+    if (i < N_FIRST + nQuarter) tFirst += t;
+    if (i >= N_OBS - nQuarter) tLast += t;
+  }
+  
+  mat Xpred = 10.0 * randu(200, 2);
+  vec mean1(200), var1(200), mean2(200), var2(200);
+  batch.makePredictions(mean1, var1, Xpred);
+  online.makePredictions(mean2, var2, Xpred);
+  
+  cout << endl << "  mean error " << max(abs(mean1 - mean2)) 
+       << ", variance error " << max(abs(var1 - var2)) << endl
+       << "  " << 1e3 * (tFirst + tLast) / (2 * nQuarter) << " ms per update (first/last quarter: " 
+       << 1e3 * tFirst / nQuarter << "/" << 1e3 * tLast / nQuarter << " ms)" << endl << "  ";
+  
+  // The observations are appended to the caller's storage, without padding
+  bool stored = online.getNumberObservations() == N_OBS 
+             && Xonline.rows() == N_OBS && Yonline.length() == N_OBS
+             && max(max(abs(Xonline - X))) == 0.0 && max(abs(Yonline - Y)) == 0.0;
+  
+  // The updates are exact for a Gaussian likelihood, up to rounding errors
+  // amplified by the conditioning of the active set covariance
+  return stored && max(abs(mean1 - mean2)) < 1e-6 && max(abs(var1 - var2)) < 1e-6;
+}
+
+bool TestPSGPOnline::testWindowMatchesBatch()
+{
+  mat X;
+  vec Y;
+  makeData(X, Y, N_OBS);
+  
+  GaussianCF cf(1.5, 1.0);
+  GaussianLikelihood lik(NUGGET);
+  mat activeSet = X.get_rows(0, N_ACTIVE - 1);
+  
+  // Batch posterior on the last N_WINDOW observations
+  mat Xlast = X.get_rows(N_OBS - N_WINDOW, N_OBS - 1);
+  vec Ylast = Y(N_OBS - N_WINDOW, N_OBS - 1);
+  PSGP batch(Xlast, Ylast, cf, N_ACTIVE);
+  batch.setVerbose(false);
+  batch.computePosteriorFixedActiveSet(lik, activeSet);
+  
+  // Stream all observations, starting from a full window
+  mat Xwindow = X.get_rows(0, N_WINDOW - 1);
+  vec Ywindow = Y(0, N_WINDOW - 1);
+  PSGP stream(Xwindow, Ywindow, cf, N_ACTIVE);
+  stream.setVerbose(false);
+  stream.setWindow(N_WINDOW);
+  stream.computePosteriorFixedActiveSet(lik, activeSet);
+  
+  for (int i = N_WINDOW; i < N_OBS; i++)
+  {
+    stream.addObservations(X.get_rows(i, i), Y(i, i), lik);
+  }
+  
+  mat Xpred = 10.0 * randu(200, 2);
+  vec mean1(200), var1(200), mean2(200), var2(200);
+  batch.makePredictions(mean1, var1, Xpred);
+  stream.makePredictions(mean2, var2, Xpred);
+  
+  cout << endl << "  mean error " << max(abs(mean1 - mean2)) 
+       << ", variance error " << max(abs(var1 - var2)) << endl << "  ";
+  
+  // The storage does not grow beyond the window
+  bool bounded = stream.getNumberObservations() == N_WINDOW && Xwindow.rows() == N_WINDOW;
+  
+  return bounded && max(abs(mean1 - mean2)) < 1e-6 && max(abs(var1 - var2)) < 1e-6;
+}
+
+bool TestPSGPOnline::testWindowActiveSetUpdates()
+{
+  mat X;
+  vec Y;
+  makeDriftingData(X, Y, N_DRIFT);
+  
+  GaussianCF cf(1.0, 1.0);
+  GaussianLikelihood lik(NUGGET);
+  AlgoVersion versions[3] = { ALGO_V1, ALGO_V2, ALGO_V3 };
+  bool ok = true;
+  
+  cout << endl;
+  for (int v = 0; v < 3; v++)
+  {
+    mat Xwindow = X.get_rows(0, N_DRIFT_WINDOW - 1);
+    vec Ywindow = Y(0, N_DRIFT_WINDOW - 1);
+    PSGP stream(Xwindow, Ywindow, cf, N_DRIFT_ACTIVE);
+    stream.setVerbose(false);
+    stream.setAlgoVersion(versions[v]);
+    stream.setWindow(N_DRIFT_WINDOW);
+    stream.computePosterior(lik);
+    
+    for (int i = N_DRIFT_WINDOW; i < N_DRIFT; i++)
+    {
+      stream.addObservations(X.get_rows(i, i), Y(i, i), lik, true);
+    }
+    
+    // Active points whose observation has left the window
+    ivec active = stream.getActiveSetIndices();
+    int expired = 0;
+    for (int j = 0; j < stream.getSizeActiveSet(); j++) 
+    {
+      if (active(j) < 0) expired++;
+    }
+    
+    // Predictions in the region covered by the window
+    mat Xpred = 10.0 * randu(200, 2);
+    Xpred.set_col(0, 9.0 + 0.8 * randu(200));
+    vec mean(200), var(200), truth(200);
+    stream.makePredictions(mean, var, Xpred);
+    for (int i = 0; i < 200; i++) truth(i) = sin(Xpred(i,0)) * cos(0.5*Xpred(i,1));
+    
+    cout << "  version " << v + 1 << ": " << stream.getSizeActiveSet() << " active points, " 
+         << expired << " expired, RMS error " << sqrt(sum_sqr(mean - truth) / 200.0) << endl;
+    
+    ok = ok && expired == 0 && sqrt(sum_sqr(mean - truth) / 200.0) < 0.05;
+  }
+  cout << "  ";
+  
+  return ok;
+}
+
+/**
+ * Run the tests
+ */
+int main() {
+  TestPSGPOnline test;
+  test.run();
+}
@@ -0,0 +1,43 @@
+#ifndef TESTPSGPONLINE_H_
+#define TESTPSGPONLINE_H_
+
+#include "Test.h"
+#include "gaussian_processes/PSGP.h"
+#include "covariance_functions/GaussianCF.h"
+#include "likelihood_models/GaussianLikelihood.h"
+
+#include <sys/time.h>
+
+using namespace std;
+using namespace itpp;
+
+class TestPSGPOnline : public Test
+{
+public:
+  TestPSGPOnline();
+  virtual ~TestPSGPOnline();
+  
+  /**
+   * Test that adding observations one at a time (with a fixed active set)
+   * gives the same posterior as the batch computation on all of them, 
+   * that the caller's locations and observations hold exactly the 
+   * observations, and report the time per update
+   */
+  static bool testOnlineMatchesBatch();
+  
+  /**
+   * Test that streaming observations through a sliding window gives the
+   * same posterior as the batch computation on the observations left in
+   * the window, with bounded storage
+   */
+  static bool testWindowMatchesBatch();
+  
+  /**
+   * Test that, with active set updates in a sliding window, active points 
+   * whose observation has expired are replaced first (for each algorithm
+   * version), so that the active set follows drifting observations
+   */
+  static bool testWindowActiveSetUpdates();
+};
+
+#endif /*TESTPSGPONLINE_H_*/
@@ -0,0 +1,181 @@
+#include "TestPSGPPredictions.h"
+
+#define N_OBS    1500
+#define N_ACTIVE 300
+
+namespace
+{
+  /**
+   * Fit a PSGP to noisy observations of a smooth function on [0,10]^2
+   */
+  PSGP *fitPSGP(mat &X, vec &Y, GaussianCF &cf, GaussianLikelihood &lik, double nugget)
+  {
+    RNG_reset(0);
+    X = 10.0 * randu(N_OBS, 2);
+    Y.set_size(N_OBS);
+    for (int i=0; i<N_OBS; i++) Y(i) = sin(X(i,0)) * cos(0.5*X(i,1)) + sqrt(nugget)*randn();
+    
+    PSGP *psgp = new PSGP(X, Y, cf, N_ACTIVE, 1, 1);
+    psgp->computePosterior(lik);
+    return psgp;
+  }
+  
+  double wallTime()
+  {
+    timeval t;
+    gettimeofday(&t, NULL);
+    return t.tv_sec + 1e-6 * t.tv_usec;
+  }
+}
+
+TestPSGPPredictions::TestPSGPPredictions() 
+{
+  header = "Test set for PSGP predictions";
+  addTest(&testSinglePrecisionAccuracy, "Accuracy of single precision predictions");
+  addTest(&testSinglePrecisionThroughput, "Throughput of single precision predictions");
+  addTest(&testBlockPredictions, "Block predictions against point predictions");
+}
+
+TestPSGPPredictions::~TestPSGPPredictions() {}
+
+/**
+ * Compare the single and double precision predictions at random locations
+ * and at the observations, with a typical and a very small nugget (which
+ * gives a large cancellation in the variance at the data), for the default
+ * and a loose variance tolerance
+ */
+bool TestPSGPPredictions::testSinglePrecisionAccuracy()
+{
+  return singlePrecisionAccuracy(1e-2, SINGLE_PRECISION_TOLERANCE) 
+      && singlePrecisionAccuracy(1e-4, SINGLE_PRECISION_TOLERANCE)
+      && singlePrecisionAccuracy(1e-2, 1e-2);
+}
+
+bool TestPSGPPredictions::singlePrecisionAccuracy(double nugget, double tolerance)
+{
+  mat X;
+  vec Y;
+  GaussianCF cf(1.5, 1.0);
+  GaussianLikelihood lik(nugget);
+  PSGP *psgp = fitPSGP(X, Y, cf, lik, nugget);
+  psgp->setSinglePrecisionPredictions(true, tolerance);
+  
+  mat Xpred = concat_vertical(10.0 * randu(2000, 2), X);
+  double meanError, varError;
+  psgp->comparePredictionPrecision(Xpred, meanError, varError);
+  
+  vec mean(Xpred.rows()), var(Xpred.rows());
+  psgp->makePredictions(mean, var, Xpred);
+  delete psgp;
+  
+  // The mean is a sum of 300 products in float, the variance error is 
+  // bounded by the tolerance times the prior variance (1)
+  return meanError < 1e-4 && varError < tolerance && min(var) >= 0.0;
+}
+
+/**
+ * Time the prediction paths on a 200 x 200 grid, with the default and a 
+ * loose variance tolerance. The predictions must agree, the timings are 
+ * only reported (they depend on the BLAS used by the double precision path
+ * and on the number of variances recomputed in double precision).
+ */
+bool TestPSGPPredictions::testSinglePrecisionThroughput()
+{
+  mat X;
+  vec Y;
+  GaussianCF cf(1.5, 1.0);
+  GaussianLikelihood lik(1e-2);
+  PSGP *psgp = fitPSGP(X, Y, cf, lik, 1e-2);
+  
+  int nGrid = 200;
+  mat Xgrid(nGrid*nGrid, 2);
+  for (int i=0; i<nGrid; i++)
+  {
+    for (int j=0; j<nGrid; j++)
+    {
+      Xgrid(i + nGrid*j, 0) = 10.0 * i / (nGrid - 1);
+      Xgrid(i + nGrid*j, 1) = 10.0 * j / (nGrid - 1);
+    }
+  }
+  
+  int nPred = Xgrid.rows();
+  vec meanD(nPred), varD(nPred), meanF(nPred), varF(nPred), meanL(nPred), varL(nPred);
+  
+  double t0 = wallTime();
+  psgp->makePredictions(meanD, varD, Xgrid);
+  double t1 = wallTime();
+  psgp->setSinglePrecisionPredictions(true);
+  psgp->makePredictions(meanF, varF, Xgrid);
+  double t2 = wallTime();
+  psgp->setSinglePrecisionPredictions(true, 1e-2);
+  psgp->makePredictions(meanL, varL, Xgrid);
+  double t3 = wallTime();
+  delete psgp;
+  
+  cout << endl 
+       << "  double:                    " << nPred / (t1 - t0) << " predictions/s" << endl
+       << "  single, default tolerance: " << nPred / (t2 - t1) << " predictions/s (x" 
+       << (t1 - t0) / (t2 - t1) << ")" << endl
+       << "  single, tolerance 1e-2:    " << nPred / (t3 - t2) << " predictions/s (x" 
+       << (t1 - t0) / (t3 - t2) << "), max variance error " << max(abs(varL - varD)) << endl << "  ";
+  
+  return max(abs(meanF - meanD)) < 1e-4 && max(abs(varF - varD)) < SINGLE_PRECISION_TOLERANCE
+      && max(abs(meanL - meanD)) < 1e-4 && max(abs(varL - varD)) < 1e-2;
+}
+
+bool TestPSGPPredictions::testBlockPredictions()
+{
+  mat X;
+  vec Y;
+  GaussianCF cf(1.5, 1.0);
+  GaussianLikelihood lik(1e-2);
+  PSGP *psgp = fitPSGP(X, Y, cf, lik, 1e-2);
+  
+  // Regions 0 and 1 split [0,10]^2 in halves (more than REGION_BLOCK_SIZE 
+  // locations each), region 2 is empty, the locations of the strip 
+  // x < 1 are not assigned to any region
+  int nPred = 1500, nRegions = 3;
+  mat Xpred = 10.0 * randu(nPred, 2);
+  ivec region(nPred);
+  for (int i=0; i<nPred; i++) region(i) = (Xpred(i,0) < 1.0) ? -1 : (Xpred(i,1) < 5.0 ? 0 : 1);
+  
+  vec blockMean(nRegions), blockVar(nRegions);
+  psgp->makeBlockPredictions(blockMean, blockVar, Xpred, region);
+  
+  vec mean(nPred), var(nPred);
+  psgp->makePredictions(mean, var, Xpred);
+  
+  bool ok = (blockMean(2) != blockMean(2)) && (blockVar(2) != blockVar(2));
+  
+  cout << endl;
+  for (int r=0; r<2; r++)
+  {
+    ivec idx = find(region == r);
+    int n = idx.length();
+    double pointMean = sum(mean(idx)) / n;
+    
+    PSGPPredictiveCovariance cov(*psgp, Xpred.get_rows(idx));
+    double fullVar = sumsum(cov.full()) / ((double) n * n);
+    
+    double errMean = fabs(blockMean(r) - pointMean);
+    double errVar = fabs(blockVar(r) - fullVar);
+    cout << "  region " << r << " (" << n << " locations): mean error " << errMean 
+         << ", variance " << fullVar << " (error " << errVar << ")" << endl;
+    
+    // The variance of the average is a small difference of prior and 
+    // low rank terms of order 1, so its error is absolute
+    ok = ok && n > REGION_BLOCK_SIZE && errMean < 1e-10 && errVar < 1e-10;
+  }
+  cout << "  ";
+  
+  delete psgp;
+  return ok;
+}
+
+/**
+ * Run the tests
+ */
+int main() {
+  TestPSGPPredictions test;
+  test.run();
+}
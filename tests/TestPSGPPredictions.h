@@ -0,0 +1,46 @@
+#ifndef TESTPSGPPREDICTIONS_H_
+#define TESTPSGPPREDICTIONS_H_
+
+#include "Test.h"
+#include "gaussian_processes/PSGP.h"
+#include "gaussian_processes/PSGPPredictiveCovariance.h"
+#include "covariance_functions/GaussianCF.h"
+#include "likelihood_models/GaussianLikelihood.h"
+
+#include <sys/time.h>
+
+using namespace std;
+using namespace itpp;
+
+class TestPSGPPredictions : public Test
+{
+public:
+  TestPSGPPredictions();
+  virtual ~TestPSGPPredictions();
+  
+  /**
+   * Test that single precision predictions match the double precision 
+   * ones, and that the variances are never negative (including at the 
+   * observations, where the variance term cancels the most)
+   */
+  static bool testSinglePrecisionAccuracy();
+  
+  /**
+   * Time the single and double precision predictions on a large grid and
+   * report the throughput of each
+   */
+  static bool testSinglePrecisionThroughput();
+  
+  /**
+   * Test that the block predictions of each region are the average of the
+   * point predictions (mean) and 1'*S*1/n^2, where S is the full predictive
+   * covariance of the region (variance), including regions of more than 
+   * REGION_BLOCK_SIZE locations, an empty region and unassigned locations
+   */
+  static bool testBlockPredictions();
+
+private:
+  static bool singlePrecisionAccuracy(double nugget, double tolerance);
+};
+
+#endif /*TESTPSGPPREDICTIONS_H_*/
@@ -0,0 +1,109 @@
+#include "TestPSGPSampler.h"
+
+#define N_OBS     300
+#define N_ACTIVE  40
+#define N_SAMPLES 20000
+#define NUGGET    0.01
+
+namespace
+{
+  /**
+   * PSGP posterior for a smooth function with a little noise on [0,10]^2
+   */
+  PSGP *trainPSGP(mat &X, vec &Y, GaussianCF &cf)
+  {
+    RNG_reset(7);
+    X = 10.0*randu(N_OBS, 2);
+    Y.set_size(N_OBS);
+    for (int i=0; i<N_OBS; i++) Y(i) = sin(X(i,0)) + cos(X(i,1)) + sqrt(NUGGET)*randn();
+    
+    GaussianLikelihood lik(NUGGET);
+    PSGP *psgp = new PSGP(X, Y, cf, N_ACTIVE);
+    psgp->setVerbose(false);
+    psgp->computePosterior(lik);
+    return psgp;
+  }
+  
+  /**
+   * Compare the sample mean and covariance of the realisations with the
+   * predictive mean and covariance of the PSGP. Errors are measured in 
+   * standard errors of the estimates.
+   */
+  bool compareMoments(const mat &samples, const PSGP &psgp, const mat &Xpred)
+  {
+    int n = Xpred.rows();
+    double N = samples.cols();
+    
+    vec mean(n), var(n);
+    psgp.makePredictions(mean, var, Xpred);
+    mat Sigma = PSGPPredictiveCovariance(psgp, Xpred).full();
+    
+    vec sampleMean = sum(samples, 2) / N;
+    mat centred = samples;
+    for (int j=0; j<samples.cols(); j++) centred.set_col(j, samples.get_col(j) - sampleMean);
+    mat S = (centred * centred.transpose()) / (N - 1.0);
+    
+    double meanErr = 0.0, covErr = 0.0;
+    for (int i=0; i<n; i++)
+    {
+      meanErr = std::max(meanErr, fabs(sampleMean(i) - mean(i)) / sqrt(Sigma(i,i) / N));
+      for (int j=0; j<n; j++)
+      {
+        double se = sqrt((Sigma(i,i) * Sigma(j,j) + Sigma(i,j) * Sigma(i,j)) / N);
+        covErr = std::max(covErr, fabs(S(i,j) - Sigma(i,j)) / se);
+      }
+    }
+    
+    cout << "(mean " << meanErr << ", covariance " << covErr << " standard errors) ";
+    
+    return meanErr < 5.0 && covErr < 5.0;
+  }
+}
+
+TestPSGPSampler::TestPSGPSampler() 
+{
+  header = "Test set for the PSGP posterior sampler";
+  addTest(&testExactMoments, "Moments of exact realisations");
+  addTest(&testLowRankMoments, "Moments of low rank realisations at the active set");
+}
+
+TestPSGPSampler::~TestPSGPSampler() {}
+
+bool TestPSGPSampler::testExactMoments()
+{
+  mat X;
+  vec Y;
+  GaussianCF cf(1.5, 1.0);
+  PSGP *psgp = trainPSGP(X, Y, cf);
+  
+  // Close locations, so that the realisations are strongly correlated
+  mat Xpred = 3.0 + 2.0*randu(30, 2);
+  PSGPSampler sampler(*psgp, Xpred, false, 1234);
+  
+  bool ok = compareMoments(sampler.sample(N_SAMPLES), *psgp, Xpred);
+  delete psgp;
+  return ok;
+}
+
+bool TestPSGPSampler::testLowRankMoments()
+{
+  mat X;
+  vec Y;
+  GaussianCF cf(1.5, 1.0);
+  PSGP *psgp = trainPSGP(X, Y, cf);
+  
+  mat Xpred = psgp->getActiveSetLocations();
+  PSGPSampler sampler(*psgp, Xpred, true, 1234);
+  
+  bool ok = (sampler.getRank() == N_ACTIVE) && compareMoments(sampler.sample(N_SAMPLES), *psgp, Xpred);
+  delete psgp;
+  return ok;
+}
+
+/**
+ * Run the tests
+ */
+int main() {
+  TestPSGPSampler test;
+  test.run();
+}
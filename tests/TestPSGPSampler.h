@@ -0,0 +1,33 @@
+#ifndef TESTPSGPSAMPLER_H_
+#define TESTPSGPSAMPLER_H_
+
+#include "Test.h"
+#include "gaussian_processes/PSGPSampler.h"
+#include "gaussian_processes/PSGPPredictiveCovariance.h"
+#include "covariance_functions/GaussianCF.h"
+#include "likelihood_models/GaussianLikelihood.h"
+
+using namespace std;
+using namespace itpp;
+
+class TestPSGPSampler : public Test
+{
+public:
+  TestPSGPSampler();
+  virtual ~TestPSGPSampler();
+  
+  /**
+   * Test that the sample mean and covariance of exact realisations 
+   * (approx=false) match the predictive mean and covariance of the PSGP,
+   * within a Monte Carlo tolerance
+   */
+  static bool testExactMoments();
+  
+  /**
+   * Same for the low rank realisations (approx=true) at the active set,
+   * where the projected process has the full predictive covariance
+   */
+  static bool testLowRankMoments();
+};
+
+#endif /*TESTPSGPSAMPLER_H_*/
@@ -0,0 +1,246 @@
+#include "TestPSGPShards.h"
+
+#define N_OBS    1000
+#define N_ACTIVE 50
+#define N_SHARDS 4
+#define NUGGET   0.01
+
+namespace
+{
+  /**
+   * Seeded data set, so that forked processes see the same data
+   */
+  void generateData(mat &X, vec &Y)
+  {
+    RNG_reset(123);
+    X = 10.0*randu(N_OBS, 2);
+    Y.set_size(N_OBS);
+    for (int i=0; i<N_OBS; i++) Y(i) = sin(X(i,0)) + cos(X(i,1)) + sqrt(NUGGET)*randn();
+  }
+  
+  /**
+   * Observations iShard, iShard + N_SHARDS, ...
+   */
+  ivec shardIndexes(int iShard)
+  {
+    ivec idx;
+    for (int i=iShard; i<N_OBS; i+=N_SHARDS) 
+    {
+      idx.set_size(idx.length()+1, true);
+      idx(idx.length()-1) = i;
+    }
+    return idx;
+  }
+  
+  /**
+   * Posterior of one shard for the shared active set
+   */
+  PSGP *shardPosterior(mat &Xshard, vec &Yshard, GaussianCF &cf, const mat &activeSet)
+  {
+    GaussianLikelihood lik(NUGGET);
+    PSGP *psgp = new PSGP(Xshard, Yshard, cf, activeSet.rows());
+    psgp->setVerbose(false);
+    psgp->computePosteriorFixedActiveSet(lik, activeSet);
+    return psgp;
+  }
+  
+  /**
+   * Compare the predictions of the merged posterior with those of the 
+   * posterior computed on all observations
+   */
+  bool compareWithSingle(PSGP &merged, mat &X, vec &Y, GaussianCF &cf, const mat &activeSet)
+  {
+    PSGP *single = shardPosterior(X, Y, cf, activeSet);
+    
+    mat Xtst = 10.0*randu(200, 2);
+    vec mean1(200), var1(200), mean2(200), var2(200);
+    merged.makePredictions(mean1, var1, Xtst);
+    single->makePredictions(mean2, var2, Xtst);
+    delete single;
+    
+    cout << "(mean " << max(abs(mean1 - mean2)) << ", variance " << max(abs(var1 - var2)) << ") ";
+    
+    return max(abs(mean1 - mean2)) < 1e-6 && max(abs(var1 - var2)) < 1e-6;
+  }
+  
+  /**
+   * Whether a forked process calling op on the merged PSGP is stopped
+   * by an error (instead of exiting normally)
+   */
+  bool rejectedInChild(PSGP &merged, const mat &Xnew, const vec &Ynew, int op)
+  {
+    cout << flush;
+    pid_t pid = fork();
+    if (pid == 0)
+    {
+      GaussianLikelihood lik(NUGGET);
+      vec mean, var;
+      mat U;
+      vec b;
+      switch (op)
+      {
+      case 0: merged.leaveOneOut(mean, var); break;
+      case 1: merged.addObservations(Xnew, Ynew, lik); break;
+      case 2: merged.getSiteContributions(U, b); break;
+      case 3: merged.recomputePosterior(); break;
+      }
+      _exit(0);
+    }
+    
+    int status;
+    waitpid(pid, &status, 0);
+    return !(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+  }
+}
+
+TestPSGPShards::TestPSGPShards() 
+{
+  header = "Test set for PSGP posteriors over data shards";
+  addTest(&testMergeContributions, "Merge of shard contributions");
+  addTest(&testMergeShardFiles, "Merge of shard files from separate processes");
+  addTest(&testOperationsAfterMerge, "Operations on a merged posterior");
+}
+
+TestPSGPShards::~TestPSGPShards() {}
+
+bool TestPSGPShards::testMergeContributions()
+{
+  mat X;
+  vec Y;
+  generateData(X, Y);
+  
+  GaussianCF cf(1.5, 1.0);
+  GreedyMaxMinDesign design(1.0);
+  mat activeSet = X.get_rows(design.subsample(X, N_ACTIVE));
+  
+  mat U = zeros(N_ACTIVE, N_ACTIVE);
+  vec b = zeros(N_ACTIVE);
+  
+  for (int s=0; s<N_SHARDS; s++)
+  {
+    ivec idx = shardIndexes(s);
+    mat Xshard = X.get_rows(idx);
+    vec Yshard = Y(idx);
+    PSGP *shard = shardPosterior(Xshard, Yshard, cf, activeSet);
+    
+    mat Us;
+    vec bs;
+    shard->getSiteContributions(Us, bs);
+    U += Us;
+    b += bs;
+    delete shard;
+  }
+  
+  mat Xnone(0, 2);
+  vec Ynone(0);
+  PSGP merged(Xnone, Ynone, cf, N_ACTIVE);
+  merged.setPosteriorFromSiteContributions(activeSet, U, b);
+  
+  return compareWithSingle(merged, X, Y, cf, activeSet);
+}
+
+bool TestPSGPShards::testMergeShardFiles()
+{
+  mat X;
+  vec Y;
+  generateData(X, Y);
+  
+  GaussianCF cf(1.5, 1.0);
+  GreedyMaxMinDesign design(1.0);
+  mat activeSet = X.get_rows(design.subsample(X, N_ACTIVE));
+  
+  vector<string> files;
+  vector<pid_t> children;
+  
+  for (int s=0; s<N_SHARDS; s++)
+  {
+    ostringstream name;
+    name << P_tmpdir << "/psgp_test_shard_" << getpid() << "_" << s << ".it";
+    files.push_back(name.str());
+    
+    pid_t pid = fork();
+    if (pid == 0)
+    {
+      // Each process regenerates the data, as on a separate machine
+      mat Xs;
+      vec Ys;
+      generateData(Xs, Ys);
+      ivec idx = shardIndexes(s);
+      mat Xshard = Xs.get_rows(idx);
+      vec Yshard = Ys(idx);
+      PSGP *shard = shardPosterior(Xshard, Yshard, cf, activeSet);
+      _exit(shard->writeSiteContributions(files[s]) ? 0 : 1);
+    }
+    children.push_back(pid);
+  }
+  
+  bool ok = true;
+  for (int s=0; s<N_SHARDS; s++)
+  {
+    int status;
+    waitpid(children[s], &status, 0);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) ok = false;
+  }
+  
+  mat Xnone(0, 2);
+  vec Ynone(0);
+  PSGP merged(Xnone, Ynone, cf, N_ACTIVE);
+  ok = ok && merged.mergeSiteContributions(files);
+  
+  for (int s=0; s<N_SHARDS; s++) remove(files[s].c_str());
+  
+  return ok && compareWithSingle(merged, X, Y, cf, activeSet);
+}
+
+bool TestPSGPShards::testOperationsAfterMerge()
+{
+  mat X;
+  vec Y;
+  generateData(X, Y);
+  
+  GaussianCF cf(1.5, 1.0);
+  GreedyMaxMinDesign design(1.0);
+  mat activeSet = X.get_rows(design.subsample(X, N_ACTIVE));
+  
+  PSGP *single = shardPosterior(X, Y, cf, activeSet);
+  mat U;
+  vec b;
+  single->getSiteContributions(U, b);
+  delete single;
+  
+  // Merged PSGP on the whole data set, so that a posterior can be 
+  // recomputed afterwards
+  PSGP merged(X, Y, cf, N_ACTIVE);
+  merged.setVerbose(false);
+  merged.setPosteriorFromSiteContributions(activeSet, U, b);
+  
+  bool ok = compareWithSingle(merged, X, Y, cf, activeSet);
+  
+  mat Xnew = 10.0*randu(10, 2);
+  vec Ynew = zeros(10);
+  for (int op=0; op<4; op++)
+  {
+    if (!rejectedInChild(merged, Xnew, Ynew, op))
+    {
+      cout << "(operation " << op << " accepted) ";
+      ok = false;
+    }
+  }
+  
+  // A new posterior makes the site-based operations available again
+  GaussianLikelihood lik(NUGGET);
+  merged.computePosteriorFixedActiveSet(lik, activeSet);
+  vec mean(N_OBS), var(N_OBS);
+  merged.leaveOneOut(mean, var);
+  
+  return ok && compareWithSingle(merged, X, Y, cf, activeSet) 
+            && min(var) > 0.0 && max(abs(mean - Y)) < 1.0;
+}
+
+/**
+ * Run the tests
+ */
+int main() {
+  TestPSGPShards test;
+  test.run();
+}
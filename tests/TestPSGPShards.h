@@ -0,0 +1,46 @@
+#ifndef TESTPSGPSHARDS_H_
+#define TESTPSGPSHARDS_H_
+
+#include "Test.h"
+#include "gaussian_processes/PSGP.h"
+#include "covariance_functions/GaussianCF.h"
+#include "likelihood_models/GaussianLikelihood.h"
+#include "design/GreedyMaxMinDesign.h"
+
+#include <sstream>
+#include <cstdio>
+
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+using namespace std;
+using namespace itpp;
+
+class TestPSGPShards : public Test
+{
+public:
+  TestPSGPShards();
+  virtual ~TestPSGPShards();
+  
+  /**
+   * Test that merging the site contributions of shards (computed in the
+   * same process) gives the posterior of the whole data set
+   */
+  static bool testMergeContributions();
+  
+  /**
+   * Same, with each shard computed in a separate (forked) process and 
+   * the contributions exchanged through files
+   */
+  static bool testMergeShardFiles();
+  
+  /**
+   * Test that a merged posterior can be used for predictions, that 
+   * operations needing the site parameters are rejected (in a forked 
+   * process) and that a recomputed posterior can be used again
+   */
+  static bool testOperationsAfterMerge();
+};
+
+#endif /*TESTPSGPSHARDS_H_*/
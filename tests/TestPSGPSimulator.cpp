@@ -0,0 +1,198 @@
+#include "TestPSGPSimulator.h"
+
+#define N_OBS     200
+#define N_ACTIVE  30
+#define N_SAMPLES 4000
+#define NUGGET    0.01
+
+namespace
+{
+  /**
+   * Smooth function with a little noise on [0,10]^2
+   */
+  void generateData(mat &X, vec &Y)
+  {
+    RNG_reset(42);
+    X = 10.0*randu(N_OBS, 2);
+    Y.set_size(N_OBS);
+    for (int i=0; i<N_OBS; i++) Y(i) = sin(X(i,0)) + cos(X(i,1)) + sqrt(NUGGET)*randn();
+  }
+  
+  /**
+   * Maximum difference between the empirical covariance of zero mean 
+   * realisations (one per column) and the covariance function
+   */
+  double priorCovarianceError(const mat &samples, const mat &X, CovarianceFunction &cf)
+  {
+    mat K(X.rows(), X.rows());
+    cf.covariance(K, X);
+    mat S = (samples * samples.transpose()) / double(samples.cols());
+    return max(max(abs(S - K)));
+  }
+  
+  /**
+   * Compare the sample mean and variance of the realisations with the
+   * predictions of the PSGP, within a Monte Carlo tolerance
+   */
+  bool compareWithPredictions(const mat &samples, const PSGP &psgp, const mat &Xpred)
+  {
+    int n = Xpred.rows();
+    vec mean(n), var(n);
+    psgp.makePredictions(mean, var, Xpred);
+    
+    double N = samples.cols();
+    double meanErr = 0.0, varErr = 0.0;
+    for (int i=0; i<n; i++)
+    {
+      vec s = samples.get_row(i);
+      double m = sum(s) / N;
+      double v = sum_sqr(s - m) / (N - 1.0);
+      
+      // Errors relative to the standard errors of the sample mean and variance
+      meanErr = std::max(meanErr, fabs(m - mean(i)) / sqrt(var(i) / N));
+      varErr = std::max(varErr, fabs(v - var(i)) / (var(i) * sqrt(2.0 / N)));
+    }
+    
+    cout << "(mean " << meanErr << ", variance " << varErr << " standard errors) ";
+    
+    return meanErr < 5.0 && varErr < 5.0;
+  }
+}
+
+TestPSGPSimulator::TestPSGPSimulator() 
+{
+  header = "Test set for the PSGP conditional simulator";
+  addTest(&testPriorCovariance, "Covariance of circulant embedding realisations");
+  addTest(&testConditionalScattered, "Conditional realisations at scattered locations");
+  addTest(&testConditionalGrid, "Conditional realisations on a grid");
+  addTest(&testNegativeEigenvalues, "Embedding with negative eigenvalues");
+}
+
+TestPSGPSimulator::~TestPSGPSimulator() {}
+
+bool TestPSGPSimulator::testPriorCovariance()
+{
+  mat X;
+  vec Y;
+  generateData(X, Y);
+  
+  GaussianCF cf(1.5, 2.0);
+  GaussianLikelihood lik(NUGGET);
+  PSGP psgp(X, Y, cf, N_ACTIVE);
+  psgp.setVerbose(false);
+  psgp.computePosterior(lik);
+  PSGPSimulator sim(psgp);
+  sim.setEmbeddingPadding(4.0);
+  
+  vec origin1 = "0.0", spacing1 = "0.4";
+  ivec size1 = "25";
+  mat S1 = sim.samplePriorGrid(origin1, spacing1, size1, N_SAMPLES);
+  double err1 = priorCovarianceError(S1, PSGPSimulator::gridLocations(origin1, spacing1, size1), cf);
+  
+  vec origin2 = "1.0 -2.0", spacing2 = "0.5 0.7";
+  ivec size2 = "8 6";
+  mat S2 = sim.samplePriorGrid(origin2, spacing2, size2, N_SAMPLES);
+  double err2 = priorCovarianceError(S2, PSGPSimulator::gridLocations(origin2, spacing2, size2), cf);
+  
+  cout << "(1D " << err1 << ", 2D " << err2 << ") ";
+  
+  // Standard error of the empirical covariance is below 2.0 * sqrt(2/N) = 0.045
+  return err1 < 0.25 && err2 < 0.25;
+}
+
+bool TestPSGPSimulator::testConditionalScattered()
+{
+  mat X;
+  vec Y;
+  generateData(X, Y);
+  
+  GaussianCF cf(1.5, 1.0);
+  GaussianLikelihood lik(NUGGET);
+  PSGP psgp(X, Y, cf, N_ACTIVE);
+  psgp.setVerbose(false);
+  psgp.computePosterior(lik);
+  PSGPSimulator sim(psgp);
+  
+  mat Xpred = 10.0*randu(100, 2);
+  
+  return compareWithPredictions(sim.simulate(Xpred, N_SAMPLES, LocalResidual), psgp, Xpred)
+      && compareWithPredictions(sim.simulate(Xpred, N_SAMPLES, DiagonalResidual), psgp, Xpred);
+}
+
+bool TestPSGPSimulator::testConditionalGrid()
+{
+  mat X;
+  vec Y;
+  generateData(X, Y);
+  
+  vec origin = "0.0 0.0", spacing = "0.5 0.5";
+  ivec size = "21 21";
+  mat Xgrid = PSGPSimulator::gridLocations(origin, spacing, size);
+  
+  // Active set on grid nodes, so that snapping them to the grid is exact
+  ivec iActive(N_ACTIVE);
+  for (int i=0; i<N_ACTIVE; i++) iActive(i) = (i * 97) % Xgrid.rows();
+  
+  GaussianCF cf(1.5, 1.0);
+  GaussianLikelihood lik(NUGGET);
+  PSGP psgp(X, Y, cf, N_ACTIVE);
+  psgp.setVerbose(false);
+  psgp.computePosteriorFixedActiveSet(lik, Xgrid.get_rows(iActive));
+  PSGPSimulator sim(psgp);
+  sim.setEmbeddingPadding(2.0);
+  
+  return compareWithPredictions(sim.simulateGrid(origin, spacing, size, N_SAMPLES), psgp, Xgrid);
+}
+
+bool TestPSGPSimulator::testNegativeEigenvalues()
+{
+  mat X;
+  vec Y;
+  generateData(X, Y);
+  
+  // Range of the same order as the grid, so that the minimal embedding 
+  // is not positive definite
+  GaussianCF cf(10.0, 1.0);
+  GaussianLikelihood lik(NUGGET);
+  PSGP psgp(X, Y, cf, N_ACTIVE);
+  psgp.setVerbose(false);
+  psgp.computePosterior(lik);
+  PSGPSimulator sim(psgp);
+  
+  vec origin = "0.0", spacing = "1.0";
+  ivec size = "33";
+  mat Xgrid = PSGPSimulator::gridLocations(origin, spacing, size);
+  
+  ostringstream warnings;
+  streambuf *cerrBuffer = cerr.rdbuf(warnings.rdbuf());
+  
+  sim.setEmbeddingPadding(1.0);
+  mat S1 = sim.samplePriorGrid(origin, spacing, size, N_SAMPLES);
+  bool warned = (warnings.str().find("not positive definite") != string::npos);
+  
+  warnings.str("");
+  sim.setEmbeddingPadding(8.0);
+  mat S2 = sim.samplePriorGrid(origin, spacing, size, N_SAMPLES);
+  bool warnedPadded = (warnings.str().find("not positive definite") != string::npos);
+  
+  cerr.rdbuf(cerrBuffer);
+  
+  bool finite = true;
+  for (int i=0; i<S1.rows(); i++)
+  {
+    for (int j=0; j<S1.cols(); j++) finite = finite && (S1(i,j) == S1(i,j)) && fabs(S1(i,j)) < 1e10;
+  }
+  
+  double err = priorCovarianceError(S2, Xgrid, cf);
+  cout << "(warning " << warned << ", padded warning " << warnedPadded << ", padded error " << err << ") ";
+  
+  return warned && finite && !warnedPadded && err < 0.25;
+}
+
+/**
+ * Run the tests
+ */
+int main() {
+  TestPSGPSimulator test;
+  test.run();
+}
@@ -0,0 +1,46 @@
+#ifndef TESTPSGPSIMULATOR_H_
+#define TESTPSGPSIMULATOR_H_
+
+#include "Test.h"
+#include "gaussian_processes/PSGPSimulator.h"
+#include "covariance_functions/GaussianCF.h"
+#include "likelihood_models/GaussianLikelihood.h"
+
+#include <sstream>
+
+using namespace std;
+using namespace itpp;
+
+class TestPSGPSimulator : public Test
+{
+public:
+  TestPSGPSimulator();
+  virtual ~TestPSGPSimulator();
+  
+  /**
+   * Test that the empirical covariance of unconditional realisations on a
+   * grid (circulant embedding) matches the covariance function, in 1 and
+   * 2 dimensions
+   */
+  static bool testPriorCovariance();
+  
+  /**
+   * Test that the sample mean and variance of conditional realisations at
+   * scattered locations match the predictions of the PSGP
+   */
+  static bool testConditionalScattered();
+  
+  /**
+   * Same, for conditional realisations on a grid
+   */
+  static bool testConditionalGrid();
+  
+  /**
+   * Test that an embedding with negative eigenvalues gives a warning and 
+   * finite realisations, and that padding the embedding removes the 
+   * warning and gives the right covariance
+   */
+  static bool testNegativeEigenvalues();
+};
+
+#endif /*TESTPSGPSIMULATOR_H_*/
@@ -0,0 +1,167 @@
+#include "TestPSGPSnapshot.h"
+
+#define NUM_READERS   4
+#define NUM_PUBLISHES 2000
+
+namespace
+{
+  /**
+   * State shared between the reader threads and the writer
+   */
+  struct SwapState
+  {
+    PSGPSnapshotHolder *holder;
+    mat Xpred;
+    vec mean[2], var[2];     // Expected predictions for odd/even versions
+    volatile int done;
+    int failures;
+    int reads;
+  };
+
+  /**
+   * Fit a PSGP to a noisy sine, scaled by a and shifted by b
+   */
+  PSGP *fitPSGP(GaussianCF &cf, GaussianLikelihood &lik, double a, double b)
+  {
+    mat X(200, 1);
+    X.set_col(0, linspace(-5.0, 5.0, 200));
+    
+    RNG_reset(0);
+    vec Y = a*sin(X.get_col(0)) + b + 0.1*randn(200);
+    
+    PSGP *psgp = new PSGP(X, Y, cf, 20, 1, 2);
+    psgp->computePosterior(lik);
+    return psgp;
+  }
+}
+
+TestPSGPSnapshot::TestPSGPSnapshot() 
+{
+  header = "Test set for PSGP posterior snapshots";
+  addTest(&testSnapshotPredictions, "Predictions from a PSGP snapshot");
+  addTest(&testConcurrentSwaps, "Concurrent predictions and snapshot swaps");
+}
+
+TestPSGPSnapshot::~TestPSGPSnapshot() {}
+
+/**
+ * Test that predictions from a snapshot match those of the PSGP (over 
+ * several prediction blocks, the last one partial)
+ */
+bool TestPSGPSnapshot::testSnapshotPredictions()
+{
+  GaussianCF cf(1.0, 1.5);
+  GaussianLikelihood lik(0.01);
+  PSGP *psgp = fitPSGP(cf, lik, 1.0, 0.0);
+  
+  int nPred = 2 * PREDICTION_BLOCK_SIZE + 50;
+  mat Xpred(nPred, 1);
+  Xpred.set_col(0, linspace(-6.0, 6.0, nPred));
+  vec mean(nPred), var(nPred), smean, svar;
+  psgp->makePredictions(mean, var, Xpred, cf);
+  
+  bool passed;
+  {
+    PSGPSnapshotHolder holder;
+    holder.publish(new PSGPSnapshot(*psgp, new GaussianCF(1.0, 1.0)));
+    
+    SnapshotReader snapshot(holder);
+    snapshot->makePredictions(smean, svar, Xpred);
+    
+    passed = snapshot->getVersion() == 1 
+          && max(abs(smean - mean)) < 1e-12 && max(abs(svar - var)) < 1e-12;
+  }
+  delete psgp;
+  
+  return passed && PSGPSnapshot::getNumberAlive() == 0;
+}
+
+/**
+ * Stress test: reader threads predict from acquired snapshots while a 
+ * writer keeps publishing new ones. The writer alternates between two 
+ * posteriors, so a reader can check that its predictions match the 
+ * version of the snapshot it holds.
+ */
+bool TestPSGPSnapshot::testConcurrentSwaps()
+{
+  GaussianCF cf(1.0, 1.5);
+  GaussianLikelihood lik(0.01);
+  PSGP *psgp[2];
+  psgp[0] = fitPSGP(cf, lik, 2.0, 1.0);    // Even versions
+  psgp[1] = fitPSGP(cf, lik, 1.0, 0.0);    // Odd versions
+  
+  SwapState state;
+  state.Xpred.set_size(30, 1);
+  state.Xpred.set_col(0, linspace(-6.0, 6.0, 30));
+  for (int i=0; i<2; i++) 
+  {
+    state.mean[i].set_size(30);
+    state.var[i].set_size(30);
+    psgp[i]->makePredictions(state.mean[i], state.var[i], state.Xpred, cf);
+  }
+  state.holder = new PSGPSnapshotHolder();
+  state.done = 0;
+  state.failures = 0;
+  state.reads = 0;
+  
+  state.holder->publish(new PSGPSnapshot(*psgp[1], new GaussianCF(1.0, 1.0)));
+  
+  pthread_t readers[NUM_READERS];
+  for (int i=0; i<NUM_READERS; i++) 
+    pthread_create(&readers[i], NULL, &reader, &state);
+  
+  for (int i=2; i<=NUM_PUBLISHES; i++) 
+    state.holder->publish(new PSGPSnapshot(*psgp[i%2], new GaussianCF(1.0, 1.0)));
+  
+  __sync_lock_test_and_set(&state.done, 1);
+  for (int i=0; i<NUM_READERS; i++) pthread_join(readers[i], NULL);
+  
+  bool passed = state.failures == 0 && state.holder->getVersion() == NUM_PUBLISHES
+             && PSGPSnapshot::getNumberAlive() == 1;
+  
+  delete state.holder;
+  delete psgp[0];
+  delete psgp[1];
+  
+  cout << state.reads << " reads, " << state.failures << " failures, " 
+       << PSGPSnapshot::getNumberAlive() << " snapshots left" << endl;
+  
+  return passed && PSGPSnapshot::getNumberAlive() == 0;
+}
+
+/**
+ * Reader thread: acquire the current snapshot, predict and check the 
+ * predictions against those expected for its version
+ */
+void *TestPSGPSnapshot::reader(void *arg)
+{
+  SwapState *state = (SwapState *) arg;
+  vec mean, var;
+  int lastVersion = 0;
+  
+  while (!__sync_add_and_fetch(&state->done, 0)) 
+  {
+    SnapshotReader snapshot(*state->holder);
+    int version = snapshot->getVersion();
+    snapshot->makePredictions(mean, var, state->Xpred);
+    
+    int k = version % 2;
+    if (version < lastVersion 
+        || max(abs(mean - state->mean[k])) > 1e-12 
+        || max(abs(var - state->var[k])) > 1e-12) 
+      __sync_add_and_fetch(&state->failures, 1);
+    
+    lastVersion = version;
+    __sync_add_and_fetch(&state->reads, 1);
+  }
+  
+  return NULL;
+}
+
+/**
+ * Run the tests
+ */
+int main() {
+  TestPSGPSnapshot test;
+  test.run();
+}
@@ -0,0 +1,37 @@
+#ifndef TESTPSGPSNAPSHOT_H_
+#define TESTPSGPSNAPSHOT_H_
+
+#include "Test.h"
+#include "gaussian_processes/PSGP.h"
+#include "gaussian_processes/PSGPSnapshot.h"
+#include "covariance_functions/GaussianCF.h"
+#include "likelihood_models/GaussianLikelihood.h"
+
+#include <pthread.h>
+
+using namespace std;
+using namespace itpp;
+
+class TestPSGPSnapshot : public Test
+{
+public:
+  TestPSGPSnapshot();
+  virtual ~TestPSGPSnapshot();
+  
+  /**
+   * Test that predictions from a snapshot match those of the PSGP
+   */
+  static bool testSnapshotPredictions();
+  
+  /**
+   * Stress test: reader threads predict from acquired snapshots while a 
+   * writer keeps publishing new ones. Checks that each reader sees a 
+   * consistent snapshot and that all snapshots are reclaimed.
+   */
+  static bool testConcurrentSwaps();
+  
+private:
+  static void *reader(void *arg);
+};
+
+#endif /*TESTPSGPSNAPSHOT_H_*/
@@ -0,0 +1,133 @@
+#include "TestRandomFeatureGP.h"
+
+#define N_OBS   200
+#define N_GRAM  30
+#define NUGGET  0.05
+
+namespace
+{
+  void makeData(mat &X, vec &Y)
+  {
+    RNG_reset(0);
+    X = 5.0 * randu(N_OBS, 2);
+    Y.set_size(N_OBS);
+    for (int i=0; i<N_OBS; i++) Y(i) = sin(X(i,0)) * cos(X(i,1)) + sqrt(NUGGET)*randn();
+  }
+  
+  /**
+   * Maximum difference between the covariance matrix of X and the Gram 
+   * matrix of the random features for nFrequencies frequencies sampled 
+   * from the spectral density of cf (features as in RandomFeatureGP)
+   */
+  double gramError(StationaryCF &cf, const mat &X, int nFrequencies)
+  {
+    mat W;
+    cf.sampleSpectralDensity(W, nFrequencies, X.cols());
+    
+    double lengthScale = cf.getParameter(0);
+    double amplitude = sqrt(cf.getParameter(1) / nFrequencies);
+    mat Theta = X * W.transpose() / lengthScale;
+    
+    mat Phi(X.rows(), 2 * nFrequencies);
+    for (int i=0; i<X.rows(); i++)
+    {
+      for (int k=0; k<nFrequencies; k++)
+      {
+        Phi(i, k) = amplitude * cos(Theta(i, k));
+        Phi(i, nFrequencies + k) = amplitude * sin(Theta(i, k));
+      }
+    }
+    
+    mat K(X.rows(), X.rows());
+    cf.covariance(K, X);
+    
+    return max(max(abs(Phi * Phi.transpose() - K)));
+  }
+}
+
+TestRandomFeatureGP::TestRandomFeatureGP() 
+{
+  header = "Test set for random feature GP regression";
+  addTest(&testFeatureGram, "Gram matrix of the features against the covariance");
+  addTest(&testGradient, "Gradient of the marginal likelihood against finite differences");
+}
+
+TestRandomFeatureGP::~TestRandomFeatureGP() {}
+
+bool TestRandomFeatureGP::testFeatureGram()
+{
+  GaussianCF    gaussian(1.3, 1.5);
+  ExponentialCF exponential(1.3, 1.5);
+  Matern3CF     matern3(1.5, 1.3);
+  Matern5CF     matern5(1.5, 1.3);
+  
+  cout << endl;
+  bool ok = featureGram(gaussian, "Gaussian");
+  ok = featureGram(exponential, "Exponential") && ok;
+  ok = featureGram(matern3, "Matern 3/2") && ok;
+  ok = featureGram(matern5, "Matern 5/2") && ok;
+  cout << "  ";
+  
+  return ok;
+}
+
+bool TestRandomFeatureGP::featureGram(StationaryCF &cf, string name)
+{
+  RNG_reset(1);
+  mat X = 3.0 * randu(N_GRAM, 2);
+  
+  // The error of each entry decreases as 1/sqrt(F), with a standard 
+  // deviation below variance/sqrt(2F)
+  int F[3] = { 100, 2000, 40000 };
+  vec err(3);
+  for (int j=0; j<3; j++) err(j) = gramError(cf, X, F[j]);
+  
+  cout << "  " << name << ": max error " << err(0) << ", " << err(1) 
+       << ", " << err(2) << " for " << F[0] << ", " << F[1] << ", " << F[2] << " frequencies" << endl;
+  
+  return err(2) < err(0) && err(2) < 0.05;
+}
+
+bool TestRandomFeatureGP::testGradient()
+{
+  mat X;
+  vec Y;
+  makeData(X, Y);
+  
+  GaussianCF cf(1.2, 1.0);
+  RandomFeatureGP rfgp(2, 1, X, Y, cf, 100, NUGGET);
+  
+  vec params = rfgp.getTransformedParameters();
+  vec grad = rfgp.gradient();
+  double h = 1e-6, maxError = 0.0;
+  
+  printf("\n  Param   Analytic   Fin.diff.  Rel.error\n");
+  for (int i=0; i<params.size(); i++)
+  {
+    vec p = params;
+    p(i) = params(i) + h;
+    rfgp.setTransformedParameters(p);
+    double f1 = rfgp.objective();
+    p(i) = params(i) - h;
+    rfgp.setTransformedParameters(p);
+    double f2 = rfgp.objective();
+    
+    double fd = (f1 - f2) / (2.0 * h);
+    double err = abs(grad(i) - fd) / (1.0 + abs(fd));
+    if (err > maxError) maxError = err;
+    
+    printf("  %3d: %10.5f %10.5f %10.5f\n", i, grad(i), fd, err);
+  }
+  rfgp.setTransformedParameters(params);
+  cout << "  ";
+  
+  return maxError < 1e-4;
+}
+
+/**
+ * Run the tests
+ */
+int main() {
+  TestRandomFeatureGP test;
+  test.run();
+}
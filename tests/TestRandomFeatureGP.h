@@ -0,0 +1,38 @@
+#ifndef TESTRANDOMFEATUREGP_H_
+#define TESTRANDOMFEATUREGP_H_
+
+#include "Test.h"
+#include "gaussian_processes/RandomFeatureGP.h"
+#include "covariance_functions/GaussianCF.h"
+#include "covariance_functions/ExponentialCF.h"
+#include "covariance_functions/Matern3CF.h"
+#include "covariance_functions/Matern5CF.h"
+
+using namespace std;
+using namespace itpp;
+
+class TestRandomFeatureGP : public Test
+{
+public:
+  TestRandomFeatureGP();
+  virtual ~TestRandomFeatureGP();
+  
+  /**
+   * Test that the Gram matrix of the random features approaches the 
+   * covariance matrix as the number of frequencies grows, for each 
+   * covariance function with a spectral density (Gaussian, and the 
+   * Student t sampler of the exponential, Matern 3/2 and 5/2)
+   */
+  static bool testFeatureGram();
+  
+  /**
+   * Test the gradient of the marginal likelihood against finite 
+   * differences
+   */
+  static bool testGradient();
+
+private:
+  static bool featureGram(StationaryCF &cf, string name);
+};
+
+#endif /*TESTRANDOMFEATUREGP_H_*/
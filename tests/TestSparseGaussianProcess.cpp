@@ -0,0 +1,131 @@
+#include "TestSparseGaussianProcess.h"
+
+#define N_OBS      60
+#define N_INDUCING 15
+#define N_PRED     30
+#define NUGGET     0.05
+
+namespace
+{
+  void makeData(mat &X, vec &Y)
+  {
+    RNG_reset(0);
+    X = 5.0 * randu(N_OBS, 2);
+    Y.set_size(N_OBS);
+    for (int i=0; i<N_OBS; i++) Y(i) = sin(X(i,0)) * cos(X(i,1)) + sqrt(NUGGET)*randn();
+  }
+}
+
+TestSparseGaussianProcess::TestSparseGaussianProcess() 
+{
+  header = "Test set for sparse GP regression";
+  addTest(&testLikelihoodMatchesExact, "Likelihood and predictions against the exact GP");
+  addTest(&testGradientVFE, "Gradient of the VFE objective against finite differences");
+  addTest(&testGradientFITC, "Gradient of the FITC objective against finite differences");
+}
+
+TestSparseGaussianProcess::~TestSparseGaussianProcess() {}
+
+bool TestSparseGaussianProcess::testLikelihoodMatchesExact()
+{
+  mat X;
+  vec Y;
+  makeData(X, Y);
+  
+  GaussianCF   kernel(1.2, 1.0);
+  WhiteNoiseCF nugget(NUGGET);
+  SumCF        cf(kernel);
+  cf.add(nugget);
+  
+  GaussianProcess gp(2, 1, X, Y, cf);
+  
+  // Latent predictions (noise-free covariance) of the exact GP
+  mat Xpred = 5.0 * randu(N_PRED, 2);
+  vec mean1(N_PRED), var1(N_PRED);
+  gp.makePredictions(mean1, var1, Xpred, kernel);
+  
+  bool passed = true;
+  for (int a = 0; a < 2; a++)
+  {
+    SparseApproximation approx = (a == 0) ? SPARSE_APPROX_VFE : SPARSE_APPROX_FITC;
+    
+    // Several chunks, the last one partial
+    SparseGaussianProcess sgp(2, 1, X, Y, kernel, X, NUGGET, approx);
+    sgp.setChunkSize(25);
+    
+    vec mean2(N_PRED), var2(N_PRED);
+    sgp.makePredictions(mean2, var2, Xpred);
+    double errLik = abs(gp.objective() - sgp.objective());
+    
+    cout << endl << "  " << ((a == 0) ? "VFE: " : "FITC:") << " likelihood error " << errLik 
+         << ", mean error " << max(abs(mean1 - mean2)) << ", variance error " << max(abs(var1 - var2));
+    
+    // Up to the jitter added to Kuu
+    passed = passed && errLik < 1e-4 && max(abs(mean1 - mean2)) < 1e-4 && max(abs(var1 - var2)) < 1e-4;
+  }
+  cout << endl << "  ";
+  
+  return passed;
+}
+
+bool TestSparseGaussianProcess::testGradientVFE()
+{
+  return gradCheck(SPARSE_APPROX_VFE);
+}
+
+bool TestSparseGaussianProcess::testGradientFITC()
+{
+  return gradCheck(SPARSE_APPROX_FITC);
+}
+
+bool TestSparseGaussianProcess::gradCheck(SparseApproximation approx)
+{
+  mat X;
+  vec Y;
+  makeData(X, Y);
+  
+  GaussianCF kernel(1.2, 1.0);
+  SparseGaussianProcess sgp(2, 1, X, Y, kernel, X.get_rows(0, N_INDUCING - 1), NUGGET, approx);
+  sgp.setChunkSize(25);
+  sgp.setOptimiseInducingInputs(true);
+  
+  vec params = sgp.getTransformedParameters();
+  vec grad = sgp.gradient();
+  int nKernel = kernel.getNumberParameters();
+  double h = 1e-6, tolerance = 1e-4, maxInducing = 0.0, maxError = 0.0;
+  
+  printf("\n  Param   Analytic   Fin.diff.  Rel.error  Parameter name\n");
+  for (int i=0; i<params.size(); i++)
+  {
+    vec p = params;
+    p(i) = params(i) + h;
+    sgp.setTransformedParameters(p);
+    double f1 = sgp.objective();
+    p(i) = params(i) - h;
+    sgp.setTransformedParameters(p);
+    double f2 = sgp.objective();
+    
+    double fd = (f1 - f2) / (2.0 * h);
+    double err = abs(grad(i) - fd) / (1.0 + abs(fd));
+    if (err > maxError) maxError = err;
+    
+    if (i < nKernel) 
+      printf("  %3d: %10.5f %10.5f %10.5f   %s\n", i, grad(i), fd, err, (kernel.getParameterName(i)).c_str());
+    else if (i == nKernel)
+      printf("  %3d: %10.5f %10.5f %10.5f   %s\n", i, grad(i), fd, err, "log noise variance");
+    else if (err > maxInducing) 
+      maxInducing = err;
+  }
+  printf("  Max relative error over the inducing inputs: %10.5f\n  ", maxInducing);
+  sgp.setTransformedParameters(params);
+  
+  return maxError < tolerance;
+}
+
+/**
+ * Run the tests
+ */
+int main() {
+  TestSparseGaussianProcess test;
+  test.run();
+}
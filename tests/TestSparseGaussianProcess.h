@@ -0,0 +1,44 @@
+#ifndef TESTSPARSEGAUSSIANPROCESS_H_
+#define TESTSPARSEGAUSSIANPROCESS_H_
+
+#include "Test.h"
+#include "gaussian_processes/GaussianProcess.h"
+#include "gaussian_processes/SparseGaussianProcess.h"
+#include "covariance_functions/GaussianCF.h"
+#include "covariance_functions/WhiteNoiseCF.h"
+#include "covariance_functions/SumCF.h"
+
+using namespace std;
+using namespace itpp;
+
+class TestSparseGaussianProcess : public Test
+{
+public:
+  TestSparseGaussianProcess();
+  virtual ~TestSparseGaussianProcess();
+  
+  /**
+   * Test that, with the observations as inducing inputs, the VFE and FITC
+   * likelihoods and predictions match those of the exact GP
+   */
+  static bool testLikelihoodMatchesExact();
+  
+  /**
+   * Test the gradient of the VFE and FITC objectives (covariance 
+   * parameters, noise variance and inducing inputs) against finite 
+   * differences
+   */
+  static bool testGradientVFE();
+  static bool testGradientFITC();
+  
+  /**
+   * Computes the error between the analytic gradient of the objective and
+   * a central finite differences estimate, for the given approximation. 
+   * The error for each covariance parameter and the noise variance, and 
+   * the max error over the inducing inputs, are displayed. Returns true if
+   * all relative errors are below a fixed tolerance (1e-4).
+   */
+  static bool gradCheck(SparseApproximation approx);
+};
+
+#endif /*TESTSPARSEGAUSSIANPROCESS_H_*/